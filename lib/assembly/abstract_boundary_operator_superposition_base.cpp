@@ -428,7 +428,7 @@ assembleJointOperatorWeakFormInAcaMode(
         nonlocalPart.reset(
                     AcaGlobalAssembler<BasisFunctionType, ResultType>::
                     assembleDetachedWeakForm(
-                        *this->dualToRange(), *this->domain(),
+                        this->dualToRange(), this->domain(),
                         stlAssemblersForNonlocalTerms,
                         stlSparseDiscreteTerms,
                         nonlocalOpWeights,
@@ -29,15 +29,215 @@
 #include "discrete_aca_boundary_operator.hpp"
 
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/thread_pool.hpp"
+
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 #ifdef WITH_TRILINOS
-#include <Thyra_DetachedSpmdVectorView.hpp>
 #include <Thyra_SpmdVectorSpaceDefaultBase.hpp>
 #endif
 
 namespace Bempp
 {
 
+namespace
+{
+
+// Return the blocks of a H-matrix converted to the type used during its LU
+// factorization. Generic version: no conversion needed.
+template <typename AhmedValueType>
+boost::shared_array<mblock<AhmedValueType>*> blocksForFactorization(
+        const blcluster* /* blockCluster */,
+        const boost::shared_array<mblock<AhmedValueType>*>& blocks)
+{
+    return blocks;
+}
+
+// Single-precision complex blocks are converted to double precision. The
+// converted copy only lives until the factorization is complete.
+boost::shared_array<mblock<dcomp>*> blocksForFactorization(
+        const blcluster* blockCluster,
+        const boost::shared_array<mblock<scomp>*>& blocks)
+{
+    const size_t blockCount = blockCluster->nleaves();
+    boost::shared_array<mblock<dcomp>*> result =
+            allocateAhmedMblockArray<std::complex<double> >(blockCount);
+    for (size_t b = 0; b < blockCount; ++b)
+        result[b] = convertMblock<std::complex<double>, std::complex<float> >(
+                    blocks[b]);
+    return result;
+}
+
+// Minimum number of rows of an off-diagonal block of the LU factors whose
+// product with a vector is split between several tasks
+const unsigned int MIN_PARALLEL_BLOCK_ROW_COUNT = 512;
+
+template <typename ValueType>
+void multiplyAddBlock(
+        ValueType multiplier, blcluster* bl,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks,
+        typename AhmedTypeTraits<ValueType>::Type* x,
+        typename AhmedTypeTraits<ValueType>::Type* y);
+
+/** \brief Body of the parallel loop adding the contributions of the block
+ *  rows of a H-matrix block to a vector. */
+template <typename ValueType>
+class BlockRowProductLoopBody
+{
+public:
+    typedef typename AhmedTypeTraits<ValueType>::Type AhmedValueType;
+
+    BlockRowProductLoopBody(ValueType multiplier, blcluster* bl,
+                            mblock<AhmedValueType>** blocks,
+                            AhmedValueType* x, AhmedValueType* y) :
+        m_multiplier(multiplier), m_bl(bl), m_blocks(blocks), m_x(x), m_y(y) {
+    }
+
+    void operator() (const tbb::blocked_range<unsigned int>& r) const {
+        for (unsigned int rs = r.begin(); rs != r.end(); ++rs)
+            for (unsigned int cs = 0; cs < m_bl->getncs(); ++cs)
+                if (blcluster* son = m_bl->getson(rs, cs))
+                    multiplyAddBlock(m_multiplier, son, m_blocks, m_x, m_y);
+    }
+
+private:
+    ValueType m_multiplier;
+    blcluster* m_bl;
+    mblock<AhmedValueType>** m_blocks;
+    AhmedValueType* m_x;
+    // mutable OK because each block row writes to a separate part of m_y
+    AhmedValueType* m_y;
+};
+
+// Compute y += multiplier * A x, where A is the block bl of a H-matrix and
+// x and y are full-length vectors. Block rows are processed in parallel.
+template <typename ValueType>
+void multiplyAddBlock(
+        ValueType multiplier, blcluster* bl,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocks,
+        typename AhmedTypeTraits<ValueType>::Type* x,
+        typename AhmedTypeTraits<ValueType>::Type* y)
+{
+    if (bl->isleaf() || bl->getn1() < MIN_PARALLEL_BLOCK_ROW_COUNT)
+        mltaGeHVec(ahmedCast(multiplier), bl, blocks, x, y);
+    else
+        tbb::parallel_for(tbb::blocked_range<unsigned int>(0, bl->getnrs()),
+                          BlockRowProductLoopBody<ValueType>(
+                              multiplier, bl, blocks, x, y));
+}
+
+// Solve the system L x = b, where L is the diagonal block bl of the lower
+// triangular LU factor, overwriting b with x (a full-length vector). The
+// diagonal sons are processed in order; the updates of the remaining
+// unknowns by the off-diagonal blocks are multithreaded.
+template <typename ValueType>
+void solveLowerTriangular(
+        blcluster* bl,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocksL,
+        typename AhmedTypeTraits<ValueType>::Type* x)
+{
+    if (bl->isleaf()) {
+        blocksL[bl->getidx()]->ltr_solve(1, x + bl->getb1(), bl->getn1());
+        return;
+    }
+    const unsigned int sonCount = bl->getnrs();
+    for (unsigned int i = 0; i < sonCount; ++i) {
+        solveLowerTriangular<ValueType>(bl->getson(i, i), blocksL, x);
+        for (unsigned int j = i + 1; j < sonCount; ++j)
+            if (blcluster* son = bl->getson(j, i))
+                multiplyAddBlock(static_cast<ValueType>(-1.), son, blocksL,
+                                 x, x);
+    }
+}
+
+// Solve the system U x = b, where U is the diagonal block bl of the upper
+// triangular LU factor, overwriting b with x (a full-length vector)
+template <typename ValueType>
+void solveUpperTriangular(
+        blcluster* bl,
+        mblock<typename AhmedTypeTraits<ValueType>::Type>** blocksU,
+        typename AhmedTypeTraits<ValueType>::Type* x)
+{
+    if (bl->isleaf()) {
+        blocksU[bl->getidx()]->utr_solve(1, x + bl->getb1(), bl->getn1());
+        return;
+    }
+    const unsigned int sonCount = bl->getnrs();
+    for (unsigned int i = sonCount; i-- > 0; ) {
+        solveUpperTriangular<ValueType>(bl->getson(i, i), blocksU, x);
+        for (unsigned int j = 0; j < i; ++j)
+            if (blcluster* son = bl->getson(j, i))
+                multiplyAddBlock(static_cast<ValueType>(-1.), son, blocksU,
+                                 x, x);
+    }
+}
+
+// Solve the system LU x = b, overwriting b with x. This does the same as
+// AHMED's HLU_solve(), but multithreaded.
+template <typename ValueType>
+void hluSolve(blcluster* blockCluster,
+              mblock<typename AhmedTypeTraits<ValueType>::Type>** blocksL,
+              mblock<typename AhmedTypeTraits<ValueType>::Type>** blocksU,
+              arma::Col<ValueType>& b)
+{
+    solveLowerTriangular<ValueType>(blockCluster, blocksL, ahmedCast(b.memptr()));
+    solveUpperTriangular<ValueType>(blockCluster, blocksU, ahmedCast(b.memptr()));
+}
+
+// Single-precision complex vectors are solved for in double precision
+void hluSolve(blcluster* blockCluster,
+              mblock<dcomp>** blocksL, mblock<dcomp>** blocksU,
+              arma::Col<std::complex<float> >& b)
+{
+    arma::Col<std::complex<double> > doubleB(b.n_rows);
+    std::copy(b.begin(), b.end(), doubleB.begin());
+    hluSolve(blockCluster, blocksL, blocksU, doubleB);
+    for (size_t i = 0; i < b.n_rows; ++i)
+        b[i] = std::complex<float>(doubleB[i]);
+}
+
+/** \brief Body of the parallel loop applying an operator to individual
+ *  columns of a matrix. */
+template <typename ValueType>
+class ColumnApplyLoopBody
+{
+public:
+    ColumnApplyLoopBody(const DiscreteBoundaryOperator<ValueType>& op,
+                        const arma::Mat<ValueType>& x_in,
+                        arma::Mat<ValueType>& y_inout,
+                        ValueType alpha, ValueType beta) :
+        m_op(op), m_x_in(x_in), m_y_inout(y_inout),
+        m_alpha(alpha), m_beta(beta) {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t col = r.begin(); col != r.end(); ++col) {
+            // const_cast because it's more natural to have
+            // a const arma::Col<ValueType> array than
+            // an arma::Col<const ValueType> one.
+            const arma::Col<ValueType> xCol(
+                        const_cast<ValueType*>(m_x_in.colptr(col)),
+                        m_x_in.n_rows, false /* copy_aux_mem */);
+            arma::Col<ValueType> yCol(m_y_inout.colptr(col),
+                                      m_y_inout.n_rows, false);
+            m_op.apply(NO_TRANSPOSE, xCol, yCol, m_alpha, m_beta);
+        }
+    }
+
+private:
+    const DiscreteBoundaryOperator<ValueType>& m_op;
+    const arma::Mat<ValueType>& m_x_in;
+    // mutable OK because each column is written by a single thread
+    arma::Mat<ValueType>& m_y_inout;
+    ValueType m_alpha;
+    ValueType m_beta;
+};
+
+} // namespace
+
 template <typename ValueType>
 AcaApproximateLuInverse<ValueType>::AcaApproximateLuInverse(
         const DiscreteAcaBoundaryOperator<ValueType>& fwdOp,
@@ -51,11 +251,14 @@ AcaApproximateLuInverse<ValueType>::AcaApproximateLuInverse(
 #endif
     m_blockCluster(0), m_blocksL(0), m_blocksU(0),
     m_domainPermutation(fwdOp.m_rangePermutation),
-    m_rangePermutation(fwdOp.m_domainPermutation)
+    m_rangePermutation(fwdOp.m_domainPermutation),
+    m_parallelizationOptions(fwdOp.m_parallelizationOptions)
 {
     const blcluster* fwdBlockCluster = fwdOp.m_blockCluster.get();
+    boost::shared_array<AhmedFactorMblock*> fwdBlocks =
+            blocksForFactorization(fwdBlockCluster, fwdOp.m_blocks);
     bool result = genLUprecond(const_cast<blcluster*>(fwdBlockCluster),
-                               fwdOp.m_blocks.get(),
+                               fwdBlocks.get(),
                                delta, fwdOp.m_maximumRank,
                                m_blockCluster, m_blocksL, m_blocksU, true);
     if (!result)
@@ -64,29 +267,6 @@ AcaApproximateLuInverse<ValueType>::AcaApproximateLuInverse(
                 "Approximate LU factorisation failed");
 }
 
-template <>
-AcaApproximateLuInverse<std::complex<float> >::AcaApproximateLuInverse(
-        const DiscreteAcaBoundaryOperator<std::complex<float> >& fwdOp,
-        MagnitudeType delta) :
-    // All range-domain swaps intended!
-#ifdef WITH_TRILINOS
-    m_domainSpace(fwdOp.m_rangeSpace),
-    m_rangeSpace(fwdOp.m_domainSpace),
-#else
-    m_rowCount(fwdOp.columnCount()), m_columnCount(fwdOp.rowCount()),
-#endif
-    m_blockCluster(0), m_blocksL(0), m_blocksU(0),
-    m_domainPermutation(fwdOp.m_rangePermutation),
-    m_rangePermutation(fwdOp.m_domainPermutation)
-{
-    // Ahmed doesn't define the genLUprecond() variant with
-    // the second parameter of type mblock<scomp>**
-    throw std::runtime_error(
-                "AcaApproximateLuInverse::AcaApproximateLuInverse(): "
-                "due to a deficiency in Ahmed approximate LU factorisation "
-                "of single-precision complex H matrices is not supported");
-}
-
 template <typename ValueType>
 AcaApproximateLuInverse<ValueType>::~AcaApproximateLuInverse()
 {
@@ -151,48 +331,6 @@ bool AcaApproximateLuInverse<ValueType>::opSupportedImpl(
     return (M_trans == Thyra::NOTRANS);
 }
 
-template <typename ValueType>
-void AcaApproximateLuInverse<ValueType>::applyImpl(
-        const Thyra::EOpTransp M_trans,
-        const Thyra::MultiVectorBase<ValueType>& X_in,
-        const Teuchos::Ptr<Thyra::MultiVectorBase<ValueType> >& Y_inout,
-        const ValueType alpha,
-        const ValueType beta) const
-{
-    typedef Thyra::Ordinal Ordinal;
-
-    // Note: the name is VERY misleading: these asserts don't disappear in
-    // release runs, and in case of failure throw exceptions rather than
-    // abort.
-    TEUCHOS_ASSERT(this->opSupported(M_trans));
-    TEUCHOS_ASSERT(X_in.range()->isCompatible(*this->domain()));
-    TEUCHOS_ASSERT(Y_inout->range()->isCompatible(*this->range()));
-    TEUCHOS_ASSERT(Y_inout->domain()->isCompatible(*X_in.domain()));
-
-    const Ordinal colCount = X_in.domain()->dim();
-
-    // Loop over the input columns
-
-    for (Ordinal col = 0; col < colCount; ++col) {
-        // Get access the the elements of column col
-        Thyra::ConstDetachedSpmdVectorView<ValueType> xVec(X_in.col(col));
-        Thyra::DetachedSpmdVectorView<ValueType> yVec(Y_inout->col(col));
-        const Teuchos::ArrayRCP<const ValueType> xArray(xVec.sv().values());
-        const Teuchos::ArrayRCP<ValueType> yArray(yVec.sv().values());
-
-        // const_cast because it's more natural to have
-        // a const arma::Col<ValueType> array than
-        // an arma::Col<const ValueType> one.
-        const arma::Col<ValueType> xCol(
-                    const_cast<ValueType*>(xArray.get()), xArray.size(),
-                    false /* copy_aux_mem */);
-        arma::Col<ValueType> yCol(yArray.get(), yArray.size(), false);
-
-        applyBuiltInImpl(static_cast<TranspositionMode>(M_trans),
-                         xCol, yCol, alpha, beta);
-    }
-}
-
 #endif // WITH_TRILINOS
 
 template <typename ValueType>
@@ -207,7 +345,7 @@ applyBuiltInImpl(const TranspositionMode trans,
         throw std::runtime_error(
                 "AcaApproximateLuInverse::applyBuiltInImpl(): "
                 "transposition modes other than NO_TRANSPOSE are not supported");
-    if (columnCount() != x_in.n_rows && rowCount() != y_inout.n_rows)
+    if (columnCount() != x_in.n_rows || rowCount() != y_inout.n_rows)
         throw std::invalid_argument(
                 "AcaApproximateLuInverse::applyBuiltInImpl(): "
                 "incorrect vector length");
@@ -221,13 +359,48 @@ applyBuiltInImpl(const TranspositionMode trans,
     arma::Col<ValueType> permuted;
     m_domainPermutation.permuteVector(x_in, permuted);
 
-    HLU_solve(m_blockCluster, m_blocksL, m_blocksU, ahmedCast(permuted.memptr()));
+    Fiber::ScopedScheduler scheduler(m_parallelizationOptions);
+    {
+        Fiber::SerialBlasRegion region;
+        solve(permuted);
+    }
 
     arma::Col<ValueType> operatorActionResult;
     m_rangePermutation.unpermuteVector(permuted, operatorActionResult);
     y_inout += alpha * operatorActionResult;
 }
 
+template <typename ValueType>
+void AcaApproximateLuInverse<ValueType>::
+applyBuiltInImpl(const TranspositionMode trans,
+                 const arma::Mat<ValueType>& x_in,
+                 arma::Mat<ValueType>& y_inout,
+                 const ValueType alpha,
+                 const ValueType beta) const
+{
+    if (trans != NO_TRANSPOSE)
+        throw std::runtime_error(
+                "AcaApproximateLuInverse::applyBuiltInImpl(): "
+                "transposition modes other than NO_TRANSPOSE are not supported");
+
+    // The triangular solves for individual columns are independent; each of
+    // them is multithreaded, too
+    Fiber::ScopedScheduler scheduler(m_parallelizationOptions);
+    {
+        Fiber::SerialBlasRegion region;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, x_in.n_cols, 1),
+                          ColumnApplyLoopBody<ValueType>(
+                              *this, x_in, y_inout, alpha, beta));
+    }
+}
+
+template <typename ValueType>
+void AcaApproximateLuInverse<ValueType>::solve(
+        arma::Col<ValueType>& permuted) const
+{
+    hluSolve(m_blockCluster, m_blocksL, m_blocksU, permuted);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(AcaApproximateLuInverse);
 
 } // namespace Bempp
@@ -29,8 +29,11 @@
 
 #include "ahmed_aux_fwd.hpp"
 #include "index_permutation.hpp"
+#include "../fiber/parallelization_options.hpp"
 #include "../fiber/scalar_traits.hpp"
 
+#include <complex>
+
 #ifdef WITH_TRILINOS
 #include <Thyra_SpmdVectorSpaceBase_decl.hpp>
 #endif
@@ -42,8 +45,38 @@ namespace Bempp
 template <typename ValueType> class DiscreteAcaBoundaryOperator;
 /** \endcond */
 
+/** \cond PRIVATE */
+// Type of the entries of the LU factors of a H-matrix with entries of type
+// ValueType. AHMED cannot factorize single-precision complex H-matrices, so
+// these are factorized in double precision.
+template <typename ValueType>
+struct AcaLuFactorType
+{
+    typedef ValueType Type;
+};
+
+template <>
+struct AcaLuFactorType<std::complex<float> >
+{
+    typedef std::complex<double> Type;
+};
+/** \endcond */
+
 /** \ingroup composite_discrete_operators
  *  \brief Approximate LU decomposition of a H-matrix
+ *
+ *  The factorization is done by AHMED's genLUprecond() and runs serially.
+ *  AHMED does not support single-precision complex H-matrices; these are
+ *  copied to double precision for the duration of the factorization, and
+ *  their LU factors are stored in double precision.
+ *
+ *  The forward and backward substitutions are multithreaded, using the
+ *  parallelization options of the factorized operator. The diagonal blocks
+ *  of the block cluster tree are processed in order, while the products of
+ *  large off-diagonal blocks with the partial solution are split between
+ *  their block rows. When the operator is applied to several vectors at
+ *  once, e.g. by a block Krylov solver, the solves for individual vectors
+ *  are run in parallel, too.
  */
 template <typename ValueType>
 class AcaApproximateLuInverse : public DiscreteBoundaryOperator<ValueType>
@@ -77,12 +110,6 @@ public:
 
 protected:
     virtual bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
-    virtual void applyImpl(
-            const Thyra::EOpTransp M_trans,
-            const Thyra::MultiVectorBase<ValueType>& X_in,
-            const Teuchos::Ptr<Thyra::MultiVectorBase<ValueType> >& Y_inout,
-            const ValueType alpha,
-            const ValueType beta) const;
 #endif
 
 private:
@@ -91,14 +118,20 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const;
-
-
+    virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                  const arma::Mat<ValueType>& x_in,
+                                  arma::Mat<ValueType>& y_inout,
+                                  const ValueType alpha,
+                                  const ValueType beta) const;
 
 private:
     /** \cond PRIVATE */
     typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
     typedef AhmedDofWrapper<CoordinateType> AhmedDofType;
-    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+    typedef typename AcaLuFactorType<ValueType>::Type FactorType;
+    typedef mblock<typename AhmedTypeTraits<FactorType>::Type> AhmedFactorMblock;
+
+    void solve(arma::Col<ValueType>& permuted) const;
 
 #ifdef WITH_TRILINOS
     Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_domainSpace;
@@ -109,11 +142,12 @@ private:
 #endif
 
     blcluster* m_blockCluster;
-    AhmedMblock** m_blocksL;
-    AhmedMblock** m_blocksU;
+    AhmedFactorMblock** m_blocksL;
+    AhmedFactorMblock** m_blocksU;
 
     IndexPermutation m_domainPermutation;
     IndexPermutation m_rangePermutation;
+    Fiber::ParallelizationOptions m_parallelizationOptions;
     /** \endcond */
 };
 
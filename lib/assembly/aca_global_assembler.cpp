@@ -36,9 +36,11 @@
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/local_assembler_for_operators.hpp"
 #include "../fiber/serial_blas_region.hpp"
+#include "../fiber/thread_pool.hpp"
 #include "../fiber/scalar_traits.hpp"
 #include "../space/space.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
@@ -52,6 +54,7 @@
 #ifdef WITH_AHMED
 #include "ahmed_aux.hpp"
 #include "discrete_aca_boundary_operator.hpp"
+#include "mixed_precision_discrete_boundary_operator.hpp"
 #include "scattered_range.hpp"
 #include "weak_form_aca_assembly_helper.hpp"
 #endif
@@ -119,7 +122,9 @@ public:
                 apprx_unsym(m_helper, m_blocks[cluster->getidx()],
                             cluster, m_options.eps, m_options.maximumRank);
             m_stats[leafClusterIndex].endTime = tbb::tick_count::now();
-            // TODO: recompress
+            // Note: apprx_sym() and apprx_unsym() already truncate the
+            // low-rank factors of each block by SVD (with the same eps and
+            // maximumRank), so there is no need to recompress them here.
             const int HASH_COUNT = 20;
             if (m_verbose)
                 progressbar(std::cout, TEXT, (++m_done) - 1,
@@ -140,6 +145,177 @@ private:
     std::vector<ChunkStatistics>& m_stats;
 };
 
+/** \brief Collect the roots of disjoint subtrees of a block cluster tree
+ *  containing at most \p maxLeafCount leaves each.
+ *
+ *  Subtrees consisting of a single leaf are skipped since they cannot be
+ *  agglomerated. */
+void collectAgglomerationSubtrees(blcluster* bl, size_t maxLeafCount,
+                                  std::vector<blcluster*>& subtrees)
+{
+    if (!bl || bl->isleaf())
+        return;
+    if (bl->nleaves() <= maxLeafCount) {
+        subtrees.push_back(bl);
+        return;
+    }
+    for (unsigned int rs = 0; rs < bl->getnrs(); ++rs)
+        for (unsigned int cs = 0; cs < bl->getncs(); ++cs)
+            collectAgglomerationSubtrees(bl->getson(rs, cs), maxLeafCount,
+                                         subtrees);
+}
+
+bool hasMoreLeaves(const blcluster* bl1, const blcluster* bl2)
+{
+    return bl1->nleaves() > bl2->nleaves();
+}
+
+template <typename ResultType>
+class AgglomerationLoopBody
+{
+    typedef mblock<typename AhmedTypeTraits<ResultType>::Type> AhmedMblock;
+public:
+    AgglomerationLoopBody(const std::vector<blcluster*>& subtrees,
+                          boost::shared_array<AhmedMblock*> blocks,
+                          const AcaOptions& options) :
+        m_subtrees(subtrees), m_blocks(blocks), m_options(options)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        // Each subtree owns a distinct set of leaves, hence of mblocks
+        for (size_t i = r.begin(); i != r.end(); ++i)
+            agglH(m_subtrees[i], m_blocks.get(),
+                  m_options.eps, m_options.maximumRank);
+    }
+
+private:
+    const std::vector<blcluster*>& m_subtrees;
+    boost::shared_array<AhmedMblock*> m_blocks;
+    const AcaOptions& m_options;
+};
+
+/** \brief Agglomerate the nodes of a block cluster tree lying above the
+ *  subtrees already agglomerated by agglomerateInParallel().
+ *
+ *  The tree is traversed bottom-up, as in agglH() itself. A node can only be
+ *  merged into a single low-rank block if all its sons are leaves, so agglH()
+ *  is called only on such nodes; this prevents the (already agglomerated)
+ *  subtrees from being traversed again. */
+template <typename ResultType>
+void agglomerateAboveSubtrees(
+        blcluster* bl,
+        const std::vector<blcluster*>& sortedSubtrees,
+        mblock<typename AhmedTypeTraits<ResultType>::Type>** blocks,
+        const AcaOptions& options)
+{
+    if (!bl || bl->isleaf() ||
+            std::binary_search(sortedSubtrees.begin(), sortedSubtrees.end(), bl))
+        return;
+    bool sonsAreLeaves = true;
+    for (unsigned int rs = 0; rs < bl->getnrs(); ++rs)
+        for (unsigned int cs = 0; cs < bl->getncs(); ++cs) {
+            blcluster* son = bl->getson(rs, cs);
+            if (!son)
+                continue;
+            agglomerateAboveSubtrees<ResultType>(son, sortedSubtrees,
+                                                 blocks, options);
+            if (!son->isleaf())
+                sonsAreLeaves = false;
+        }
+    if (sonsAreLeaves)
+        agglH(bl, blocks, options.eps, options.maximumRank);
+}
+
+/** \brief Agglomerate the blocks of an H-matrix in parallel.
+ *
+ *  The block cluster tree is split into about <tt>8 * threadCount</tt>
+ *  disjoint subtrees, which are then agglomerated concurrently (largest
+ *  first) with AHMED's agglH(). Each call to agglH() modifies only the nodes
+ *  of the subtree it is given and the mblocks belonging to the leaves of
+ *  that subtree, so the concurrent calls do not interfere with each other.
+ *  Finally, the nodes lying above these subtrees are agglomerated serially,
+ *  so that the resulting H-matrix is the same as that produced by a single
+ *  call to agglH() on the whole tree. */
+template <typename ResultType>
+void agglomerateInParallel(
+        blcluster* blockClusterTree,
+        boost::shared_array<mblock<typename AhmedTypeTraits<ResultType>::Type>*> blocks,
+        const AcaOptions& options,
+        int threadCount)
+{
+    if (threadCount <= 1) {
+        agglH(blockClusterTree, blocks.get(),
+              options.eps, options.maximumRank);
+        return;
+    }
+
+    const size_t leafCount = blockClusterTree->nleaves();
+    const size_t maxLeafCount =
+            std::max<size_t>(1, leafCount / (8 * threadCount));
+    std::vector<blcluster*> subtrees;
+    collectAgglomerationSubtrees(blockClusterTree, maxLeafCount, subtrees);
+    std::stable_sort(subtrees.begin(), subtrees.end(), hasMoreLeaves);
+
+    {
+        Fiber::SerialBlasRegion region; // if possible, ensure that BLAS is single-threaded
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, subtrees.size(), 1),
+                          AgglomerationLoopBody<ResultType>(subtrees, blocks,
+                                                            options));
+    }
+
+    // agglH() merges sons into their parent node in place, so the subtree
+    // roots remain valid after the parallel loop
+    std::sort(subtrees.begin(), subtrees.end());
+    agglomerateAboveSubtrees<ResultType>(blockClusterTree, subtrees,
+                                         blocks.get(), options);
+}
+
+/** \brief Convert an assembled H-matrix to single precision (see
+ *  AcaOptions::singlePrecisionStorage).
+ *
+ *  The primary template handles double-precision operators; H-matrices that
+ *  are already stored in single precision are returned unchanged by the
+ *  specialization below. */
+template <typename ResultType,
+          typename SinglePrecisionType =
+              typename Fiber::ScalarTraits<ResultType>::SinglePrecisionType>
+struct SinglePrecisionStorage
+{
+    static std::auto_ptr<DiscreteBoundaryOperator<ResultType> > convert(
+            std::auto_ptr<DiscreteAcaBoundaryOperator<ResultType> > acaOp)
+    {
+#if defined(ENABLE_SINGLE_PRECISION)
+        // The double-precision H-matrix is released as soon as its
+        // single-precision copy is ready
+        shared_ptr<const DiscreteBoundaryOperator<ResultType> > source(
+                    acaOp.release());
+        shared_ptr<const DiscreteBoundaryOperator<SinglePrecisionType> >
+                singlePrecisionOp = singlePrecisionAcaOperator(source);
+        source.reset();
+        return std::auto_ptr<DiscreteBoundaryOperator<ResultType> >(
+                    new MixedPrecisionDiscreteBoundaryOperator<ResultType>(
+                        singlePrecisionOp));
+#else
+        throw std::runtime_error(
+                    "AcaGlobalAssembler::assembleDetachedWeakForm(): "
+                    "storage of H-matrices in single precision requires "
+                    "BEM++ to be compiled with ENABLE_SINGLE_PRECISION");
+#endif
+    }
+};
+
+template <typename ResultType>
+struct SinglePrecisionStorage<ResultType, ResultType>
+{
+    static std::auto_ptr<DiscreteBoundaryOperator<ResultType> > convert(
+            std::auto_ptr<DiscreteAcaBoundaryOperator<ResultType> > acaOp)
+    {
+        return std::auto_ptr<DiscreteBoundaryOperator<ResultType> >(
+                    acaOp.release());
+    }
+};
+
 void reallyGetClusterIds(const cluster& clusterTree,
                          const std::vector<unsigned int>& p2oDofs,
                          std::vector<unsigned int>& clusterIds,
@@ -168,8 +344,8 @@ void getClusterIds(const cluster& clusterTree,
 template <typename BasisFunctionType, typename ResultType>
 std::auto_ptr<DiscreteBoundaryOperator<ResultType> >
 AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
-        const Space<BasisFunctionType>& testSpace,
-        const Space<BasisFunctionType>& trialSpace,
+        const shared_ptr<const Space<BasisFunctionType> >& testSpace,
+        const shared_ptr<const Space<BasisFunctionType> >& trialSpace,
         const std::vector<LocalAssembler*>& localAssemblers,
         const std::vector<const DiscreteBndOp*>& sparseTermsToAdd,
         const std::vector<ResultType>& denseTermsMultipliers,
@@ -213,9 +389,9 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
 #endif // WITH_TRILINOS
 
     const size_t testDofCount = indexWithGlobalDofs ?
-                testSpace.globalDofCount() : testSpace.flatLocalDofCount();
+                testSpace->globalDofCount() : testSpace->flatLocalDofCount();
     const size_t trialDofCount = indexWithGlobalDofs ?
-                trialSpace.globalDofCount() : trialSpace.flatLocalDofCount();
+                trialSpace->globalDofCount() : trialSpace->flatLocalDofCount();
 
     if (symmetric && testDofCount != trialDofCount)
         throw std::invalid_argument("AcaGlobalAssembler::assembleDetachedWeakForm(): "
@@ -225,22 +401,24 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
 
     // o2p: map of original indices to permuted indices
     // p2o: map of permuted indices to original indices
+    // The cluster trees and permutations are cached and shared with other
+    // operators assembled on the same spaces
     typedef ClusterConstructionHelper<BasisFunctionType> CCH;
     shared_ptr<AhmedBemCluster> testClusterTree;
     shared_ptr<IndexPermutation> test_o2pPermutation, test_p2oPermutation;
-    CCH::constructBemCluster(testSpace, indexWithGlobalDofs, acaOptions,
-                             testClusterTree,
-                             test_o2pPermutation, test_p2oPermutation);
+    CCH::getBemCluster(testSpace, indexWithGlobalDofs, acaOptions,
+                       testClusterTree,
+                       test_o2pPermutation, test_p2oPermutation);
     shared_ptr<AhmedBemCluster> trialClusterTree;
     shared_ptr<IndexPermutation> trial_o2pPermutation, trial_p2oPermutation;
-    if (symmetric || &testSpace == &trialSpace) {
+    if (symmetric || testSpace == trialSpace) {
         trialClusterTree = testClusterTree;
         trial_o2pPermutation = test_o2pPermutation;
         trial_p2oPermutation = test_p2oPermutation;
     } else
-        CCH::constructBemCluster(trialSpace, indexWithGlobalDofs, acaOptions,
-                                 trialClusterTree,
-                                 trial_o2pPermutation, trial_p2oPermutation);
+        CCH::getBemCluster(trialSpace, indexWithGlobalDofs, acaOptions,
+                           trialClusterTree,
+                           trial_o2pPermutation, trial_p2oPermutation);
 
 //    // Export VTK plots showing the disctribution of leaf cluster ids
 //    std::vector<unsigned int> testClusterIds;
@@ -258,10 +436,10 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
                   << std::endl;
 
     unsigned int blockCount = 0;
-    shared_ptr<AhmedBemBlcluster> bemBlclusterTree(
-                CCH::constructBemBlockCluster(acaOptions, symmetric,
-                                              *testClusterTree, *trialClusterTree,
-                                              blockCount).release());
+    shared_ptr<AhmedBemBlcluster> bemBlclusterTree =
+            CCH::getBemBlockCluster(testSpace, trialSpace, acaOptions, symmetric,
+                                    testClusterTree, trialClusterTree,
+                                    blockCount);
 
     if (verbosityAtLeastHigh)
         std::cout << "Mblock count: " << blockCount << std::endl;
@@ -271,7 +449,7 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
     std::vector<unsigned int> p2oTrialDofs =
         trial_p2oPermutation->permutedIndices();
     WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>
-        helper(testSpace, trialSpace, p2oTestDofs, p2oTrialDofs,
+        helper(*testSpace, *trialSpace, p2oTestDofs, p2oTrialDofs,
                localAssemblers, sparseTermsToAdd,
                denseTermsMultipliers, sparseTermsMultipliers, options);
 
@@ -314,15 +492,9 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
 
     const ParallelizationOptions& parallelOptions =
             options.parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled())
-    {
-        if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+    const int maxThreadCount =
+            Fiber::ScopedScheduler::requestedThreadCount(parallelOptions);
+    Fiber::ScopedScheduler scheduler(parallelOptions);
     tbb::atomic<size_t> done;
     done = 0;
 
@@ -362,14 +534,20 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
                   << std::endl;
     }
 
-    // TODO: parallelise!
     if (acaOptions.recompress) {
         if (verbosityAtLeastDefault)
             std::cout << "About to start ACA agglomeration" << std::endl;
-        agglH(bemBlclusterTree.get(), blocks.get(),
-              acaOptions.eps, acaOptions.maximumRank);
+        tbb::tick_count agglomerationStart = tbb::tick_count::now();
+        agglomerateInParallel<ResultType>(
+                    bemBlclusterTree.get(), blocks, acaOptions,
+                    maxThreadCount == tbb::task_scheduler_init::automatic ?
+                        tbb::task_scheduler_init::default_num_threads() :
+                        maxThreadCount);
+        tbb::tick_count agglomerationEnd = tbb::tick_count::now();
         if (verbosityAtLeastDefault)
-            std::cout << "Agglomeration finished" << std::endl;
+            std::cout << "Agglomeration took "
+                      << (agglomerationEnd - agglomerationStart).seconds()
+                      << " s" << std::endl;
     }
 
     // // Dump timing data of individual chunks
@@ -432,21 +610,33 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
                                      *test_o2pPermutation,
                                      parallelOptions));
 
+    std::auto_ptr<DiscreteBndOp> storedOp;
+    if (acaOptions.singlePrecisionStorage) {
+        if (verbosityAtLeastDefault)
+            std::cout << "Converting H-matrix to single precision ..."
+                      << std::flush;
+        storedOp = SinglePrecisionStorage<ResultType>::convert(acaOp);
+        if (verbosityAtLeastDefault)
+            std::cout << " done." << std::endl;
+    }
+    else
+        storedOp = acaOp;
+
     std::auto_ptr<DiscreteBndOp> result;
     if (indexWithGlobalDofs)
-        result = acaOp;
+        result = storedOp;
     else {
 #ifdef WITH_TRILINOS
         // without Trilinos, this code will never be reached -- an exception
         // will be thrown earlier in this function
         typedef DiscreteBoundaryOperatorComposition<ResultType> DiscreteBndOpComp;
-        shared_ptr<DiscreteBndOp> acaOpShared(acaOp.release());
+        shared_ptr<DiscreteBndOp> acaOpShared(storedOp.release());
         shared_ptr<DiscreteBndOp> trialGlobalToLocal =
                 constructOperatorMappingGlobalToFlatLocalDofs<
-                BasisFunctionType, ResultType>(trialSpace);
+                BasisFunctionType, ResultType>(*trialSpace);
         shared_ptr<DiscreteBndOp> testLocalToGlobal =
                 constructOperatorMappingFlatLocalToGlobalDofs<
-                BasisFunctionType, ResultType>(testSpace);
+                BasisFunctionType, ResultType>(*testSpace);
         shared_ptr<DiscreteBndOp> tmp(
                     new DiscreteBndOpComp(acaOpShared, trialGlobalToLocal));
         result.reset(new DiscreteBndOpComp(testLocalToGlobal, tmp));
@@ -464,8 +654,8 @@ AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
 template <typename BasisFunctionType, typename ResultType>
 std::auto_ptr<DiscreteBoundaryOperator<ResultType> >
 AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
-        const Space<BasisFunctionType>& testSpace,
-        const Space<BasisFunctionType>& trialSpace,
+        const shared_ptr<const Space<BasisFunctionType> >& testSpace,
+        const shared_ptr<const Space<BasisFunctionType> >& trialSpace,
         LocalAssembler& localAssembler,
         const AssemblyOptions& options,
         int symmetry)
@@ -63,8 +63,8 @@ public:
     typedef Fiber::LocalAssemblerForOperators<ResultType> LocalAssembler;
 
     static std::auto_ptr<DiscreteBndOp> assembleDetachedWeakForm(
-            const Space<BasisFunctionType>& testSpace,
-            const Space<BasisFunctionType>& trialSpace,
+            const shared_ptr<const Space<BasisFunctionType> >& testSpace,
+            const shared_ptr<const Space<BasisFunctionType> >& trialSpace,
             const std::vector<LocalAssembler*>& localAssemblers,
             const std::vector<const DiscreteBndOp*>& sparseTermsToAdd,
             const std::vector<ResultType>& denseTermsMultipliers,
@@ -73,8 +73,8 @@ public:
             int symmetry);
 
     static std::auto_ptr<DiscreteBndOp> assembleDetachedWeakForm(
-            const Space<BasisFunctionType>& testSpace,
-            const Space<BasisFunctionType>& trialSpace,
+            const shared_ptr<const Space<BasisFunctionType> >& testSpace,
+            const shared_ptr<const Space<BasisFunctionType> >& trialSpace,
             LocalAssembler& localAssembler,
             const AssemblyOptions& options,
             int symmetry); // used to be "bool symmetric"; fortunately "true"
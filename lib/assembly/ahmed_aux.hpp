@@ -32,6 +32,8 @@
 
 #include "../common/boost_scoped_array_fwd.hpp"
 #include "../common/boost_shared_array_fwd.hpp"
+#include <algorithm>
+#include <cassert>
 #include <complex>
 #include <iostream>
 #include <memory>
@@ -152,6 +154,44 @@ allocateAhmedMblockArray(const blcluster* cluster)
     return allocateAhmedMblockArray<ValueType>(cluster->nleaves());
 }
 
+/** \brief Return a newly allocated copy of an AHMED matrix block, with
+ *  entries converted from \p SourceValueType to \p TargetValueType.
+ *
+ *  Returns a null pointer if \p block is null. */
+template <typename TargetValueType, typename SourceValueType>
+mblock<typename AhmedTypeTraits<TargetValueType>::Type>* convertMblock(
+        const mblock<typename AhmedTypeTraits<SourceValueType>::Type>* block)
+{
+    typedef mblock<typename AhmedTypeTraits<SourceValueType>::Type>
+            AhmedSourceMblock;
+    typedef mblock<typename AhmedTypeTraits<TargetValueType>::Type>
+            AhmedTargetMblock;
+
+    if (!block)
+        return 0;
+    // AHMED is not const-correct
+    AhmedSourceMblock* source = const_cast<AhmedSourceMblock*>(block);
+    std::auto_ptr<AhmedTargetMblock> target(
+                new AhmedTargetMblock(source->getn1(), source->getn2()));
+    if (source->isLrM())
+        target->setrank(source->rank());
+    else if (source->isHeM())
+        target->setHeM();
+    else if (source->isLtM())
+        target->setLtM();
+    else if (source->isUtM())
+        target->setUtM();
+    else
+        target->setGeM();
+    assert(target->nvals() == source->nvals());
+    // AHMED's complex types are layout-compatible with std::complex
+    const SourceValueType* sourceData =
+            reinterpret_cast<const SourceValueType*>(source->getdata());
+    std::copy(sourceData, sourceData + source->nvals(),
+              reinterpret_cast<TargetValueType*>(target->getdata()));
+    return target.release();
+}
+
 } // namespace Bempp
 
 #endif
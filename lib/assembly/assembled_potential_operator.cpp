@@ -0,0 +1,126 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "assembled_potential_operator.hpp"
+
+#include "discrete_boundary_operator.hpp"
+#include "grid_function.hpp"
+
+#include "../fiber/explicit_instantiation.hpp"
+#include "../space/space.hpp"
+
+#include <stdexcept>
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType, typename ResultType>
+AssembledPotentialOperator<BasisFunctionType, ResultType>::
+AssembledPotentialOperator(
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        const shared_ptr<const arma::Mat<CoordinateType> >& evaluationPoints,
+        const shared_ptr<const DiscreteBoundaryOperator<ResultType> >& op,
+        int componentCount) :
+    m_space(space), m_evaluationPoints(evaluationPoints), m_op(op),
+    m_componentCount(componentCount)
+{
+    if (!m_space || !m_evaluationPoints || !m_op)
+        throw std::invalid_argument(
+                "AssembledPotentialOperator::AssembledPotentialOperator(): "
+                "space, evaluationPoints and op must not be null");
+    if (m_componentCount < 1)
+        throw std::invalid_argument(
+                "AssembledPotentialOperator::AssembledPotentialOperator(): "
+                "componentCount must be positive");
+    if (m_op->columnCount() != m_space->globalDofCount())
+        throw std::invalid_argument(
+                "AssembledPotentialOperator::AssembledPotentialOperator(): "
+                "number of columns of op must match the number of global "
+                "degrees of freedom of space");
+    if (m_op->rowCount() != m_componentCount * m_evaluationPoints->n_cols)
+        throw std::invalid_argument(
+                "AssembledPotentialOperator::AssembledPotentialOperator(): "
+                "number of rows of op must be equal to the number of "
+                "evaluation points times componentCount");
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const Space<BasisFunctionType> >
+AssembledPotentialOperator<BasisFunctionType, ResultType>::space() const
+{
+    return m_space;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const arma::Mat<typename AssembledPotentialOperator<
+BasisFunctionType, ResultType>::CoordinateType> >
+AssembledPotentialOperator<BasisFunctionType, ResultType>::evaluationPoints() const
+{
+    return m_evaluationPoints;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+AssembledPotentialOperator<BasisFunctionType, ResultType>::discreteOperator() const
+{
+    return m_op;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+int AssembledPotentialOperator<BasisFunctionType, ResultType>::componentCount() const
+{
+    return m_componentCount;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType>
+AssembledPotentialOperator<BasisFunctionType, ResultType>::apply(
+        const GridFunction<BasisFunctionType, ResultType>& argument) const
+{
+    if (argument.space() != m_space)
+        throw std::invalid_argument(
+                "AssembledPotentialOperator::apply(): "
+                "argument must be expanded in the space for which the "
+                "operator was assembled");
+    arma::Col<ResultType> values(m_op->rowCount());
+    m_op->apply(NO_TRANSPOSE, argument.coefficients(), values, 1., 0.);
+    return arma::Mat<ResultType>(values.memptr(), m_componentCount,
+                                 m_evaluationPoints->n_cols);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType>
+AssembledPotentialOperator<BasisFunctionType, ResultType>::applyBatch(
+        const arma::Mat<ResultType>& argumentCoefficients) const
+{
+    if (argumentCoefficients.n_rows != m_space->globalDofCount())
+        throw std::invalid_argument(
+                "AssembledPotentialOperator::applyBatch(): "
+                "number of rows of argumentCoefficients must match the "
+                "number of global degrees of freedom of the space for which "
+                "the operator was assembled");
+    arma::Mat<ResultType> values(m_op->rowCount(), argumentCoefficients.n_cols);
+    m_op->apply(NO_TRANSPOSE, argumentCoefficients, values, 1., 0.);
+    return values;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(AssembledPotentialOperator);
+
+} // namespace Bempp
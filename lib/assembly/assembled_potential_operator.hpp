@@ -0,0 +1,147 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_assembled_potential_operator_hpp
+#define bempp_assembled_potential_operator_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/scalar_traits.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+
+namespace Bempp
+{
+
+/** \cond FORWARD_DECL */
+template <typename ValueType> class DiscreteBoundaryOperator;
+template <typename BasisFunctionType, typename ResultType> class GridFunction;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup potential_operators
+ *  \brief Potential operator discretized for a fixed function space and a
+ *  fixed set of evaluation points.
+ *
+ *  An AssembledPotentialOperator stores the matrix mapping the expansion
+ *  coefficients of a charge distribution in a given space to the values of
+ *  its potential at given points. Once it has been constructed (typically by
+ *  PotentialOperator::assemble()), the potentials of any number of charge
+ *  distributions can be obtained by matrix-vector or matrix-matrix
+ *  products, without recalculating the geometrical data, quadrature rules
+ *  and kernel values.
+ *
+ *  The (<tt>i + c * j</tt>, \e k)th element of the matrix, where \e c is the
+ *  number of components of the potential, is the ith component of the
+ *  potential generated at the jth evaluation point by the kth basis
+ *  function of the space.
+ *
+ *  \tparam BasisFunctionType_
+ *    Type of the values of the (components of the) basis functions into
+ *    which functions acted upon by the operator are expanded.
+ *  \tparam ResultType_
+ *    Type of the values of the (components of the) potential. */
+template <typename BasisFunctionType_, typename ResultType_>
+class AssembledPotentialOperator
+{
+public:
+    /** \brief Type of the values of the (components of the) basis functions
+     * into which functions acted upon by the operator are expanded. */
+    typedef BasisFunctionType_ BasisFunctionType;
+    /** \brief Type of the values of the (components of the) potential. */
+    typedef ResultType_ ResultType;
+    /** \brief Type used to represent coordinates. */
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    /** \brief Constructor.
+     *
+     *  \param[in] space
+     *    Space in which the charge distributions are expanded.
+     *  \param[in] evaluationPoints
+     *    2D array whose (i, j)th element is the ith coordinate of the jth
+     *    evaluation point.
+     *  \param[in] op
+     *    Discrete operator mapping the expansion coefficients of a charge
+     *    distribution to the values of its potential, stored as described
+     *    in the documentation of this class.
+     *  \param[in] componentCount
+     *    Number of components of the potential.
+     *
+     *  An exception is thrown if the dimensions of \p op are incompatible
+     *  with \p space, \p evaluationPoints and \p componentCount. */
+    AssembledPotentialOperator(
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const shared_ptr<const arma::Mat<CoordinateType> >& evaluationPoints,
+            const shared_ptr<const DiscreteBoundaryOperator<ResultType> >& op,
+            int componentCount);
+
+    /** \brief Return the space in which the charge distributions are
+     *  expanded. */
+    shared_ptr<const Space<BasisFunctionType> > space() const;
+    /** \brief Return the points at which potentials are evaluated. */
+    shared_ptr<const arma::Mat<CoordinateType> > evaluationPoints() const;
+    /** \brief Return the discrete operator mapping expansion coefficients to
+     *  values of the potential. */
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > discreteOperator() const;
+    /** \brief Return the number of components of the potential. */
+    int componentCount() const;
+
+    /** \brief Evaluate the potential of a given charge distribution.
+     *
+     *  \param[in] argument
+     *    Charge distribution. It must be expanded in the space returned by
+     *    space().
+     *
+     *  \returns A 2D array whose (i, j)th element is the ith component of
+     *  the potential at the jth evaluation point. */
+    arma::Mat<ResultType> apply(
+            const GridFunction<BasisFunctionType, ResultType>& argument) const;
+
+    /** \brief Evaluate the potentials of several charge distributions at
+     *  once.
+     *
+     *  \param[in] argumentCoefficients
+     *    2D array whose kth column contains the expansion coefficients of the
+     *    kth charge distribution in the space returned by space().
+     *
+     *  \returns A 2D array whose (<tt>i + c * j</tt>, \e k)th element, where
+     *  \e c is the number of components of the potential, is the ith
+     *  component of the potential of the kth charge distribution at the jth
+     *  evaluation point.
+     *
+     *  All charge distributions are processed in a single traversal of the
+     *  stored matrix, which is considerably faster than calling apply() for
+     *  each of them in turn. */
+    arma::Mat<ResultType> applyBatch(
+            const arma::Mat<ResultType>& argumentCoefficients) const;
+
+private:
+    /** \cond PRIVATE */
+    shared_ptr<const Space<BasisFunctionType> > m_space;
+    shared_ptr<const arma::Mat<CoordinateType> > m_evaluationPoints;
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > m_op;
+    int m_componentCount;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -38,7 +38,8 @@ AcaOptions::AcaOptions() :
     recompress(false),
     outputPostscript(false),
     outputFname("aca.ps"),
-    scaling(1.0)
+    scaling(1.0),
+    singlePrecisionStorage(false)
 {
 }
 
@@ -97,6 +98,17 @@ void AssemblyOptions::switchToTbb(int maxThreadCount)
     setMaxThreadCount(maxThreadCount);
 }
 
+void AssemblyOptions::setHMatrixMultiplicationMode(
+        ParallelizationOptions::HMatrixMultiplicationMode mode)
+{
+    m_parallelizationOptions.setHMatrixMultiplicationMode(mode);
+}
+
+void AssemblyOptions::setElementDataCacheMemoryBudget(size_t budget)
+{
+    m_parallelizationOptions.setElementDataCacheMemoryBudget(budget);
+}
+
 const ParallelizationOptions& AssemblyOptions::parallelizationOptions() const
 {
        return m_parallelizationOptions;
@@ -84,10 +84,9 @@ struct AcaOptions
     /** \brief Recompress ACA matrix after construction?
      *
      *  If true, blocks of H matrices are agglomerated in an attempt to reduce
-     *  memory consumption.
-     *
-     *  Warning: this procedure is not parallelised yet, therefore it may be
-     *  slow.
+     *  memory consumption. The agglomeration is controlled by \p eps and
+     *  \p maximumRank and is done in parallel on independent subtrees of
+     *  the block cluster tree.
      *
      *  Default value: false. */
     bool recompress;
@@ -107,6 +106,26 @@ struct AcaOptions
      *
      *  Usually does not need to be changed. Default value: 1. */
     double scaling;
+    /** \brief Store double-precision H-matrices in single precision?
+     *
+     *  If true, the entries of H-matrices assembled for double-precision
+     *  result types are rounded to \c float or <tt>std::complex<float></tt>
+     *  once the assembly is finished. The resulting weak forms
+     *  (MixedPrecisionDiscreteBoundaryOperator objects) take half the memory
+     *  and are still applied to double-precision vectors, with the results
+     *  accumulated in double precision. The relative accuracy of
+     *  matrix-vector products drops to about 1e-7, so \p eps should not be
+     *  set below 1e-6. The option has no effect for single-precision result
+     *  types.
+     *
+     *  Weak forms stored in single precision cannot be passed to functions
+     *  operating directly on H-matrices, such as acaOperatorSum() or
+     *  acaOperatorApproximateLuInverse().
+     *
+     *  \see DefaultIterativeSolver::enableIterativeRefinement().
+     *
+     *  Default value: false. */
+    bool singlePrecisionStorage;
 };
 
 using Fiber::OpenClOptions;
@@ -187,6 +206,22 @@ public:
      *  \deprecated Use setMaxThreadCount() instead. */
     BEMPP_DEPRECATED void switchToTbb(int maxThreadCount = AUTO);
 
+    /** \brief Set the algorithm used to parallelise products of H-matrices
+     *  with vectors.
+     *
+     *  This setting is stored in the H-matrices assembled in the ACA mode.
+     *  See ParallelizationOptions::setHMatrixMultiplicationMode() for more
+     *  information. */
+    void setHMatrixMultiplicationMode(
+            ParallelizationOptions::HMatrixMultiplicationMode mode);
+
+    /** \brief Set the memory budget (in bytes) of the element data caches
+     *  used during the assembly of integral operators.
+     *
+     *  See ParallelizationOptions::setElementDataCacheMemoryBudget() for
+     *  more information. */
+    void setElementDataCacheMemoryBudget(size_t budget);
+
     /** \brief Return current parallelization options. */
     const ParallelizationOptions& parallelizationOptions() const;
 
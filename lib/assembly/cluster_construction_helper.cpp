@@ -31,9 +31,186 @@
 #include "../common/shared_ptr.hpp"
 #include "../common/boost_make_shared_fwd.hpp"
 
+#include <boost/weak_ptr.hpp>
+#include <map>
+#include <tbb/mutex.h>
+#include <utility>
+
 namespace Bempp
 {
 
+namespace
+{
+
+#ifdef WITH_AHMED
+/** \brief Process-wide cache of the trees returned by
+ *  ClusterConstructionHelper::getBemCluster() and getBemBlockCluster(). */
+template <typename BasisFunctionType>
+struct ClusterCache
+{
+    typedef ClusterConstructionHelper<BasisFunctionType> CCH;
+    typedef typename CCH::AhmedBemCluster AhmedBemCluster;
+    typedef typename CCH::AhmedBemBlcluster AhmedBemBlcluster;
+    typedef Space<BasisFunctionType> SpaceType;
+
+    struct ClusterKey
+    {
+        const SpaceType* space;
+        bool indexWithGlobalDofs;
+        unsigned int minimumBlockSize;
+        unsigned int maximumBlockSize;
+
+        bool operator<(const ClusterKey& other) const {
+            if (space != other.space)
+                return space < other.space;
+            if (indexWithGlobalDofs != other.indexWithGlobalDofs)
+                return indexWithGlobalDofs < other.indexWithGlobalDofs;
+            if (minimumBlockSize != other.minimumBlockSize)
+                return minimumBlockSize < other.minimumBlockSize;
+            return maximumBlockSize < other.maximumBlockSize;
+        }
+    };
+
+    struct ClusterEntry
+    {
+        // The entry is valid only as long as the space is alive (a new
+        // space could otherwise be allocated at the same address)
+        boost::weak_ptr<const SpaceType> space;
+
+        // Guards the three members below, which are initialised lazily
+        tbb::mutex mutex;
+        shared_ptr<AhmedBemCluster> cluster;
+        shared_ptr<IndexPermutation> o2p;
+        shared_ptr<IndexPermutation> p2o;
+
+        bool isValid() const {
+            return !space.expired();
+        }
+    };
+
+    // The cluster trees depend on the DOF indexing mode and the block sizes,
+    // so these are part of the key, too
+    struct BlockClusterKey
+    {
+        const SpaceType* testSpace;
+        const SpaceType* trialSpace;
+        bool indexWithGlobalDofs;
+        unsigned int minimumBlockSize;
+        unsigned int maximumBlockSize;
+        bool symmetric;
+        double eta;
+
+        bool operator<(const BlockClusterKey& other) const {
+            if (testSpace != other.testSpace)
+                return testSpace < other.testSpace;
+            if (trialSpace != other.trialSpace)
+                return trialSpace < other.trialSpace;
+            if (indexWithGlobalDofs != other.indexWithGlobalDofs)
+                return indexWithGlobalDofs < other.indexWithGlobalDofs;
+            if (minimumBlockSize != other.minimumBlockSize)
+                return minimumBlockSize < other.minimumBlockSize;
+            if (maximumBlockSize != other.maximumBlockSize)
+                return maximumBlockSize < other.maximumBlockSize;
+            if (symmetric != other.symmetric)
+                return symmetric < other.symmetric;
+            return eta < other.eta;
+        }
+    };
+
+    struct BlockClusterEntry
+    {
+        boost::weak_ptr<const SpaceType> testSpace;
+        boost::weak_ptr<const SpaceType> trialSpace;
+
+        // Guards the four members below, which are initialised lazily.
+        // The cluster trees are referenced by the block cluster tree and
+        // must be kept alive together with it
+        tbb::mutex mutex;
+        shared_ptr<AhmedBemCluster> testCluster;
+        shared_ptr<AhmedBemCluster> trialCluster;
+        shared_ptr<AhmedBemBlcluster> blockCluster;
+        unsigned int blockCount;
+
+        bool isValid() const {
+            return !testSpace.expired() && !trialSpace.expired();
+        }
+    };
+
+    typedef std::map<ClusterKey, shared_ptr<ClusterEntry> > ClusterMap;
+    typedef std::map<BlockClusterKey, shared_ptr<BlockClusterEntry> >
+    BlockClusterMap;
+
+    // Return the entry for the given key, creating it if necessary. The
+    // trees are built by the caller while holding only the entry's mutex,
+    // so that trees for different keys can be built concurrently.
+    shared_ptr<ClusterEntry> clusterEntry(
+            const ClusterKey& key, const shared_ptr<const SpaceType>& space) {
+        tbb::mutex::scoped_lock lock(mutex);
+        typename ClusterMap::iterator it = clusters.find(key);
+        if (it != clusters.end() && it->second->isValid())
+            return it->second;
+
+        discardInvalidEntries();
+        shared_ptr<ClusterEntry> newEntry(new ClusterEntry);
+        newEntry->space = space;
+        clusters[key] = newEntry;
+        return newEntry;
+    }
+
+    shared_ptr<BlockClusterEntry> blockClusterEntry(
+            const BlockClusterKey& key,
+            const shared_ptr<const SpaceType>& testSpace,
+            const shared_ptr<const SpaceType>& trialSpace) {
+        tbb::mutex::scoped_lock lock(mutex);
+        typename BlockClusterMap::iterator it = blockClusters.find(key);
+        if (it != blockClusters.end() && it->second->isValid())
+            return it->second;
+
+        discardInvalidEntries();
+        shared_ptr<BlockClusterEntry> newEntry(new BlockClusterEntry);
+        newEntry->testSpace = testSpace;
+        newEntry->trialSpace = trialSpace;
+        newEntry->blockCount = 0;
+        blockClusters[key] = newEntry;
+        return newEntry;
+    }
+
+    // Discard entries belonging to spaces that no longer exist. Must be
+    // called with the mutex locked.
+    void discardInvalidEntries() {
+        for (typename ClusterMap::iterator it = clusters.begin();
+             it != clusters.end(); )
+            if (it->second->isValid())
+                ++it;
+            else
+                clusters.erase(it++);
+        for (typename BlockClusterMap::iterator it = blockClusters.begin();
+             it != blockClusters.end(); )
+            if (it->second->isValid())
+                ++it;
+            else
+                blockClusters.erase(it++);
+    }
+
+    // Guards the maps below
+    tbb::mutex mutex;
+    ClusterMap clusters;
+    BlockClusterMap blockClusters;
+};
+
+template <typename BasisFunctionType>
+ClusterCache<BasisFunctionType>& clusterCache()
+{
+    // Deliberately never deleted, since the cache may be accessed after
+    // static objects have been destroyed
+    static ClusterCache<BasisFunctionType>* cache =
+            new ClusterCache<BasisFunctionType>;
+    return *cache;
+}
+#endif // WITH_AHMED
+
+} // namespace
+
 template <typename BasisFunctionType>
 void ClusterConstructionHelper<BasisFunctionType>::constructBemCluster(
         const Space<BasisFunctionType>& space,
@@ -127,6 +304,119 @@ ClusterConstructionHelper<BasisFunctionType>::constructBemBlockCluster(
 #endif // WITH_AHMED
 }
 
+template <typename BasisFunctionType>
+void ClusterConstructionHelper<BasisFunctionType>::getBemCluster(
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        bool indexWithGlobalDofs,
+        const AcaOptions& acaOptions,
+        shared_ptr<AhmedBemCluster>& cluster,
+        shared_ptr<IndexPermutation>& o2p,
+        shared_ptr<IndexPermutation>& p2o)
+{
+#ifdef WITH_AHMED
+    if (!space)
+        throw std::invalid_argument("getBemCluster(): "
+                                    "space must not be null");
+
+    typedef ClusterCache<BasisFunctionType> Cache;
+    typename Cache::ClusterKey key;
+    key.space = space.get();
+    key.indexWithGlobalDofs = indexWithGlobalDofs;
+    key.minimumBlockSize = acaOptions.minimumBlockSize;
+    key.maximumBlockSize = acaOptions.maximumBlockSize;
+    shared_ptr<typename Cache::ClusterEntry> entry =
+            clusterCache<BasisFunctionType>().clusterEntry(key, space);
+
+    tbb::mutex::scoped_lock lock(entry->mutex);
+    if (!entry->cluster)
+        constructBemCluster(*space, indexWithGlobalDofs, acaOptions,
+                            entry->cluster, entry->o2p, entry->p2o);
+    cluster = entry->cluster;
+    o2p = entry->o2p;
+    p2o = entry->p2o;
+#else // without Ahmed
+    throw std::runtime_error("getBemCluster(): "
+                             "AHMED not available. Recompile BEM++ "
+                             "with the symbol WITH_AHMED defined.");
+#endif // WITH_AHMED
+}
+
+template <typename BasisFunctionType>
+shared_ptr<typename ClusterConstructionHelper<
+               BasisFunctionType>::AhmedBemBlcluster>
+ClusterConstructionHelper<BasisFunctionType>::getBemBlockCluster(
+        const shared_ptr<const Space<BasisFunctionType> >& testSpace,
+        const shared_ptr<const Space<BasisFunctionType> >& trialSpace,
+        const AcaOptions& acaOptions,
+        bool symmetric,
+        const shared_ptr<AhmedBemCluster>& testCluster,
+        const shared_ptr<AhmedBemCluster>& trialCluster,
+        /* output parameter */
+        unsigned int& blockCount)
+{
+#ifdef WITH_AHMED
+    if (!testSpace || !trialSpace)
+        throw std::invalid_argument("getBemBlockCluster(): "
+                                    "spaces must not be null");
+    if (!testCluster || !trialCluster)
+        throw std::invalid_argument("getBemBlockCluster(): "
+                                    "cluster trees must not be null");
+    if (acaOptions.recompress)
+        return shared_ptr<AhmedBemBlcluster>(
+                    constructBemBlockCluster(acaOptions, symmetric,
+                                             *testCluster, *trialCluster,
+                                             blockCount).release());
+
+    typedef ClusterCache<BasisFunctionType> Cache;
+    typename Cache::BlockClusterKey key;
+    key.testSpace = testSpace.get();
+    key.trialSpace = trialSpace.get();
+    key.indexWithGlobalDofs = acaOptions.globalAssemblyBeforeCompression;
+    key.minimumBlockSize = acaOptions.minimumBlockSize;
+    key.maximumBlockSize = acaOptions.maximumBlockSize;
+    key.symmetric = symmetric;
+    key.eta = acaOptions.eta;
+    shared_ptr<typename Cache::BlockClusterEntry> entry =
+            clusterCache<BasisFunctionType>().blockClusterEntry(
+                key, testSpace, trialSpace);
+
+    tbb::mutex::scoped_lock lock(entry->mutex);
+    if (!entry->blockCluster) {
+        entry->blockCluster.reset(
+                    constructBemBlockCluster(acaOptions, symmetric,
+                                             *testCluster, *trialCluster,
+                                             entry->blockCount).release());
+        entry->testCluster = testCluster;
+        entry->trialCluster = trialCluster;
+    } else if (entry->testCluster != testCluster ||
+               entry->trialCluster != trialCluster)
+        // The caller has not obtained the cluster trees from
+        // getBemCluster(); the cached tree refers to different ones
+        return shared_ptr<AhmedBemBlcluster>(
+                    constructBemBlockCluster(acaOptions, symmetric,
+                                             *testCluster, *trialCluster,
+                                             blockCount).release());
+    blockCount = entry->blockCount;
+    return entry->blockCluster;
+#else // without Ahmed
+    throw std::runtime_error("getBemBlockCluster(): "
+                             "AHMED not available. Recompile BEM++ "
+                             "with the symbol WITH_AHMED defined.");
+#endif // WITH_AHMED
+}
+
+template <typename BasisFunctionType>
+void ClusterConstructionHelper<BasisFunctionType>::clearCache()
+{
+#ifdef WITH_AHMED
+    typedef ClusterCache<BasisFunctionType> Cache;
+    Cache& cache = clusterCache<BasisFunctionType>();
+    tbb::mutex::scoped_lock lock(cache.mutex);
+    cache.clusters.clear();
+    cache.blockClusters.clear();
+#endif // WITH_AHMED
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS(ClusterConstructionHelper);
 
 } // namespace Bempp
@@ -39,6 +39,19 @@ class AcaOptions;
 class IndexPermutation;
 /** \endcond */
 
+/** \ingroup weak_form_assembly_internal
+ *  \brief Construction of AHMED cluster trees and block cluster trees.
+ *
+ *  The constructBemCluster() and constructBemBlockCluster() functions
+ *  always build new trees. The getBemCluster() and getBemBlockCluster()
+ *  functions return trees from a process-wide cache, building them only
+ *  on first use. Cached trees are shared by all operators assembled on the
+ *  same spaces with the same ACA options (for instance, the single-layer,
+ *  double-layer and hypersingular operators of a Burton-Miller
+ *  formulation). The cache holds only weak references to the spaces;
+ *  entries whose spaces have been destroyed are discarded on the next
+ *  request. Trees for different spaces or options can be constructed
+ *  concurrently. */
 template <typename BasisFunctionType>
 struct ClusterConstructionHelper
 {
@@ -65,6 +78,47 @@ struct ClusterConstructionHelper
         AhmedBemCluster& trialCluster,
         /* output parameter */
         unsigned int& blockCount);
+
+    /** \brief Return the cluster tree of the DOFs of \p space and the
+     *  associated DOF permutations.
+     *
+     *  The tree and permutations are constructed with constructBemCluster()
+     *  on first request and cached until \p space is destroyed or
+     *  clearCache() is called. The cluster tree must not be modified. */
+    static void getBemCluster(
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        bool indexWithGlobalDofs,
+        const AcaOptions& acaOptions,
+        shared_ptr<AhmedBemCluster>& cluster,
+        shared_ptr<IndexPermutation>& o2p,
+        shared_ptr<IndexPermutation>& p2o);
+
+    /** \brief Return the block cluster tree built from the cluster trees
+     *  \p testCluster and \p trialCluster of \p testSpace and \p trialSpace.
+     *
+     *  \p testCluster and \p trialCluster should be obtained from
+     *  getBemCluster() with the same \p acaOptions. The block cluster tree
+     *  is constructed with constructBemBlockCluster() on first request and
+     *  cached until one of the spaces is destroyed or clearCache() is
+     *  called. Trees built with different ACA options are cached
+     *  separately.
+     *
+     *  Agglomeration of H-matrix blocks modifies the block cluster tree.
+     *  Therefore, if <tt>acaOptions.recompress</tt> is set, a new tree is
+     *  constructed on each call and nothing is cached. The same happens if
+     *  \p testCluster or \p trialCluster are not the cached trees. */
+    static shared_ptr<AhmedBemBlcluster> getBemBlockCluster(
+        const shared_ptr<const Space<BasisFunctionType> >& testSpace,
+        const shared_ptr<const Space<BasisFunctionType> >& trialSpace,
+        const AcaOptions& acaOptions,
+        bool symmetric,
+        const shared_ptr<AhmedBemCluster>& testCluster,
+        const shared_ptr<AhmedBemCluster>& trialCluster,
+        /* output parameter */
+        unsigned int& blockCount);
+
+    /** \brief Remove all cached cluster trees and block cluster trees. */
+    static void clearCache();
 };
 
 } // namespace Bempp
@@ -124,6 +124,35 @@ void ComplexifiedDiscreteBoundaryOperator<RealType>::applyBuiltInImpl(
     y_inout.set_imag(y_im);
 }
 
+template <typename RealType>
+void ComplexifiedDiscreteBoundaryOperator<RealType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    if (beta == static_cast<ValueType>(0.))
+        y_inout.fill(static_cast<ValueType>(0.));
+    else
+        y_inout *= beta;
+
+    arma::Mat<RealType> x_re = arma::real(x_in);
+    arma::Mat<RealType> x_im = arma::imag(x_in);
+
+    arma::Mat<RealType> y_re = arma::real(y_inout);
+    arma::Mat<RealType> y_im = arma::imag(y_inout);
+
+    m_operator->apply(trans, x_re, y_re, alpha.real(), 1.);
+    m_operator->apply(trans, x_im, y_re, -alpha.imag(), 1.);
+
+    m_operator->apply(trans, x_re, y_im, alpha.imag(), 1.);
+    m_operator->apply(trans, x_im, y_im, alpha.real(), 1.);
+
+    y_inout.set_real(y_re);
+    y_inout.set_imag(y_im);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT_REAL_ONLY(
     ComplexifiedDiscreteBoundaryOperator);
 
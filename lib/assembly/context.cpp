@@ -21,6 +21,7 @@
 #include "context.hpp"
 
 #include "abstract_boundary_operator.hpp"
+#include "mass_matrix_cache.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 
 #include <boost/make_shared.hpp>
@@ -34,7 +35,8 @@ Context<BasisFunctionType, ResultType>::Context(
         const shared_ptr<const QuadratureStrategy>& quadStrategy,
         const AssemblyOptions& assemblyOptions) :
     m_quadStrategy(quadStrategy),
-    m_assemblyOptions(assemblyOptions)
+    m_assemblyOptions(assemblyOptions),
+    m_massMatrixCache(new MassMatrixCache<BasisFunctionType, ResultType>)
 {
     if (quadStrategy.get() == 0)
         throw std::invalid_argument("Context::Context(): "
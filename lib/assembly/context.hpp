@@ -14,6 +14,7 @@ namespace Bempp
 class GeometryFactory;
 template <typename ValueType> class DiscreteBoundaryOperator;
 template <typename BasisFunctionType, typename ResultType> class AbstractBoundaryOperator;
+template <typename BasisFunctionType, typename ResultType> class MassMatrixCache;
 /** \endcond */
 
 /** \ingroup weak_form_assembly
@@ -75,9 +76,18 @@ public:
         return m_quadStrategy;
     }
 
+    /** \brief Return a reference to the cache of mass matrices assembled
+     *  with this context.
+     *
+     *  The cache is shared by copies of this Context. */
+    const MassMatrixCache<BasisFunctionType, ResultType>& massMatrixCache() const {
+        return *m_massMatrixCache;
+    }
+
 private:
     shared_ptr<const QuadratureStrategy> m_quadStrategy;
     AssemblyOptions m_assemblyOptions;
+    shared_ptr<MassMatrixCache<BasisFunctionType, ResultType> > m_massMatrixCache;
 };
 
 } // namespace Bempp
@@ -0,0 +1,260 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "csr_matrix.hpp"
+
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#ifdef WITH_TRILINOS
+#include <Epetra_Comm.h>
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_Map.h>
+#endif
+
+namespace Bempp
+{
+
+namespace
+{
+
+// Minimum number of rows processed by a single task. Sparse matrix-vector
+// products are memory-bound; there is no point in splitting small matrices.
+const int CSR_ROW_GRAIN_SIZE = 512;
+
+template <typename ValueType>
+class CsrMatVecLoopBody
+{
+public:
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+
+    CsrMatVecLoopBody(const int* rowOffsets,
+                      const int* columnIndices,
+                      const CoordinateType* values,
+                      const arma::Mat<ValueType>& x_in,
+                      arma::Mat<ValueType>& y_inout,
+                      ValueType alpha, ValueType beta) :
+        m_rowOffsets(rowOffsets), m_columnIndices(columnIndices),
+        m_values(values), m_x_in(x_in), m_y_inout(y_inout),
+        m_alpha(alpha), m_beta(beta)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<int>& r) const {
+        const ValueType zero = static_cast<ValueType>(0.);
+        for (size_t col = 0; col < m_x_in.n_cols; ++col) {
+            const ValueType* x = m_x_in.colptr(col);
+            // mutable OK because each task writes to a different set of rows
+            ValueType* y = m_y_inout.colptr(col);
+            for (int row = r.begin(); row != r.end(); ++row) {
+                ValueType sum = zero;
+                const int end = m_rowOffsets[row + 1];
+                for (int k = m_rowOffsets[row]; k < end; ++k)
+                    sum += m_values[k] * x[m_columnIndices[k]];
+                if (m_beta == zero)
+                    y[row] = m_alpha * sum;
+                else
+                    y[row] = m_alpha * sum + m_beta * y[row];
+            }
+        }
+    }
+
+private:
+    const int* m_rowOffsets;
+    const int* m_columnIndices;
+    const CoordinateType* m_values;
+    const arma::Mat<ValueType>& m_x_in;
+    arma::Mat<ValueType>& m_y_inout;
+    ValueType m_alpha;
+    ValueType m_beta;
+};
+
+} // namespace
+
+template <typename ValueType>
+CsrMatrix<ValueType>::CsrMatrix(
+        int rowCount, int columnCount,
+        std::vector<int>& rowOffsets,
+        std::vector<int>& columnIndices,
+        std::vector<CoordinateType>& values) :
+    m_rowCount(rowCount), m_columnCount(columnCount)
+{
+    m_rowOffsets.swap(rowOffsets);
+    m_columnIndices.swap(columnIndices);
+    m_values.swap(values);
+    if (rowCount < 0 || columnCount < 0 ||
+            m_rowOffsets.size() != static_cast<size_t>(rowCount) + 1 ||
+            m_rowOffsets.front() != 0 ||
+            m_columnIndices.size() != m_values.size() ||
+            static_cast<size_t>(m_rowOffsets.back()) != m_values.size())
+        throw std::invalid_argument("CsrMatrix::CsrMatrix(): "
+                                    "inconsistent matrix structure");
+}
+
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+CsrMatrix<ValueType>::CsrMatrix(const Epetra_CrsMatrix& mat)
+{
+    if (mat.Comm().NumProc() != 1)
+        throw std::runtime_error(
+                "CsrMatrix::CsrMatrix(): "
+                "conversion of distributed matrices is unsupported");
+    if (!mat.Filled())
+        throw std::invalid_argument(
+                "CsrMatrix::CsrMatrix(): "
+                "FillComplete() has not been called on the matrix");
+    const Epetra_Map& rowMap = mat.RowMap();
+    const Epetra_Map& columnMap = mat.ColMap();
+    const Epetra_Map& rangeMap = mat.RangeMap();
+    const Epetra_Map& domainMap = mat.DomainMap();
+    m_rowCount = rangeMap.NumGlobalElements();
+    m_columnCount = domainMap.NumGlobalElements();
+    if (!rowMap.UniqueGIDs() || mat.NumMyRows() != m_rowCount)
+        throw std::invalid_argument(
+                "CsrMatrix::CsrMatrix(): "
+                "the row map of the matrix must be a permutation of "
+                "its range map");
+
+    // Row and column indices used by Epetra are local; translate them to
+    // positions in the range and domain maps, in which the matrix acts on
+    // vectors
+    std::vector<int> rows(m_rowCount);
+    m_rowOffsets.assign(m_rowCount + 1, 0);
+    for (int localRow = 0; localRow < m_rowCount; ++localRow) {
+        const int row = rangeMap.LID(rowMap.GID(localRow));
+        if (row < 0)
+            throw std::invalid_argument(
+                    "CsrMatrix::CsrMatrix(): "
+                    "the row map of the matrix must be a permutation of "
+                    "its range map");
+        rows[localRow] = row;
+        m_rowOffsets[row + 1] = mat.NumMyEntries(localRow);
+    }
+    for (int row = 0; row < m_rowCount; ++row)
+        m_rowOffsets[row + 1] += m_rowOffsets[row];
+
+    m_columnIndices.resize(m_rowOffsets.back());
+    m_values.resize(m_rowOffsets.back());
+    std::vector<std::pair<int, CoordinateType> > rowEntries;
+    for (int localRow = 0; localRow < m_rowCount; ++localRow) {
+        int entryCount = 0;
+        double* values = 0;
+        int* localColumns = 0;
+        if (mat.ExtractMyRowView(localRow, entryCount,
+                                 values, localColumns) != 0)
+            throw std::runtime_error(
+                    "CsrMatrix::CsrMatrix(): "
+                    "Epetra_CrsMatrix::ExtractMyRowView() failed");
+        rowEntries.resize(entryCount);
+        for (int entry = 0; entry < entryCount; ++entry) {
+            const int column = domainMap.LID(columnMap.GID(localColumns[entry]));
+            if (column < 0)
+                throw std::invalid_argument(
+                        "CsrMatrix::CsrMatrix(): "
+                        "the matrix contains entries lying outside "
+                        "its domain map");
+            rowEntries[entry] = std::make_pair(
+                        column, static_cast<CoordinateType>(values[entry]));
+        }
+        // The column map need not be ordered like the domain map
+        std::sort(rowEntries.begin(), rowEntries.end());
+        const int offset = m_rowOffsets[rows[localRow]];
+        for (int entry = 0; entry < entryCount; ++entry) {
+            m_columnIndices[offset + entry] = rowEntries[entry].first;
+            m_values[offset + entry] = rowEntries[entry].second;
+        }
+    }
+}
+#endif
+
+template <typename ValueType>
+CsrMatrix<ValueType>::~CsrMatrix()
+{
+}
+
+template <typename ValueType>
+void CsrMatrix<ValueType>::apply(bool transpose,
+                                 const arma::Mat<ValueType>& x_in,
+                                 arma::Mat<ValueType>& y_inout,
+                                 const ValueType alpha,
+                                 const ValueType beta) const
+{
+    if (transpose) {
+        transposed().apply(false, x_in, y_inout, alpha, beta);
+        return;
+    }
+
+    if (x_in.n_rows != static_cast<unsigned int>(m_columnCount) ||
+            y_inout.n_rows != static_cast<unsigned int>(m_rowCount) ||
+            x_in.n_cols != y_inout.n_cols)
+        throw std::invalid_argument("CsrMatrix::apply(): "
+                                    "vectors have incorrect dimensions");
+    if (m_rowCount == 0 || x_in.n_cols == 0)
+        return;
+
+    // Guard against empty vectors (&v[0] is undefined for them)
+    static const int noIndices[1] = { 0 };
+    static const CoordinateType noValues[1] = { 0 };
+    const int* columnIndices =
+            m_columnIndices.empty() ? noIndices : &m_columnIndices[0];
+    const CoordinateType* values = m_values.empty() ? noValues : &m_values[0];
+
+    typedef CsrMatVecLoopBody<ValueType> Body;
+    tbb::parallel_for(tbb::blocked_range<int>(0, m_rowCount,
+                                              CSR_ROW_GRAIN_SIZE),
+                      Body(&m_rowOffsets[0], columnIndices, values,
+                           x_in, y_inout, alpha, beta));
+}
+
+template <typename ValueType>
+const CsrMatrix<ValueType>& CsrMatrix<ValueType>::transposed() const
+{
+    tbb::mutex::scoped_lock lock(m_transposedMutex);
+    if (!m_transposed) {
+        // Counting sort of the entries by column index
+        std::vector<int> rowOffsets(m_columnCount + 1, 0);
+        for (size_t k = 0; k < m_columnIndices.size(); ++k)
+            ++rowOffsets[m_columnIndices[k] + 1];
+        for (int col = 0; col < m_columnCount; ++col)
+            rowOffsets[col + 1] += rowOffsets[col];
+
+        std::vector<int> columnIndices(m_values.size());
+        std::vector<CoordinateType> values(m_values.size());
+        std::vector<int> position(rowOffsets.begin(), rowOffsets.end() - 1);
+        for (int row = 0; row < m_rowCount; ++row)
+            for (int k = m_rowOffsets[row]; k < m_rowOffsets[row + 1]; ++k) {
+                const int dest = position[m_columnIndices[k]]++;
+                columnIndices[dest] = row;
+                values[dest] = m_values[k];
+            }
+        m_transposed.reset(new CsrMatrix(m_columnCount, m_rowCount, rowOffsets,
+                                         columnIndices, values));
+    }
+    return *m_transposed;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(CsrMatrix);
+
+} // namespace Bempp
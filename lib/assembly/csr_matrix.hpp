@@ -0,0 +1,146 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_csr_matrix_hpp
+#define bempp_csr_matrix_hpp
+
+#include "../common/common.hpp"
+#include "bempp/common/config_trilinos.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../common/shared_ptr.hpp"
+#include "../fiber/scalar_traits.hpp"
+
+#include <boost/utility.hpp>
+#include <tbb/mutex.h>
+#include <vector>
+
+#ifdef WITH_TRILINOS
+/** \cond FORWARD_DECL */
+class Epetra_CrsMatrix;
+/** \endcond */
+#endif
+
+namespace Bempp
+{
+
+/** \ingroup discrete_boundary_operators
+ *  \brief Real sparse matrix stored in the compressed sparse row (CSR)
+ *  format, with a multithreaded matrix-vector product kernel.
+ *
+ *  The matrix entries are stored as real numbers of type
+ *  <tt>ScalarTraits<ValueType>::RealType</tt>; the vectors it acts on have
+ *  entries of type \p ValueType. Products with complex vectors are therefore
+ *  computed directly, without splitting the vectors into real and imaginary
+ *  parts.
+ *
+ *  Products with the transposed matrix use a transposed copy of the matrix,
+ *  which is constructed on first use and kept for the lifetime of the object.
+ *  No memory is allocated during subsequent matrix-vector products.
+ *
+ *  \tparam ValueType
+ *    Type of the entries of the vectors the matrix acts on. One of: \c float,
+ *    \c double, <tt>std::complex<float></tt>, <tt>std::complex<double></tt>. */
+template <typename ValueType>
+class CsrMatrix : boost::noncopyable
+{
+public:
+    /** \brief Type of the matrix entries. */
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+
+    /** \brief Constructor.
+     *
+     *  \param[in] rowCount Number of rows.
+     *  \param[in] columnCount Number of columns.
+     *  \param[in,out] rowOffsets
+     *    Vector of length <tt>rowCount + 1</tt>. The column indices and values
+     *    of the entries in row \c i are stored at positions
+     *    <tt>rowOffsets[i]</tt>, ..., <tt>rowOffsets[i + 1] - 1</tt> of
+     *    \p columnIndices and \p values.
+     *  \param[in,out] columnIndices Column indices of the entries.
+     *  \param[in,out] values Values of the entries.
+     *
+     *  To avoid copying, the contents of \p rowOffsets, \p columnIndices and
+     *  \p values are moved into the new matrix; on return these vectors are
+     *  empty. */
+    CsrMatrix(int rowCount, int columnCount,
+              std::vector<int>& rowOffsets,
+              std::vector<int>& columnIndices,
+              std::vector<CoordinateType>& values);
+
+#ifdef WITH_TRILINOS
+    /** \brief Construct a copy of a (serial) Epetra matrix.
+     *
+     *  The rows and columns of the new matrix are ordered as the elements of
+     *  the range and domain maps of \p mat, respectively. An exception is
+     *  thrown if \p mat is distributed, has not been fill-completed or has
+     *  entries lying outside its range or domain map. */
+    explicit CsrMatrix(const Epetra_CrsMatrix& mat);
+#endif
+
+    /** \brief Destructor. */
+    ~CsrMatrix();
+
+    /** \brief Number of rows of the matrix. */
+    int rowCount() const { return m_rowCount; }
+    /** \brief Number of columns of the matrix. */
+    int columnCount() const { return m_columnCount; }
+    /** \brief Number of stored entries. */
+    size_t nonzeroCount() const { return m_values.size(); }
+
+    /** \brief Offsets of the rows in the arrays returned by columnIndices()
+     *  and values(). */
+    const std::vector<int>& rowOffsets() const { return m_rowOffsets; }
+    /** \brief Column indices of the stored entries. */
+    const std::vector<int>& columnIndices() const { return m_columnIndices; }
+    /** \brief Values of the stored entries. */
+    const std::vector<CoordinateType>& values() const { return m_values; }
+
+    /** \brief Compute <tt>y_inout := alpha * A * x_in + beta * y_inout</tt>,
+     *  where \c A is this matrix or (if \p transpose is \c true) its transpose.
+     *
+     *  \p x_in and \p y_inout may have several columns; all are processed in
+     *  a single sweep over the matrix. If \p beta is zero, the original
+     *  contents of \p y_inout are ignored (in particular, NaNs are not
+     *  propagated). */
+    void apply(bool transpose,
+               const arma::Mat<ValueType>& x_in,
+               arma::Mat<ValueType>& y_inout,
+               const ValueType alpha,
+               const ValueType beta) const;
+
+private:
+    /** \cond PRIVATE */
+    const CsrMatrix& transposed() const;
+
+    int m_rowCount;
+    int m_columnCount;
+    std::vector<int> m_rowOffsets;
+    std::vector<int> m_columnIndices;
+    std::vector<CoordinateType> m_values;
+
+    mutable tbb::mutex m_transposedMutex;
+    mutable shared_ptr<const CsrMatrix> m_transposed;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -32,21 +32,36 @@
 #include "../common/complex_aux.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/serial_blas_region.hpp"
+#include "../fiber/thread_pool.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <utility>
+#include <boost/cstdint.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <boost/type_traits/is_complex.hpp>
+#include <boost/utility.hpp>
 
 #include <tbb/blocked_range.h>
 #include <tbb/concurrent_queue.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_reduce.h>
-#include <tbb/task_scheduler_init.h>
 
 #ifdef WITH_TRILINOS
 #include <Thyra_SpmdVectorSpaceDefaultBase.hpp>
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+#define BEMPP_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace Bempp
 {
 
@@ -68,42 +83,192 @@ void dumpblcluster(const blcluster* bl, const std::string& indent)
 namespace
 {
 
+inline void mltaSyHVec(double d, blcluster* bl, mblock<double>** A, double* x,
+                       double* y)
+{
+    mltaHeHVec(d, bl, A, x, y);
+}
+
+inline void mltaSyHVec(float d, blcluster* bl, mblock<float>** A, float* x,
+                       float* y)
+{
+    mltaHeHVec(d, bl, A, x, y);
+}
+
+inline void mltaSyHVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
+                       scomp* y)
+{
+    throw std::runtime_error("mltaSyHVec(): the overload of this function for "
+                             "complex single-precision numbers does not exist "
+                             "in AHMED");
+}
+
+/** \brief Contribution of a single leaf block A of an H-matrix to an
+ *  H-matrix-vector product y := y + multiplier * op(H) x. */
+struct MblockContribution
+{
+    enum Type {
+        /** \brief y(rows) += multiplier * A x(cols). */
+        DIRECT,
+        /** \brief y(cols) += multiplier * A^T x(rows). */
+        TRANSPOSED,
+        /** \brief y(cols) += multiplier * A^H x(rows). */
+        CONJUGATE_TRANSPOSED,
+        /** \brief A is a diagonal block of a symmetric H-matrix;
+         *  y(rows) += multiplier * A x(cols). */
+        SYMMETRIC_DIAGONAL,
+        /** \brief A is a diagonal block of a Hermitian H-matrix;
+         *  y(rows) += multiplier * A x(cols). */
+        HERMITIAN_DIAGONAL
+    };
+
+    MblockContribution(size_t leaf_, Type type_) :
+        leaf(leaf_), type(type_) {
+    }
+
+    /** \brief Index of the leaf in an AhmedLeafClusterArray. */
+    size_t leaf;
+    Type type;
+
+    /** \brief Return true if this contribution updates the part of the
+     *  output vector corresponding to the columns of the block. */
+    bool updatesColumnRange() const {
+        return type == TRANSPOSED || type == CONJUGATE_TRANSPOSED;
+    }
+};
+
+/** \brief List the contributions of the leaf blocks of a non-symmetric
+ *  H-matrix to the product y := y + multiplier * op(H) x. */
+void listNonsymmetricMblockContributions(
+        size_t leafClusterCount, TranspositionMode trans,
+        std::vector<MblockContribution>& contributions)
+{
+    MblockContribution::Type type;
+    if (trans == NO_TRANSPOSE)
+        type = MblockContribution::DIRECT;
+    else if (trans == TRANSPOSE)
+        type = MblockContribution::TRANSPOSED;
+    else if (trans == CONJUGATE_TRANSPOSE)
+        type = MblockContribution::CONJUGATE_TRANSPOSED;
+    else
+        throw std::invalid_argument(
+                "listNonsymmetricMblockContributions(): "
+                "unsupported transposition mode");
+    contributions.clear();
+    contributions.reserve(leafClusterCount);
+    for (size_t leaf = 0; leaf < leafClusterCount; ++leaf)
+        contributions.push_back(MblockContribution(leaf, type));
+}
+
+/** \brief List the contributions of the leaf blocks of a symmetric or
+ *  Hermitian H-matrix H to the product y := y + multiplier * H x.
+ *
+ *  Only the blocks lying on one side of the diagonal are stored. Each of
+ *  them contributes to the product both directly and through its transpose
+ *  (for symmetric H) or conjugate transpose (for Hermitian H). */
+void listSymmetricMblockContributions(
+        AhmedLeafClusterArray& leafClusters, bool hermitian,
+        std::vector<MblockContribution>& contributions)
+{
+    const size_t leafClusterCount = leafClusters.size();
+    contributions.clear();
+    contributions.reserve(2 * leafClusterCount);
+    for (size_t leaf = 0; leaf < leafClusterCount; ++leaf) {
+        const blcluster* cluster = leafClusters[leaf];
+        if (cluster->getb1() == cluster->getb2() &&
+                cluster->getn1() == cluster->getn2())
+            contributions.push_back(MblockContribution(
+                    leaf, hermitian ? MblockContribution::HERMITIAN_DIAGONAL
+                                    : MblockContribution::SYMMETRIC_DIAGONAL));
+        else {
+            contributions.push_back(MblockContribution(
+                    leaf, MblockContribution::DIRECT));
+            contributions.push_back(MblockContribution(
+                    leaf, hermitian ? MblockContribution::CONJUGATE_TRANSPOSED
+                                    : MblockContribution::TRANSPOSED));
+        }
+    }
+}
+
+/** \brief Add a single mblock contribution to all columns of the
+ *  multivector \p y using AHMED's routines. */
+template <typename ValueType>
+void applyMblockContribution(
+        MblockContribution::Type type,
+        ValueType multiplier,
+        blcluster* cluster,
+        const boost::shared_array<
+            mblock<typename AhmedTypeTraits<ValueType>::Type>*>& blocks,
+        arma::Mat<ValueType>& x,
+        arma::Mat<ValueType>& y)
+{
+    mblock<typename AhmedTypeTraits<ValueType>::Type>* block =
+            blocks[cluster->getidx()];
+    for (size_t col = 0; col < x.n_cols; ++col) {
+        ValueType* xCol = x.colptr(col);
+        ValueType* yCol = y.colptr(col);
+        switch (type) {
+        case MblockContribution::DIRECT:
+            block->mltaVec(ahmedCast(multiplier),
+                           ahmedCast(xCol + cluster->getb2()),
+                           ahmedCast(yCol + cluster->getb1()));
+            break;
+        case MblockContribution::TRANSPOSED:
+            block->mltatVec(ahmedCast(multiplier),
+                            ahmedCast(xCol + cluster->getb1()),
+                            ahmedCast(yCol + cluster->getb2()));
+            break;
+        case MblockContribution::CONJUGATE_TRANSPOSED:
+            block->mltahVec(ahmedCast(multiplier),
+                            ahmedCast(xCol + cluster->getb1()),
+                            ahmedCast(yCol + cluster->getb2()));
+            break;
+        // For a diagonal leaf, the routines acting on a whole H-matrix only
+        // touch the leaf's own block (and expect full-length vectors)
+        case MblockContribution::SYMMETRIC_DIAGONAL:
+            mltaSyHVec(ahmedCast(multiplier), cluster, blocks.get(),
+                       ahmedCast(xCol), ahmedCast(yCol));
+            break;
+        case MblockContribution::HERMITIAN_DIAGONAL:
+            mltaHeHVec(ahmedCast(multiplier), cluster, blocks.get(),
+                       ahmedCast(xCol), ahmedCast(yCol));
+            break;
+        }
+    }
+}
+
 template <typename ValueType>
 class MblockMultiplicationLoopBody
 {
     typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
 public:
-    typedef tbb::concurrent_queue<size_t> LeafClusterIndexQueue;
+    typedef tbb::concurrent_queue<size_t> ContributionIndexQueue;
 
     MblockMultiplicationLoopBody(
-            TranspositionMode trans,
             ValueType multiplier,
-            arma::Col<ValueType>& x,
-            arma::Col<ValueType>& y,
+            arma::Mat<ValueType>& x,
+            arma::Mat<ValueType>& y,
             AhmedLeafClusterArray& leafClusters,
             boost::shared_array<AhmedMblock*> blocks,
-            LeafClusterIndexQueue& leafClusterIndexQueue,
+            const std::vector<MblockContribution>& contributions,
+            ContributionIndexQueue& contributionIndexQueue,
             std::vector<ChunkStatistics>& stats) :
-        m_trans(trans),
         m_multiplier(multiplier), m_x(x), m_local_y(y),
         m_leafClusters(leafClusters), m_blocks(blocks),
-        m_leafClusterIndexQueue(leafClusterIndexQueue),
+        m_contributions(contributions),
+        m_contributionIndexQueue(contributionIndexQueue),
         m_stats(stats)
     {
-        if (trans != NO_TRANSPOSE && trans != TRANSPOSE &&
-            trans != CONJUGATE_TRANSPOSE)
-            throw std::invalid_argument(
-                "MblockMultiplicationLoopBody::MblockMultiplicationLoopBody(): "
-                "unsupported transposition mode");
         // m_local_y.fill(static_cast<ValueType>(0.));
     }
 
     MblockMultiplicationLoopBody(MblockMultiplicationLoopBody& other, tbb::split) :
-        m_trans(other.m_trans),
         m_multiplier(other.m_multiplier),
-        m_x(other.m_x), m_local_y(other.m_local_y.n_rows),
+        m_x(other.m_x),
+        m_local_y(other.m_local_y.n_rows, other.m_local_y.n_cols),
         m_leafClusters(other.m_leafClusters), m_blocks(other.m_blocks),
-        m_leafClusterIndexQueue(other.m_leafClusterIndexQueue),
+        m_contributions(other.m_contributions),
+        m_contributionIndexQueue(other.m_contributionIndexQueue),
         m_stats(other.m_stats)
     {
         m_local_y.fill(static_cast<ValueType>(0.));
@@ -112,35 +277,24 @@ public:
     template <typename Range>
     void operator() (const Range& r) {
         for (typename Range::const_iterator i = r.begin(); i != r.end(); ++i) {
-            size_t leafClusterIndex = -1;
-            if (!m_leafClusterIndexQueue.try_pop(leafClusterIndex)) {
+            size_t contributionIndex = -1;
+            if (!m_contributionIndexQueue.try_pop(contributionIndex)) {
                 std::cerr << "MblockMultiplicationLoopBody::operator(): "
                              "Warning: try_pop failed; this shouldn't happen!"
                           << std::endl;
                 continue;
             }
-            m_stats[leafClusterIndex].valid = true;
-            m_stats[leafClusterIndex].chunkStart = r.begin();
-            m_stats[leafClusterIndex].chunkSize = r.size();
-            m_stats[leafClusterIndex].startTime = tbb::tick_count::now();
-
-            blcluster* cluster = m_leafClusters[leafClusterIndex];
-            if (m_trans == NO_TRANSPOSE)
-                m_blocks[cluster->getidx()]->mltaVec(
-                    ahmedCast(m_multiplier),
-                    ahmedCast(&m_x(cluster->getb2())),
-                    ahmedCast(&m_local_y(cluster->getb1())));
-            else if (m_trans == TRANSPOSE)
-                m_blocks[cluster->getidx()]->mltatVec(
-                    ahmedCast(m_multiplier),
-                    ahmedCast(&m_x(cluster->getb1())),
-                    ahmedCast(&m_local_y(cluster->getb2())));
-            else // m_trans == CONJUGATE_TRANSPOSE)
-                m_blocks[cluster->getidx()]->mltahVec(
-                    ahmedCast(m_multiplier),
-                    ahmedCast(&m_x(cluster->getb1())),
-                    ahmedCast(&m_local_y(cluster->getb2())));
-            m_stats[leafClusterIndex].endTime = tbb::tick_count::now();
+            m_stats[contributionIndex].valid = true;
+            m_stats[contributionIndex].chunkStart = r.begin();
+            m_stats[contributionIndex].chunkSize = r.size();
+            m_stats[contributionIndex].startTime = tbb::tick_count::now();
+
+            const MblockContribution& contribution =
+                    m_contributions[contributionIndex];
+            applyMblockContribution(contribution.type, m_multiplier,
+                                    m_leafClusters[contribution.leaf],
+                                    m_blocks, m_x, m_local_y);
+            m_stats[contributionIndex].endTime = tbb::tick_count::now();
         }
     }
 
@@ -149,18 +303,390 @@ public:
     }
 
 private:
-    TranspositionMode m_trans;
     ValueType m_multiplier;
-    arma::Col<ValueType>& m_x;
+    arma::Mat<ValueType>& m_x;
 public:
-    arma::Col<ValueType> m_local_y;
+    arma::Mat<ValueType> m_local_y;
 private:
     AhmedLeafClusterArray& m_leafClusters;
     boost::shared_array<AhmedMblock*> m_blocks;
-    LeafClusterIndexQueue& m_leafClusterIndexQueue;
+    const std::vector<MblockContribution>& m_contributions;
+    ContributionIndexQueue& m_contributionIndexQueue;
     std::vector<ChunkStatistics>& m_stats;
 };
 
+/** \brief Compute y := y + multiplier * op(H) x by summing thread-local
+ *  copies of \p y, each accumulating a subset of \p contributions. */
+template <typename ValueType>
+void multiplyWithReduction(
+        ValueType multiplier,
+        arma::Mat<ValueType>& x,
+        arma::Mat<ValueType>& y,
+        AhmedLeafClusterArray& leafClusters,
+        const boost::shared_array<
+            mblock<typename AhmedTypeTraits<ValueType>::Type>*>& blocks,
+        const std::vector<MblockContribution>& contributions)
+{
+    const size_t contributionCount = contributions.size();
+    std::vector<ChunkStatistics> chunkStats(contributionCount);
+
+    // Process the biggest blocks first
+    std::vector<std::pair<size_t, size_t> > sizes(contributionCount);
+    for (size_t i = 0; i < contributionCount; ++i) {
+        const blcluster* cluster = leafClusters[contributions[i].leaf];
+        sizes[i] = std::make_pair(
+                    static_cast<size_t>(cluster->getn1()) * cluster->getn2(), i);
+    }
+    std::stable_sort(sizes.begin(), sizes.end(),
+                     std::greater<std::pair<size_t, size_t> >());
+
+    typedef MblockMultiplicationLoopBody<ValueType> Body;
+    typename Body::ContributionIndexQueue contributionIndexQueue;
+    for (size_t i = 0; i < contributionCount; ++i)
+        contributionIndexQueue.push(sizes[i].second);
+
+    Body body(multiplier, x, y, leafClusters, blocks, contributions,
+              contributionIndexQueue, chunkStats);
+    tbb::parallel_reduce(tbb::blocked_range<size_t>(0, contributionCount),
+                         body);
+    y = body.m_local_y;
+}
+
+/** \brief Leaf-block contributions to an H-matrix-vector product grouped
+ *  according to the disjoint ranges of output-vector entries they update. */
+struct MblockOutputPartition
+{
+    /** \brief Boundaries of the output ranges: range \p i consists of the
+     *  entries with indices from rangeStarts[i] to rangeStarts[i + 1] - 1. */
+    std::vector<unsigned int> rangeStarts;
+    /** \brief Range \p i is updated by the contributions with indices
+     *  entries[entryOffsets[i]], ..., entries[entryOffsets[i + 1] - 1]. */
+    std::vector<size_t> entryOffsets;
+    std::vector<size_t> entries;
+};
+
+/** \brief Split the output vector of an H-matrix-vector product into ranges
+ *  such that each contribution either covers a range completely or does not
+ *  touch it at all. */
+void buildMblockOutputPartition(
+        AhmedLeafClusterArray& leafClusters,
+        const std::vector<MblockContribution>& contributions,
+        unsigned int outputSize,
+        MblockOutputPartition& partition)
+{
+    const size_t contributionCount = contributions.size();
+    std::vector<unsigned int> begins(contributionCount);
+    std::vector<unsigned int> ends(contributionCount);
+    for (size_t i = 0; i < contributionCount; ++i) {
+        const blcluster* cluster = leafClusters[contributions[i].leaf];
+        if (contributions[i].updatesColumnRange()) {
+            begins[i] = cluster->getb2();
+            ends[i] = cluster->getb2() + cluster->getn2();
+        } else {
+            begins[i] = cluster->getb1();
+            ends[i] = cluster->getb1() + cluster->getn1();
+        }
+    }
+
+    std::vector<unsigned int>& starts = partition.rangeStarts;
+    starts.clear();
+    starts.reserve(2 * contributionCount + 2);
+    starts.push_back(0);
+    starts.push_back(outputSize);
+    starts.insert(starts.end(), begins.begin(), begins.end());
+    starts.insert(starts.end(), ends.begin(), ends.end());
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+    const size_t rangeCount = starts.size() - 1;
+
+    // Build a compressed list of the contributions to each range (two passes:
+    // first count, then fill)
+    std::vector<size_t>& offsets = partition.entryOffsets;
+    offsets.assign(rangeCount + 1, 0);
+    std::vector<std::pair<size_t, size_t> > coveredRanges(contributionCount);
+    for (size_t i = 0; i < contributionCount; ++i) {
+        coveredRanges[i].first =
+                std::lower_bound(starts.begin(), starts.end(), begins[i]) -
+                starts.begin();
+        coveredRanges[i].second =
+                std::lower_bound(starts.begin(), starts.end(), ends[i]) -
+                starts.begin();
+        for (size_t range = coveredRanges[i].first;
+             range < coveredRanges[i].second; ++range)
+            ++offsets[range + 1];
+    }
+    for (size_t range = 0; range < rangeCount; ++range)
+        offsets[range + 1] += offsets[range];
+
+    partition.entries.resize(offsets[rangeCount]);
+    std::vector<size_t> positions(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < contributionCount; ++i)
+        for (size_t range = coveredRanges[i].first;
+             range < coveredRanges[i].second; ++range)
+            partition.entries[positions[range]++] = i;
+}
+
+/** \brief Check whether the output-partitioning algorithm can be used.
+ *
+ *  This is the case if all off-diagonal blocks are stored either as general
+ *  dense blocks or as low-rank blocks, and no diagonal block spans more than
+ *  one output range (diagonal blocks are processed by AHMED as a whole). */
+template <typename ValueType>
+bool isOutputPartitioningApplicable(
+        AhmedLeafClusterArray& leafClusters,
+        const boost::shared_array<
+            mblock<typename AhmedTypeTraits<ValueType>::Type>*>& blocks,
+        const std::vector<MblockContribution>& contributions,
+        const MblockOutputPartition& partition)
+{
+    for (size_t i = 0; i < contributions.size(); ++i) {
+        const MblockContribution& contribution = contributions[i];
+        blcluster* cluster = leafClusters[contribution.leaf];
+        if (contribution.type == MblockContribution::SYMMETRIC_DIAGONAL ||
+                contribution.type == MblockContribution::HERMITIAN_DIAGONAL) {
+            const std::vector<unsigned int>& starts = partition.rangeStarts;
+            const size_t range =
+                    std::lower_bound(starts.begin(), starts.end(),
+                                     cluster->getb1()) - starts.begin();
+            if (starts[range + 1] != cluster->getb1() + cluster->getn1())
+                return false;
+        } else {
+            mblock<typename AhmedTypeTraits<ValueType>::Type>* block =
+                    blocks[cluster->getidx()];
+            if (!block->isGeM() && !block->isLrM())
+                return false;
+        }
+    }
+    return true;
+}
+
+// Low-rank blocks are stored by AHMED as A = U V^H, with U (n1 x rank)
+// immediately followed by V (n2 x rank) in the block's data array. Dense
+// blocks are stored column by column.
+
+/** \brief Body of the parallel loop multiplying the inner factors of all
+ *  low-rank blocks with the appropriate rows of the input multivector. */
+template <typename ValueType>
+class LowRankMblockProjectionLoopBody
+{
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+public:
+    LowRankMblockProjectionLoopBody(
+            const arma::Mat<ValueType>& x,
+            AhmedLeafClusterArray& leafClusters,
+            const boost::shared_array<AhmedMblock*>& blocks,
+            const std::vector<MblockContribution>& contributions,
+            const std::vector<size_t>& rankOffsets,
+            std::vector<ValueType>& projections) :
+        m_x(x), m_leafClusters(leafClusters), m_blocks(blocks),
+        m_contributions(contributions), m_rankOffsets(rankOffsets),
+        m_projections(projections)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+            const unsigned int rank = m_rankOffsets[i + 1] - m_rankOffsets[i];
+            if (rank == 0)
+                continue;
+            const MblockContribution& contribution = m_contributions[i];
+            blcluster* cluster = m_leafClusters[contribution.leaf];
+            AhmedMblock* block = m_blocks[cluster->getidx()];
+            const unsigned int n1 = block->getn1();
+            const unsigned int n2 = block->getn2();
+            ValueType* data = reinterpret_cast<ValueType*>(block->getdata());
+            const unsigned int colCount = m_x.n_cols;
+            arma::Mat<ValueType> projection(
+                        &m_projections[m_rankOffsets[i] * colCount],
+                        rank, colCount, false /* copy_aux_mem */);
+            if (contribution.type == MblockContribution::DIRECT) {
+                arma::Mat<ValueType> v(data + n1 * rank, n2, rank, false);
+                projection = v.t() * m_x.rows(cluster->getb2(),
+                                              cluster->getb2() + n2 - 1);
+            } else {
+                arma::Mat<ValueType> u(data, n1, rank, false);
+                if (contribution.type == MblockContribution::TRANSPOSED)
+                    projection = u.st() * m_x.rows(cluster->getb1(),
+                                                   cluster->getb1() + n1 - 1);
+                else // contribution.type == CONJUGATE_TRANSPOSED
+                    projection = u.t() * m_x.rows(cluster->getb1(),
+                                                  cluster->getb1() + n1 - 1);
+            }
+        }
+    }
+
+private:
+    const arma::Mat<ValueType>& m_x;
+    AhmedLeafClusterArray& m_leafClusters;
+    boost::shared_array<AhmedMblock*> m_blocks;
+    const std::vector<MblockContribution>& m_contributions;
+    const std::vector<size_t>& m_rankOffsets;
+    // mutable OK because each contribution writes to a separate part of
+    // this vector
+    std::vector<ValueType>& m_projections;
+};
+
+/** \brief Body of the parallel loop updating disjoint ranges of the output
+ *  vector of an H-matrix-vector product. */
+template <typename ValueType>
+class OutputRangeUpdateLoopBody
+{
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+public:
+    OutputRangeUpdateLoopBody(
+            ValueType multiplier,
+            arma::Mat<ValueType>& x,
+            arma::Mat<ValueType>& y,
+            AhmedLeafClusterArray& leafClusters,
+            const boost::shared_array<AhmedMblock*>& blocks,
+            const std::vector<MblockContribution>& contributions,
+            const MblockOutputPartition& partition,
+            const std::vector<size_t>& rankOffsets,
+            std::vector<ValueType>& projections) :
+        m_multiplier(multiplier), m_x(x), m_y(y),
+        m_leafClusters(leafClusters), m_blocks(blocks),
+        m_contributions(contributions), m_partition(partition),
+        m_rankOffsets(rankOffsets), m_projections(projections)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t range = r.begin(); range != r.end(); ++range) {
+            const unsigned int first = m_partition.rangeStarts[range];
+            const unsigned int last = m_partition.rangeStarts[range + 1] - 1;
+            for (size_t e = m_partition.entryOffsets[range];
+                 e < m_partition.entryOffsets[range + 1]; ++e) {
+                const size_t i = m_partition.entries[e];
+                const MblockContribution& contribution = m_contributions[i];
+                blcluster* cluster = m_leafClusters[contribution.leaf];
+                if (contribution.type == MblockContribution::SYMMETRIC_DIAGONAL ||
+                        contribution.type == MblockContribution::HERMITIAN_DIAGONAL) {
+                    // The block covers exactly this range
+                    applyMblockContribution(contribution.type, m_multiplier,
+                                            cluster, m_blocks, m_x, m_y);
+                    continue;
+                }
+                AhmedMblock* block = m_blocks[cluster->getidx()];
+                const unsigned int b1 = cluster->getb1();
+                const unsigned int b2 = cluster->getb2();
+                const unsigned int n1 = block->getn1();
+                const unsigned int n2 = block->getn2();
+                ValueType* data = reinterpret_cast<ValueType*>(block->getdata());
+                if (block->isLrM()) {
+                    const unsigned int rank =
+                            m_rankOffsets[i + 1] - m_rankOffsets[i];
+                    if (rank == 0)
+                        continue;
+                    arma::Mat<ValueType> projection(
+                                &m_projections[m_rankOffsets[i] * m_x.n_cols],
+                                rank, m_x.n_cols, false /* copy_aux_mem */);
+                    if (contribution.type == MblockContribution::DIRECT) {
+                        arma::Mat<ValueType> u(data, n1, rank, false);
+                        m_y.rows(first, last) += m_multiplier *
+                                (u.rows(first - b1, last - b1) * projection);
+                    } else {
+                        arma::Mat<ValueType> v(data + n1 * rank, n2, rank, false);
+                        if (contribution.type == MblockContribution::TRANSPOSED)
+                            m_y.rows(first, last) += m_multiplier *
+                                    (arma::conj(v.rows(first - b2, last - b2)) *
+                                     projection);
+                        else // contribution.type == CONJUGATE_TRANSPOSED
+                            m_y.rows(first, last) += m_multiplier *
+                                    (v.rows(first - b2, last - b2) * projection);
+                    }
+                } else { // general dense block
+                    arma::Mat<ValueType> a(data, n1, n2, false);
+                    if (contribution.type == MblockContribution::DIRECT)
+                        m_y.rows(first, last) += m_multiplier *
+                                (a.rows(first - b1, last - b1) *
+                                 m_x.rows(b2, b2 + n2 - 1));
+                    else if (contribution.type == MblockContribution::TRANSPOSED)
+                        m_y.rows(first, last) += m_multiplier *
+                                (a.cols(first - b2, last - b2).st() *
+                                 m_x.rows(b1, b1 + n1 - 1));
+                    else // contribution.type == CONJUGATE_TRANSPOSED
+                        m_y.rows(first, last) += m_multiplier *
+                                (a.cols(first - b2, last - b2).t() *
+                                 m_x.rows(b1, b1 + n1 - 1));
+                }
+            }
+        }
+    }
+
+private:
+    ValueType m_multiplier;
+    // non-const only because AHMED is not const-correct
+    arma::Mat<ValueType>& m_x;
+    // mutable OK because each range of this vector is updated by one thread
+    arma::Mat<ValueType>& m_y;
+    AhmedLeafClusterArray& m_leafClusters;
+    boost::shared_array<AhmedMblock*> m_blocks;
+    const std::vector<MblockContribution>& m_contributions;
+    const MblockOutputPartition& m_partition;
+    const std::vector<size_t>& m_rankOffsets;
+    std::vector<ValueType>& m_projections;
+};
+
+/** \brief Compute y := y + multiplier * op(H) x without making thread-local
+ *  copies of \p y.
+ *
+ *  The product is evaluated in two parallel stages. First, the inner
+ *  factors of all low-rank blocks are applied to \p x. Then the entries of
+ *  \p y are split into disjoint ranges (see buildMblockOutputPartition()),
+ *  and each range is updated by a single thread with all the contributions
+ *  covering it.
+ *
+ *  \returns false (without modifying \p y) if the algorithm is not
+ *  applicable to the H-matrix in question (see
+ *  isOutputPartitioningApplicable()), true otherwise. */
+template <typename ValueType>
+bool multiplyWithOutputPartitioning(
+        ValueType multiplier,
+        arma::Mat<ValueType>& x,
+        arma::Mat<ValueType>& y,
+        AhmedLeafClusterArray& leafClusters,
+        const boost::shared_array<
+            mblock<typename AhmedTypeTraits<ValueType>::Type>*>& blocks,
+        const std::vector<MblockContribution>& contributions)
+{
+    if (y.n_rows == 0)
+        return true;
+
+    MblockOutputPartition partition;
+    buildMblockOutputPartition(leafClusters, contributions, y.n_rows,
+                               partition);
+    if (!isOutputPartitioningApplicable<ValueType>(
+                leafClusters, blocks, contributions, partition))
+        return false;
+
+    const size_t contributionCount = contributions.size();
+    std::vector<size_t> rankOffsets(contributionCount + 1, 0);
+    for (size_t i = 0; i < contributionCount; ++i) {
+        mblock<typename AhmedTypeTraits<ValueType>::Type>* block =
+                blocks[leafClusters[contributions[i].leaf]->getidx()];
+        const bool isDiagonal =
+                contributions[i].type == MblockContribution::SYMMETRIC_DIAGONAL ||
+                contributions[i].type == MblockContribution::HERMITIAN_DIAGONAL;
+        rankOffsets[i + 1] = rankOffsets[i] +
+                (!isDiagonal && block->isLrM() ? block->rank() : 0);
+    }
+    // Each low-rank contribution needs rank * x.n_cols entries
+    std::vector<ValueType> projections(rankOffsets[contributionCount] *
+                                       x.n_cols);
+
+    typedef LowRankMblockProjectionLoopBody<ValueType> ProjectionBody;
+    typedef OutputRangeUpdateLoopBody<ValueType> UpdateBody;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, contributionCount),
+                      ProjectionBody(x, leafClusters, blocks, contributions,
+                                     rankOffsets, projections));
+    tbb::parallel_for(tbb::blocked_range<size_t>(
+                          0, partition.rangeStarts.size() - 1),
+                      UpdateBody(multiplier, x, y, leafClusters, blocks,
+                                 contributions, partition,
+                                 rankOffsets, projections));
+    return true;
+}
+
 bool areEqual(const blcluster* op1, const blcluster* op2)
 {
     if (!op1 || !op2)
@@ -177,45 +703,384 @@ bool areEqual(const blcluster* op1, const blcluster* op2)
     return true;
 }
 
-inline void mltaSyHVec(double d, blcluster* bl, mblock<double>** A, double* x,
-                       double* y)
+// Binary storage of H-matrices (see saveAcaOperator())
+
+const char acaFileMagic[8] = { 'B', 'E', 'M', 'P', 'P', 'A', 'C', 'A' };
+const boost::uint32_t acaFileVersion = 1;
+// Written in the native byte order; used to detect files created on machines
+// of different endianness
+const boost::uint32_t acaFileByteOrderMark = 0x01020304;
+
+template <typename ValueType> struct AcaFileValueTypeCode;
+template <> struct AcaFileValueTypeCode<float>
+{ enum { value = 1 }; };
+template <> struct AcaFileValueTypeCode<double>
+{ enum { value = 2 }; };
+template <> struct AcaFileValueTypeCode<std::complex<float> >
+{ enum { value = 3 }; };
+template <> struct AcaFileValueTypeCode<std::complex<double> >
+{ enum { value = 4 }; };
+
+enum AcaFileMblockKind {
+    ABSENT_MBLOCK = 0,
+    LOW_RANK_MBLOCK = 1,
+    GENERAL_DENSE_MBLOCK = 2,
+    HERMITIAN_DENSE_MBLOCK = 3,
+    LOWER_TRIANGULAR_DENSE_MBLOCK = 4,
+    UPPER_TRIANGULAR_DENSE_MBLOCK = 5
+};
+
+enum AcaFileLeafFlags {
+    ADMISSIBLE_LEAF = 1,
+    SEPARATED_LEAF = 2
+};
+
+class AcaFileWriter : boost::noncopyable
 {
-    mltaHeHVec(d, bl, A, x, y);
+public:
+    explicit AcaFileWriter(const std::string& fileName) :
+        m_stream(fileName.c_str(), std::ios::out | std::ios::binary)
+    {
+        if (!m_stream)
+            throw std::runtime_error("saveAcaOperator(): cannot open file '" +
+                                     fileName + "' for writing");
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        writeArray(&value, 1);
+    }
+
+    template <typename T>
+    void writeArray(const T* values, size_t count) {
+        if (count == 0)
+            return;
+        m_stream.write(reinterpret_cast<const char*>(values),
+                       count * sizeof(T));
+        if (!m_stream)
+            throw std::runtime_error("saveAcaOperator(): write error");
+    }
+
+    void close() {
+        m_stream.close();
+        if (!m_stream)
+            throw std::runtime_error("saveAcaOperator(): write error");
+    }
+
+private:
+    std::ofstream m_stream;
+};
+
+/** \brief Sequential reader of a file mapped into memory (or, on systems
+ *  without mmap(), loaded into a buffer). */
+class AcaFileReader : boost::noncopyable
+{
+public:
+    explicit AcaFileReader(const std::string& fileName) :
+        m_data(0), m_size(0), m_position(0), m_mapping(0)
+    {
+#ifdef BEMPP_HAS_MMAP
+        const int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("loadAcaOperator(): cannot open file '" +
+                                     fileName + "'");
+        struct stat status;
+        if (fstat(fd, &status) != 0) {
+            ::close(fd);
+            throw std::runtime_error("loadAcaOperator(): cannot determine "
+                                     "the size of file '" + fileName + "'");
+        }
+        m_size = status.st_size;
+        if (m_size > 0) {
+            void* mapping = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("loadAcaOperator(): cannot map "
+                                         "file '" + fileName + "' into memory");
+            }
+            m_mapping = mapping;
+            madvise(m_mapping, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(m_mapping);
+        }
+        ::close(fd); // the mapping stays valid
+#else
+        std::ifstream stream(fileName.c_str(), std::ios::in | std::ios::binary);
+        if (!stream)
+            throw std::runtime_error("loadAcaOperator(): cannot open file '" +
+                                     fileName + "'");
+        stream.seekg(0, std::ios::end);
+        m_buffer.resize(stream.tellg());
+        stream.seekg(0, std::ios::beg);
+        if (!m_buffer.empty())
+            stream.read(&m_buffer[0], m_buffer.size());
+        if (!stream)
+            throw std::runtime_error("loadAcaOperator(): cannot read file '" +
+                                     fileName + "'");
+        m_size = m_buffer.size();
+        m_data = m_buffer.empty() ? 0 : &m_buffer[0];
+#endif
+    }
+
+    ~AcaFileReader() {
+#ifdef BEMPP_HAS_MMAP
+        if (m_mapping)
+            munmap(m_mapping, m_size);
+#endif
+    }
+
+    template <typename T>
+    T read() {
+        T value;
+        readArray(&value, 1);
+        return value;
+    }
+
+    template <typename T>
+    void readArray(T* values, size_t count) {
+        if (count == 0)
+            return;
+        if (count > (m_size - m_position) / sizeof(T))
+            throw std::runtime_error("loadAcaOperator(): "
+                                     "unexpected end of file");
+        std::memcpy(values, m_data + m_position, count * sizeof(T));
+        m_position += count * sizeof(T);
+    }
+
+    bool atEnd() const {
+        return m_position == m_size;
+    }
+
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_position;
+    void* m_mapping;
+    std::vector<char> m_buffer;
+};
+
+void writeIndexPermutation(AcaFileWriter& writer,
+                           const IndexPermutation& permutation)
+{
+    const std::vector<unsigned int> indices = permutation.permutedIndices();
+    writer.write<boost::uint64_t>(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        writer.write<boost::uint32_t>(indices[i]);
 }
 
-inline void mltaSyHVec(float d, blcluster* bl, mblock<float>** A, float* x,
-                       float* y)
+std::vector<unsigned int> readIndexPermutation(AcaFileReader& reader,
+                                               unsigned int expectedSize)
 {
-    mltaHeHVec(d, bl, A, x, y);
+    const boost::uint64_t size = reader.read<boost::uint64_t>();
+    if (size != expectedSize)
+        throw std::runtime_error("loadAcaOperator(): index permutation has "
+                                 "incorrect length");
+    std::vector<unsigned int> indices(size);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = reader.read<boost::uint32_t>();
+        if (indices[i] >= expectedSize)
+            throw std::runtime_error("loadAcaOperator(): invalid entry in "
+                                     "index permutation");
+    }
+    return indices;
 }
 
-inline void mltaSyHVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
-                       scomp* y)
+// The tree is stored in depth-first order. Each node is described by its
+// row and column offsets and sizes and the dimensions of its array of sons.
+// Each son is preceded by a byte indicating whether it exists; leaves are
+// followed by their mblock index and admissibility flags.
+void writeBlockClusterTree(AcaFileWriter& writer, const blcluster* cluster)
 {
-    throw std::runtime_error("mltaSyHVec(): the overload of this function for "
-                             "complex single-precision numbers does not exist "
-                             "in AHMED");
+    writer.write<boost::uint32_t>(cluster->getb1());
+    writer.write<boost::uint32_t>(cluster->getb2());
+    writer.write<boost::uint32_t>(cluster->getn1());
+    writer.write<boost::uint32_t>(cluster->getn2());
+    if (cluster->isleaf()) {
+        // AHMED is not const-correct
+        blcluster* nonconstCluster = const_cast<blcluster*>(cluster);
+        writer.write<boost::uint32_t>(0);
+        writer.write<boost::uint32_t>(0);
+        writer.write<boost::uint32_t>(cluster->getidx());
+        boost::uint8_t flags = 0;
+        if (nonconstCluster->isadm())
+            flags |= ADMISSIBLE_LEAF;
+        if (nonconstCluster->issep())
+            flags |= SEPARATED_LEAF;
+        writer.write(flags);
+    } else {
+        writer.write<boost::uint32_t>(cluster->getnrs());
+        writer.write<boost::uint32_t>(cluster->getncs());
+        for (unsigned int row = 0; row < cluster->getnrs(); ++row)
+            for (unsigned int col = 0; col < cluster->getncs(); ++col) {
+                const blcluster* son = cluster->getson(row, col);
+                writer.write<boost::uint8_t>(son ? 1 : 0);
+                if (son)
+                    writeBlockClusterTree(writer, son);
+            }
+    }
+}
+
+template <typename ValueType>
+std::auto_ptr<typename DiscreteAcaBoundaryOperator<ValueType>::AhmedBemBlcluster>
+readBlockClusterTree(AcaFileReader& reader, size_t blockCount)
+{
+    typedef typename DiscreteAcaBoundaryOperator<ValueType>::AhmedBemBlcluster
+            AhmedBemBlcluster;
+
+    const unsigned int b1 = reader.read<boost::uint32_t>();
+    const unsigned int b2 = reader.read<boost::uint32_t>();
+    const unsigned int n1 = reader.read<boost::uint32_t>();
+    const unsigned int n2 = reader.read<boost::uint32_t>();
+    std::auto_ptr<AhmedBemBlcluster> cluster(
+                new AhmedBemBlcluster(b1, b2, n1, n2));
+    const unsigned int nrs = reader.read<boost::uint32_t>();
+    const unsigned int ncs = reader.read<boost::uint32_t>();
+    if (nrs == 0 || ncs == 0) {
+        const unsigned int idx = reader.read<boost::uint32_t>();
+        if (idx >= blockCount)
+            throw std::runtime_error("loadAcaOperator(): invalid mblock index");
+        const boost::uint8_t flags = reader.read<boost::uint8_t>();
+        cluster->setidx(idx);
+        cluster->setadm(flags & ADMISSIBLE_LEAF);
+        cluster->setsep(flags & SEPARATED_LEAF);
+    } else {
+        std::vector<blcluster*> sons(nrs * ncs, 0);
+        try {
+            for (size_t i = 0; i < sons.size(); ++i)
+                if (reader.read<boost::uint8_t>())
+                    sons[i] = readBlockClusterTree<ValueType>(
+                                reader, blockCount).release();
+        }
+        catch (...) {
+            for (size_t i = 0; i < sons.size(); ++i)
+                delete sons[i];
+            throw; // rethrow
+        }
+        cluster->setsons(nrs, ncs, &sons[0]);
+    }
+    return cluster;
 }
 
-// For real types, SyHh = SyH
-inline void mltaSyHhVec(double d, blcluster* bl, mblock<double>** A, double* x,
-                        double* y)
+template <typename ValueType>
+void writeMblock(AcaFileWriter& writer,
+                 const mblock<typename AhmedTypeTraits<ValueType>::Type>* block)
 {
-    mltaSyHVec(d, bl, A, x, y);
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+
+    if (!block) {
+        writer.write<boost::uint8_t>(ABSENT_MBLOCK);
+        return;
+    }
+    // AHMED is not const-correct
+    AhmedMblock* nonconstBlock = const_cast<AhmedMblock*>(block);
+    boost::uint8_t kind;
+    if (nonconstBlock->isLrM())
+        kind = LOW_RANK_MBLOCK;
+    else if (nonconstBlock->isHeM())
+        kind = HERMITIAN_DENSE_MBLOCK;
+    else if (nonconstBlock->isLtM())
+        kind = LOWER_TRIANGULAR_DENSE_MBLOCK;
+    else if (nonconstBlock->isUtM())
+        kind = UPPER_TRIANGULAR_DENSE_MBLOCK;
+    else
+        kind = GENERAL_DENSE_MBLOCK;
+    writer.write(kind);
+    writer.write<boost::uint32_t>(nonconstBlock->getn1());
+    writer.write<boost::uint32_t>(nonconstBlock->getn2());
+    writer.write<boost::uint32_t>(
+                kind == LOW_RANK_MBLOCK ? nonconstBlock->rank() : 0);
+    writer.write<boost::uint64_t>(nonconstBlock->nvals());
+    writer.writeArray(nonconstBlock->getdata(), nonconstBlock->nvals());
 }
 
-inline void mltaSyHhVec(float d, blcluster* bl, mblock<float>** A, float* x,
-                        float* y)
+// Read an mblock stored by writeMblock(). The dimensions stored in the file
+// must equal expectedN1 x expectedN2, the dimensions of the leaf of the
+// block cluster tree the mblock belongs to.
+template <typename ValueType>
+mblock<typename AhmedTypeTraits<ValueType>::Type>* readMblock(
+        AcaFileReader& reader,
+        unsigned int expectedN1, unsigned int expectedN2)
 {
-    mltaSyHVec(d, bl, A, x, y);
+    typedef mblock<typename AhmedTypeTraits<ValueType>::Type> AhmedMblock;
+
+    const boost::uint8_t kind = reader.read<boost::uint8_t>();
+    if (kind == ABSENT_MBLOCK)
+        return 0;
+    const unsigned int n1 = reader.read<boost::uint32_t>();
+    const unsigned int n2 = reader.read<boost::uint32_t>();
+    const unsigned int rank = reader.read<boost::uint32_t>();
+    const boost::uint64_t valueCount = reader.read<boost::uint64_t>();
+    if (n1 != expectedN1 || n2 != expectedN2)
+        throw std::runtime_error("loadAcaOperator(): mblock dimensions do not "
+                                 "match the block cluster tree");
+
+    std::auto_ptr<AhmedMblock> block(new AhmedMblock(n1, n2));
+    switch (kind) {
+    case LOW_RANK_MBLOCK:
+        block->setrank(rank);
+        break;
+    case GENERAL_DENSE_MBLOCK:
+        block->setGeM();
+        break;
+    case HERMITIAN_DENSE_MBLOCK:
+        block->setHeM();
+        break;
+    case LOWER_TRIANGULAR_DENSE_MBLOCK:
+        block->setLtM();
+        break;
+    case UPPER_TRIANGULAR_DENSE_MBLOCK:
+        block->setUtM();
+        break;
+    default:
+        throw std::runtime_error("loadAcaOperator(): invalid mblock type");
+    }
+    if (valueCount != block->nvals())
+        throw std::runtime_error("loadAcaOperator(): mblock size does not "
+                                 "match its dimensions");
+    reader.readArray(block->getdata(), valueCount);
+    return block.release();
 }
 
-inline void mltaSyHhVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
-                        scomp* y)
+// Conversion of H-matrices to single precision (see
+// singlePrecisionAcaOperator())
+
+template <typename TargetValueType>
+std::auto_ptr<typename DiscreteAcaBoundaryOperator<TargetValueType>::AhmedBemBlcluster>
+copyBlockClusterTree(const blcluster* cluster)
 {
-    throw std::runtime_error("mltaSyHhVec(): the overload of this function for "
-                             "complex single-precision numbers does not exist "
-                             "in AHMED");
+    typedef typename DiscreteAcaBoundaryOperator<TargetValueType>::AhmedBemBlcluster
+            AhmedBemBlcluster;
+
+    std::auto_ptr<AhmedBemBlcluster> copy(
+                new AhmedBemBlcluster(cluster->getb1(), cluster->getb2(),
+                                      cluster->getn1(), cluster->getn2()));
+    if (cluster->isleaf()) {
+        // AHMED is not const-correct
+        blcluster* nonconstCluster = const_cast<blcluster*>(cluster);
+        copy->setidx(cluster->getidx());
+        copy->setadm(nonconstCluster->isadm());
+        copy->setsep(nonconstCluster->issep());
+    } else {
+        const unsigned int nrs = cluster->getnrs();
+        const unsigned int ncs = cluster->getncs();
+        std::vector<blcluster*> sons(nrs * ncs, 0);
+        try {
+            for (unsigned int row = 0; row < nrs; ++row)
+                for (unsigned int col = 0; col < ncs; ++col) {
+                    const blcluster* son = cluster->getson(row, col);
+                    if (son)
+                        sons[row * ncs + col] =
+                                copyBlockClusterTree<TargetValueType>(son)
+                                .release();
+                }
+        }
+        catch (...) {
+            for (size_t i = 0; i < sons.size(); ++i)
+                delete sons[i];
+            throw; // rethrow
+        }
+        copy->setsons(nrs, ncs, &sons[0]);
+    }
+    return copy;
 }
 
 } // namespace
@@ -462,6 +1327,21 @@ applyBuiltInImpl(const TranspositionMode trans,
                  arma::Col<ValueType>& y_inout,
                  const ValueType alpha,
                  const ValueType beta) const
+{
+    applyBuiltInImpl(trans,
+                     static_cast<const arma::Mat<ValueType>&>(x_in),
+                     static_cast<arma::Mat<ValueType>&>(y_inout),
+                     alpha, beta);
+}
+
+template <typename ValueType>
+void
+DiscreteAcaBoundaryOperator<ValueType>::
+applyBuiltInImpl(const TranspositionMode trans,
+                 const arma::Mat<ValueType>& x_in,
+                 arma::Mat<ValueType>& y_inout,
+                 const ValueType alpha,
+                 const ValueType beta) const
 {
     if (trans != NO_TRANSPOSE && trans != TRANSPOSE && trans != CONJUGATE_TRANSPOSE)
         throw std::runtime_error(
@@ -479,102 +1359,73 @@ applyBuiltInImpl(const TranspositionMode trans,
                             columnCount() != y_inout.n_rows)))
         throw std::invalid_argument(
                 "DiscreteAcaBoundaryOperator::applyBuiltInImpl(): "
-                "incorrect vector length");
+                "incorrect number of rows");
 
     if (beta == static_cast<ValueType>(0.))
         y_inout.fill(static_cast<ValueType>(0.));
     else
         y_inout *= beta;
 
-    arma::Col<ValueType> permutedArgument;
+    arma::Mat<ValueType> permutedArgument;
     if (!transposed)
-        m_domainPermutation.permuteVector(x_in, permutedArgument);
+        m_domainPermutation.permuteRows(x_in, permutedArgument);
     else
-        m_rangePermutation.permuteVector(x_in, permutedArgument);
+        m_rangePermutation.permuteRows(x_in, permutedArgument);
 
-    arma::Col<ValueType> permutedResult;
+    arma::Mat<ValueType> permutedResult;
     if (!transposed)
-        m_rangePermutation.permuteVector(y_inout, permutedResult);
+        m_rangePermutation.permuteRows(y_inout, permutedResult);
     else
-        m_domainPermutation.permuteVector(y_inout, permutedResult);
-
-    if (m_symmetry & SYMMETRIC) {
-        // TODO: parallelise
-        if (trans == NO_TRANSPOSE || trans == TRANSPOSE)
-            mltaSyHVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-                       ahmedCast(permutedArgument.memptr()),
-                       ahmedCast(permutedResult.memptr()));
-        else // trans == CONJUGATE_TRANSPOSE
-            mltaSyHhVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-                       ahmedCast(permutedArgument.memptr()),
-                       ahmedCast(permutedResult.memptr()));
-    }
-    else if (m_symmetry & HERMITIAN) {
-        // NO_TRANSPOSE and CONJUGATE_TRANSPOSE are equivalent
-        if (trans == NO_TRANSPOSE || trans == CONJUGATE_TRANSPOSE)
-            mltaHeHVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-                       ahmedCast(permutedArgument.memptr()),
-                       ahmedCast(permutedResult.memptr()));
-        else { // trans == TRANSPOSE
-            // alpha A^T x + beta y = (alpha^* A^H x^* + beta^* y^*)^*
-            // = (alpha^* A x^* + beta^* y^*)^*
-            permutedArgument = arma::conj(permutedArgument);
-            permutedResult = arma::conj(permutedResult);
-            ValueType alphaConj = conj(alpha);
-            mltaHeHVec(ahmedCast(alphaConj), nonconstBlockCluster, m_blocks.get(),
-                       ahmedCast(permutedArgument.memptr()),
-                       ahmedCast(permutedResult.memptr()));
-            permutedResult = arma::conj(permutedResult);
-        }
+        m_domainPermutation.permuteRows(y_inout, permutedResult);
+
+    AhmedLeafClusterArray leafClusters(nonconstBlockCluster);
+    std::vector<MblockContribution> contributions;
+
+    // For symmetric and Hermitian H-matrices, reduce the problem to
+    // computing y := alpha H x, using the identities
+    // alpha conj(H) x + beta y = (alpha^* H x^* + beta^* y^*)^*
+    // (needed for CONJUGATE_TRANSPOSE if H is symmetric and TRANSPOSE if H
+    // is Hermitian)
+    bool conjugate = false;
+    if (m_symmetry & (SYMMETRIC | HERMITIAN)) {
+        const bool hermitian = !(m_symmetry & SYMMETRIC);
+        if (boost::is_complex<ValueType>())
+            conjugate = hermitian ? (trans == TRANSPOSE)
+                                  : (trans == CONJUGATE_TRANSPOSE);
+        listSymmetricMblockContributions(leafClusters, hermitian,
+                                         contributions);
     }
-    else {
-//        if (trans == NO_TRANSPOSE)
-//            mltaGeHVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-//                       ahmedCast(permutedArgument.memptr()),
-//                       ahmedCast(permutedResult.memptr()));
-//        else // trans == CONJUGATE_TRANSPOSE
-//            mltaGeHhVec(ahmedCast(alpha), nonconstBlockCluster, m_blocks.get(),
-//                        ahmedCast(permutedArgument.memptr()),
-//                        ahmedCast(permutedResult.memptr()));
-
-        AhmedLeafClusterArray leafClusters(nonconstBlockCluster);
-        leafClusters.sortAccordingToClusterSize();
-        const size_t leafClusterCount = leafClusters.size();
-
-        int maxThreadCount = 1;
-        if (!m_parallelizationOptions.isOpenClEnabled()) {
-            if (m_parallelizationOptions.maxThreadCount() ==
-                    ParallelizationOptions::AUTO)
-                maxThreadCount = tbb::task_scheduler_init::automatic;
-            else
-                maxThreadCount = m_parallelizationOptions.maxThreadCount();
-        }
-        tbb::task_scheduler_init scheduler(maxThreadCount);
-
-        std::vector<ChunkStatistics> chunkStats(leafClusterCount);
-
-        typedef MblockMultiplicationLoopBody<ValueType> Body;
-        typename Body::LeafClusterIndexQueue leafClusterIndexQueue;
-        for (size_t i = 0; i < leafClusterCount; ++i)
-            leafClusterIndexQueue.push(i);
-
-        // std::cout << "----------------------------\nperm Arg\n" << permutedArgument;
-        // std::cout << "perm Res\n" << permutedResult;
-        Body body(trans,
-                  alpha, permutedArgument, permutedResult,
-                  leafClusters, m_blocks,
-                  leafClusterIndexQueue, chunkStats);
-        {
-            Fiber::SerialBlasRegion region;
-            tbb::parallel_reduce(tbb::blocked_range<size_t>(0, leafClusterCount),
-                                 body);
-        }
-        permutedResult = body.m_local_y;
+    else
+        listNonsymmetricMblockContributions(leafClusters.size(), trans,
+                                            contributions);
+
+    ValueType multiplier = alpha;
+    if (conjugate) {
+        permutedArgument = arma::conj(permutedArgument);
+        permutedResult = arma::conj(permutedResult);
+        multiplier = conj(alpha);
+    }
+
+    Fiber::ScopedScheduler scheduler(m_parallelizationOptions);
+    {
+        Fiber::SerialBlasRegion region;
+        if (m_parallelizationOptions.hMatrixMultiplicationMode() !=
+                ParallelizationOptions::OUTPUT_PARTITIONING ||
+                !multiplyWithOutputPartitioning(multiplier,
+                                                permutedArgument, permutedResult,
+                                                leafClusters, m_blocks,
+                                                contributions))
+            multiplyWithReduction(multiplier, permutedArgument, permutedResult,
+                                  leafClusters, m_blocks, contributions);
     }
+
+    if (conjugate)
+        permutedResult = arma::conj(permutedResult);
+
     if (!transposed)
-        m_rangePermutation.unpermuteVector(permutedResult, y_inout);
+        m_rangePermutation.unpermuteRows(permutedResult, y_inout);
     else
-        m_domainPermutation.unpermuteVector(permutedResult, y_inout);
+        m_domainPermutation.unpermuteRows(permutedResult, y_inout);
 }
 
 template <typename ValueType>
@@ -817,6 +1668,166 @@ shared_ptr<const DiscreteBoundaryOperator<ValueType> > acaOperatorApproximateLuI
     return result;
 }
 
+template <typename ValueType>
+void saveAcaOperator(
+        const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& op,
+        const std::string& fileName)
+{
+    shared_ptr<const DiscreteAcaBoundaryOperator<ValueType> > acaOp =
+            DiscreteAcaBoundaryOperator<ValueType>::castToAca(op);
+    if (!acaOp)
+        throw std::invalid_argument("saveAcaOperator(): "
+                                    "operand must not be null");
+
+    const size_t blockCount = acaOp->blockCount();
+    typename DiscreteAcaBoundaryOperator<ValueType>::AhmedMblockArray blocks =
+            acaOp->blocks();
+
+    AcaFileWriter writer(fileName);
+    writer.writeArray(acaFileMagic, sizeof(acaFileMagic));
+    writer.write(acaFileByteOrderMark);
+    writer.write(acaFileVersion);
+    writer.write<boost::uint32_t>(AcaFileValueTypeCode<ValueType>::value);
+    writer.write<boost::uint32_t>(acaOp->rowCount());
+    writer.write<boost::uint32_t>(acaOp->columnCount());
+    writer.write<double>(acaOp->eps());
+    writer.write<boost::int32_t>(acaOp->maximumRank());
+    writer.write<boost::int32_t>(acaOp->symmetry());
+    writer.write<boost::uint64_t>(blockCount);
+    writeIndexPermutation(writer, acaOp->domainPermutation());
+    writeIndexPermutation(writer, acaOp->rangePermutation());
+    writeBlockClusterTree(writer, acaOp->blockCluster().get());
+    for (size_t b = 0; b < blockCount; ++b)
+        writeMblock<ValueType>(writer, blocks[b]);
+    writer.close();
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType> > loadAcaOperator(
+        const std::string& fileName,
+        const ParallelizationOptions& parallelizationOptions)
+{
+    typedef typename DiscreteAcaBoundaryOperator<ValueType>::AhmedBemBlcluster
+            AhmedBemBlcluster;
+    typedef typename DiscreteAcaBoundaryOperator<ValueType>::AhmedMblock
+            AhmedMblock;
+
+    AcaFileReader reader(fileName);
+    char magic[sizeof(acaFileMagic)];
+    reader.readArray(magic, sizeof(magic));
+    if (!std::equal(magic, magic + sizeof(magic), acaFileMagic))
+        throw std::runtime_error("loadAcaOperator(): file '" + fileName +
+                                 "' does not contain a H-matrix");
+    if (reader.read<boost::uint32_t>() != acaFileByteOrderMark)
+        throw std::runtime_error("loadAcaOperator(): file '" + fileName +
+                                 "' was created on a machine with different "
+                                 "byte order");
+    if (reader.read<boost::uint32_t>() != acaFileVersion)
+        throw std::runtime_error("loadAcaOperator(): file '" + fileName +
+                                 "' has an unsupported format version");
+    if (reader.read<boost::uint32_t>() !=
+            static_cast<boost::uint32_t>(AcaFileValueTypeCode<ValueType>::value))
+        throw std::runtime_error("loadAcaOperator(): file '" + fileName +
+                                 "' stores a H-matrix of a different "
+                                 "value type");
+
+    const unsigned int rowCount = reader.read<boost::uint32_t>();
+    const unsigned int columnCount = reader.read<boost::uint32_t>();
+    const double eps = reader.read<double>();
+    const int maximumRank = reader.read<boost::int32_t>();
+    const int symmetry = reader.read<boost::int32_t>();
+    const size_t blockCount = reader.read<boost::uint64_t>();
+    const std::vector<unsigned int> domainPermutation =
+            readIndexPermutation(reader, columnCount);
+    const std::vector<unsigned int> rangePermutation =
+            readIndexPermutation(reader, rowCount);
+
+    shared_ptr<const AhmedBemBlcluster> blockCluster(
+                readBlockClusterTree<ValueType>(reader, blockCount).release());
+    if (blockCluster->nleaves() != blockCount)
+        throw std::runtime_error("loadAcaOperator(): number of mblocks does "
+                                 "not match the block cluster tree");
+    // Dimensions of the leaf associated with each mblock
+    std::vector<std::pair<unsigned int, unsigned int> > blockDims(
+                blockCount, std::make_pair(0u, 0u));
+    std::vector<bool> blockHasLeaf(blockCount, false);
+    AhmedLeafClusterArray leafClusters(
+                const_cast<AhmedBemBlcluster*>(blockCluster.get()));
+    for (size_t l = 0; l < leafClusters.size(); ++l) {
+        const blcluster* leaf = leafClusters[l];
+        const unsigned int idx = leaf->getidx();
+        if (blockHasLeaf[idx])
+            throw std::runtime_error("loadAcaOperator(): mblock index used "
+                                     "by several leaves of the block cluster "
+                                     "tree");
+        blockHasLeaf[idx] = true;
+        blockDims[idx] = std::make_pair(leaf->getn1(), leaf->getn2());
+    }
+    boost::shared_array<AhmedMblock*> blocks =
+            allocateAhmedMblockArray<ValueType>(blockCount);
+    for (size_t b = 0; b < blockCount; ++b)
+        blocks[b] = readMblock<ValueType>(reader, blockDims[b].first,
+                                          blockDims[b].second);
+    if (!reader.atEnd())
+        throw std::runtime_error("loadAcaOperator(): unexpected data at the "
+                                 "end of file '" + fileName + "'");
+
+    shared_ptr<const DiscreteBoundaryOperator<ValueType> > result(
+                new DiscreteAcaBoundaryOperator<ValueType>(
+                    rowCount, columnCount, eps, maximumRank, symmetry,
+                    blockCluster, blocks,
+                    domainPermutation, rangePermutation,
+                    parallelizationOptions));
+    return result;
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<
+    typename Fiber::ScalarTraits<ValueType>::SinglePrecisionType> >
+singlePrecisionAcaOperator(
+        const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& op)
+{
+#if defined(ENABLE_SINGLE_PRECISION)
+    typedef typename Fiber::ScalarTraits<ValueType>::SinglePrecisionType
+            SinglePrecisionType;
+    typedef DiscreteAcaBoundaryOperator<SinglePrecisionType>
+            SinglePrecisionAcaOp;
+    typedef typename SinglePrecisionAcaOp::AhmedBemBlcluster AhmedBemBlcluster;
+    typedef typename SinglePrecisionAcaOp::AhmedMblock AhmedMblock;
+
+    shared_ptr<const DiscreteAcaBoundaryOperator<ValueType> > acaOp =
+            DiscreteAcaBoundaryOperator<ValueType>::castToAca(op);
+    if (!acaOp)
+        throw std::invalid_argument("singlePrecisionAcaOperator(): "
+                                    "operand must not be null");
+
+    shared_ptr<const AhmedBemBlcluster> blockCluster(
+                copyBlockClusterTree<SinglePrecisionType>(
+                    acaOp->blockCluster().get()).release());
+    const size_t blockCount = acaOp->blockCount();
+    typename DiscreteAcaBoundaryOperator<ValueType>::AhmedMblockArray
+            sourceBlocks = acaOp->blocks();
+    boost::shared_array<AhmedMblock*> blocks =
+            allocateAhmedMblockArray<SinglePrecisionType>(blockCount);
+    for (size_t b = 0; b < blockCount; ++b)
+        blocks[b] = convertMblock<SinglePrecisionType, ValueType>(
+                    sourceBlocks[b]);
+
+    shared_ptr<const DiscreteBoundaryOperator<SinglePrecisionType> > result(
+                new SinglePrecisionAcaOp(
+                    acaOp->rowCount(), acaOp->columnCount(),
+                    acaOp->eps(), acaOp->maximumRank(), acaOp->symmetry(),
+                    blockCluster, blocks,
+                    acaOp->domainPermutation(), acaOp->rangePermutation(),
+                    acaOp->parallelizationOptions()));
+    return result;
+#else
+    throw std::runtime_error("singlePrecisionAcaOperator(): "
+                             "BEM++ has been compiled without support for "
+                             "single precision");
+#endif
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteAcaBoundaryOperator);
 
 #define INSTANTIATE_FREE_FUNCTIONS(RESULT) \
@@ -836,7 +1847,19 @@ FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteAcaBoundaryOperator);
     template shared_ptr<const DiscreteBoundaryOperator<RESULT> > \
         acaOperatorApproximateLuInverse( \
             const shared_ptr<const DiscreteBoundaryOperator<RESULT> >& op, \
-            double delta)
+            double delta); \
+    template void \
+        saveAcaOperator( \
+            const shared_ptr<const DiscreteBoundaryOperator<RESULT> >& op, \
+            const std::string& fileName); \
+    template shared_ptr<const DiscreteBoundaryOperator< \
+            Fiber::ScalarTraits<RESULT>::SinglePrecisionType> > \
+        singlePrecisionAcaOperator( \
+            const shared_ptr<const DiscreteBoundaryOperator<RESULT> >& op); \
+    template shared_ptr<const DiscreteBoundaryOperator<RESULT> > \
+        loadAcaOperator<RESULT>( \
+            const std::string& fileName, \
+            const ParallelizationOptions& parallelizationOptions)
 
 #if defined(ENABLE_SINGLE_PRECISION)
 INSTANTIATE_FREE_FUNCTIONS(float);
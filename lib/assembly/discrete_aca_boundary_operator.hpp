@@ -120,6 +120,69 @@ shared_ptr<const DiscreteBoundaryOperator<ValueType> > acaOperatorApproximateLuI
         const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& op,
         double delta);
 
+/** \brief Save a discrete boundary operator stored as a H-matrix to a file.
+ *
+ *  The block cluster tree, the mblocks (dense blocks and factors of low-rank
+ *  blocks) and the domain and range index permutations of the H-matrix are
+ *  written to the file \p fileName in a compact, versioned binary format. The
+ *  operator can subsequently be recreated with loadAcaOperator(), which makes
+ *  it possible to reuse an assembled weak form across program runs.
+ *
+ *  Numbers are stored in the native byte order, so the file can only be read
+ *  on machines of the same endianness.
+ *
+ *  A std::bad_cast exception is thrown if \p op can not be cast to
+ *  DiscreteAcaBoundaryOperator; a std::runtime_error is thrown if the file
+ *  can not be written. */
+template <typename ValueType>
+void saveAcaOperator(
+        const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& op,
+        const std::string& fileName);
+
+/** \brief Load a discrete boundary operator stored as a H-matrix from a file
+ *  created by saveAcaOperator().
+ *
+ *  \param[in] fileName
+ *    Name of the file to read.
+ *  \param[in] parallelizationOptions
+ *    Options determining the maximum number of threads used in
+ *    the apply() routine of the loaded operator.
+ *
+ *  On POSIX systems the file is memory-mapped rather than read through a
+ *  stream. A std::runtime_error is thrown if the file can not be read, is
+ *  corrupt, was written by an incompatible version of BEM++ or stores an
+ *  operator with a value type different from \p ValueType. */
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<ValueType> > loadAcaOperator(
+        const std::string& fileName,
+        const ParallelizationOptions& parallelizationOptions =
+            ParallelizationOptions());
+
+/** \brief Convert a discrete boundary operator stored as a H-matrix to
+ *  single precision.
+ *
+ *  \param[in] op Discrete boundary operator to be converted.
+ *
+ *  \return A shared pointer to a newly allocated discrete boundary operator
+ *  storing a copy of the H-matrix representation of \p op, with all entries
+ *  rounded to \c float (if \p ValueType is real) or
+ *  <tt>std::complex<float></tt> (if \p ValueType is complex). The block
+ *  cluster tree, the index permutations and the parameters used in the
+ *  assembly of \p op are preserved.
+ *
+ *  The returned operator takes half the memory of a double-precision
+ *  H-matrix. It can be applied to vectors of type \p ValueType after wrapping
+ *  it in a MixedPrecisionDiscreteBoundaryOperator.
+ *
+ *  A std::bad_cast exception is thrown if \p op can not be cast to
+ *  DiscreteAcaBoundaryOperator; a std::runtime_error is thrown if BEM++ has
+ *  been compiled without support for single precision. */
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<
+    typename Fiber::ScalarTraits<ValueType>::SinglePrecisionType> >
+singlePrecisionAcaOperator(
+        const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& op);
+
 // class DiscreteAcaBoundaryOperator
 
 /** \ingroup discrete_boundary_operators
@@ -186,9 +249,6 @@ public:
      *    depends and which therefore must stay alive for the lifetime
      *    of this operator. Useful for constructing ACA operators that
      *    combine mblocks of several other operators.
-     *
-     *  \note Currently the apply() routine is only parallelized for
-     *  non-Hermitian H-matrices.
      */
     DiscreteAcaBoundaryOperator(
             unsigned int rowCount, unsigned int columnCount,
@@ -233,9 +293,6 @@ public:
      *    of this operator. Useful for constructing ACA operators that
      *    combine mblocks of several other operators.
      *
-     *  \note Currently the apply() routine is only parallelized for
-     *  non-Hermitian H-matrices.
-     *
      *  \deprecated This constructor is deprecated. Use the non-deprecated
      *  constructor. */
     DiscreteAcaBoundaryOperator(
@@ -280,9 +337,6 @@ public:
      *    of this operator. Useful for constructing ACA operators that
      *    combine mblocks of several other operators.
      *
-     *  \note Currently the apply() routine is only parallelized for
-     *  non-Hermitian H-matrices.
-     *
      *  \deprecated This constructor is deprecated. Use the non-deprecated
      *  constructor.
      */
@@ -392,6 +446,11 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const;
+    virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                  const arma::Mat<ValueType>& x_in,
+                                  arma::Mat<ValueType>& y_inout,
+                                  const ValueType alpha,
+                                  const ValueType beta) const;
 
 private:
     /** \cond PRIVATE */
@@ -125,6 +125,11 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const;
+    virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                  const arma::Mat<ValueType>& x_in,
+                                  arma::Mat<ValueType>& y_inout,
+                                  const ValueType alpha,
+                                  const ValueType beta) const;
 private:
     /** \cond PRIVATE */
     Fiber::_2dArray<shared_ptr<const Base> > m_blocks;
@@ -30,7 +30,7 @@
 
 #include "../fiber/explicit_instantiation.hpp"
 
-#include <Thyra_DetachedSpmdVectorView.hpp>
+#include <Thyra_DetachedMultiVectorView.hpp>
 
 namespace Bempp
 {
@@ -83,6 +83,24 @@ void DiscreteBoundaryOperator<ValueType>::dump() const
     std::cout << asMatrix() << std::endl;
 }
 
+template <typename ValueType>
+void DiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    // Default implementation: apply the operator to each column separately
+    for (size_t col = 0; col < x_in.n_cols; ++col) {
+        const arma::Col<ValueType> xCol(
+                    const_cast<ValueType*>(x_in.colptr(col)), x_in.n_rows,
+                    false /* copy_aux_mem */);
+        arma::Col<ValueType> yCol(y_inout.colptr(col), y_inout.n_rows, false);
+        applyBuiltInImpl(trans, xCol, yCol, alpha, beta);
+    }
+}
+
 #ifdef WITH_TRILINOS
 template <typename ValueType>
 void DiscreteBoundaryOperator<ValueType>::applyImpl(
@@ -104,22 +122,38 @@ void DiscreteBoundaryOperator<ValueType>::applyImpl(
 
     const Ordinal colCount = X_in.domain()->dim();
 
-    // Loop over the input columns
+    // Get access to all columns of X_in and Y_inout at once
+    Thyra::ConstDetachedMultiVectorView<ValueType> xView(
+                Teuchos::rcpFromRef(X_in));
+    Thyra::DetachedMultiVectorView<ValueType> yView(
+                Teuchos::rcpFromPtr(Y_inout));
+
+    if (xView.leadingDim() == xView.subDim() &&
+            yView.leadingDim() == yView.subDim()) {
+        // Both multivectors are stored contiguously, column by column: wrap
+        // them in Armadillo matrices and apply the operator to all columns
+        // in one go. const_cast is used because it's more natural to have a
+        // const arma::Mat<ValueType> array than an arma::Mat<const ValueType>
+        // one.
+        const arma::Mat<ValueType> xMat(
+                    const_cast<ValueType*>(xView.values()),
+                    xView.subDim(), colCount, false /* copy_aux_mem */);
+        arma::Mat<ValueType> yMat(yView.values(), yView.subDim(), colCount,
+                                  false);
+        applyBuiltInImpl(static_cast<TranspositionMode>(M_trans),
+                         xMat, yMat, alpha, beta);
+        return;
+    }
 
+    // Loop over the input columns
     for (Ordinal col = 0; col < colCount; ++col) {
-        // Get access the the elements of X_in's and Y_inout's column #col
-        Thyra::ConstDetachedSpmdVectorView<ValueType> xVec(X_in.col(col));
-        Thyra::DetachedSpmdVectorView<ValueType> yVec(Y_inout->col(col));
-        const Teuchos::ArrayRCP<const ValueType> xArray(xVec.sv().values());
-        const Teuchos::ArrayRCP<ValueType> yArray(yVec.sv().values());
-
-        // Wrap the Trilinos array in an Armadillo vector. const_cast is used
-        // because it's more natural to have a const arma::Col<ValueType> array
-        // than an arma::Col<const ValueType> one.
+        // Wrap the Trilinos columns in Armadillo vectors
         const arma::Col<ValueType> xCol(
-                    const_cast<ValueType*>(xArray.get()), xArray.size(),
+                    const_cast<ValueType*>(xView.values() + col * xView.leadingDim()),
+                    xView.subDim(),
                     false /* copy_aux_mem */);
-        arma::Col<ValueType> yCol(yArray.get(), yArray.size(), false);
+        arma::Col<ValueType> yCol(yView.values() + col * yView.leadingDim(),
+                                  yView.subDim(), false);
 
         applyBuiltInImpl(static_cast<TranspositionMode>(M_trans),
                          xCol, yCol, alpha, beta);
@@ -156,6 +156,56 @@ public:
         applyBuiltInImpl(trans, x_in, y_inout, alpha, beta);
     }
 
+    /** \brief Apply the operator to several vectors at once.
+     *
+     *  Set the elements of the matrix \p y_inout to
+     *
+     *  <tt>y_inout := alpha * trans(L) * x_in + beta * y_inout</tt>,
+     *
+     *  where \c L is the linear operator represented by this object and each
+     *  column of \p x_in and \p y_inout is treated as a separate vector.
+     *
+     *  \param[in] trans
+     *    Determines whether what is applied is the "bare" operator, its
+     *    transpose, conjugate or conjugate transpose.
+     *  \param[in] x_in
+     *    The right-hand-side multivector, stored column by column.
+     *  \param[in,out] y_inout
+     *    The target multivector being transformed. It must have as many
+     *    columns as \p x_in. When <tt>beta == 0.0</tt>, this multivector can
+     *    have uninitialized elements.
+     *  \param[in] alpha
+     *    Scalar multiplying this operator.
+     *  \param[in] beta
+     *    The multiplier for the target multivector \p y_inout.
+     *
+     *  Operators whose storage allows it (e.g. dense matrices, sparse
+     *  matrices and H-matrices) traverse their data only once for all
+     *  columns; the others apply themselves to each column in turn.
+     *
+     *  This overload is always available, even if the library was compiled
+     *  without Trilinos.
+     */
+    void apply(const TranspositionMode trans,
+               const arma::Mat<ValueType>& x_in,
+               arma::Mat<ValueType>& y_inout,
+               const ValueType alpha,
+               const ValueType beta) const {
+        bool transposed = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+        if (x_in.n_rows != (transposed ? rowCount() : columnCount()))
+            throw std::invalid_argument("DiscreteBoundaryOperator::apply(): "
+                                        "matrix x_in has invalid number of rows");
+        if (y_inout.n_rows != (transposed ? columnCount() : rowCount()))
+            throw std::invalid_argument("DiscreteBoundaryOperator::apply(): "
+                                        "matrix y_inout has invalid number of rows");
+        if (x_in.n_cols != y_inout.n_cols)
+            throw std::invalid_argument("DiscreteBoundaryOperator::apply(): "
+                                        "matrices x_in and y_inout have "
+                                        "different numbers of columns");
+
+        applyBuiltInImpl(trans, x_in, y_inout, alpha, beta);
+    }
+
     /** \brief Return a representation that can be casted to a
      *  DiscreteAcaBoundaryOperator
      *
@@ -243,6 +293,17 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const = 0;
+
+    /** \brief Multi-vector variant of applyBuiltInImpl().
+     *
+     *  The default implementation applies the operator to each column of
+     *  \p x_in separately. Subclasses able to process all columns in a
+     *  single pass over their data should override it. */
+    virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                  const arma::Mat<ValueType>& x_in,
+                                  arma::Mat<ValueType>& y_inout,
+                                  const ValueType alpha,
+                                  const ValueType beta) const;
 };
 
 /** \brief Unary plus: return a copy of the argument. */
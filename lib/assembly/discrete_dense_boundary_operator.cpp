@@ -115,12 +115,27 @@ void DiscreteDenseBoundaryOperator<ValueType>::applyBuiltInImpl(
         arma::Col<ValueType>& y_inout,
         const ValueType alpha,
         const ValueType beta) const
+{
+    applyBuiltInImpl(trans,
+                     static_cast<const arma::Mat<ValueType>&>(x_in),
+                     static_cast<arma::Mat<ValueType>&>(y_inout),
+                     alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteDenseBoundaryOperator<ValueType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
 {
     if (beta == static_cast<ValueType>(0.))
         y_inout.fill(static_cast<ValueType>(0.));
     else
         y_inout *= beta;
 
+    // For a single column Armadillo calls GEMV, otherwise GEMM
     switch (trans)
     {
     case NO_TRANSPOSE:
@@ -265,7 +265,6 @@ void DiscreteInverseSparseBoundaryOperator<ValueType>::applyBuiltInImpl(
         const ValueType alpha,
         const ValueType beta) const
 {
-    // TODO: protect with a mutex (this function is not thread-safe)
     if (trans != NO_TRANSPOSE)
         throw std::invalid_argument("DiscreteInverseSparseBoundaryOperator::"
                                     "applyBuiltInImpl(): "
@@ -277,7 +276,13 @@ void DiscreteInverseSparseBoundaryOperator<ValueType>::applyBuiltInImpl(
                                     "incorrect vector lengths");
     arma::Col<ValueType> solution(dim);
     solution.fill(0.);
-    solveWithAmesos(*m_problem, *m_solver, solution, x_in);
+    {
+        // The operator may be shared between threads (e.g. through
+        // MassMatrixCache), but Amesos stores the right-hand side and
+        // solution in m_problem
+        tbb::mutex::scoped_lock lock(m_solverMutex);
+        solveWithAmesos(*m_problem, *m_solver, solution, x_in);
+    }
     if (beta == static_cast<ValueType>(0.))
         y_inout = alpha * solution;
     else {
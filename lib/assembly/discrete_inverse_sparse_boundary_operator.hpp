@@ -35,6 +35,7 @@
 
 #include <Teuchos_RCP.hpp>
 #include <Thyra_SpmdVectorSpaceBase_decl.hpp>
+#include <tbb/mutex.h>
 
 /** \cond FORWARD_DECL */
 class Amesos_BaseSolver;
@@ -95,6 +96,9 @@ private:
     Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_space;
     int m_symmetry;
     std::auto_ptr<Amesos_BaseSolver> m_solver;
+    // Serialises the solves in applyBuiltInImpl(), which modify the state
+    // of m_problem and m_solver
+    mutable tbb::mutex m_solverMutex;
     /** \endcond */
 };
 
@@ -125,6 +125,20 @@ void DiscreteNullBoundaryOperator<ValueType>::applyBuiltInImpl(
         y_inout *= beta;
 }
 
+template <typename ValueType>
+void DiscreteNullBoundaryOperator<ValueType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    if (beta == static_cast<ValueType>(0.))
+        y_inout.fill(static_cast<ValueType>(0.));
+    else
+        y_inout *= beta;
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteNullBoundaryOperator);
 
 } // namespace Bempp
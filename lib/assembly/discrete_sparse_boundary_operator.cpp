@@ -25,10 +25,12 @@
 #include "discrete_sparse_boundary_operator.hpp"
 
 #include "ahmed_mblock_array_deleter.hpp"
+#include "csr_matrix.hpp"
 #include "discrete_aca_boundary_operator.hpp"
 #include "index_permutation.hpp"
 #include "sparse_to_h_matrix_converter.hpp"
 
+#include "../common/boost_make_shared_fwd.hpp"
 #include "../common/boost_shared_array_fwd.hpp"
 #include "../fiber/explicit_instantiation.hpp"
 #include "../fiber/parallelization_options.hpp"
@@ -36,170 +38,34 @@
 #include <iostream>
 #include <stdexcept>
 
-#include <Epetra_Map.h>
-#include <Epetra_Vector.h>
 #include <Epetra_CrsMatrix.h>
+#include <Epetra_LocalMap.h>
 #include <Epetra_SerialComm.h>
 #include <Thyra_SpmdVectorSpaceDefaultBase.hpp>
 
 namespace Bempp
 {
 
-// Helper functions for the applyBuiltIn member function
-namespace
-{
-
 template <typename ValueType>
-void reallyApplyBuiltInImpl(const Epetra_CrsMatrix& mat,
-                            const TranspositionMode trans,
-                            const arma::Col<ValueType>& x_in,
-                            arma::Col<ValueType>& y_inout,
-                            const ValueType alpha,
-                            const ValueType beta);
-
-template <>
-void reallyApplyBuiltInImpl<double>(const Epetra_CrsMatrix& mat,
-                                    const TranspositionMode trans,
-                                    const arma::Col<double>& x_in,
-                                    arma::Col<double>& y_inout,
-                                    const double alpha,
-                                    const double beta)
-{
-    if (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE) {
-        assert(mat.NumGlobalRows() == static_cast<int>(x_in.n_rows));
-        assert(mat.NumGlobalCols() == static_cast<int>(y_inout.n_rows));
-    } else {
-        assert(mat.NumGlobalCols() == static_cast<int>(x_in.n_rows));
-        assert(mat.NumGlobalRows() == static_cast<int>(y_inout.n_rows));
-    }
-
-    Epetra_Map map_x(x_in.n_rows, 0, Epetra_SerialComm());
-    Epetra_Map map_y(y_inout.n_rows, 0, Epetra_SerialComm());
-
-    Epetra_Vector vec_x(View, map_x, const_cast<double*>(x_in.memptr()));
-    // vec_temp will store the result of matrix * x_in
-    Epetra_Vector vec_temp(map_y, false /* no need to initialise to zero */);
-
-    mat.Multiply(trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE,
-                 vec_x, vec_temp);
-
-    if (beta == 0.)
-        for (size_t i = 0; i < y_inout.n_rows; ++i)
-            y_inout(i) = alpha * vec_temp[i];
-    else
-        for (size_t i = 0; i < y_inout.n_rows; ++i)
-            y_inout(i) = alpha * vec_temp[i] + beta * y_inout(i);
-}
-
-template <>
-void reallyApplyBuiltInImpl<float>(const Epetra_CrsMatrix& mat,
-                                   const TranspositionMode trans,
-                                   const arma::Col<float>& x_in,
-                                   arma::Col<float>& y_inout,
-                                   const float alpha,
-                                   const float beta)
-{
-    // Copy the float vectors to double vectors
-    arma::Col<double> x_in_double(x_in.n_rows);
-    std::copy(x_in.begin(), x_in.end(), x_in_double.begin());
-    arma::Col<double> y_inout_double(y_inout.n_rows);
-    if (beta != 0.f)
-        std::copy(y_inout.begin(), y_inout.end(), y_inout_double.begin());
-
-    // Do the operation on the double vectors
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_in_double, y_inout_double, alpha, beta);
-
-    // Copy the result back to the float vector
-    std::copy(y_inout_double.begin(), y_inout_double.end(), y_inout.begin());
-}
-
-template <>
-void reallyApplyBuiltInImpl<std::complex<float> >(
-        const Epetra_CrsMatrix& mat,
-        const TranspositionMode trans,
-        const arma::Col<std::complex<float> >& x_in,
-        arma::Col<std::complex<float> >& y_inout,
-        const std::complex<float> alpha,
-        const std::complex<float> beta)
-{
-    // Do the y_inout *= beta part
-    const std::complex<float> zero(0.f, 0.f);
-    if (beta == zero)
-        y_inout.fill(zero);
-    else
-        y_inout *= beta;
-
-    // Separate the real and imaginary components and store them in
-    // double-precision vectors
-    arma::Col<double> x_real(x_in.n_rows);
-    for (size_t i = 0; i < x_in.n_rows; ++i)
-        x_real(i) = x_in(i).real();
-    arma::Col<double> x_imag(x_in.n_rows);
-    for (size_t i = 0; i < x_in.n_rows; ++i)
-        x_imag(i) = x_in(i).imag();
-    arma::Col<double> y_real(y_inout.n_rows);
-    for (size_t i = 0; i < y_inout.n_rows; ++i)
-        y_real(i) = y_inout(i).real();
-    arma::Col<double> y_imag(y_inout.n_rows);
-    for (size_t i = 0; i < y_inout.n_rows; ++i)
-        y_imag(i) = y_inout(i).imag();
-
-    // Do the "+= alpha A x" part (in steps)
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_real, y_real, alpha.real(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_imag, y_real, -alpha.imag(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_real, y_imag, alpha.imag(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_imag, y_imag, alpha.real(), 1.);
-
-    // Copy the result back to the complex vector
-    for (size_t i = 0; i < y_inout.n_rows; ++i)
-        y_inout(i) = std::complex<float>(y_real(i), y_imag(i));
-}
-
-template <>
-void reallyApplyBuiltInImpl<std::complex<double> >(
-        const Epetra_CrsMatrix& mat,
-        const TranspositionMode trans,
-        const arma::Col<std::complex<double> >& x_in,
-        arma::Col<std::complex<double> >& y_inout,
-        const std::complex<double> alpha,
-        const std::complex<double> beta)
+DiscreteSparseBoundaryOperator<ValueType>::
+DiscreteSparseBoundaryOperator(
+        const shared_ptr<const CsrMatrix<ValueType> >& mat,
+        int symmetry, TranspositionMode trans,
+        const shared_ptr<AhmedBemBlcluster>& blockCluster,
+        const shared_ptr<IndexPermutation>& domainPermutation,
+        const shared_ptr<IndexPermutation>& rangePermutation) :
+    m_mat(mat), m_symmetry(symmetry), m_trans(trans),
+    m_blockCluster(blockCluster),
+    m_domainPermutation(domainPermutation),
+    m_rangePermutation(rangePermutation)
 {
-    // Do the y_inout *= beta part
-    const std::complex<double> zero(0., 0.);
-    if (beta == zero)
-        y_inout.fill(zero);
-    else
-        y_inout *= beta;
-
-    // Separate the real and imaginary components
-    arma::Col<double> x_real(arma::real(x_in));
-    arma::Col<double> x_imag(arma::imag(x_in));
-    arma::Col<double> y_real(arma::real(y_inout));
-    arma::Col<double> y_imag(arma::imag(y_inout));
-
-    // Do the "+= alpha A x" part (in steps)
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_real, y_real, alpha.real(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_imag, y_real, -alpha.imag(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_real, y_imag, alpha.imag(), 1.);
-    reallyApplyBuiltInImpl<double>(
-                mat, trans, x_imag, y_imag, alpha.real(), 1.);
-
-    // Copy the result back to the complex vector
-    for (size_t i = 0; i < y_inout.n_rows; ++i)
-        y_inout(i) = std::complex<double>(y_real(i), y_imag(i));
+    if (!m_mat)
+        throw std::invalid_argument(
+                "DiscreteSparseBoundaryOperator::"
+                "DiscreteSparseBoundaryOperator(): mat must not be null");
+    initializeVectorSpaces();
 }
 
-} // namespace
-
-
 template <typename ValueType>
 DiscreteSparseBoundaryOperator<ValueType>::
 DiscreteSparseBoundaryOperator(
@@ -208,70 +74,66 @@ DiscreteSparseBoundaryOperator(
         const shared_ptr<AhmedBemBlcluster>& blockCluster,
         const shared_ptr<IndexPermutation>& domainPermutation,
         const shared_ptr<IndexPermutation>& rangePermutation) :
-    m_mat(mat), m_symmetry(symmetry), m_trans(trans),
+    m_symmetry(symmetry), m_trans(trans),
     m_blockCluster(blockCluster),
     m_domainPermutation(domainPermutation),
     m_rangePermutation(rangePermutation)
 {
-    m_domainSpace = Thyra::defaultSpmdVectorSpace<ValueType>(
-                isTransposed() ? m_mat->NumGlobalRows() : m_mat->NumGlobalCols());
-    m_rangeSpace = Thyra::defaultSpmdVectorSpace<ValueType>(
-                isTransposed() ? m_mat->NumGlobalCols() : m_mat->NumGlobalRows());
+    if (!mat)
+        throw std::invalid_argument(
+                "DiscreteSparseBoundaryOperator::"
+                "DiscreteSparseBoundaryOperator(): mat must not be null");
+    m_mat.reset(new CsrMatrix<ValueType>(*mat));
+    initializeVectorSpaces();
+}
+
+template <typename ValueType>
+void DiscreteSparseBoundaryOperator<ValueType>::initializeVectorSpaces()
+{
+    m_domainSpace = Thyra::defaultSpmdVectorSpace<ValueType>(columnCount());
+    m_rangeSpace = Thyra::defaultSpmdVectorSpace<ValueType>(rowCount());
 }
 
 template <typename ValueType>
 void DiscreteSparseBoundaryOperator<ValueType>::dump() const
 {
     if (isTransposed())
-        std::cout << "Transpose of " << *m_mat << std::endl;
+        std::cout << "Transpose of " << *epetraMatrix() << std::endl;
     else
-        std::cout << *m_mat << std::endl;
+        std::cout << *epetraMatrix() << std::endl;
 }
 
 template <typename ValueType>
 arma::Mat<ValueType>
 DiscreteSparseBoundaryOperator<ValueType>::asMatrix() const
 {
-    if (m_mat->Comm().NumProc() != 1)
-        throw std::runtime_error(
-                "DiscreteSparseBoundaryOperator::asMatrix(): "
-                "conversion of distributed matrices to local matrices is unsupported");
-
     bool transposed = isTransposed();
-    const int untransposedRowCount = m_mat->NumGlobalRows();
+    const int untransposedRowCount = m_mat->rowCount();
+    const std::vector<int>& rowOffsets = m_mat->rowOffsets();
+    const std::vector<int>& columnIndices = m_mat->columnIndices();
+    const std::vector<CoordinateType>& values = m_mat->values();
+
     arma::Mat<ValueType> mat(rowCount(), columnCount());
     mat.fill(0.);
     for (int row = 0; row < untransposedRowCount; ++row)
-    {
-        int entryCount = 0;
-        double* values = 0;
-        int* indices = 0;
-        int errorCode = m_mat->ExtractMyRowView(row, entryCount,
-                                                values, indices);
-        if (errorCode != 0)
-            throw std::runtime_error(
-                    "DiscreteSparseBoundaryOperator::asMatrix(): "
-                    "Epetra_CrsMatrix::ExtractMyRowView()) failed");
-        if (transposed)
-            for (int entry = 0; entry < entryCount; ++entry)
-                mat(indices[entry], row) = values[entry];
-        else
-            for (int entry = 0; entry < entryCount; ++entry)
-                mat(row, indices[entry]) = values[entry];
-    }
+        for (int k = rowOffsets[row]; k < rowOffsets[row + 1]; ++k)
+            if (transposed)
+                mat(columnIndices[k], row) = values[k];
+            else
+                mat(row, columnIndices[k]) = values[k];
     return mat;
 }
 
 template <typename ValueType>
 unsigned int DiscreteSparseBoundaryOperator<ValueType>::rowCount() const
 {
-    return isTransposed() ? m_mat->NumGlobalCols() : m_mat->NumGlobalRows();
+    return isTransposed() ? m_mat->columnCount() : m_mat->rowCount();
 }
 
 template <typename ValueType>
 unsigned int DiscreteSparseBoundaryOperator<ValueType>::columnCount() const
 {
-    return isTransposed() ? m_mat->NumGlobalRows() : m_mat->NumGlobalCols();
+    return isTransposed() ? m_mat->rowCount() : m_mat->columnCount();
 }
 
 template <typename ValueType>
@@ -291,37 +153,23 @@ void DiscreteSparseBoundaryOperator<ValueType>::addBlock(
                 "DiscreteSparseBoundaryOperator::addBlock(): "
                 "incorrect block size");
 
-    int entryCount = 0;
-    double* values = 0;
-    int* indices = 0;
+    const std::vector<int>& rowOffsets = m_mat->rowOffsets();
+    const std::vector<int>& columnIndices = m_mat->columnIndices();
+    const std::vector<CoordinateType>& values = m_mat->values();
 
     for (size_t row = 0; row < untransposedRows.size(); ++row)
     {
-        // Provision for future MPI support.
-        if (m_mat->IndicesAreLocal())
-        {
-            int errorCode = m_mat->ExtractMyRowView(
-                        untransposedRows[row], entryCount, values, indices);
-            if (errorCode != 0)
-                throw std::runtime_error(
-                        "DiscreteSparseBoundaryOperator::addBlock(): "
-                        "Epetra_CrsMatrix::ExtractMyRowView()) failed");
-        }
-        else
-        {
-            int errorCode = m_mat->ExtractGlobalRowView(
-                        untransposedRows[row], entryCount, values, indices);
-            if (errorCode != 0)
-                throw std::runtime_error(
-                        "DiscreteSparseBoundaryOperator::addBlock(): "
-                        "Epetra_CrsMatrix::ExtractGlobalRowView()) failed");
-        }
-
+        const int untransposedRow = untransposedRows[row];
+        if (untransposedRow < 0 || untransposedRow >= m_mat->rowCount())
+            throw std::invalid_argument(
+                    "DiscreteSparseBoundaryOperator::addBlock(): "
+                    "row index out of range");
         for (size_t col = 0; col < untransposedCols.size(); ++col)
-            for (int entry = 0; entry < entryCount; ++entry)
-                if (indices[entry] == cols[col])
+            for (int k = rowOffsets[untransposedRow];
+                 k < rowOffsets[untransposedRow + 1]; ++k)
+                if (columnIndices[k] == untransposedCols[col])
                     block(transposed ? col : row, transposed ? row : col) +=
-                            alpha * static_cast<ValueType>(values[entry]);
+                            alpha * static_cast<ValueType>(values[k]);
     }
 }
 
@@ -346,10 +194,14 @@ DiscreteSparseBoundaryOperator<ValueType>::asDiscreteAcaBoundaryOperator(
                                  "asDiscreteAcaBoundaryOperator(): "
                                  "transposed operators are not supported yet");
 
-    int* rowOffsets = 0;
-    int* colIndices = 0;
-    double* values = 0;
-    m_mat->ExtractCrsDataPointers(rowOffsets, colIndices, values);
+    // The converter expects mutable arrays of doubles
+    std::vector<int> rowOffsets(m_mat->rowOffsets());
+    std::vector<int> colIndices(m_mat->columnIndices());
+    std::vector<double> values(m_mat->values().begin(),
+                               m_mat->values().end());
+    // Guard against empty vectors (&v[0] is undefined for them)
+    colIndices.push_back(0);
+    values.push_back(0.);
 
     std::vector<unsigned int> domain_o2p =
             m_domainPermutation->permutedIndices();
@@ -363,7 +215,7 @@ DiscreteSparseBoundaryOperator<ValueType>::asDiscreteAcaBoundaryOperator(
     boost::shared_array<AhmedMblock*> mblocks;
     int trueMaximumRank = 0;
     SparseToHMatrixConverter<ValueType>::constructHMatrix(
-        rowOffsets, colIndices, values,
+        &rowOffsets[0], &colIndices[0], &values[0],
         domain_o2p, range_p2o, eps,
         m_blockCluster.get(),
         mblocks, trueMaximumRank);
@@ -399,6 +251,45 @@ DiscreteSparseBoundaryOperator<ValueType>::castToSparse(
 template <typename ValueType>
 shared_ptr<const Epetra_CrsMatrix>
 DiscreteSparseBoundaryOperator<ValueType>::epetraMatrix() const
+{
+    const int rowCount = m_mat->rowCount();
+    const int columnCount = m_mat->columnCount();
+    const std::vector<int>& rowOffsets = m_mat->rowOffsets();
+    const std::vector<CoordinateType>& values = m_mat->values();
+    std::vector<int> columnIndices(m_mat->columnIndices());
+
+    Epetra_SerialComm comm; // To be replaced once we begin to use MPI
+    Epetra_LocalMap rowMap(rowCount, 0 /* index_base */, comm);
+    Epetra_LocalMap columnMap(columnCount, 0 /* index_base */, comm);
+    std::vector<int> entryCounts(rowCount + 1);
+    for (int row = 0; row < rowCount; ++row)
+        entryCounts[row] = rowOffsets[row + 1] - rowOffsets[row];
+    shared_ptr<Epetra_CrsMatrix> result = boost::make_shared<Epetra_CrsMatrix>(
+                Copy, rowMap, columnMap, &entryCounts[0],
+                true /* static profile */);
+
+    std::vector<double> rowValues;
+    for (int row = 0; row < rowCount; ++row) {
+        const int begin = rowOffsets[row];
+        const int entryCount = entryCounts[row];
+        if (entryCount == 0)
+            continue;
+        rowValues.assign(values.begin() + begin,
+                         values.begin() + begin + entryCount);
+        int errorCode = result->InsertGlobalValues(
+                    row, entryCount, &rowValues[0], &columnIndices[begin]);
+        if (errorCode != 0)
+            throw std::runtime_error(
+                    "DiscreteSparseBoundaryOperator::epetraMatrix(): "
+                    "Epetra_CrsMatrix::InsertGlobalValues() failed");
+    }
+    result->FillComplete(columnMap, rowMap);
+    return result;
+}
+
+template <typename ValueType>
+shared_ptr<const CsrMatrix<ValueType> >
+DiscreteSparseBoundaryOperator<ValueType>::csrMatrix() const
 {
     return m_mat;
 }
@@ -446,18 +337,26 @@ void DiscreteSparseBoundaryOperator<ValueType>::applyBuiltInImpl(
         const ValueType alpha,
         const ValueType beta) const
 {
-    TranspositionMode realTrans = trans;
-    bool transposed = isTransposed();
-    if (transposed)
-        switch (trans) {
-        case NO_TRANSPOSE: realTrans = TRANSPOSE; break;
-        case TRANSPOSE: realTrans = NO_TRANSPOSE; break;
-        case CONJUGATE: realTrans = CONJUGATE_TRANSPOSE; break;
-        case CONJUGATE_TRANSPOSE: realTrans = CONJUGATE; break;
-        // default: should not happen; anyway, don't change trans
-        }
-
-    reallyApplyBuiltInImpl(*m_mat, realTrans, x_in, y_inout, alpha, beta);
+    applyBuiltInImpl(trans,
+                     static_cast<const arma::Mat<ValueType>&>(x_in),
+                     static_cast<arma::Mat<ValueType>&>(y_inout),
+                     alpha, beta);
+}
+
+template <typename ValueType>
+void DiscreteSparseBoundaryOperator<ValueType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    // The stored matrix is real, so conjugation is a no-op and only the
+    // transposition flags matter
+    const bool transposeRequested =
+            trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE;
+    m_mat->apply(transposeRequested != isTransposed(),
+                 x_in, y_inout, alpha, beta);
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(DiscreteSparseBoundaryOperator);
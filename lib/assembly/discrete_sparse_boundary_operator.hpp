@@ -46,11 +46,16 @@ class Epetra_CrsMatrix;
 namespace Bempp
 {
 /** \cond FORWARD_DECL */
+template <typename ValueType> class CsrMatrix;
 class IndexPermutation;
 /** \endcond */
 
 /** \ingroup discrete_boundary_operators
  *  \brief Discrete boundary operator stored as a sparse matrix.
+ *
+ *  The matrix is stored as a CsrMatrix, which multiplies real and complex
+ *  vectors directly in a single multithreaded sweep over the matrix. An
+ *  Epetra_CrsMatrix is constructed only on request, by epetraMatrix().
  */
 template <typename ValueType>
 class DiscreteSparseBoundaryOperator :
@@ -74,6 +79,29 @@ public:
      *  \param[in] trans
      *    If different from NO_TRANSPOSE, the discrete operator will represent
      *    a transposed and/or complex-conjugated matrix \p mat. */
+    DiscreteSparseBoundaryOperator(
+            const shared_ptr<const CsrMatrix<ValueType> >& mat,
+            int symmetry = NO_SYMMETRY,
+            TranspositionMode trans = NO_TRANSPOSE,
+            const shared_ptr<AhmedBemBlcluster>& blockCluster =
+            shared_ptr<AhmedBemBlcluster>(),
+            const shared_ptr<IndexPermutation>& domainPermutation =
+            shared_ptr<IndexPermutation>(),
+            const shared_ptr<IndexPermutation>& rangePermutation =
+            shared_ptr<IndexPermutation>());
+
+    /** \brief Constructor.
+     *
+     *  \param[in] mat
+     *    Sparse matrix that will be represented by the newly
+     *    constructed operator. Must not be null. The operator stores a
+     *    CsrMatrix copy of \p mat and does not keep a reference to it.
+     *  \param[in] symmetry
+     *    Symmetry of the matrix. May be any combination of flags defined
+     *    in the Symmetry enumeration type.
+     *  \param[in] trans
+     *    If different from NO_TRANSPOSE, the discrete operator will represent
+     *    a transposed and/or complex-conjugated matrix \p mat. */
     DiscreteSparseBoundaryOperator(
             const shared_ptr<const Epetra_CrsMatrix>& mat,
             int symmetry = NO_SYMMETRY,
@@ -118,13 +146,21 @@ public:
             discreteOperator);
 
 #ifdef WITH_TRILINOS
-    /** \brief Return a shared pointer to the sparse matrix stored within
-     *  this operator.
+    /** \brief Return a new Epetra_CrsMatrix containing a copy of the
+     *  sparse matrix stored within this operator.
+     *
+     *  The copy is constructed anew on each call.
      *
      *  \note The discrete operator represents the matrix returned by this
      *  function *and possibly transposed and/or complex-conjugated*, depending on
      *  the value returned by transpositionMode(). */
     shared_ptr<const Epetra_CrsMatrix> epetraMatrix() const;
+
+    /** \brief Return a shared pointer to the sparse matrix stored within
+     *  this operator.
+     *
+     *  The note in the documentation of epetraMatrix() applies also here. */
+    shared_ptr<const CsrMatrix<ValueType> > csrMatrix() const;
 #endif
 
     /** \brief Return the active sparse matrix transformation.
@@ -155,7 +191,13 @@ private:
                                   arma::Col<ValueType>& y_inout,
                                   const ValueType alpha,
                                   const ValueType beta) const;
+    virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                  const arma::Mat<ValueType>& x_in,
+                                  arma::Mat<ValueType>& y_inout,
+                                  const ValueType alpha,
+                                  const ValueType beta) const;
     bool isTransposed() const;
+    void initializeVectorSpaces();
 
     // void constructAhmedMatrix(
     //         int* rowOffsets, int* colIndices, double* values,
@@ -170,7 +212,7 @@ private:
 private:
     /** \cond PRIVATE */
 #ifdef WITH_TRILINOS
-    shared_ptr<const Epetra_CrsMatrix> m_mat;
+    shared_ptr<const CsrMatrix<ValueType> > m_mat;
     int m_symmetry;
     TranspositionMode m_trans;
     shared_ptr<AhmedBemBlcluster> m_blockCluster;
@@ -38,6 +38,7 @@
 #include "../fiber/collection_of_basis_transformations.hpp"
 #include "../fiber/quadrature_strategy.hpp"
 #include "../fiber/serial_blas_region.hpp"
+#include "../fiber/thread_pool.hpp"
 #include "../fiber/local_assembler_for_operators.hpp"
 #include "../grid/entity.hpp"
 #include "../grid/entity_iterator.hpp"
@@ -50,12 +51,11 @@
 #include "../common/armadillo_fwd.hpp"
 #include "../common/boost_make_shared_fwd.hpp"
 #include "../common/boost_ptr_vector_fwd.hpp"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
 #include <tbb/parallel_for.h>
-#include <tbb/spin_mutex.h>
-#include <tbb/task_scheduler_init.h>
 #include <tbb/tick_count.h>
 
 namespace Bempp
@@ -68,27 +68,32 @@ namespace
 
 // Body of parallel loop
 
+/** \brief Body of the parallel loop assembling the dense weak form.
+ *
+ *  The loop runs over a subset of trial elements no two of which share a
+ *  global DOF (see colorElements()). Each iteration therefore writes to a
+ *  separate set of columns of \p result and no synchronisation is needed. */
 template <typename BasisFunctionType, typename ResultType>
 class DenseWeakFormAssemblerLoopBody
 {
 public:
-    typedef tbb::spin_mutex MutexType;
-
     DenseWeakFormAssemblerLoopBody(
             const std::vector<int>& testIndices,
+            const std::vector<int>& trialIndices,
             const std::vector<std::vector<GlobalDofIndex> >& testGlobalDofs,
             const std::vector<std::vector<GlobalDofIndex> >& trialGlobalDofs,
             Fiber::LocalAssemblerForOperators<ResultType>& assembler,
-            arma::Mat<ResultType>& result, MutexType& mutex) :
-        m_testIndices(testIndices),
+            arma::Mat<ResultType>& result) :
+        m_testIndices(testIndices), m_trialIndices(trialIndices),
         m_testGlobalDofs(testGlobalDofs), m_trialGlobalDofs(trialGlobalDofs),
-        m_assembler(assembler), m_result(result), m_mutex(mutex) {
+        m_assembler(assembler), m_result(result) {
     }
 
     void operator() (const tbb::blocked_range<size_t>& r) const {
         const int elementCount = m_testIndices.size();
         std::vector<arma::Mat<ResultType> > localResult;
-        for (size_t trialIndex = r.begin(); trialIndex != r.end(); ++trialIndex) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+            const int trialIndex = m_trialIndices[i];
             // Evaluate integrals over pairs of the current trial element and
             // all the test elements
             m_assembler.evaluateLocalWeakForms(TEST_TRIAL, m_testIndices, trialIndex,
@@ -96,59 +101,89 @@ public:
 
             const int trialDofCount = m_trialGlobalDofs[trialIndex].size();
             // Global assembly
-            {
-                MutexType::scoped_lock lock(m_mutex);
-                // Loop over test indices
-                for (int testIndex = 0; testIndex < elementCount; ++testIndex) {
-                    const int testDofCount = m_testGlobalDofs[testIndex].size();
-                    // Add the integrals to appropriate entries in the operator's matrix
-                    for (int trialDof = 0; trialDof < trialDofCount; ++trialDof)
-                        for (int testDof = 0; testDof < testDofCount; ++testDof)
-                            m_result(m_testGlobalDofs[testIndex][testDof],
-                                     m_trialGlobalDofs[trialIndex][trialDof]) +=
-                                    localResult[testIndex](testDof, trialDof);
-                }
+            // Loop over test indices
+            for (int testIndex = 0; testIndex < elementCount; ++testIndex) {
+                const int testDofCount = m_testGlobalDofs[testIndex].size();
+                // Add the integrals to appropriate entries in the operator's matrix
+                for (int trialDof = 0; trialDof < trialDofCount; ++trialDof)
+                    for (int testDof = 0; testDof < testDofCount; ++testDof)
+                        m_result(m_testGlobalDofs[testIndex][testDof],
+                                 m_trialGlobalDofs[trialIndex][trialDof]) +=
+                                localResult[testIndex](testDof, trialDof);
             }
         }
     }
 
 private:
     const std::vector<int>& m_testIndices;
+    const std::vector<int>& m_trialIndices;
     const std::vector<std::vector<GlobalDofIndex> >& m_testGlobalDofs;
     const std::vector<std::vector<GlobalDofIndex> >& m_trialGlobalDofs;
     // mutable OK because Assembler is thread-safe. (Alternative to "mutable" here:
     // make assembler's internal integrator map mutable)
     typename Fiber::LocalAssemblerForOperators<ResultType>& m_assembler;
-    // mutable OK because write access to this matrix is protected by a mutex
+    // mutable OK because the trial elements processed concurrently
+    // contribute to disjoint sets of columns of this matrix
     arma::Mat<ResultType>& m_result;
-
-    // mutex must be mutable because we need to lock and unlock it
-    MutexType& m_mutex;
 };
 
+/** \brief Split elements into groups ("colours") such that no two elements
+ *  of the same group share a global DOF.
+ *
+ *  \param[in] globalDofs
+ *    List of lists of global DOF indices corresponding to the local DOFs on
+ *    each element, as returned by gatherGlobalDofs().
+ *  \param[in] globalDofCount
+ *    Total number of global DOFs.
+ *
+ *  \returns A list of element groups. Within each group, element indices are
+ *  sorted in ascending order.
+ *
+ *  A greedy algorithm is used: each element receives the lowest colour not
+ *  yet taken by any other element sharing one of its DOFs. For the usual
+ *  function spaces the number of colours is bounded by the maximum number of
+ *  elements adjacent to a vertex. */
+std::vector<std::vector<int> > colorElements(
+        const std::vector<std::vector<GlobalDofIndex> >& globalDofs,
+        size_t globalDofCount)
+{
+    const size_t elementCount = globalDofs.size();
+    // Colours already assigned to elements containing a given DOF
+    std::vector<std::vector<int> > dofColors(globalDofCount);
+    std::vector<std::vector<int> > colors;
+    std::vector<char> forbidden;
+
+    for (size_t e = 0; e < elementCount; ++e) {
+        const std::vector<GlobalDofIndex>& dofs = globalDofs[e];
+        forbidden.assign(colors.size() + 1, false);
+        for (size_t i = 0; i < dofs.size(); ++i) {
+            const std::vector<int>& used = dofColors[dofs[i]];
+            for (size_t j = 0; j < used.size(); ++j)
+                forbidden[used[j]] = true;
+        }
+        int color = 0;
+        while (forbidden[color])
+            ++color;
+        if (color == static_cast<int>(colors.size()))
+            colors.push_back(std::vector<int>());
+        colors[color].push_back(e);
+        for (size_t i = 0; i < dofs.size(); ++i) {
+            std::vector<int>& used = dofColors[dofs[i]];
+            if (std::find(used.begin(), used.end(), color) == used.end())
+                used.push_back(color);
+        }
+    }
+    return colors;
+}
+
 /** Build a list of lists of global DOF indices corresponding to the local DOFs
  *  on each element of space.grid(). */
 template <typename BasisFunctionType>
 std::vector<std::vector<GlobalDofIndex> > gatherGlobalDofs(
         const Space<BasisFunctionType>& space)
 {
-    // Get the grid's leaf view so that we can iterate over elements
-    std::auto_ptr<GridView> view = space.grid()->leafView();
-    const int elementCount = view->entityCount(0);
-
-    // Global DOF indices corresponding to local DOFs on elements
-    std::vector<std::vector<GlobalDofIndex> > globalDofs(elementCount);
-
-    // Gather global DOF lists
-    const Mapper& mapper = view->elementMapper();
-    std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
-    while (!it->finished()) {
-        const Entity<0>& element = it->entity();
-        const int elementIndex = mapper.entityIndex(element);
-        space.getGlobalDofs(element, globalDofs[elementIndex]);
-        it->next();
-    }
-
+    std::vector<std::vector<GlobalDofIndex> > globalDofs;
+    space.getGlobalDofsOfAllElements(globalDofs);
     return globalDofs;
 }
 
@@ -267,7 +302,6 @@ assembleWeakFormInDenseMode(
     std::vector<std::vector<GlobalDofIndex> > trialGlobalDofs =
             gatherGlobalDofs(trialSpace);
     const size_t testElementCount = testGlobalDofs.size();
-    const size_t trialElementCount = trialGlobalDofs.size();
 
     // Make a vector of all element indices
     std::vector<int> testIndices(testElementCount);
@@ -279,24 +313,24 @@ assembleWeakFormInDenseMode(
                                  trialSpace.globalDofCount());
     result.fill(0.);
 
+    // Group trial elements so that those assembled concurrently never
+    // contribute to the same column of the matrix
+    const std::vector<std::vector<int> > trialColors =
+            colorElements(trialGlobalDofs, trialSpace.globalDofCount());
+
     typedef DenseWeakFormAssemblerLoopBody<BasisFunctionType, ResultType> Body;
-    typename Body::MutexType mutex;
 
     const ParallelizationOptions& parallelOptions =
             options.parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled()) {
-        if (parallelOptions.maxThreadCount() == ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+    Fiber::ScopedScheduler scheduler(parallelOptions);
     {
         Fiber::SerialBlasRegion region;
-        tbb::parallel_for(tbb::blocked_range<size_t>(0, trialElementCount),
-                          Body(testIndices, testGlobalDofs, trialGlobalDofs,
-                               assembler, result, mutex));
+        for (size_t color = 0; color < trialColors.size(); ++color)
+            tbb::parallel_for(tbb::blocked_range<size_t>(
+                                  0, trialColors[color].size()),
+                              Body(testIndices, trialColors[color],
+                                   testGlobalDofs, trialGlobalDofs,
+                                   assembler, result));
     }
 
     //// Old serial code (TODO: decide whether to keep it behind e.g. #ifndef PARALLEL)
@@ -332,11 +366,8 @@ assembleWeakFormInAcaMode(
         LocalAssembler& assembler,
         const AssemblyOptions& options) const
 {
-    const Space<BasisFunctionType>& testSpace = *this->dualToRange();
-    const Space<BasisFunctionType>& trialSpace = *this->domain();
-
     return AcaGlobalAssembler<BasisFunctionType, ResultType>::assembleDetachedWeakForm(
-                testSpace, trialSpace, assembler, options,
+                this->dualToRange(), this->domain(), assembler, options,
                 this->symmetry() & SYMMETRIC);
 }
 
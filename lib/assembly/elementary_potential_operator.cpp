@@ -20,25 +20,143 @@
 
 #include "elementary_potential_operator.hpp"
 
+#include "discrete_dense_boundary_operator.hpp"
 #include "evaluation_options.hpp"
 #include "grid_function.hpp"
 #include "interpolated_function.hpp"
 #include "local_assembler_construction_helper.hpp"
 
+#include "../common/boost_make_shared_fwd.hpp"
 #include "../common/shared_ptr.hpp"
 
+#include "../fiber/element_bounding_box_index.hpp"
 #include "../fiber/evaluator_for_integral_operators.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/hierarchical_evaluator_for_integral_operators.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/thread_pool.hpp"
 
 #include "../grid/entity.hpp"
 #include "../grid/entity_iterator.hpp"
-#include "../grid/geometry.hpp"
+#include "../grid/flat_grid_data.hpp"
 #include "../grid/grid.hpp"
 #include "../grid/grid_view.hpp"
-#include "../grid/index_set.hpp"
+
+#include "../space/space.hpp"
+
+#include <algorithm>
+#include <tbb/parallel_for.h>
 
 namespace Bempp
 {
+
+namespace
+{
+
+/** \cond PRIVATE */
+
+// Fills the rows of the matrix of an assembled potential operator
+// corresponding to chunks of evaluation points.
+template <typename ResultType>
+class PotentialMatrixLoopBody
+{
+public:
+    typedef Fiber::EvaluatorForIntegralOperators<ResultType> Evaluator;
+    typedef typename Evaluator::CoordinateType CoordinateType;
+
+    PotentialMatrixLoopBody(
+            size_t chunkSize,
+            const Evaluator& evaluator,
+            const std::vector<std::vector<GlobalDofIndex> >& globalDofs,
+            const Fiber::ElementBoundingBoxIndex<CoordinateType>* nearFieldIndex,
+            const arma::Mat<CoordinateType>& points,
+            arma::Mat<ResultType>& result) :
+        m_chunkSize(chunkSize), m_evaluator(evaluator),
+        m_globalDofs(globalDofs),
+        m_nearFieldIndex(nearFieldIndex),
+        m_points(points), m_result(result),
+        m_componentCount(result.n_rows / std::max<size_t>(1, points.n_cols))
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const size_t pointCount = m_points.n_cols;
+        const size_t elementCount = m_globalDofs.size();
+        std::vector<int> elements;
+        arma::Mat<CoordinateType> blockPoints;
+        arma::Mat<CoordinateType> point(m_points.n_rows, 1);
+        std::vector<arma::Mat<ResultType> > values, farFieldValues;
+        // The basis functions of each element are transformed once per
+        // block of chunks, and the kernels are evaluated once per chunk and
+        // element, whatever the number of local basis functions
+        for (size_t i = r.begin(); i < r.end(); i += CHUNKS_PER_BLOCK) {
+            const size_t start = m_chunkSize * i;
+            const size_t end = std::min(
+                        m_chunkSize * std::min(i + CHUNKS_PER_BLOCK, r.end()),
+                        pointCount);
+            blockPoints = m_points.cols(start, end - 1 /* inclusive */);
+
+            // Far-field contributions of all elements
+            for (size_t e = 0; e < elementCount; ++e) {
+                m_evaluator.evaluateLocalBasisContributions(
+                            Evaluator::FAR_FIELD, e, blockPoints, values);
+                for (size_t j = 0; j < m_globalDofs[e].size(); ++j)
+                    if (m_globalDofs[e][j] >= 0)
+                        addToColumn(values[j], start, m_globalDofs[e][j]);
+            }
+
+            // Corrections for elements close to evaluation points
+            if (!m_nearFieldIndex)
+                continue;
+            for (size_t p = start; p < end; ++p) {
+                m_nearFieldIndex->findElements(m_points.colptr(p), elements);
+                point.col(0) = m_points.col(p);
+                for (size_t k = 0; k < elements.size(); ++k) {
+                    const int e = elements[k];
+                    m_evaluator.evaluateLocalBasisContributions(
+                                Evaluator::NEAR_FIELD, e, point, values);
+                    m_evaluator.evaluateLocalBasisContributions(
+                                Evaluator::FAR_FIELD, e, point, farFieldValues);
+                    for (size_t j = 0; j < m_globalDofs[e].size(); ++j) {
+                        if (m_globalDofs[e][j] < 0)
+                            continue;
+                        values[j] -= farFieldValues[j];
+                        addToColumn(values[j], p, m_globalDofs[e][j]);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    // Add the values of the potential at consecutive points, starting from
+    // the point with index firstPoint, to the column of the result matrix
+    // corresponding to a global DOF
+    void addToColumn(const arma::Mat<ResultType>& values, size_t firstPoint,
+                     GlobalDofIndex dof) const {
+        ResultType* dest = m_result.colptr(dof) + m_componentCount * firstPoint;
+        const ResultType* src = values.memptr();
+        for (size_t k = 0; k < values.n_elem; ++k)
+            dest[k] += src[k];
+    }
+
+private:
+    // Maximum number of chunks of points processed together; bounds the
+    // size of the arrays of values of individual basis functions
+    enum { CHUNKS_PER_BLOCK = 8 };
+
+    size_t m_chunkSize;
+    const Evaluator& m_evaluator;
+    const std::vector<std::vector<GlobalDofIndex> >& m_globalDofs;
+    const Fiber::ElementBoundingBoxIndex<CoordinateType>* m_nearFieldIndex;
+    const arma::Mat<CoordinateType>& m_points;
+    arma::Mat<ResultType>& m_result;
+    size_t m_componentCount;
+};
+
+/** \endcond */
+
+} // namespace
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
 std::auto_ptr<InterpolatedFunction<ResultType> >
 ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::evaluateOnGrid(
@@ -60,43 +178,23 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::evaluate
     // Get coordinates of interpolation points, i.e. the evaluationGrid's vertices
 
     std::auto_ptr<GridView> evalView = evaluationGrid.leafView();
-    const int evalGridDim = evaluationGrid.dim();
-    const int evalPointCount = evalView->entityCount(evalGridDim);
-    arma::Mat<CoordinateType> evalPoints(evalGridDim, evalPointCount);
-
-    const IndexSet& evalIndexSet = evalView->indexSet();
-    // TODO: extract into template function, perhaps add case evalGridDim == 1
-    if (evalGridDim == 2) {
-        const int vertexCodim = 2;
-        std::auto_ptr<EntityIterator<vertexCodim> > it =
-                evalView->entityIterator<vertexCodim>();
-        while (!it->finished()) {
-            const Entity<vertexCodim>& vertex = it->entity();
-            const Geometry& geo = vertex.geometry();
-            const int vertexIndex = evalIndexSet.entityIndex(vertex);
-            arma::Col<CoordinateType> activeCol(evalPoints.unsafe_col(vertexIndex));
-            geo.getCenter(activeCol);
-            it->next();
-        }
-    } else if (evalGridDim == 3) {
-        const int vertexCodim = 3;
-        std::auto_ptr<EntityIterator<vertexCodim> > it =
-                evalView->entityIterator<vertexCodim>();
-        while (!it->finished()) {
-            const Entity<vertexCodim>& vertex = it->entity();
-            const Geometry& geo = vertex.geometry();
-            const int vertexIndex = evalIndexSet.entityIndex(vertex);
-            arma::Col<CoordinateType> activeCol(evalPoints.unsafe_col(vertexIndex));
-            geo.getCenter(activeCol);
-            it->next();
-        }
+    const FlatGridData& evalData = evalView->flatGridData();
+    const int worldDim = evalData.worldDimension();
+    const int evalPointCount = evalData.vertexCount();
+    arma::Mat<CoordinateType> evalPoints(worldDim, evalPointCount);
+    for (int dim = 0; dim < worldDim; ++dim) {
+        const double* coords = evalData.vertexCoordinates(dim);
+        for (int point = 0; point < evalPointCount; ++point)
+            evalPoints(dim, point) = coords[point];
     }
 
-    // right now we don't bother about far and near field
-    // (this might depend on evaluation options)
-
+    // Evaluate all contributions with the far-field quadrature rule, then
+    // correct those of elements close to evaluation points
     arma::Mat<ResultType> result;
     evaluator->evaluate(Evaluator::FAR_FIELD, evalPoints, result);
+    if (options.isNearFieldQuadratureEnabled())
+        evaluator->applyNearFieldCorrection(
+                    evalPoints, options.nearFieldRelativeDistance(), result);
 
     //    std::cout << "Interpolation results:\n";
     //    for (int point = 0; point < evalPointCount; ++point)
@@ -127,15 +225,117 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::evaluate
     std::auto_ptr<Evaluator> evaluator =
             makeEvaluator(argument, quadStrategy, options);
 
-    // right now we don't bother about far and near field
-    // (this might depend on evaluation options)
-
+    // Evaluate all contributions with the far-field quadrature rule, then
+    // correct those of elements close to evaluation points
     arma::Mat<ResultType> result;
     evaluator->evaluate(Evaluator::FAR_FIELD, evaluationPoints, result);
+    if (options.isNearFieldQuadratureEnabled())
+        evaluator->applyNearFieldCorrection(
+                    evaluationPoints, options.nearFieldRelativeDistance(), result);
 
     return result;
 }
 
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+AssembledPotentialOperator<BasisFunctionType, ResultType>
+ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::assemble(
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        const shared_ptr<const arma::Mat<CoordinateType> >& evaluationPoints,
+        const QuadratureStrategy& quadStrategy,
+        const EvaluationOptions& options) const
+{
+    if (!space)
+        throw std::invalid_argument(
+                "ElementaryPotentialOperator::assemble(): "
+                "space must not be null");
+    if (!evaluationPoints)
+        throw std::invalid_argument(
+                "ElementaryPotentialOperator::assemble(): "
+                "evaluationPoints must not be null");
+    if (evaluationPoints->n_rows != space->grid()->dimWorld())
+        throw std::invalid_argument(
+                "ElementaryPotentialOperator::assemble(): "
+                "the number of coordinates of each evaluation point must be "
+                "equal to the dimension of the space containing the surface "
+                "on which the function space 'space' is defined");
+
+    typedef Fiber::RawGridGeometry<CoordinateType> RawGridGeometry;
+    typedef std::vector<const Fiber::Basis<BasisFunctionType>*> BasisPtrVector;
+    typedef std::vector<std::vector<ResultType> > CoefficientsVector;
+    typedef LocalAssemblerConstructionHelper Helper;
+
+    shared_ptr<RawGridGeometry> rawGeometry;
+    shared_ptr<GeometryFactory> geometryFactory;
+    shared_ptr<Fiber::OpenClHandler> openClHandler;
+    shared_ptr<BasisPtrVector> bases;
+
+    shared_ptr<const Grid> grid = space->grid();
+    Helper::collectGridData(*grid,
+                            rawGeometry, geometryFactory);
+    Helper::makeOpenClHandler(options.parallelizationOptions().openClOptions(),
+                              rawGeometry, openClHandler);
+    Helper::collectBases(*space, bases);
+
+    // Get the global DOFs of each element
+    std::vector<std::vector<GlobalDofIndex> > globalDofs;
+    space->getGlobalDofsOfAllElements(globalDofs);
+    const int elementCount = globalDofs.size();
+
+    // The potential is linear in the local coefficients of the argument,
+    // so the matrix is built from the potentials of individual local basis
+    // functions, which the evaluator computes irrespective of the
+    // coefficients it is constructed with
+    shared_ptr<CoefficientsVector> localCoefficients =
+            boost::make_shared<CoefficientsVector>(elementCount);
+    for (int e = 0; e < elementCount; ++e)
+        (*localCoefficients)[e].resize(globalDofs[e].size(), 0.);
+    std::auto_ptr<Evaluator> evaluator =
+            quadStrategy.makeEvaluatorForIntegralOperators(
+                geometryFactory, rawGeometry,
+                bases,
+                make_shared_from_ref(kernels()),
+                make_shared_from_ref(trialTransformations()),
+                make_shared_from_ref(integral()),
+                localCoefficients,
+                openClHandler,
+                options.parallelizationOptions());
+
+    const int componentCount = integral().resultDimension();
+    const size_t pointCount = evaluationPoints->n_cols;
+    arma::Mat<ResultType> matrix(componentCount * pointCount,
+                                 space->globalDofCount());
+    matrix.fill(0.);
+
+    if (elementCount > 0 && pointCount > 0) {
+        std::auto_ptr<Fiber::ElementBoundingBoxIndex<CoordinateType> >
+                nearFieldIndex;
+        if (options.isNearFieldQuadratureEnabled())
+            nearFieldIndex.reset(new Fiber::ElementBoundingBoxIndex<CoordinateType>(
+                                     *rawGeometry,
+                                     options.nearFieldRelativeDistance()));
+
+        // Process the evaluation points in chunks of the same size as
+        // the evaluators do
+        const size_t chunkSize = 96;
+        const size_t chunkCount = (pointCount + chunkSize - 1) / chunkSize;
+
+        Fiber::ScopedScheduler scheduler(options.parallelizationOptions());
+        typedef PotentialMatrixLoopBody<ResultType> Body;
+        {
+            Fiber::SerialBlasRegion region;
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount),
+                              Body(chunkSize, *evaluator, globalDofs,
+                                   nearFieldIndex.get(), *evaluationPoints,
+                                   matrix));
+        }
+    }
+
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > op(
+                new DiscreteDenseBoundaryOperator<ResultType>(matrix));
+    return AssembledPotentialOperator<BasisFunctionType, ResultType>(
+                space, evaluationPoints, op, componentCount);
+}
+
 // UNDOCUMENTED PRIVATE METHODS
 
 /** \cond PRIVATE */
@@ -182,7 +382,8 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::makeEval
     }
 
     // Now create the evaluator
-    return quadStrategy.makeEvaluatorForIntegralOperators(
+    std::auto_ptr<Evaluator> evaluator =
+            quadStrategy.makeEvaluatorForIntegralOperators(
                 geometryFactory, rawGeometry,
                 bases,
                 make_shared_from_ref(kernels()),
@@ -191,6 +392,16 @@ ElementaryPotentialOperator<BasisFunctionType, KernelType, ResultType>::makeEval
                 localCoefficients,
                 openClHandler,
                 options.parallelizationOptions());
+    if (options.evaluationMode() == EvaluationOptions::HIERARCHICAL) {
+        const HierarchicalEvaluationOptions& hOptions =
+                options.hierarchicalEvaluationOptions();
+        evaluator.reset(
+                    new Fiber::HierarchicalEvaluatorForIntegralOperators<ResultType>(
+                        evaluator, hOptions.eta, hOptions.interpolationOrder,
+                        hOptions.maximumLeafSize,
+                        options.parallelizationOptions()));
+    }
+    return evaluator;
 }
 
 /** \endcond */
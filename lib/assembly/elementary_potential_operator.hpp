@@ -117,6 +117,12 @@ public:
             const QuadratureStrategy& quadStrategy,
             const EvaluationOptions& options) const;
 
+    virtual AssembledPotentialOperator<BasisFunctionType_, ResultType_> assemble(
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const shared_ptr<const arma::Mat<CoordinateType> >& evaluationPoints,
+            const QuadratureStrategy& quadStrategy,
+            const EvaluationOptions& options) const;
+
 private:
     /** \cond PRIVATE */
     std::auto_ptr<Evaluator>
@@ -26,10 +26,79 @@
 namespace Bempp
 {
 
-EvaluationOptions::EvaluationOptions()
+HierarchicalEvaluationOptions::HierarchicalEvaluationOptions() :
+    eta(2.),
+    interpolationOrder(5),
+    maximumLeafSize(64)
 {
 }
 
+EvaluationOptions::EvaluationOptions() :
+    m_evaluationMode(DENSE),
+    m_nearFieldQuadratureEnabled(true),
+    m_nearFieldRelativeDistance(2.)
+{
+}
+
+void EvaluationOptions::switchToDenseMode()
+{
+    m_evaluationMode = DENSE;
+}
+
+void EvaluationOptions::switchToHierarchicalMode(
+        const HierarchicalEvaluationOptions& options)
+{
+    if (options.eta <= 0.)
+        throw std::invalid_argument(
+                "EvaluationOptions::switchToHierarchicalMode(): "
+                "eta must be positive");
+    if (options.interpolationOrder < 1)
+        throw std::invalid_argument(
+                "EvaluationOptions::switchToHierarchicalMode(): "
+                "interpolationOrder must be positive");
+    if (options.maximumLeafSize < 1)
+        throw std::invalid_argument(
+                "EvaluationOptions::switchToHierarchicalMode(): "
+                "maximumLeafSize must be positive");
+    m_evaluationMode = HIERARCHICAL;
+    m_hierarchicalEvaluationOptions = options;
+}
+
+EvaluationOptions::Mode EvaluationOptions::evaluationMode() const
+{
+    return m_evaluationMode;
+}
+
+const HierarchicalEvaluationOptions&
+EvaluationOptions::hierarchicalEvaluationOptions() const
+{
+    return m_hierarchicalEvaluationOptions;
+}
+
+void EvaluationOptions::enableNearFieldQuadrature(bool value)
+{
+    m_nearFieldQuadratureEnabled = value;
+}
+
+bool EvaluationOptions::isNearFieldQuadratureEnabled() const
+{
+    return m_nearFieldQuadratureEnabled;
+}
+
+void EvaluationOptions::setNearFieldRelativeDistance(double distance)
+{
+    if (distance < 0.)
+        throw std::invalid_argument(
+                "EvaluationOptions::setNearFieldRelativeDistance(): "
+                "distance must be nonnegative");
+    m_nearFieldRelativeDistance = distance;
+}
+
+double EvaluationOptions::nearFieldRelativeDistance() const
+{
+    return m_nearFieldRelativeDistance;
+}
+
 //void EvaluationOptions::switchToOpenCl(const OpenClOptions& openClOptions)
 //{
 //    m_parallelizationOptions.switchToOpenCl(openClOptions);
@@ -34,6 +34,38 @@ namespace Bempp
 using Fiber::OpenClOptions;
 using Fiber::ParallelizationOptions;
 
+/** \ingroup potential_operators
+ *  \brief Parameters of the hierarchical evaluation of potentials.
+ *
+ *  \see EvaluationOptions::switchToHierarchicalMode(). */
+struct HierarchicalEvaluationOptions
+{
+    /** \brief Initialize the parameters to default values. */
+    HierarchicalEvaluationOptions();
+
+    /** \brief Cluster-pair admissibility parameter.
+     *
+     *  A cluster of evaluation points and a cluster of quadrature points on
+     *  the surface interact through the far-field approximation if the
+     *  larger of their diameters does not exceed \p eta times the distance
+     *  between them. Smaller values give more accurate, but slower
+     *  evaluation.
+     *
+     *  Default value: 2. */
+    double eta;
+    /** \brief Number of Chebyshev nodes along each axis of a cluster's
+     *  bounding box used to interpolate far-field interactions.
+     *
+     *  The interpolation error decreases exponentially with this number.
+     *
+     *  Default value: 5. */
+    unsigned int interpolationOrder;
+    /** \brief Maximum number of points in a leaf cluster.
+     *
+     *  Default value: 64. */
+    unsigned int maximumLeafSize;
+};
+
 /** \ingroup potential_operators
  *  \brief Options controlling evaluation of potentials.
  */
@@ -45,6 +77,89 @@ public:
 
     enum { AUTO = -1 };
 
+    /** @name Evaluation mode
+      @{ */
+
+    /** \brief Possible modes of evaluation of potentials. */
+    enum Mode {
+        /** \brief Sum the contributions of all quadrature points on the
+         *  surface at each evaluation point. */
+        DENSE,
+        /** \brief Cluster evaluation points and quadrature points and
+         *  approximate interactions of well-separated clusters by
+         *  interpolation. */
+        HIERARCHICAL
+    };
+
+    /** \brief Evaluate potentials by direct summation.
+     *
+     *  This is the default evaluation mode. Its cost is proportional to the
+     *  product of the number of evaluation points and the number of
+     *  elements of the surface. */
+    void switchToDenseMode();
+
+    /** \brief Evaluate potentials hierarchically.
+     *
+     *  In this mode the cost of evaluation grows only slightly faster than
+     *  linearly with the number of evaluation points and elements, at the
+     *  price of an approximation error controlled by \p options. This
+     *  makes the evaluation of potentials on large grids of points
+     *  feasible. Since far-field interactions are approximated by
+     *  polynomial interpolation, this mode is intended for non-oscillatory
+     *  kernels and for oscillatory ones at low frequencies. */
+    void switchToHierarchicalMode(const HierarchicalEvaluationOptions& options);
+
+    /** \brief Current evaluation mode. */
+    Mode evaluationMode() const;
+
+    /** \brief Current parameters of hierarchical evaluation.
+     *
+     *  \note These settings are only used in the hierarchical evaluation
+     *  mode, i.e. when evaluationMode() returns HIERARCHICAL. */
+    const HierarchicalEvaluationOptions& hierarchicalEvaluationOptions() const;
+
+    /** @}
+      @name Near field
+      @{ */
+
+    /** \brief Enable or disable the use of the near-field quadrature rule
+     *  for elements close to evaluation points.
+     *
+     *  If this option is enabled (default), the contributions of elements
+     *  lying within nearFieldRelativeDistance() element diameters of an
+     *  evaluation point are integrated with a higher-order quadrature rule
+     *  than those of the remaining elements. This substantially improves
+     *  the accuracy of potentials evaluated close to the surface, at a
+     *  modest additional cost proportional to the number of such
+     *  point-element pairs. */
+    void enableNearFieldQuadrature(bool value = true);
+
+    /** \brief Return whether the near-field quadrature rule is used for
+     *  elements close to evaluation points.
+     *
+     *  \see enableNearFieldQuadrature(). */
+    bool isNearFieldQuadratureEnabled() const;
+
+    /** \brief Set the distance below which an element is considered close
+     *  to an evaluation point.
+     *
+     *  The distance is measured from the element's bounding box and
+     *  expressed in multiples of the element's diameter. \p distance must
+     *  be nonnegative.
+     *
+     *  Default value: 2. */
+    void setNearFieldRelativeDistance(double distance);
+
+    /** \brief Return the distance below which an element is considered
+     *  close to an evaluation point.
+     *
+     *  \see setNearFieldRelativeDistance(). */
+    double nearFieldRelativeDistance() const;
+
+    /** @}
+      @name Parallelization
+      @{ */
+
     // Temporarily removed (OpenCl support is broken).
     // void enableOpenCl(const OpenClOptions& openClOptions);
     // void disableOpenCl();
@@ -63,7 +178,13 @@ public:
     /** \brief Return current parallelization options. */
     const ParallelizationOptions& parallelizationOptions() const;
 
+    /** @} */
+
 private:
+    Mode m_evaluationMode;
+    HierarchicalEvaluationOptions m_hierarchicalEvaluationOptions;
+    bool m_nearFieldQuadratureEnabled;
+    double m_nearFieldRelativeDistance;
     ParallelizationOptions m_parallelizationOptions;
 };
 
@@ -0,0 +1,50 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "global_to_local_dof_map.hpp"
+
+namespace Bempp
+{
+
+void invertGlobalDofMap(
+        const std::vector<std::vector<GlobalDofIndex> >& globalDofs,
+        size_t globalDofCount,
+        GlobalToLocalDofMap& result)
+{
+    // Two passes: first count the local DOFs of each global DOF, then
+    // store them
+    const size_t elementCount = globalDofs.size();
+    std::vector<size_t>& offsets = result.offsets;
+    offsets.assign(globalDofCount + 1, 0);
+    for (size_t e = 0; e < elementCount; ++e)
+        for (size_t ldof = 0; ldof < globalDofs[e].size(); ++ldof)
+            ++offsets[globalDofs[e][ldof] + 1];
+    for (size_t dof = 0; dof < globalDofCount; ++dof)
+        offsets[dof + 1] += offsets[dof];
+
+    result.localDofs.resize(offsets[globalDofCount]);
+    std::vector<size_t> positions(offsets.begin(), offsets.end() - 1);
+    for (size_t e = 0; e < elementCount; ++e)
+        for (size_t ldof = 0; ldof < globalDofs[e].size(); ++ldof)
+            result.localDofs[positions[globalDofs[e][ldof]]++] =
+                    LocalDof(e, ldof);
+}
+
+} // namespace Bempp
@@ -0,0 +1,62 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_global_to_local_dof_map_hpp
+#define bempp_global_to_local_dof_map_hpp
+
+#include "../common/common.hpp"
+#include "../common/types.hpp"
+
+#include <vector>
+
+namespace Bempp
+{
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Lists of local DOFs corresponding to each global DOF of a space.
+ *
+ *  The local DOFs corresponding to global DOF \c i are stored in
+ *  <tt>localDofs[offsets[i]]</tt>, ..., <tt>localDofs[offsets[i + 1] - 1]</tt>,
+ *  ordered by increasing element index. This layout lets each global DOF be
+ *  assembled independently of the others, without locks. */
+struct GlobalToLocalDofMap
+{
+    std::vector<size_t> offsets;
+    std::vector<LocalDof> localDofs;
+};
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Invert an element-to-global-DOF map.
+ *
+ *  \param[in] globalDofs
+ *    Vector whose <tt>e</tt>th element contains the indices of the global
+ *    DOFs corresponding to the local DOFs of element \c e.
+ *  \param[in] globalDofCount
+ *    Number of global DOFs.
+ *  \param[out] result
+ *    The inverted map. */
+void invertGlobalDofMap(
+        const std::vector<std::vector<GlobalDofIndex> >& globalDofs,
+        size_t globalDofCount,
+        GlobalToLocalDofMap& result);
+
+} // namespace Bempp
+
+#endif
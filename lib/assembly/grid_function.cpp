@@ -25,8 +25,10 @@
 #include "boundary_operator.hpp"
 #include "context.hpp"
 #include "discrete_boundary_operator.hpp"
+#include "global_to_local_dof_map.hpp"
 #include "identity_operator.hpp"
 #include "local_assembler_construction_helper.hpp"
+#include "mass_matrix_cache.hpp"
 
 #include "../common/complex_aux.hpp"
 #include "../common/deprecated.hpp"
@@ -40,6 +42,8 @@
 #include "../fiber/local_assembler_for_grid_functions.hpp"
 #include "../fiber/opencl_handler.hpp"
 #include "../fiber/raw_grid_geometry.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/thread_pool.hpp"
 #include "../grid/geometry_factory.hpp"
 #include "../grid/grid.hpp"
 #include "../grid/grid_view.hpp"
@@ -50,6 +54,8 @@
 #include "../space/space.hpp"
 
 #include <set>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 // TODO: rewrite the constructor of OpenClHandler.
 // It should take a bool useOpenCl and *in addition to that* openClOptions.
@@ -69,51 +75,124 @@ namespace Bempp
 namespace
 {
 
+/** \brief Return whichever of \p candidate1 and \p candidate2 points to
+ *  \p space, or a null pointer if neither does.
+ *
+ *  Used to decide whether mass matrices involving \p space may be taken from
+ *  the cache, which needs to monitor the lifetime of the spaces. */
+template <typename BasisFunctionType>
+shared_ptr<const Space<BasisFunctionType> > findSharedSpace(
+        const Space<BasisFunctionType>& space,
+        const shared_ptr<const Space<BasisFunctionType> >& candidate1,
+        const shared_ptr<const Space<BasisFunctionType> >& candidate2)
+{
+    if (candidate1.get() == &space)
+        return candidate1;
+    if (candidate2.get() == &space)
+        return candidate2;
+    return shared_ptr<const Space<BasisFunctionType> >();
+}
+
+/** \brief Body of the parallel loop evaluating the integrals of a function
+ *  against the basis functions living on individual elements. */
+template <typename ResultType>
+class LocalProjectionLoopBody
+{
+public:
+    LocalProjectionLoopBody(
+            Fiber::LocalAssemblerForGridFunctions<ResultType>& assembler,
+            std::vector<arma::Col<ResultType> >& localResult) :
+        m_assembler(assembler), m_localResult(localResult) {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::vector<int> elementIndices(r.size());
+        for (size_t i = 0; i < r.size(); ++i)
+            elementIndices[i] = r.begin() + i;
+        std::vector<arma::Col<ResultType> > chunkResult;
+        m_assembler.evaluateLocalWeakForms(elementIndices, chunkResult);
+        for (size_t i = 0; i < r.size(); ++i)
+            m_localResult[r.begin() + i] = chunkResult[i];
+    }
+
+private:
+    // mutable OK because Assembler is thread-safe
+    Fiber::LocalAssemblerForGridFunctions<ResultType>& m_assembler;
+    // mutable OK because each element is processed by a single thread
+    std::vector<arma::Col<ResultType> >& m_localResult;
+};
+
+/** \brief Body of the parallel loop adding the local projections to the
+ *  entries of the global vector of projections.
+ *
+ *  Each iteration handles a single global DOF and sums the contributions of
+ *  all elements in a fixed order, so the result does not depend on the
+ *  number of threads. */
+template <typename ResultType>
+class GlobalProjectionLoopBody
+{
+public:
+    GlobalProjectionLoopBody(
+            const GlobalToLocalDofMap& localDofs,
+            const std::vector<arma::Col<ResultType> >& localResult,
+            arma::Col<ResultType>& result) :
+        m_localDofs(localDofs),
+        m_localResult(localResult), m_result(result) {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t globalDof = r.begin(); globalDof != r.end(); ++globalDof) {
+            ResultType sum = 0.;
+            for (size_t i = m_localDofs.offsets[globalDof];
+                 i < m_localDofs.offsets[globalDof + 1]; ++i) {
+                const LocalDof& localDof = m_localDofs.localDofs[i];
+                sum += m_localResult[localDof.entityIndex](localDof.dofIndex);
+            }
+            m_result(globalDof) = sum;
+        }
+    }
+
+private:
+    const GlobalToLocalDofMap& m_localDofs;
+    const std::vector<arma::Col<ResultType> >& m_localResult;
+    // mutable OK because each entry is written by a single thread
+    arma::Col<ResultType>& m_result;
+};
+
 template <typename BasisFunctionType, typename ResultType>
 shared_ptr<arma::Col<ResultType> > reallyCalculateProjections(
         const Space<BasisFunctionType>& dualSpace,
         Fiber::LocalAssemblerForGridFunctions<ResultType>& assembler,
         const AssemblyOptions& options)
 {
-    // TODO: parallelise using TBB (the parameter options will then start be used)
-
-    // Get the grid's leaf view so that we can iterate over elements
-    std::auto_ptr<GridView> view = dualSpace.grid()->leafView();
-    const size_t elementCount = view->entityCount(0);
-
     // Global DOF indices corresponding to local DOFs on elements
-    std::vector<std::vector<GlobalDofIndex> > testGlobalDofs(elementCount);
-
-    // Gather global DOF lists
-    const Mapper& mapper = view->elementMapper();
-    std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
-    while (!it->finished()) {
-        const Entity<0>& element = it->entity();
-        const int elementIndex = mapper.entityIndex(element);
-        dualSpace.getGlobalDofs(element, testGlobalDofs[elementIndex]);
-        it->next();
-    }
+    std::vector<std::vector<GlobalDofIndex> > testGlobalDofs;
+    dualSpace.getGlobalDofsOfAllElements(testGlobalDofs);
+    const size_t elementCount = testGlobalDofs.size();
+    const size_t globalDofCount = dualSpace.globalDofCount();
 
-    // Make a vector of all element indices
-    std::vector<int> testIndices(elementCount);
-    for (size_t i = 0; i < elementCount; ++i)
-        testIndices[i] = i;
+    // Invert the element-to-global-DOF map, so that each global DOF can be
+    // assembled independently
+    GlobalToLocalDofMap localDofs;
+    invertGlobalDofMap(testGlobalDofs, globalDofCount, localDofs);
 
     // Create the weak form's column vector
     shared_ptr<arma::Col<ResultType> > result(
-                new arma::Col<ResultType>(dualSpace.globalDofCount()));
-    result->fill(0.);
-
-    std::vector<arma::Col<ResultType> > localResult;
-    // Evaluate local weak forms
-    assembler.evaluateLocalWeakForms(testIndices, localResult);
+                new arma::Col<ResultType>(globalDofCount));
 
-    // Loop over test indices
-    for (size_t testIndex = 0; testIndex < elementCount; ++testIndex)
+    std::vector<arma::Col<ResultType> > localResult(elementCount);
+    Fiber::ScopedScheduler scheduler(options.parallelizationOptions());
+    {
+        Fiber::SerialBlasRegion region;
+        // Evaluate local weak forms
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, elementCount),
+                          LocalProjectionLoopBody<ResultType>(
+                              assembler, localResult));
         // Add the integrals to appropriate entries in the global weak form
-        for (size_t testDof = 0; testDof < testGlobalDofs[testIndex].size(); ++testDof)
-            (*result)(testGlobalDofs[testIndex][testDof]) +=
-                    localResult[testIndex](testDof);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, globalDofCount),
+                          GlobalProjectionLoopBody<ResultType>(
+                              localDofs, localResult, *result));
+    }
 
     // Return the vector of projections <phi_i, f>
     return result;
@@ -407,16 +486,22 @@ GridFunction<BasisFunctionType, ResultType>::projections(
                 "GridFunction::projections(): "
                 "space and dual space must be defined on the same grid");
 
-    // Calculate the mass matrix
-    typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
-    BoundaryOp id = identityOperator(
-                m_context, m_space, m_space,
-                make_shared_from_ref(dualSpace_));
+    // Get the mass matrix
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > massMatrix;
+    if (shared_ptr<const Space<BasisFunctionType> > dualSpace =
+            findSharedSpace(dualSpace_, m_dualSpace, m_space))
+        massMatrix = m_context->massMatrixCache().massMatrix(
+                    m_context, m_space, dualSpace);
+    else
+        // We don't control the lifetime of dualSpace_, so don't cache
+        massMatrix = identityOperator(
+                    m_context, m_space, m_space,
+                    make_shared_from_ref(dualSpace_)).weakForm();
 
     arma::Col<ResultType> projects(dualSpace_.globalDofCount());
-    id.weakForm()->apply(NO_TRANSPOSE, *m_coefficients, projects,
-                         static_cast<ResultType>(1.),
-                         static_cast<ResultType>(0.));
+    massMatrix->apply(NO_TRANSPOSE, *m_coefficients, projects,
+                      static_cast<ResultType>(1.),
+                      static_cast<ResultType>(0.));
     return projects;
 }
 
@@ -453,16 +538,21 @@ void GridFunction<BasisFunctionType, ResultType>::setProjections(
     // GridFunction instances (but copying a GridFunction is fairly
     // cheap since it only stores shared pointers).
 
-    // Calculate the (pseudo)inverse mass matrix
-    typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
-    BoundaryOp id = identityOperator(
-                m_context, m_space, m_space,
-                make_shared_from_ref(dualSpace_));
-    BoundaryOp pinvId = pseudoinverse(id);
+    // Get the (pseudo)inverse mass matrix
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > inverseMassMatrix;
+    if (shared_ptr<const Space<BasisFunctionType> > dualSpace =
+            findSharedSpace(dualSpace_, m_dualSpace, m_space))
+        inverseMassMatrix = m_context->massMatrixCache().inverseMassMatrix(
+                    m_context, m_space, dualSpace);
+    else
+        // We don't control the lifetime of dualSpace_, so don't cache
+        inverseMassMatrix = pseudoinverse(identityOperator(
+                    m_context, m_space, m_space,
+                    make_shared_from_ref(dualSpace_))).weakForm();
 
     shared_ptr<arma::Col<ResultType> > newCoefficients(
                 new arma::Col<ResultType>(m_space->globalDofCount()));
-    pinvId.weakForm()->apply(
+    inverseMassMatrix->apply(
                 NO_TRANSPOSE, projects, *newCoefficients,
                 static_cast<ResultType>(1.), static_cast<ResultType>(0.));
     m_coefficients = newCoefficients;
@@ -479,15 +569,13 @@ GridFunction<BasisFunctionType, ResultType>::L2Norm() const
     if (!m_space)
         throw std::runtime_error("GridFunction::L2_Norm() must not be called "
                                  "on an uninitialized GridFunction object");
-    typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
 
     // Get the vector of coefficients
     const arma::Col<ResultType>& coeffs = coefficients();
 
-    // Calculate the mass matrix
-    BoundaryOp id = identityOperator(m_context, m_space, m_space, m_space);
+    // Get the mass matrix
     shared_ptr<const DiscreteBoundaryOperator<ResultType> > massMatrix =
-            id.weakForm();
+            m_context->massMatrixCache().massMatrix(m_context, m_space, m_space);
 
     arma::Col<ResultType> product(coeffs.n_rows);
     massMatrix->apply(NO_TRANSPOSE, coeffs, product, 1., 0.);
@@ -28,10 +28,13 @@
 #include "assembly_options.hpp"
 #include "boundary_operator.hpp"
 #include "cluster_construction_helper.hpp"
+#include "csr_matrix.hpp"
 #include "discrete_dense_boundary_operator.hpp"
 #include "discrete_sparse_boundary_operator.hpp"
 #include "context.hpp"
+#include "global_to_local_dof_map.hpp"
 
+#include "../common/complex_aux.hpp"
 #include "../common/types.hpp"
 #include "../fiber/basis.hpp"
 #include "../fiber/explicit_instantiation.hpp"
@@ -40,6 +43,8 @@
 #include "../fiber/opencl_handler.hpp"
 #include "../fiber/raw_grid_geometry.hpp"
 #include "../fiber/scalar_function_value_functor.hpp"
+#include "../fiber/serial_blas_region.hpp"
+#include "../fiber/thread_pool.hpp"
 #include "../fiber/default_collection_of_basis_transformations.hpp"
 #include "../grid/entity_iterator.hpp"
 #include "../grid/geometry_factory.hpp"
@@ -51,112 +56,174 @@
 #include "../common/boost_make_shared_fwd.hpp"
 #include <boost/type_traits/is_complex.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tbb/tick_count.h>
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 
-#ifdef WITH_TRILINOS
-// This is a workaround of the problem of the abs() function being declared
-// both in Epetra and in AHMED. It relies of the implementation detail (!) that
-// in Epetra the declaration of abs is put between #ifndef __IBMCPP__ ...
-// #endif. So it may well break in future versions of Trilinos. The ideal
-// solution would be for AHMED to use namespaces.
-#ifndef __IBMCPP__
-#define __IBMCPP__
-#include <Epetra_FECrsMatrix.h>
-#include <Epetra_LocalMap.h>
-#include <Epetra_SerialComm.h>
-#undef __IBMCPP__
-#else
-#include <Epetra_FECrsMatrix.h>
-#include <Epetra_LocalMap.h>
-#include <Epetra_SerialComm.h>
-#endif
-#endif // WITH_TRILINOS
-
 namespace Bempp
 {
 
 #ifdef WITH_TRILINOS
-// Internal helper functions for Epetra
+// Internal helper functions for sparse-mode assembly
 namespace
 {
 
-template <typename ValueType>
-int epetraSumIntoGlobalValues(Epetra_FECrsMatrix& matrix,
-                              const std::vector<int>& rowIndices,
-                              const std::vector<int>& colIndices,
-                              const arma::Mat<ValueType>& values);
-
-// Specialisation for double -- no intermediate array is needed
-template <>
-inline int epetraSumIntoGlobalValues<double>(
-        Epetra_FECrsMatrix& matrix,
-        const std::vector<int>& rowIndices,
-        const std::vector<int>& colIndices,
-        const arma::Mat<double>& values)
+/** \brief Body of the parallel loop evaluating the local weak forms on
+ *  chunks of elements. */
+template <typename ResultType>
+class LocalWeakFormLoopBody
 {
-    assert(rowIndices.size() == values.n_rows);
-    assert(colIndices.size() == values.n_cols);
-    return matrix.SumIntoGlobalValues(rowIndices.size(), &rowIndices[0],
-                                      colIndices.size(), &colIndices[0],
-                                      values.memptr(),
-                                      Epetra_FECrsMatrix::COLUMN_MAJOR);
-}
+public:
+    LocalWeakFormLoopBody(
+            Fiber::LocalAssemblerForOperators<ResultType>& assembler,
+            std::vector<arma::Mat<ResultType> >& localResult) :
+        m_assembler(assembler), m_localResult(localResult) {
+    }
 
-// Specialisation for float
-template <>
-inline int epetraSumIntoGlobalValues<float>(
-        Epetra_FECrsMatrix& matrix,
-        const std::vector<int>& rowIndices,
-        const std::vector<int>& colIndices,
-        const arma::Mat<float>& values)
-{
-    // Convert data from float into double (expected by Epetra)
-    arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-    std::copy(values.begin(), values.end(), doubleValues.begin());
-    return epetraSumIntoGlobalValues<double>(
-                matrix, rowIndices, colIndices, doubleValues);
-}
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::vector<int> elementIndices(r.size());
+        for (size_t i = 0; i < r.size(); ++i)
+            elementIndices[i] = r.begin() + i;
+        std::vector<arma::Mat<ResultType> > chunkResult;
+        m_assembler.evaluateLocalWeakForms(elementIndices, chunkResult);
+        for (size_t i = 0; i < r.size(); ++i)
+            m_localResult[r.begin() + i] = chunkResult[i];
+    }
 
-// Specialisation for std::complex<float>.
-// WARNING: at present only the real part is taken into account!
-// This is sufficient as long as we provide real-valued basis functions only.
-template <>
-inline int epetraSumIntoGlobalValues<std::complex<float> >(
-        Epetra_FECrsMatrix& matrix,
-        const std::vector<int>& rowIndices,
-        const std::vector<int>& colIndices,
-        const arma::Mat<std::complex<float> >& values)
+private:
+    // mutable OK because Assembler is thread-safe
+    Fiber::LocalAssemblerForOperators<ResultType>& m_assembler;
+    // mutable OK because each element is processed by a single thread
+    std::vector<arma::Mat<ResultType> >& m_localResult;
+};
+
+/** \brief Body of the parallel loop determining the sparsity pattern of
+ *  the matrix.
+ *
+ *  Row \c i of the matrix couples the test DOF \c i with all trial DOFs
+ *  residing on the elements adjacent to that test DOF. If \p columnIndices
+ *  is null, only the number of distinct trial DOFs in each row is computed
+ *  and stored in \p rowEntryCounts; otherwise the sorted column indices of
+ *  each row are written into \p columnIndices starting from the position
+ *  given by \p rowOffsets. */
+class SparsityPatternLoopBody
 {
-    // Extract the real part of "values" into an array of type double
-    arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-    // Check whether arma::real returns a view or a copy (if the latter,
-    // this assert will fail)
-    for (size_t i = 0; i < values.n_elem; ++i)
-        doubleValues[i] = values[i].real();
-    return epetraSumIntoGlobalValues<double>(
-                matrix, rowIndices, colIndices, doubleValues);
-}
+public:
+    SparsityPatternLoopBody(
+            const GlobalToLocalDofMap& testLocalDofs,
+            const std::vector<std::vector<GlobalDofIndex> >& trialGdofs,
+            std::vector<int>& rowEntryCounts,
+            const std::vector<int>* rowOffsets,
+            std::vector<int>* columnIndices) :
+        m_testLocalDofs(testLocalDofs),
+        m_trialGdofs(trialGdofs),
+        m_rowEntryCounts(rowEntryCounts),
+        m_rowOffsets(rowOffsets),
+        m_columnIndices(columnIndices) {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::vector<int> columns;
+        for (size_t row = r.begin(); row != r.end(); ++row) {
+            columns.clear();
+            for (size_t i = m_testLocalDofs.offsets[row];
+                 i < m_testLocalDofs.offsets[row + 1]; ++i) {
+                const std::vector<GlobalDofIndex>& elementTrialGdofs =
+                        m_trialGdofs[m_testLocalDofs.localDofs[i].entityIndex];
+                columns.insert(columns.end(), elementTrialGdofs.begin(),
+                               elementTrialGdofs.end());
+            }
+            std::sort(columns.begin(), columns.end());
+            columns.erase(std::unique(columns.begin(), columns.end()),
+                          columns.end());
+            if (m_columnIndices)
+                std::copy(columns.begin(), columns.end(),
+                          m_columnIndices->begin() + (*m_rowOffsets)[row]);
+            else
+                m_rowEntryCounts[row] = columns.size();
+        }
+    }
+
+private:
+    const GlobalToLocalDofMap& m_testLocalDofs;
+    const std::vector<std::vector<GlobalDofIndex> >& m_trialGdofs;
+    // mutable OK because each entry is written by a single thread
+    std::vector<int>& m_rowEntryCounts;
+    const std::vector<int>* m_rowOffsets;
+    // mutable OK because each row is written by a single thread
+    std::vector<int>* m_columnIndices;
+};
 
-// Specialisation for std::complex<double>.
-// WARNING: at present only the real part is taken into account!
-// This is sufficient as long as we provide real-valued basis functions only.
-template <>
-inline int epetraSumIntoGlobalValues<std::complex<double> >(
-        Epetra_FECrsMatrix& matrix,
-        const std::vector<int>& rowIndices,
-        const std::vector<int>& colIndices,
-        const arma::Mat<std::complex<double> >& values)
+/** \brief Body of the parallel loop adding the local weak forms to the
+ *  entries of the matrix with a precomputed sparsity pattern.
+ *
+ *  Each iteration handles a single row and sums the contributions of all
+ *  elements in a fixed order, so no locks are needed and the result does not
+ *  depend on the number of threads.
+ *
+ *  \note At present only the real parts of the local weak forms are taken
+ *  into account. This is sufficient as long as we provide real-valued basis
+ *  functions only. */
+template <typename ResultType>
+class SparseMatrixFillLoopBody
 {
-    // Extract the real part of "values" into an array of type double
-    arma::Mat<double> doubleValues(values.n_rows, values.n_cols);
-    for (size_t i = 0; i < values.n_elem; ++i)
-        doubleValues[i] = values[i].real();
-    return epetraSumIntoGlobalValues<double>(
-                matrix, rowIndices, colIndices, doubleValues);
-}
+public:
+    typedef typename Fiber::ScalarTraits<ResultType>::RealType CoordinateType;
+
+    SparseMatrixFillLoopBody(
+            const GlobalToLocalDofMap& testLocalDofs,
+            const std::vector<std::vector<GlobalDofIndex> >& trialGdofs,
+            const std::vector<arma::Mat<ResultType> >& localResult,
+            const std::vector<int>& rowOffsets,
+            const std::vector<int>& columnIndices,
+            std::vector<CoordinateType>& values) :
+        m_testLocalDofs(testLocalDofs),
+        m_trialGdofs(trialGdofs),
+        m_localResult(localResult),
+        m_rowOffsets(rowOffsets),
+        m_columnIndices(columnIndices),
+        m_values(values) {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t row = r.begin(); row != r.end(); ++row) {
+            const std::vector<int>::const_iterator rowBegin =
+                    m_columnIndices.begin() + m_rowOffsets[row];
+            const std::vector<int>::const_iterator rowEnd =
+                    m_columnIndices.begin() + m_rowOffsets[row + 1];
+            for (size_t i = m_testLocalDofs.offsets[row];
+                 i < m_testLocalDofs.offsets[row + 1]; ++i) {
+                const int element = m_testLocalDofs.localDofs[i].entityIndex;
+                const int testLdof = m_testLocalDofs.localDofs[i].dofIndex;
+                const std::vector<GlobalDofIndex>& elementTrialGdofs =
+                        m_trialGdofs[element];
+                const arma::Mat<ResultType>& localMatrix =
+                        m_localResult[element];
+                for (size_t trialLdof = 0; trialLdof < elementTrialGdofs.size();
+                     ++trialLdof) {
+                    const size_t position = std::lower_bound(
+                                rowBegin, rowEnd, elementTrialGdofs[trialLdof]) -
+                            m_columnIndices.begin();
+                    m_values[position] +=
+                            realPart(localMatrix(testLdof, trialLdof));
+                }
+            }
+        }
+    }
+
+private:
+    const GlobalToLocalDofMap& m_testLocalDofs;
+    const std::vector<std::vector<GlobalDofIndex> >& m_trialGdofs;
+    const std::vector<arma::Mat<ResultType> >& m_localResult;
+    const std::vector<int>& m_rowOffsets;
+    const std::vector<int>& m_columnIndices;
+    // mutable OK because each row is written by a single thread
+    std::vector<CoordinateType>& m_values;
+};
 
 } // anonymous namespace
 #endif
@@ -351,16 +418,8 @@ IdentityOperator<BasisFunctionType, ResultType>::assembleWeakFormInDenseMode(
     std::vector<std::vector<GlobalDofIndex> > testGdofs(elementCount);
 
     // Gather global DOF lists
-    const Mapper& mapper = view->elementMapper();
-    std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
-    while (!it->finished())
-    {
-        const Entity<0>& element = it->entity();
-        const int elementIndex = mapper.entityIndex(element);
-        testSpace.getGlobalDofs(element, testGdofs[elementIndex]);
-        trialSpace.getGlobalDofs(element, trialGdofs[elementIndex]);
-        it->next();
-    }
+    testSpace.getGlobalDofsOfAllElements(testGdofs);
+    trialSpace.getGlobalDofsOfAllElements(trialGdofs);
 
     // Distribute local matrices into the global matrix
     for (size_t e = 0; e < elementCount; ++e)
@@ -389,81 +448,72 @@ IdentityOperator<BasisFunctionType, ResultType>::assembleWeakFormInSparseMode(
     const Space<BasisFunctionType>& testSpace = *this->dualToRange();
     const Space<BasisFunctionType>& trialSpace = *this->domain();
 
-    // Fill local submatrices
     std::auto_ptr<GridView> view = testSpace.grid()->leafView();
     const size_t elementCount = view->entityCount(0);
-    std::vector<int> elementIndices(elementCount);
-    for (size_t i = 0; i < elementCount; ++i)
-        elementIndices[i] = i;
-    std::vector<arma::Mat<ResultType> > localResult;
-    assembler.evaluateLocalWeakForms(elementIndices, localResult);
-
-    // Estimate number of entries in each row
+    const int testGlobalDofCount = testSpace.globalDofCount();
+    const int trialGlobalDofCount = trialSpace.globalDofCount();
 
     //    This will be useful when we begin to use MPI
     //    // Get global DOF indices for which this process is responsible
-    //    const int testGlobalDofCount = testSpace.globalDofCount();
     //    Epetra_Map rowMap(testGlobalDofCount, 0 /* index-base */, comm);
     //    std::vector<int> myTestGlobalDofs(rowMap.MyGlobalElements(),
     //                                      rowMap.MyGlobalElements() +
     //                                      rowMap.NumMyElements());
     //    const int myTestGlobalDofCount = myTestGlobalDofs.size();
 
-    const int testGlobalDofCount = testSpace.globalDofCount();
-    const int trialGlobalDofCount = trialSpace.globalDofCount();
-    arma::Col<int> nonzeroEntryCountEstimates(testGlobalDofCount);
-    nonzeroEntryCountEstimates.fill(0);
-
     // Global DOF indices corresponding to local DOFs on elements
     std::vector<std::vector<GlobalDofIndex> > trialGdofs(elementCount);
     std::vector<std::vector<GlobalDofIndex> > testGdofs(elementCount);
 
     // Fill above lists
-    const Mapper& mapper = view->elementMapper();
-    std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
-    while (!it->finished())
+    testSpace.getGlobalDofsOfAllElements(testGdofs);
+    trialSpace.getGlobalDofsOfAllElements(trialGdofs);
+
+    // Invert the element-to-test-DOF map, so that each row of the matrix can
+    // be assembled independently
+    GlobalToLocalDofMap testLocalDofs;
+    invertGlobalDofMap(testGdofs, testGlobalDofCount, testLocalDofs);
+
+    std::vector<arma::Mat<ResultType> > localResult(elementCount);
+    std::vector<int> rowEntryCounts(testGlobalDofCount);
+    std::vector<int> rowOffsets(testGlobalDofCount + 1, 0);
+    std::vector<int> columnIndices;
+    std::vector<CoordinateType> values;
+    Fiber::ScopedScheduler scheduler(options.parallelizationOptions());
     {
-        const Entity<0>& element = it->entity();
-        const int elementIndex = mapper.entityIndex(element);
-        testSpace.getGlobalDofs(element, testGdofs[elementIndex]);
-        trialSpace.getGlobalDofs(element, trialGdofs[elementIndex]);
-        it->next();
+        Fiber::SerialBlasRegion region;
+        // Evaluate local weak forms
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, elementCount),
+                          LocalWeakFormLoopBody<ResultType>(
+                              assembler, localResult));
+
+        // Pass 1: count the entries in each row...
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, testGlobalDofCount),
+                          SparsityPatternLoopBody(
+                              testLocalDofs, trialGdofs,
+                              rowEntryCounts, 0, 0));
+        for (int row = 0; row < testGlobalDofCount; ++row)
+            rowOffsets[row + 1] = rowOffsets[row] + rowEntryCounts[row];
+        // ... and store their column indices
+        columnIndices.resize(rowOffsets[testGlobalDofCount]);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, testGlobalDofCount),
+                          SparsityPatternLoopBody(
+                              testLocalDofs, trialGdofs,
+                              rowEntryCounts, &rowOffsets, &columnIndices));
+
+        // Pass 2: add contributions from individual elements
+        values.resize(columnIndices.size(), 0.);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, testGlobalDofCount),
+                          SparseMatrixFillLoopBody<ResultType>(
+                              testLocalDofs, trialGdofs,
+                              localResult, rowOffsets, columnIndices, values));
     }
 
-    // Upper estimate for the number of global trial DOFs coupled to a given
-    // global test DOF: sum of the local trial DOF counts for each element that
-    // contributes to the global test DOF in question
-    for (size_t e = 0; e < elementCount; ++e)
-        for (size_t testLdof = 0; testLdof < testGdofs[e].size(); ++testLdof)
-            nonzeroEntryCountEstimates(testGdofs[e][testLdof]) +=
-                    trialGdofs[e].size();
-
-    Epetra_SerialComm comm; // To be replaced once we begin to use MPI
-    Epetra_LocalMap rowMap(testGlobalDofCount, 0 /* index_base */, comm);
-    Epetra_LocalMap colMap(trialGlobalDofCount, 0 /* index_base */, comm);
-    shared_ptr<Epetra_FECrsMatrix> result = boost::make_shared<Epetra_FECrsMatrix>(
-                Copy, rowMap, colMap,
-                nonzeroEntryCountEstimates.memptr());
-
-    // TODO: make each process responsible for a subset of elements
-    // Find maximum number of local dofs per element
-    size_t maxLdofCount = 0;
-    for (size_t e = 0; e < elementCount; ++e)
-        maxLdofCount = std::max(maxLdofCount,
-                                testGdofs[e].size() * trialGdofs[e].size());
-
-    // Initialise sparse matrix with zeros at required positions
-    arma::Col<double> zeros(maxLdofCount);
-    zeros.fill(0.);
-    for (size_t e = 0; e < elementCount; ++e)
-        result->InsertGlobalValues(testGdofs[e].size(), &testGdofs[e][0],
-                                   trialGdofs[e].size(), &trialGdofs[e][0],
-                                   zeros.memptr());
-    // Add contributions from individual elements
-    for (size_t e = 0; e < elementCount; ++e)
-        epetraSumIntoGlobalValues(
-                    *result, testGdofs[e], trialGdofs[e], localResult[e]);
-    result->GlobalAssemble();
+    // The CSR arrays are handed over to the matrix without copying
+    shared_ptr<const CsrMatrix<ResultType> > result(
+                new CsrMatrix<ResultType>(
+                    testGlobalDofCount, trialGlobalDofCount,
+                    rowOffsets, columnIndices, values));
 
     // If assembly mode is equal to ACA and we have AHMED,
     // construct the block cluster tree. Otherwise leave it uninitialized.
@@ -482,19 +532,19 @@ IdentityOperator<BasisFunctionType, ResultType>::assembleWeakFormInSparseMode(
 
         typedef ClusterConstructionHelper<BasisFunctionType> CCH;
         shared_ptr<AhmedBemCluster> testClusterTree;
-        CCH::constructBemCluster(testSpace, indexWithGlobalDofs, acaOptions,
-                                 testClusterTree,
-                                 test_o2pPermutation, test_p2oPermutation);
+        CCH::getBemCluster(this->dualToRange(), indexWithGlobalDofs, acaOptions,
+                           testClusterTree,
+                           test_o2pPermutation, test_p2oPermutation);
         // TODO: construct a hermitian H-matrix if possible
         shared_ptr<AhmedBemCluster> trialClusterTree;
-        CCH::constructBemCluster(trialSpace, indexWithGlobalDofs, acaOptions,
-                                 trialClusterTree,
-                                 trial_o2pPermutation, trial_p2oPermutation);
+        CCH::getBemCluster(this->domain(), indexWithGlobalDofs, acaOptions,
+                           trialClusterTree,
+                           trial_o2pPermutation, trial_p2oPermutation);
         unsigned int blockCount = 0;
-        blockCluster.reset(CCH::constructBemBlockCluster(
-                               acaOptions, false /* hermitian */,
-                               *testClusterTree, *trialClusterTree, blockCount)
-                           .release());
+        blockCluster = CCH::getBemBlockCluster(
+                    this->dualToRange(), this->domain(), acaOptions,
+                    false /* hermitian */,
+                    testClusterTree, trialClusterTree, blockCount);
     }
 #endif
 
@@ -79,6 +79,32 @@ public:
             original(i) = permuted(m_permutedIndices[i]);
     }
 
+    /** \brief Convert the rows of a matrix from original to permuted
+     *  ordering. */
+    template <typename ValueType>
+    void permuteRows(const arma::Mat<ValueType>& original,
+                     arma::Mat<ValueType>& permuted) const
+    {
+        const int dim = original.n_rows;
+        permuted.set_size(dim, original.n_cols);
+        for (size_t col = 0; col < original.n_cols; ++col)
+            for (int i = 0; i < dim; ++i)
+                permuted(m_permutedIndices[i], col) = original(i, col);
+    }
+
+    /** \brief Convert the rows of a matrix from permuted to original
+     *  ordering. */
+    template <typename ValueType>
+    void unpermuteRows(const arma::Mat<ValueType>& permuted,
+                       arma::Mat<ValueType>& original) const
+    {
+        const int dim = permuted.n_rows;
+        original.set_size(dim, permuted.n_cols);
+        for (size_t col = 0; col < permuted.n_cols; ++col)
+            for (int i = 0; i < dim; ++i)
+                original(i, col) = permuted(m_permutedIndices[i], col);
+    }
+
     /** \brief Permute index. */
     unsigned int permuted(unsigned int index) const {
         return m_permutedIndices[index];
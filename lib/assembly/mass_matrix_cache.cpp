@@ -0,0 +1,171 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "mass_matrix_cache.hpp"
+
+#include "abstract_boundary_operator_pseudoinverse.hpp"
+#include "boundary_operator.hpp"
+#include "context.hpp"
+#include "discrete_boundary_operator.hpp"
+#include "identity_operator.hpp"
+
+#include "../fiber/explicit_instantiation.hpp"
+#include "../space/space.hpp"
+
+#include <boost/weak_ptr.hpp>
+#include <map>
+#include <tbb/mutex.h>
+#include <utility>
+
+namespace Bempp
+{
+
+/** \cond PRIVATE */
+template <typename BasisFunctionType, typename ResultType>
+struct MassMatrixCache<BasisFunctionType, ResultType>::Impl
+{
+    typedef Space<BasisFunctionType> SpaceType;
+    typedef DiscreteBoundaryOperator<ResultType> DiscreteOp;
+
+    struct Entry
+    {
+        // The entry is valid only as long as both spaces are alive (a new
+        // space could otherwise be allocated at the same address)
+        boost::weak_ptr<const SpaceType> space;
+        boost::weak_ptr<const SpaceType> dualSpace;
+
+        // Guards the two members below, which are initialised lazily. It
+        // is held only while they are read or published, never while they
+        // are being built
+        tbb::mutex mutex;
+        shared_ptr<const DiscreteOp> massMatrix;
+        shared_ptr<const DiscreteOp> inverseMassMatrix;
+
+        bool isValid() const {
+            return !space.expired() && !dualSpace.expired();
+        }
+    };
+
+    typedef std::pair<const SpaceType*, const SpaceType*> Key;
+    typedef std::map<Key, shared_ptr<Entry> > EntryMap;
+
+    shared_ptr<Entry> entry(const shared_ptr<const SpaceType>& space,
+                            const shared_ptr<const SpaceType>& dualSpace) {
+        tbb::mutex::scoped_lock lock(mutex);
+        const Key key(space.get(), dualSpace.get());
+        typename EntryMap::iterator it = entries.find(key);
+        if (it != entries.end() && it->second->isValid())
+            return it->second;
+
+        // Discard entries belonging to spaces that no longer exist
+        for (it = entries.begin(); it != entries.end(); )
+            if (it->second->isValid())
+                ++it;
+            else
+                entries.erase(it++);
+
+        shared_ptr<Entry> newEntry(new Entry);
+        newEntry->space = space;
+        newEntry->dualSpace = dualSpace;
+        entries[key] = newEntry;
+        return newEntry;
+    }
+
+    // Guards the map below
+    tbb::mutex mutex;
+    EntryMap entries;
+};
+/** \endcond */
+
+template <typename BasisFunctionType, typename ResultType>
+MassMatrixCache<BasisFunctionType, ResultType>::MassMatrixCache() :
+    m_impl(new Impl)
+{
+}
+
+template <typename BasisFunctionType, typename ResultType>
+MassMatrixCache<BasisFunctionType, ResultType>::~MassMatrixCache()
+{
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+MassMatrixCache<BasisFunctionType, ResultType>::massMatrix(
+        const shared_ptr<const Context<BasisFunctionType, ResultType> >& context,
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        const shared_ptr<const Space<BasisFunctionType> >& dualSpace) const
+{
+    if (!context || !space || !dualSpace)
+        throw std::invalid_argument("MassMatrixCache::massMatrix(): "
+                                    "arguments must not be null");
+    shared_ptr<typename Impl::Entry> entry = m_impl->entry(space, dualSpace);
+    {
+        tbb::mutex::scoped_lock lock(entry->mutex);
+        if (entry->massMatrix)
+            return entry->massMatrix;
+    }
+    // Assemble without holding the lock, so that the (parallel) assembly
+    // can itself request mass matrices from this cache
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > massMatrix =
+            identityOperator(context, space, space, dualSpace).weakForm();
+    tbb::mutex::scoped_lock lock(entry->mutex);
+    // Keep the matrix of another thread that got here first
+    if (!entry->massMatrix)
+        entry->massMatrix = massMatrix;
+    return entry->massMatrix;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+MassMatrixCache<BasisFunctionType, ResultType>::inverseMassMatrix(
+        const shared_ptr<const Context<BasisFunctionType, ResultType> >& context,
+        const shared_ptr<const Space<BasisFunctionType> >& space,
+        const shared_ptr<const Space<BasisFunctionType> >& dualSpace) const
+{
+    if (!context || !space || !dualSpace)
+        throw std::invalid_argument("MassMatrixCache::inverseMassMatrix(): "
+                                    "arguments must not be null");
+    shared_ptr<typename Impl::Entry> entry = m_impl->entry(space, dualSpace);
+    {
+        tbb::mutex::scoped_lock lock(entry->mutex);
+        if (entry->inverseMassMatrix)
+            return entry->inverseMassMatrix;
+    }
+    // Assemble and factorize without holding the lock (see massMatrix())
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > inverseMassMatrix =
+            pseudoinverse(
+                identityOperator(context, space, space, dualSpace)).weakForm();
+    tbb::mutex::scoped_lock lock(entry->mutex);
+    if (!entry->inverseMassMatrix)
+        entry->inverseMassMatrix = inverseMassMatrix;
+    return entry->inverseMassMatrix;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void MassMatrixCache<BasisFunctionType, ResultType>::clear()
+{
+    tbb::mutex::scoped_lock lock(m_impl->mutex);
+    m_impl->entries.clear();
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(MassMatrixCache);
+
+} // namespace Bempp
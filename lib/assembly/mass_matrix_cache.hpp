@@ -0,0 +1,94 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef bempp_mass_matrix_cache_hpp
+#define bempp_mass_matrix_cache_hpp
+
+#include "../common/common.hpp"
+#include "../common/shared_ptr.hpp"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+namespace Bempp
+{
+
+/** \cond FORWARD_DECL */
+template <typename BasisFunctionType, typename ResultType> class Context;
+template <typename ValueType> class DiscreteBoundaryOperator;
+template <typename BasisFunctionType> class Space;
+/** \endcond */
+
+/** \ingroup weak_form_assembly_internal
+ *  \brief Cache of mass matrices and their (pseudo)inverses.
+ *
+ *  Each Context owns an instance of this class. It is used by GridFunction
+ *  to avoid reassembling (and, in the case of the inverse, refactorizing)
+ *  the mass matrix of a pair of spaces every time a norm or a vector of
+ *  projections is calculated.
+ *
+ *  Mass matrices are assembled lazily on first request and stored for as
+ *  long as both spaces they are associated with remain alive. All member
+ *  functions are thread-safe; no lock is held while a matrix is assembled,
+ *  so two threads requesting the same matrix at the same time may both
+ *  assemble it, but only one copy is stored and returned to both. */
+template <typename BasisFunctionType, typename ResultType>
+class MassMatrixCache : boost::noncopyable
+{
+public:
+    /** \brief Constructor. */
+    MassMatrixCache();
+
+    /** \brief Destructor. */
+    ~MassMatrixCache();
+
+    /** \brief Return the weak form of the identity operator with domain and
+     *  range \p space and space dual to range \p dualSpace.
+     *
+     *  \p context must be the Context owning this cache. */
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > massMatrix(
+            const shared_ptr<const Context<BasisFunctionType, ResultType> >& context,
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const shared_ptr<const Space<BasisFunctionType> >& dualSpace) const;
+
+    /** \brief Return the weak form of the pseudoinverse of the identity
+     *  operator with domain and range \p space and space dual to range
+     *  \p dualSpace.
+     *
+     *  \p context must be the Context owning this cache. */
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > inverseMassMatrix(
+            const shared_ptr<const Context<BasisFunctionType, ResultType> >& context,
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const shared_ptr<const Space<BasisFunctionType> >& dualSpace) const;
+
+    /** \brief Remove all mass matrices from the cache. */
+    void clear();
+
+private:
+    /** \cond PRIVATE */
+    struct Impl;
+    boost::scoped_ptr<Impl> m_impl;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,199 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "mixed_precision_discrete_boundary_operator.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include "../fiber/explicit_instantiation.hpp"
+
+#include <stdexcept>
+
+#ifdef WITH_TRILINOS
+#include <Thyra_SpmdVectorSpaceDefaultBase.hpp>
+#endif
+
+namespace Bempp
+{
+
+namespace
+{
+
+template <typename TargetType, typename SourceType>
+void convertMatrix(const arma::Mat<SourceType>& source,
+                   arma::Mat<TargetType>& target)
+{
+    target.set_size(source.n_rows, source.n_cols);
+    const SourceType* sourceData = source.memptr();
+    TargetType* targetData = target.memptr();
+    for (size_t i = 0; i < source.n_elem; ++i)
+        targetData[i] = static_cast<TargetType>(sourceData[i]);
+}
+
+// y_inout := alpha * op * x_in + beta * y_inout, with op applied in single
+// precision and the result accumulated in the precision of ValueType
+template <typename ValueType, typename SinglePrecisionType>
+void applyInSinglePrecision(
+        const DiscreteBoundaryOperator<SinglePrecisionType>& op,
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta)
+{
+    arma::Mat<SinglePrecisionType> x;
+    convertMatrix(x_in, x);
+    arma::Mat<SinglePrecisionType> y(y_inout.n_rows, y_inout.n_cols);
+    y.fill(static_cast<SinglePrecisionType>(0.));
+    op.apply(trans, x, y, static_cast<SinglePrecisionType>(1.),
+             static_cast<SinglePrecisionType>(0.));
+
+    if (beta == static_cast<ValueType>(0.))
+        y_inout.fill(static_cast<ValueType>(0.));
+    else
+        y_inout *= beta;
+    const SinglePrecisionType* yData = y.memptr();
+    ValueType* yInoutData = y_inout.memptr();
+    for (size_t i = 0; i < y_inout.n_elem; ++i)
+        yInoutData[i] += alpha * static_cast<ValueType>(yData[i]);
+}
+
+} // namespace
+
+template <typename ValueType>
+MixedPrecisionDiscreteBoundaryOperator<ValueType>::
+MixedPrecisionDiscreteBoundaryOperator(
+        const shared_ptr<const DiscreteBoundaryOperator<SinglePrecisionType> >& op) :
+    m_operator(op)
+#ifdef WITH_TRILINOS
+    , m_domainSpace(Thyra::defaultSpmdVectorSpace<ValueType>(
+                        op ? op->columnCount() : 0)),
+    m_rangeSpace(Thyra::defaultSpmdVectorSpace<ValueType>(
+                     op ? op->rowCount() : 0))
+#endif
+{
+    if (!m_operator)
+        throw std::invalid_argument(
+            "MixedPrecisionDiscreteBoundaryOperator::"
+            "MixedPrecisionDiscreteBoundaryOperator(): "
+            "the wrapped operator must not be NULL");
+}
+
+template <typename ValueType>
+arma::Mat<ValueType>
+MixedPrecisionDiscreteBoundaryOperator<ValueType>::asMatrix() const
+{
+    arma::Mat<ValueType> result;
+    convertMatrix(m_operator->asMatrix(), result);
+    return result;
+}
+
+template <typename ValueType>
+unsigned int MixedPrecisionDiscreteBoundaryOperator<ValueType>::rowCount() const
+{
+    return m_operator->rowCount();
+}
+
+template <typename ValueType>
+unsigned int MixedPrecisionDiscreteBoundaryOperator<ValueType>::columnCount() const
+{
+    return m_operator->columnCount();
+}
+
+template <typename ValueType>
+void MixedPrecisionDiscreteBoundaryOperator<ValueType>::addBlock(
+        const std::vector<int>& rows,
+        const std::vector<int>& cols,
+        const ValueType alpha,
+        arma::Mat<ValueType>& block) const
+{
+    arma::Mat<SinglePrecisionType> singlePrecisionBlock(
+                block.n_rows, block.n_cols);
+    singlePrecisionBlock.fill(static_cast<SinglePrecisionType>(0.));
+    m_operator->addBlock(rows, cols, static_cast<SinglePrecisionType>(1.),
+                         singlePrecisionBlock);
+    const SinglePrecisionType* data = singlePrecisionBlock.memptr();
+    ValueType* blockData = block.memptr();
+    for (size_t i = 0; i < block.n_elem; ++i)
+        blockData[i] += alpha * static_cast<ValueType>(data[i]);
+}
+
+template <typename ValueType>
+shared_ptr<const DiscreteBoundaryOperator<
+    typename MixedPrecisionDiscreteBoundaryOperator<ValueType>::SinglePrecisionType> >
+MixedPrecisionDiscreteBoundaryOperator<ValueType>::singlePrecisionOperator() const
+{
+    return m_operator;
+}
+
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> >
+MixedPrecisionDiscreteBoundaryOperator<ValueType>::domain() const
+{
+    return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> >
+MixedPrecisionDiscreteBoundaryOperator<ValueType>::range() const
+{
+    return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool MixedPrecisionDiscreteBoundaryOperator<ValueType>::opSupportedImpl(
+        Thyra::EOpTransp M_trans) const
+{
+    return m_operator->opSupported(M_trans);
+}
+#endif
+
+template <typename ValueType>
+void MixedPrecisionDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Col<ValueType>& x_in,
+        arma::Col<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    applyInSinglePrecision<ValueType, SinglePrecisionType>(
+                *m_operator, trans, x_in, y_inout, alpha, beta);
+}
+
+template <typename ValueType>
+void MixedPrecisionDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    applyInSinglePrecision<ValueType, SinglePrecisionType>(
+                *m_operator, trans, x_in, y_inout, alpha, beta);
+}
+
+// The wrapped operators are single-precision ones, so this class is only
+// available if single-precision support is enabled
+#if defined(ENABLE_SINGLE_PRECISION)
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(
+    MixedPrecisionDiscreteBoundaryOperator);
+#endif
+
+} // namespace Bempp
@@ -23,6 +23,8 @@
 
 #include "../common/common.hpp"
 
+#include "assembled_potential_operator.hpp"
+
 #include "../fiber/quadrature_strategy.hpp"
 #include "../common/scalar_traits.hpp"
 
@@ -38,6 +40,7 @@ class GeometryFactory;
 class Grid;
 template <typename BasisFunctionType, typename ResultType> class GridFunction;
 template <typename ResultType> class InterpolatedFunction;
+template <typename BasisFunctionType> class Space;
 /** \endcond */
 
 /** \ingroup potential_operators
@@ -52,6 +55,10 @@ template <typename ResultType> class InterpolatedFunction;
  *  The functions evaluateOnGrid() and evaluateAtPoints() can be used to
  *  evaluate the potential produced by a given charge distribution, represented
  *  with a GridFunction object, at specified points in \f$\Omega \setminus \Gamma\f$.
+ *  If potentials of many charge distributions expanded in the same space need
+ *  to be evaluated at the same points, it is more efficient to discretize the
+ *  operator once with assemble() and apply the resulting
+ *  AssembledPotentialOperator to each of them.
  *
  *  \tparam BasisFunctionType_
  *    Type of the values of the (components of the) basis functions into
@@ -110,9 +117,9 @@ public:
      * Hence values of the potential at any vertices of \p evaluationGrid that
      * coincide with \f$\Gamma\f$ can be badly wrong.
      *
-     * The current implementation does not yet take special measures to prevent
-     * loss of accuracy *near* \f$\Gamma\f$, either. If in doubt, increase the
-     * quadrature accuracy. */
+     * Contributions of elements lying close to evaluation points are integrated
+     * with a higher-order quadrature rule unless this is disabled with
+     * EvaluationOptions::enableNearFieldQuadrature(). */
     virtual std::auto_ptr<InterpolatedFunction<ResultType> > evaluateOnGrid(
             const GridFunction<BasisFunctionType, ResultType>& argument,
             const Grid& evaluationGrid,
@@ -145,15 +152,43 @@ public:
      * Hence values of the potential at any points belonging to \f$\Gamma\f$
      * can be badly wrong.
      *
-     * The current implementation does not yet take special measures to prevent
-     * loss of accuracy *near* \f$\Gamma\f$, either. Users are advised to
-     * increase the quadrature accuracy for points lying in the vicinity of
-     * \f$\Gamma\f$. */
+     * Contributions of elements lying close to evaluation points are integrated
+     * with a higher-order quadrature rule unless this is disabled with
+     * EvaluationOptions::enableNearFieldQuadrature(). */
     virtual arma::Mat<ResultType> evaluateAtPoints(
             const GridFunction<BasisFunctionType, ResultType>& argument,
             const arma::Mat<CoordinateType>& evaluationPoints,
             const QuadratureStrategy& quadStrategy,
             const EvaluationOptions& options) const = 0;
+
+    /** \brief Discretize the operator for a given function space and a given
+     *  set of evaluation points.
+     *
+     * \param[in] space
+     *   Space in which the charge distributions will be expanded.
+     * \param[in] evaluationPoints
+     *   2D array whose (i, j)th element is the ith coordinate of the jth point
+     *   at which potentials will be evaluated. The first dimension of this
+     *   array should be equal to <tt>space->grid()->dimWorld()</tt>.
+     * \param[in] quadStrategy
+     *   A #QuadratureStrategy object controlling how the integrals will be
+     *   evaluated.
+     * \param[in] options
+     *   Evaluation options.
+     *
+     * \returns An AssembledPotentialOperator storing the matrix that maps the
+     * expansion coefficients of a charge distribution to the values of its
+     * potential at \p evaluationPoints.
+     *
+     * The matrix is stored in dense form, so its memory footprint is
+     * proportional to the product of the number of evaluation points and the
+     * number of degrees of freedom of \p space. The hierarchical evaluation
+     * mode is not used. */
+    virtual AssembledPotentialOperator<BasisFunctionType, ResultType> assemble(
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const shared_ptr<const arma::Mat<CoordinateType> >& evaluationPoints,
+            const QuadratureStrategy& quadStrategy,
+            const EvaluationOptions& options) const = 0;
 };
 
 } // namespace Bempp
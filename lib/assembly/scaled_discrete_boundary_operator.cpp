@@ -96,6 +96,21 @@ void ScaledDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
                       multiplier * alpha, beta);
 }
 
+template <typename ValueType>
+void ScaledDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    ValueType multiplier = m_multiplier;
+    if (trans == CONJUGATE || trans == CONJUGATE_TRANSPOSE)
+        multiplier = conj(multiplier);
+    m_operator->apply(trans, x_in, y_inout,
+                      multiplier * alpha, beta);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(ScaledDiscreteBoundaryOperator);
 
 } // namespace Bempp
@@ -119,6 +119,20 @@ void TransposedDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
                       alpha, beta);
 }
 
+template <typename ValueType>
+void TransposedDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
+        const TranspositionMode trans,
+        const arma::Mat<ValueType>& x_in,
+        arma::Mat<ValueType>& y_inout,
+        const ValueType alpha,
+        const ValueType beta) const
+{
+    // Bitwise xor. We use the fact that bit 0 of M_trans denotes
+    // conjugation, and bit 1 -- transposition.
+    m_operator->apply(TranspositionMode(trans ^ m_trans), x_in, y_inout,
+                      alpha, beta);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(TransposedDiscreteBoundaryOperator);
 
 } // namespace Bempp
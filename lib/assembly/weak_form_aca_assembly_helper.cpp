@@ -173,7 +173,8 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
         // one local DOF from just one or a few trialElements. Evaluate the
         // local weak form for one local trial DOF at a time.
 
-        std::vector<arma::Mat<ResultType> > localResult;
+        std::vector<arma::Mat<ResultType> >& localResult =
+                m_crossLocalResults.local();
         for (size_t nTrialElem = 0;
              nTrialElem < trialElementIndices.size();
              ++nTrialElem)
@@ -194,15 +195,23 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
                                 Fiber::TEST_TRIAL, testElementIndices,
                                 activeTrialElementIndex, activeTrialLocalDof,
                                 localResult, minDist);
+                    // The block has a single column, so the row index is
+                    // also the offset in data
+                    const ResultType multiplier = m_denseTermsMultipliers[nTerm];
                     for (size_t nTestElem = 0;
                          nTestElem < testElementIndices.size();
-                         ++nTestElem)
+                         ++nTestElem) {
+                        const ResultType* localValues =
+                                localResult[nTestElem].memptr();
+                        const std::vector<LocalDofIndex>& localDofs =
+                                testLocalDofs[nTestElem];
+                        const std::vector<int>& rows = blockRows[nTestElem];
                         for (size_t nTestDof = 0;
-                             nTestDof < testLocalDofs[nTestElem].size();
+                             nTestDof < localDofs.size();
                              ++nTestDof)
-                            result(blockRows[nTestElem][nTestDof], 0) +=
-                                    m_denseTermsMultipliers[nTerm] *
-                                    localResult[nTestElem](testLocalDofs[nTestElem][nTestDof]);
+                            data[rows[nTestDof]] +=
+                                    multiplier * localValues[localDofs[nTestDof]];
+                    }
                 }
             }
         }
@@ -213,7 +222,8 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
         // one local DOF from just one or a few testElements. Evaluate the
         // local weak form for one local test DOF at a time.
 
-        std::vector<arma::Mat<ResultType> > localResult;
+        std::vector<arma::Mat<ResultType> >& localResult =
+                m_crossLocalResults.local();
         for (size_t nTestElem = 0;
              nTestElem < testElementIndices.size();
              ++nTestElem)
@@ -233,15 +243,23 @@ void WeakFormAcaAssemblyHelper<BasisFunctionType, ResultType>::cmpbl(
                                 Fiber::TRIAL_TEST, trialElementIndices,
                                 activeTestElementIndex, activeTestLocalDof,
                                 localResult, minDist);
+                    // The block has a single row, so the column index is
+                    // also the offset in data
+                    const ResultType multiplier = m_denseTermsMultipliers[nTerm];
                     for (size_t nTrialElem = 0;
                          nTrialElem < trialElementIndices.size();
-                         ++nTrialElem)
+                         ++nTrialElem) {
+                        const ResultType* localValues =
+                                localResult[nTrialElem].memptr();
+                        const std::vector<LocalDofIndex>& localDofs =
+                                trialLocalDofs[nTrialElem];
+                        const std::vector<int>& cols = blockCols[nTrialElem];
                         for (size_t nTrialDof = 0;
-                             nTrialDof < trialLocalDofs[nTrialElem].size();
+                             nTrialDof < localDofs.size();
                              ++nTrialDof)
-                            result(0, blockCols[nTrialElem][nTrialDof]) +=
-                                    m_denseTermsMultipliers[nTerm] *
-                                    localResult[nTrialElem](trialLocalDofs[nTrialElem][nTrialDof]);
+                            data[cols[nTrialDof]] +=
+                                    multiplier * localValues[localDofs[nTrialDof]];
+                    }
                 }
             }
         }
@@ -29,6 +29,7 @@
 #include "../common/types.hpp"
 #include "../fiber/scalar_traits.hpp"
 
+#include <tbb/enumerable_thread_specific.h>
 #include <vector>
 
 /** \cond FORWARD_DECL */
@@ -127,6 +128,15 @@ private:
 
     shared_ptr<LocalDofListsCache<BasisFunctionType> >
     m_testDofListsCache, m_trialDofListsCache;
+
+    /** \brief Per-thread buffers for the local weak forms evaluated when
+     *  a single row or column of a block is requested.
+     *
+     *  ACA requests single rows and columns very often, so these buffers
+     *  are reused rather than reallocated on every call to cmpbl(). */
+    typedef std::vector<arma::Mat<ResultType> > LocalResultBuffer;
+    mutable tbb::enumerable_thread_specific<LocalResultBuffer>
+    m_crossLocalResults;
 };
 
 } // namespace Bempp
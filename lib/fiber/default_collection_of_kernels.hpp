@@ -23,9 +23,59 @@
 
 #include "collection_of_kernels.hpp"
 
+#include <boost/type_traits/integral_constant.hpp>
+
 namespace Fiber
 {
 
+/** \cond PRIVATE */
+/** \brief Check whether \p Functor provides the optional evaluateScalar()
+ *  member function (see DefaultCollectionOfKernels). */
+template <typename Functor>
+class HasEvaluateScalarMember
+{
+    typedef typename Functor::ValueType ValueType;
+    typedef typename Functor::CoordinateType CoordinateType;
+    typedef char Yes;
+    typedef char No[2];
+
+    template <typename U, ValueType (U::*)(
+                  const CoordinateType*, const CoordinateType*,
+                  const CoordinateType*, const CoordinateType*) const>
+    struct Check;
+
+    template <typename U> static Yes& test(Check<U, &U::evaluateScalar>*);
+    template <typename U> static No& test(...);
+
+public:
+    enum { value = sizeof(test<Functor>(0)) == sizeof(Yes) };
+};
+
+/** \brief Check whether \p Functor provides the optional evaluateScalars()
+ *  member function (see DefaultCollectionOfKernels). */
+template <typename Functor>
+class HasEvaluateScalarsMember
+{
+    typedef typename Functor::ValueType ValueType;
+    typedef typename Functor::CoordinateType CoordinateType;
+    typedef char Yes;
+    typedef char No[2];
+
+    template <typename U, void (U::*)(
+                  size_t,
+                  const CoordinateType*, const CoordinateType*, size_t,
+                  const CoordinateType*, const CoordinateType*, size_t,
+                  ValueType*) const>
+    struct Check;
+
+    template <typename U> static Yes& test(Check<U, &U::evaluateScalars>*);
+    template <typename U> static No& test(...);
+
+public:
+    enum { value = sizeof(test<Functor>(0)) == sizeof(Yes) };
+};
+/** \endcond */
+
 /** \ingroup weak_form_elements
  *  \brief Default implementation of a collection of kernels.
 
@@ -71,6 +121,56 @@ namespace Fiber
     };
     \endcode
 
+    Functors representing a single scalar kernel (kernelCount() == 1,
+    kernelRowCount(0) == kernelColCount(0) == 1) in three dimensions can
+    additionally provide the member function
+
+    \code
+        // Return the value of the kernel at the pair of points whose
+        // coordinates are stored in testGlobal[0..2] and trialGlobal[0..2].
+        // If requested in addGeometricalDependencies(), the unit normals at
+        // these points are stored in testNormal[0..2] and trialNormal[0..2];
+        // otherwise these pointers may be null and must not be dereferenced.
+        ValueType evaluateScalar(const CoordinateType* testGlobal,
+                                 const CoordinateType* testNormal,
+                                 const CoordinateType* trialGlobal,
+                                 const CoordinateType* trialNormal) const;
+    \endcode
+
+    If it is present, evaluateOnGrid() and evaluateAtPointPairs() bypass the
+    slice objects passed to evaluate(). They copy the coordinates of chunks of
+    point pairs into buffers storing each component contiguously and call
+    evaluateScalar() in a branch-free loop over these buffers. If
+    evaluateScalar() is defined inline and real-valued, the compiler can
+    vectorise this loop (for GCC, this requires -fno-math-errno, which the
+    build system sets).
+
+    Functors providing evaluateScalar() can further provide the member
+    function
+
+    \code
+        // Evaluate the kernel at pointCount pairs of points and store the
+        // value at the p'th pair in result[p]. The coordinates of the test
+        // and trial point of that pair are stored at
+        // testGlobals[3 * testStride * p] and
+        // trialGlobals[3 * trialStride * p], and similarly for the normals.
+        // A stride of 0 denotes a single point shared by all pairs. Normal
+        // pointers are null unless requested in addGeometricalDependencies().
+        void evaluateScalars(size_t pointCount,
+                             const CoordinateType* testGlobals,
+                             const CoordinateType* testNormals,
+                             size_t testStride,
+                             const CoordinateType* trialGlobals,
+                             const CoordinateType* trialNormals,
+                             size_t trialStride,
+                             ValueType* result) const;
+    \endcode
+
+    If it is present, it is used instead of evaluateScalar() to fill whole
+    columns of the arrays of kernel values at once. This is useful for
+    functors whose per-point cost is dominated by a step that can be batched,
+    such as the table lookups of the interpolated kernel functors.
+
     See the Laplace3dSingleLayerPotentialKernelFunctor class for an example
     implementation of a (simple) kernel collection functor.
  */
@@ -110,6 +210,57 @@ public:
 
     virtual std::pair<const char*, int> evaluateClCode() const;
 
+private:
+    /** \cond PRIVATE */
+    typedef boost::integral_constant<
+        bool, HasEvaluateScalarMember<Functor>::value> HasEvaluateScalar;
+    typedef boost::integral_constant<
+        bool, HasEvaluateScalarsMember<Functor>::value> HasEvaluateScalars;
+
+    void evaluateAtPointPairsImpl(
+            const GeometricalData<CoordinateType>& testGeomData,
+            const GeometricalData<CoordinateType>& trialGeomData,
+            CollectionOf3dArrays<ValueType>& result,
+            boost::true_type) const;
+    void evaluateAtPointPairsImpl(
+            const GeometricalData<CoordinateType>& testGeomData,
+            const GeometricalData<CoordinateType>& trialGeomData,
+            CollectionOf3dArrays<ValueType>& result,
+            boost::false_type) const;
+
+    void evaluateOnGridImpl(
+            const GeometricalData<CoordinateType>& testGeomData,
+            const GeometricalData<CoordinateType>& trialGeomData,
+            CollectionOf4dArrays<ValueType>& result,
+            boost::true_type) const;
+    void evaluateOnGridImpl(
+            const GeometricalData<CoordinateType>& testGeomData,
+            const GeometricalData<CoordinateType>& trialGeomData,
+            CollectionOf4dArrays<ValueType>& result,
+            boost::false_type) const;
+
+    void evaluateScalarsImpl(
+            size_t pointCount,
+            const CoordinateType* testGlobals,
+            const CoordinateType* testNormals,
+            size_t testStride,
+            const CoordinateType* trialGlobals,
+            const CoordinateType* trialNormals,
+            size_t trialStride,
+            ValueType* result,
+            boost::true_type) const;
+    void evaluateScalarsImpl(
+            size_t pointCount,
+            const CoordinateType* testGlobals,
+            const CoordinateType* testNormals,
+            size_t testStride,
+            const CoordinateType* trialGlobals,
+            const CoordinateType* trialNormals,
+            size_t trialStride,
+            ValueType* result,
+            boost::false_type) const;
+    /** \endcond */
+
 private:
     Functor m_functor;
 };
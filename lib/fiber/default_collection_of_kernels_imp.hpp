@@ -27,11 +27,55 @@
 #include "collection_of_4d_arrays.hpp"
 #include "geometrical_data.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace Fiber
 {
 
+namespace
+{
+
+// Return a pointer to the first column of a matrix of point data, or a null
+// pointer if the matrix is empty
+template <typename CoordinateType>
+inline const CoordinateType* pointData(const arma::Mat<CoordinateType>& data)
+{
+    return data.is_empty() ? 0 : data.memptr();
+}
+
+// Number of point pairs whose coordinates are copied to the scratch buffers
+// of DefaultCollectionOfKernels::evaluateScalarsImpl() at a time
+enum { KERNEL_CHUNK_SIZE = 64 };
+
+// Copy the 3D vectors stored at points[step * p], p = 0, ..., count - 1, to
+// components[c * KERNEL_CHUNK_SIZE + p], c = 0, 1, 2
+template <typename CoordinateType>
+inline void gatherComponents(const CoordinateType* points, size_t step,
+                             size_t count, CoordinateType* components)
+{
+    const int coordCount = 3;
+    for (int c = 0; c < coordCount; ++c) {
+        CoordinateType* component = components + c * KERNEL_CHUNK_SIZE;
+        for (size_t p = 0; p < count; ++p)
+            component[p] = points[step * p + c];
+    }
+}
+
+// Set components[c * KERNEL_CHUNK_SIZE + p], c = 0, 1, 2,
+// p = 0, ..., count - 1, to zero
+template <typename CoordinateType>
+inline void zeroComponents(size_t count, CoordinateType* components)
+{
+    const int coordCount = 3;
+    for (int c = 0; c < coordCount; ++c)
+        std::fill(components + c * KERNEL_CHUNK_SIZE,
+                  components + c * KERNEL_CHUNK_SIZE + count,
+                  CoordinateType(0));
+}
+
+} // namespace
+
 template <typename Functor>
 void DefaultCollectionOfKernels<Functor>::addGeometricalDependencies(
         size_t& testGeomDeps, size_t& trialGeomDeps) const
@@ -55,12 +99,49 @@ void DefaultCollectionOfKernels<Functor>::evaluateAtPointPairs(
                            m_functor.kernelColCount(k),
                            pointCount);
 
+    evaluateAtPointPairsImpl(testGeomData, trialGeomData, result,
+                             HasEvaluateScalar());
+}
+
+template <typename Functor>
+void DefaultCollectionOfKernels<Functor>::evaluateAtPointPairsImpl(
+        const GeometricalData<CoordinateType>& testGeomData,
+        const GeometricalData<CoordinateType>& trialGeomData,
+        CollectionOf3dArrays<ValueType>& result,
+        boost::false_type) const
+{
+    const size_t pointCount = testGeomData.pointCount();
     for (size_t p = 0; p < pointCount; ++p)
         m_functor.evaluate(testGeomData.const_slice(p),
                            trialGeomData.const_slice(p),
                            result.slice(p).self());
 }
 
+template <typename Functor>
+void DefaultCollectionOfKernels<Functor>::evaluateAtPointPairsImpl(
+        const GeometricalData<CoordinateType>& testGeomData,
+        const GeometricalData<CoordinateType>& trialGeomData,
+        CollectionOf3dArrays<ValueType>& result,
+        boost::true_type) const
+{
+    const int coordCount = 3;
+    assert(result.size() == 1);
+    assert(testGeomData.dimWorld() == coordCount);
+    assert(trialGeomData.dimWorld() == coordCount);
+
+    const size_t pointCount = testGeomData.pointCount();
+    const CoordinateType* testGlobals = pointData(testGeomData.globals);
+    const CoordinateType* testNormals = pointData(testGeomData.normals);
+    const CoordinateType* trialGlobals = pointData(trialGeomData.globals);
+    const CoordinateType* trialNormals = pointData(trialGeomData.normals);
+    ValueType* values = result[0].begin();
+
+    evaluateScalarsImpl(pointCount,
+                        testGlobals, testNormals, 1,
+                        trialGlobals, trialNormals, 1,
+                        values, HasEvaluateScalars());
+}
+
 template <typename Functor>
 void DefaultCollectionOfKernels<Functor>::evaluateOnGrid(
         const GeometricalData<CoordinateType>& testGeomData,
@@ -77,6 +158,20 @@ void DefaultCollectionOfKernels<Functor>::evaluateOnGrid(
                            testPointCount,
                            trialPointCount);
 
+    evaluateOnGridImpl(testGeomData, trialGeomData, result,
+                       HasEvaluateScalar());
+}
+
+template <typename Functor>
+void DefaultCollectionOfKernels<Functor>::evaluateOnGridImpl(
+        const GeometricalData<CoordinateType>& testGeomData,
+        const GeometricalData<CoordinateType>& trialGeomData,
+        CollectionOf4dArrays<ValueType>& result,
+        boost::false_type) const
+{
+    const size_t testPointCount = testGeomData.pointCount();
+    const size_t trialPointCount = trialGeomData.pointCount();
+
 #pragma ivdep
     for (size_t trialIndex = 0; trialIndex < trialPointCount; ++trialIndex)
         for (size_t testIndex = 0; testIndex < testPointCount; ++testIndex)
@@ -85,6 +180,133 @@ void DefaultCollectionOfKernels<Functor>::evaluateOnGrid(
                                result.slice(testIndex, trialIndex).self());
 }
 
+template <typename Functor>
+void DefaultCollectionOfKernels<Functor>::evaluateOnGridImpl(
+        const GeometricalData<CoordinateType>& testGeomData,
+        const GeometricalData<CoordinateType>& trialGeomData,
+        CollectionOf4dArrays<ValueType>& result,
+        boost::true_type) const
+{
+    const int coordCount = 3;
+    assert(result.size() == 1);
+    assert(testGeomData.dimWorld() == coordCount);
+    assert(trialGeomData.dimWorld() == coordCount);
+
+    const size_t testPointCount = testGeomData.pointCount();
+    const size_t trialPointCount = trialGeomData.pointCount();
+    const CoordinateType* testGlobals = pointData(testGeomData.globals);
+    const CoordinateType* testNormals = pointData(testGeomData.normals);
+    const CoordinateType* trialGlobals = pointData(trialGeomData.globals);
+    const CoordinateType* trialNormals = pointData(trialGeomData.normals);
+    // The (0, 0, testIndex, trialIndex)th element of result[0] is stored at
+    // position testIndex + trialIndex * testPointCount
+    ValueType* values = result[0].begin();
+
+    for (size_t trialIndex = 0; trialIndex < trialPointCount; ++trialIndex) {
+        const CoordinateType* trialGlobal =
+                trialGlobals ? trialGlobals + coordCount * trialIndex : 0;
+        const CoordinateType* trialNormal =
+                trialNormals ? trialNormals + coordCount * trialIndex : 0;
+        ValueType* column = values + trialIndex * testPointCount;
+        evaluateScalarsImpl(testPointCount,
+                            testGlobals, testNormals, 1,
+                            trialGlobal, trialNormal, 0,
+                            column, HasEvaluateScalars());
+    }
+}
+
+template <typename Functor>
+void DefaultCollectionOfKernels<Functor>::evaluateScalarsImpl(
+        size_t pointCount,
+        const CoordinateType* testGlobals,
+        const CoordinateType* testNormals,
+        size_t testStride,
+        const CoordinateType* trialGlobals,
+        const CoordinateType* trialNormals,
+        size_t trialStride,
+        ValueType* result,
+        boost::true_type) const
+{
+    m_functor.evaluateScalars(pointCount,
+                              testGlobals, testNormals, testStride,
+                              trialGlobals, trialNormals, trialStride,
+                              result);
+}
+
+template <typename Functor>
+void DefaultCollectionOfKernels<Functor>::evaluateScalarsImpl(
+        size_t pointCount,
+        const CoordinateType* testGlobals,
+        const CoordinateType* testNormals,
+        size_t testStride,
+        const CoordinateType* trialGlobals,
+        const CoordinateType* trialNormals,
+        size_t trialStride,
+        ValueType* result,
+        boost::false_type) const
+{
+    const int coordCount = 3;
+    const size_t testStep = coordCount * testStride;
+    const size_t trialStep = coordCount * trialStride;
+
+    // The coordinates of each chunk of point pairs are first copied to
+    // scratch buffers holding each component in a separate contiguous array.
+    // The loop calling evaluateScalar() then reads them with unit stride and
+    // contains no branches, so that it can be vectorised once evaluateScalar()
+    // is inlined. Data not requested by the functor are left zero.
+    CoordinateType testGlobalChunk[coordCount * KERNEL_CHUNK_SIZE];
+    CoordinateType testNormalChunk[coordCount * KERNEL_CHUNK_SIZE];
+    CoordinateType trialGlobalChunk[coordCount * KERNEL_CHUNK_SIZE];
+    CoordinateType trialNormalChunk[coordCount * KERNEL_CHUNK_SIZE];
+    const CoordinateType* tg = testGlobalChunk;
+    const CoordinateType* tn = testNormalChunk;
+    const CoordinateType* rg = trialGlobalChunk;
+    const CoordinateType* rn = trialNormalChunk;
+    const size_t c1 = KERNEL_CHUNK_SIZE, c2 = 2 * KERNEL_CHUNK_SIZE;
+
+    const size_t maxCount = std::min<size_t>(KERNEL_CHUNK_SIZE, pointCount);
+    if (!testGlobals)
+        zeroComponents(maxCount, testGlobalChunk);
+    if (!testNormals)
+        zeroComponents(maxCount, testNormalChunk);
+    if (!trialGlobals)
+        zeroComponents(maxCount, trialGlobalChunk);
+    if (!trialNormals)
+        zeroComponents(maxCount, trialNormalChunk);
+
+    for (size_t start = 0; start < pointCount; start += KERNEL_CHUNK_SIZE) {
+        const size_t count = std::min<size_t>(KERNEL_CHUNK_SIZE,
+                                              pointCount - start);
+        if (testGlobals)
+            gatherComponents(testGlobals + testStep * start, testStep, count,
+                             testGlobalChunk);
+        if (testNormals)
+            gatherComponents(testNormals + testStep * start, testStep, count,
+                             testNormalChunk);
+        if (trialGlobals)
+            gatherComponents(trialGlobals + trialStep * start, trialStep,
+                             count, trialGlobalChunk);
+        if (trialNormals)
+            gatherComponents(trialNormals + trialStep * start, trialStep,
+                             count, trialNormalChunk);
+
+        ValueType* chunkResult = result + start;
+#pragma ivdep
+        for (size_t p = 0; p < count; ++p) {
+            const CoordinateType testGlobal[coordCount] =
+                { tg[p], tg[c1 + p], tg[c2 + p] };
+            const CoordinateType testNormal[coordCount] =
+                { tn[p], tn[c1 + p], tn[c2 + p] };
+            const CoordinateType trialGlobal[coordCount] =
+                { rg[p], rg[c1 + p], rg[c2 + p] };
+            const CoordinateType trialNormal[coordCount] =
+                { rn[p], rn[c1 + p], rn[c2 + p] };
+            chunkResult[p] = m_functor.evaluateScalar(
+                        testGlobal, testNormal, trialGlobal, trialNormal);
+        }
+    }
+}
+
 template <typename Functor>
 std::pair<const char*, int>
 DefaultCollectionOfKernels<Functor>::evaluateClCode() const {
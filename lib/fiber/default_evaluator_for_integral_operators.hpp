@@ -72,6 +72,25 @@ public:
                           const arma::Mat<CoordinateType>& points,
                           arma::Mat<ResultType>& result) const;
 
+    virtual void getQuadraturePoints(
+            Region region, arma::Mat<CoordinateType>& quadPoints) const;
+
+    virtual void evaluateContribution(
+            Region region,
+            const std::vector<int>& quadPointIndices,
+            const arma::Mat<CoordinateType>& points,
+            arma::Mat<ResultType>& result) const;
+
+    virtual void evaluateLocalBasisContributions(
+            Region region, int element,
+            const arma::Mat<CoordinateType>& points,
+            std::vector<arma::Mat<ResultType> >& result) const;
+
+    virtual void applyNearFieldCorrection(
+            const arma::Mat<CoordinateType>& points,
+            CoordinateType nearFieldDistance,
+            arma::Mat<ResultType>& result) const;
+
 private:
     void cacheTrialData();
     void calcTrialData(
@@ -79,8 +98,10 @@ private:
             int kernelTrialGeomDeps,
             GeometricalData<CoordinateType>& trialGeomData,
             CollectionOf2dArrays<ResultType>& trialExprValues,
-            std::vector<CoordinateType>& weights) const;
+            std::vector<CoordinateType>& weights,
+            std::vector<int>& elementQuadPointOffsets) const;
 
+    int elementCornerCount(int element) const;
     int quadOrder(const Fiber::Basis<BasisFunctionType>& basis, Region region) const;
     int farFieldQuadOrder(const Fiber::Basis<BasisFunctionType>& basis) const;
     int nearFieldQuadOrder(const Fiber::Basis<BasisFunctionType>& basis) const;
@@ -103,6 +124,10 @@ private:
     CollectionOf2dArrays<ResultType> m_farFieldTrialTransfValues;
     std::vector<CoordinateType> m_nearFieldWeights;
     std::vector<CoordinateType> m_farFieldWeights;
+    // The quadrature points of element e are stored in columns
+    // [offsets[e], offsets[e + 1]) of the arrays above
+    std::vector<int> m_nearFieldElementQuadPointOffsets;
+    std::vector<int> m_farFieldElementQuadPointOffsets;
 };
 
 } // namespace Fiber
@@ -30,14 +30,16 @@
 #include "collection_of_2d_arrays.hpp"
 #include "collection_of_3d_arrays.hpp"
 #include "collection_of_4d_arrays.hpp"
+#include "element_bounding_box_index.hpp"
 #include "kernel_trial_integral.hpp"
 #include "numerical_quadrature.hpp"
 #include "opencl_handler.hpp"
 #include "raw_grid_geometry.hpp"
 #include "serial_blas_region.hpp"
+#include "thread_pool.hpp"
 
+#include <algorithm>
 #include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
 
 namespace Fiber
 {
@@ -101,6 +103,67 @@ private:
     size_t m_outputComponentCount;
 };
 
+template <typename ResultType>
+class NearFieldCorrectionLoopBody
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+    typedef EvaluatorForIntegralOperators<ResultType> Evaluator;
+
+    NearFieldCorrectionLoopBody(
+            const Evaluator& evaluator,
+            const ElementBoundingBoxIndex<CoordinateType>& index,
+            const std::vector<int>& nearFieldOffsets,
+            const std::vector<int>& farFieldOffsets,
+            const arma::Mat<CoordinateType>& points,
+            arma::Mat<ResultType>& result) :
+        m_evaluator(evaluator), m_index(index),
+        m_nearFieldOffsets(nearFieldOffsets),
+        m_farFieldOffsets(farFieldOffsets),
+        m_points(points), m_result(result)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        std::vector<int> elements;
+        std::vector<int> nearFieldQuadPoints, farFieldQuadPoints;
+        arma::Mat<CoordinateType> point(m_points.n_rows, 1);
+        arma::Mat<ResultType> nearFieldValues, farFieldValues;
+        for (size_t p = r.begin(); p < r.end(); ++p) {
+            m_index.findElements(m_points.colptr(p), elements);
+            if (elements.empty())
+                continue;
+            nearFieldQuadPoints.clear();
+            farFieldQuadPoints.clear();
+            for (size_t i = 0; i < elements.size(); ++i) {
+                const int e = elements[i];
+                for (int q = m_nearFieldOffsets[e];
+                     q < m_nearFieldOffsets[e + 1]; ++q)
+                    nearFieldQuadPoints.push_back(q);
+                for (int q = m_farFieldOffsets[e];
+                     q < m_farFieldOffsets[e + 1]; ++q)
+                    farFieldQuadPoints.push_back(q);
+            }
+            point.col(0) = m_points.col(p);
+            m_evaluator.evaluateContribution(Evaluator::NEAR_FIELD,
+                                             nearFieldQuadPoints, point,
+                                             nearFieldValues);
+            m_evaluator.evaluateContribution(Evaluator::FAR_FIELD,
+                                             farFieldQuadPoints, point,
+                                             farFieldValues);
+            m_result.col(p) += nearFieldValues.col(0) - farFieldValues.col(0);
+        }
+    }
+
+private:
+    const Evaluator& m_evaluator;
+    const ElementBoundingBoxIndex<CoordinateType>& m_index;
+    const std::vector<int>& m_nearFieldOffsets;
+    const std::vector<int>& m_farFieldOffsets;
+    const arma::Mat<CoordinateType>& m_points;
+    arma::Mat<ResultType>& m_result;
+};
+
 } // namespace
 
 template <typename BasisFunctionType, typename KernelType,
@@ -176,15 +239,7 @@ ResultType, GeometryFactory>::evaluate(
     const size_t chunkSize = 96;
     const size_t chunkCount = (pointCount + chunkSize - 1) / chunkSize;
 
-    int maxThreadCount = 1;
-    if (!m_parallelizationOptions.isOpenClEnabled()) {
-        if (m_parallelizationOptions.maxThreadCount() ==
-                ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = m_parallelizationOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+    ScopedScheduler scheduler(m_parallelizationOptions);
     typedef EvaluationLoopBody<
             BasisFunctionType, KernelType, ResultType> Body;
     {
@@ -213,6 +268,231 @@ ResultType, GeometryFactory>::evaluate(
 //    }
 }
 
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::getQuadraturePoints(
+        Region region, arma::Mat<CoordinateType>& quadPoints) const
+{
+    const GeometricalData<CoordinateType>& trialGeomData =
+            (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD) ?
+                m_nearFieldTrialGeomData :
+                m_farFieldTrialGeomData;
+    if (trialGeomData.globals.is_empty())
+        throw std::runtime_error(
+                "DefaultEvaluatorForIntegralOperators::getQuadraturePoints(): "
+                "global coordinates of quadrature points are not available "
+                "since the kernels do not depend on them");
+    quadPoints = trialGeomData.globals;
+}
+
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::evaluateContribution(
+        Region region,
+        const std::vector<int>& quadPointIndices,
+        const arma::Mat<CoordinateType>& points,
+        arma::Mat<ResultType>& result) const
+{
+    const size_t pointCount = points.n_cols;
+    const int outputComponentCount = m_integral->resultDimension();
+
+    result.set_size(outputComponentCount, pointCount);
+    result.fill(0.);
+    if (quadPointIndices.empty() || pointCount == 0)
+        return;
+
+    const GeometricalData<CoordinateType>& trialGeomData =
+            (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD) ?
+                m_nearFieldTrialGeomData :
+                m_farFieldTrialGeomData;
+    const CollectionOf2dArrays<ResultType>& trialTransfValues =
+            (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD) ?
+                m_nearFieldTrialTransfValues :
+                m_farFieldTrialTransfValues;
+    const std::vector<CoordinateType>& weights =
+            (region == EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD) ?
+                m_nearFieldWeights :
+                m_farFieldWeights;
+
+    // Gather the data of the requested quadrature points
+    const size_t quadPointCount = quadPointIndices.size();
+    GeometricalData<CoordinateType> subsetGeomData;
+    if (!trialGeomData.globals.is_empty())
+        subsetGeomData.globals.set_size(trialGeomData.globals.n_rows,
+                                        quadPointCount);
+    if (!trialGeomData.integrationElements.is_empty())
+        subsetGeomData.integrationElements.set_size(quadPointCount);
+    if (!trialGeomData.normals.is_empty())
+        subsetGeomData.normals.set_size(trialGeomData.normals.n_rows,
+                                        quadPointCount);
+    if (!trialGeomData.jacobiansTransposed.is_empty())
+        subsetGeomData.jacobiansTransposed.set_size(
+                    trialGeomData.jacobiansTransposed.n_rows,
+                    trialGeomData.jacobiansTransposed.n_cols,
+                    quadPointCount);
+    if (!trialGeomData.jacobianInversesTransposed.is_empty())
+        subsetGeomData.jacobianInversesTransposed.set_size(
+                    trialGeomData.jacobianInversesTransposed.n_rows,
+                    trialGeomData.jacobianInversesTransposed.n_cols,
+                    quadPointCount);
+    CollectionOf2dArrays<ResultType> subsetTransfValues(trialTransfValues.size());
+    for (size_t transf = 0; transf < trialTransfValues.size(); ++transf)
+        subsetTransfValues[transf].set_size(
+                    trialTransfValues[transf].extent(0), quadPointCount);
+    std::vector<CoordinateType> subsetWeights(quadPointCount);
+
+    for (size_t i = 0; i < quadPointCount; ++i) {
+        const int point = quadPointIndices[i];
+        if (!subsetGeomData.globals.is_empty())
+            subsetGeomData.globals.col(i) = trialGeomData.globals.col(point);
+        if (!subsetGeomData.integrationElements.is_empty())
+            subsetGeomData.integrationElements(i) =
+                    trialGeomData.integrationElements(point);
+        if (!subsetGeomData.normals.is_empty())
+            subsetGeomData.normals.col(i) = trialGeomData.normals.col(point);
+        if (!subsetGeomData.jacobiansTransposed.is_empty())
+            subsetGeomData.jacobiansTransposed.slice(i) =
+                    trialGeomData.jacobiansTransposed.slice(point);
+        if (!subsetGeomData.jacobianInversesTransposed.is_empty())
+            subsetGeomData.jacobianInversesTransposed.slice(i) =
+                    trialGeomData.jacobianInversesTransposed.slice(point);
+        for (size_t transf = 0; transf < trialTransfValues.size(); ++transf)
+            for (size_t dim = 0; dim < trialTransfValues[transf].extent(0); ++dim)
+                subsetTransfValues[transf](dim, i) =
+                        trialTransfValues[transf](dim, point);
+        subsetWeights[i] = weights[point];
+    }
+
+    // Process the evaluation points serially, in chunks of the same size as
+    // in evaluate()
+    const size_t chunkSize = 96;
+    const size_t chunkCount = (pointCount + chunkSize - 1) / chunkSize;
+
+    typedef EvaluationLoopBody<
+            BasisFunctionType, KernelType, ResultType> Body;
+    Body body(chunkSize,
+              points, subsetGeomData, subsetTransfValues, subsetWeights,
+              *m_kernels, *m_integral, result);
+    body(tbb::blocked_range<size_t>(0, chunkCount));
+}
+
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::evaluateLocalBasisContributions(
+        Region region, int element,
+        const arma::Mat<CoordinateType>& points,
+        std::vector<arma::Mat<ResultType> >& result) const
+{
+    const Basis<BasisFunctionType>& basis = *(*m_trialBases)[element];
+    const int functionCount = basis.size();
+    const size_t pointCount = points.n_cols;
+    const int outputComponentCount = m_integral->resultDimension();
+    const int transformationCount = m_trialTransformations->transformationCount();
+
+    result.resize(functionCount);
+    for (int fun = 0; fun < functionCount; ++fun) {
+        result[fun].set_size(outputComponentCount, pointCount);
+        result[fun].fill(0.);
+    }
+    if (functionCount == 0 || pointCount == 0)
+        return;
+
+    // Find out which basis and geometrical data need to be calculated
+    size_t testGeomDeps = 0, trialGeomDeps = 0, basisDeps = 0;
+    m_kernels->addGeometricalDependencies(testGeomDeps, trialGeomDeps);
+    m_trialTransformations->addDependencies(basisDeps, trialGeomDeps);
+    trialGeomDeps |= INTEGRATION_ELEMENTS;
+
+    // Get quadrature points and weights, basis data and geometrical data
+    arma::Mat<CoordinateType> localQuadPoints;
+    std::vector<CoordinateType> weights;
+    fillSingleQuadraturePointsAndWeights(
+                elementCornerCount(element), quadOrder(basis, region),
+                localQuadPoints, weights);
+    const size_t quadPointCount = weights.size();
+
+    BasisData<BasisFunctionType> basisData;
+    basis.evaluate(basisDeps, localQuadPoints, ALL_DOFS, basisData);
+
+    typedef typename GeometryFactory::Geometry Geometry;
+    std::auto_ptr<Geometry> geometry(m_geometryFactory->make());
+    m_rawGeometry->setupGeometry(element, *geometry);
+    GeometricalData<CoordinateType> trialGeomData;
+    geometry->getData(trialGeomDeps, localQuadPoints, trialGeomData);
+    for (size_t point = 0; point < quadPointCount; ++point)
+        weights[point] *= trialGeomData.integrationElements(point);
+
+    // Split the transformed values of all basis functions into separate
+    // collections, one per function
+    CollectionOf3dArrays<BasisFunctionType> trialValues;
+    m_trialTransformations->evaluate(basisData, trialGeomData, trialValues);
+    std::vector<CollectionOf2dArrays<ResultType> >
+            trialTransfValues(functionCount);
+    for (int fun = 0; fun < functionCount; ++fun) {
+        trialTransfValues[fun].set_size(transformationCount);
+        for (int transf = 0; transf < transformationCount; ++transf) {
+            const size_t dimCount = trialValues[transf].extent(0);
+            trialTransfValues[fun][transf].set_size(dimCount, quadPointCount);
+            for (size_t point = 0; point < quadPointCount; ++point)
+                for (size_t dim = 0; dim < dimCount; ++dim)
+                    trialTransfValues[fun][transf](dim, point) =
+                            trialValues[transf](dim, fun, point);
+        }
+    }
+
+    // Evaluate the kernels once per chunk of points (of the same size as in
+    // evaluate()) and integrate them against each basis function in turn
+    const size_t chunkSize = 96;
+    CollectionOf4dArrays<KernelType> kernelValues;
+    GeometricalData<CoordinateType> evalPointGeomData;
+    for (size_t start = 0; start < pointCount; start += chunkSize) {
+        const size_t end = std::min(start + chunkSize, pointCount);
+        evalPointGeomData.globals = points.cols(start, end - 1 /* inclusive */);
+        m_kernels->evaluateOnGrid(evalPointGeomData, trialGeomData,
+                                  kernelValues);
+        for (int fun = 0; fun < functionCount; ++fun) {
+            // View into the current chunk of the result array
+            _2dArray<ResultType> resultChunk(outputComponentCount, end - start,
+                                             result[fun].colptr(start));
+            m_integral->evaluate(trialGeomData, kernelValues,
+                                 trialTransfValues[fun], weights,
+                                 resultChunk);
+        }
+    }
+}
+
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::applyNearFieldCorrection(
+        const arma::Mat<CoordinateType>& points,
+        CoordinateType nearFieldDistance,
+        arma::Mat<ResultType>& result) const
+{
+    if (result.n_cols != points.n_cols)
+        throw std::invalid_argument(
+                "DefaultEvaluatorForIntegralOperators::"
+                "applyNearFieldCorrection(): "
+                "result must have as many columns as there are points");
+
+    const ElementBoundingBoxIndex<CoordinateType> index(*m_rawGeometry,
+                                                        nearFieldDistance);
+
+    ScopedScheduler scheduler(m_parallelizationOptions);
+    typedef NearFieldCorrectionLoopBody<ResultType> Body;
+    {
+        Fiber::SerialBlasRegion region;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, points.n_cols),
+                          Body(*this, index,
+                               m_nearFieldElementQuadPointOffsets,
+                               m_farFieldElementQuadPointOffsets,
+                               points, result));
+    }
+}
+
 template <typename BasisFunctionType, typename KernelType,
           typename ResultType, typename GeometryFactory>
 void DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
@@ -228,11 +508,12 @@ ResultType, GeometryFactory>::cacheTrialData()
 
     calcTrialData(EvaluatorForIntegralOperators<ResultType>::FAR_FIELD,
                   trialGeomDeps, m_farFieldTrialGeomData,
-                  m_farFieldTrialTransfValues, m_farFieldWeights);
-    // near field currently not used
+                  m_farFieldTrialTransfValues, m_farFieldWeights,
+                  m_farFieldElementQuadPointOffsets);
     calcTrialData(EvaluatorForIntegralOperators<ResultType>::NEAR_FIELD,
                   trialGeomDeps, m_nearFieldTrialGeomData,
-                  m_nearFieldTrialTransfValues, m_nearFieldWeights);
+                  m_nearFieldTrialTransfValues, m_nearFieldWeights,
+                  m_nearFieldElementQuadPointOffsets);
 }
 
 template <typename BasisFunctionType, typename KernelType,
@@ -243,7 +524,8 @@ ResultType, GeometryFactory>::calcTrialData(
         int kernelTrialGeomDeps,
         GeometricalData<CoordinateType>& trialGeomData,
         CollectionOf2dArrays<ResultType>& trialTransfValues,
-        std::vector<CoordinateType>& weights) const
+        std::vector<CoordinateType>& weights,
+        std::vector<int>& elementQuadPointOffsets) const
 {
     const int elementCount = m_rawGeometry->elementCount();
     const int worldDim = m_rawGeometry->worldDimension();
@@ -282,21 +564,11 @@ ResultType, GeometryFactory>::calcTrialData(
         int order = quadOrder(activeBasis, region);
 
         // Find out the element type
-        int elementCornerCount = 0;
+        int cornerCount = 0;
         for (int e = 0; e < elementCount; ++e)
             if ((*m_trialBases)[e] == &activeBasis)
             {
-                // elementCornerCount = m_rawGeometry->elementCornerCount(e);
-                // This implementation prevents a segmentation fault on Macs
-                // when compiled with llvm in 64-bit mode with -O2 or -O3
-                const arma::Mat<int>& elementCornerIndices =
-                    m_rawGeometry->elementCornerIndices();
-                for (size_t i = 0; i < elementCornerIndices.n_rows; ++i)
-                    if (elementCornerIndices(i, e) >= 0)
-                        elementCornerCount = i + 1;
-                    else
-                        break;
-
+                cornerCount = elementCornerCount(e);
                 break;
             }
 
@@ -304,7 +576,7 @@ ResultType, GeometryFactory>::calcTrialData(
         arma::Mat<CoordinateType> localQuadPoints;
         std::vector<CoordinateType> quadWeights;
         fillSingleQuadraturePointsAndWeights(
-                    elementCornerCount, order, localQuadPoints, quadWeights);
+                    cornerCount, order, localQuadPoints, quadWeights);
 
         // Get basis data
         BasisData<BasisFunctionType> basisData;
@@ -431,6 +703,8 @@ ResultType, GeometryFactory>::calcTrialData(
         trialTransfValues[transf].set_size(
                     m_trialTransformations->resultDimension(transf), quadPointCount);
     weights.resize(quadPointCount);
+    elementQuadPointOffsets.resize(elementCount + 1);
+    elementQuadPointOffsets[0] = 0;
 
     for (int e = 0, startCol = 0;
          e < elementCount;
@@ -459,9 +733,29 @@ ResultType, GeometryFactory>::calcTrialData(
                             trialTransfValuesPerElement[e][transf](dim, point);
         for (size_t point = 0; point < trialTransfValuesPerElement[e][0].extent(1); ++point)
                 weights[startCol + point] = weightsPerElement[e][point];
+        elementQuadPointOffsets[e + 1] = endCol + 1;
     }
 }
 
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+int DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
+ResultType, GeometryFactory>::elementCornerCount(int element) const
+{
+    // return m_rawGeometry->elementCornerCount(element);
+    // This implementation prevents a segmentation fault on Macs
+    // when compiled with llvm in 64-bit mode with -O2 or -O3
+    const arma::Mat<int>& elementCornerIndices =
+            m_rawGeometry->elementCornerIndices();
+    int cornerCount = 0;
+    for (size_t i = 0; i < elementCornerIndices.n_rows; ++i)
+        if (elementCornerIndices(i, element) >= 0)
+            cornerCount = i + 1;
+        else
+            break;
+    return cornerCount;
+}
+
 template <typename BasisFunctionType, typename KernelType,
           typename ResultType, typename GeometryFactory>
 int DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
@@ -493,8 +787,10 @@ int DefaultEvaluatorForIntegralOperators<BasisFunctionType, KernelType,
 ResultType, GeometryFactory>::nearFieldQuadOrder(
         const Basis<BasisFunctionType>& basis) const
 {
-    // quick and dirty
-    return 2 * farFieldQuadOrder(basis);
+    // Used only for the elements lying within a few element sizes from the
+    // evaluation point, so it can be much higher than the far-field order
+    const int farFieldOrder = farFieldQuadOrder(basis);
+    return std::max(2 * farFieldOrder, farFieldOrder + 6);
 }
 
 } // namespace Fiber
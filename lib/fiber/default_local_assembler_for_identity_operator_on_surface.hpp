@@ -29,11 +29,11 @@
 #include "shared_ptr.hpp"
 
 #include "../common/armadillo_fwd.hpp"
-#include "../common/boost_ptr_map_fwd.hpp"
 #include <cstring>
 #include <iostream>
 #include <map>
 #include <set>
+#include <tbb/concurrent_unordered_map.h>
 #include <utility>
 #include <vector>
 
@@ -59,6 +59,7 @@ public:
         const shared_ptr<const CollectionOfBasisTransformations<CoordinateType> >& testTransformations,
         const shared_ptr<const CollectionOfBasisTransformations<CoordinateType> >& trialTransformations,
         const shared_ptr<const OpenClHandler>& openClHandler);
+    virtual ~DefaultLocalAssemblerForIdentityOperatorOnSurface();
 
     virtual void evaluateLocalWeakForms(
         CallVariant callVariant,
@@ -89,8 +90,8 @@ private:
     const TestTrialIntegrator<BasisFunctionType, ResultType>& getIntegrator(
         const SingleQuadratureDescriptor& desc);
 private:
-    typedef boost::ptr_map<SingleQuadratureDescriptor,
-            TestTrialIntegrator<BasisFunctionType, ResultType> > IntegratorMap;
+    typedef tbb::concurrent_unordered_map<SingleQuadratureDescriptor,
+            TestTrialIntegrator<BasisFunctionType, ResultType>*> IntegratorMap;
 
 private:
     shared_ptr<const GeometryFactory> m_geometryFactory;
@@ -51,6 +51,19 @@ DefaultLocalAssemblerForIdentityOperatorOnSurface(
     checkConsistencyOfGeometryAndBases(*rawGeometry, *trialBases);
 }
 
+template <typename BasisFunctionType, typename ResultType, typename GeometryFactory>
+DefaultLocalAssemblerForIdentityOperatorOnSurface<BasisFunctionType, ResultType, GeometryFactory>::
+~DefaultLocalAssemblerForIdentityOperatorOnSurface()
+{
+    // Note: obviously the destructor is assumed to be called only after
+    // all threads have ceased using the assembler!
+
+    for (typename IntegratorMap::const_iterator it = m_testTrialIntegrators.begin();
+         it != m_testTrialIntegrators.end(); ++it)
+        delete it->second;
+    m_testTrialIntegrators.clear();
+}
+
 template <typename BasisFunctionType, typename ResultType, typename GeometryFactory>
 void
 DefaultLocalAssemblerForIdentityOperatorOnSurface<BasisFunctionType, ResultType, GeometryFactory>::
@@ -220,14 +233,27 @@ getIntegrator(const SingleQuadratureDescriptor& desc)
                                          points, weights);
 
     typedef NumericalTestTrialIntegrator<BasisFunctionType, ResultType,
-            GeometryFactory> Integrator;
-    std::auto_ptr<TestTrialIntegrator<BasisFunctionType, ResultType> > integrator(
-        new Integrator(points, weights,
-                       *m_geometryFactory, *m_rawGeometry,
-                       *m_testTransformations, *m_trialTransformations,
-                       *m_openClHandler));
-
-    return *m_testTrialIntegrators.insert(desc, integrator).first->second;
+            GeometryFactory> ConcreteIntegrator;
+    TestTrialIntegrator<BasisFunctionType, ResultType>* integrator(
+        new ConcreteIntegrator(points, weights,
+                               *m_geometryFactory, *m_rawGeometry,
+                               *m_testTransformations, *m_trialTransformations,
+                               *m_openClHandler));
+
+    // Attempt to insert the newly created integrator into the map
+    std::pair<typename IntegratorMap::iterator, bool> result =
+            m_testTrialIntegrators.insert(std::make_pair(desc, integrator));
+    if (result.second)
+        // Insertion succeeded. The newly created integrator will be deleted in
+        // our own destructor
+        ;
+    else
+        // Insertion failed -- another thread was faster. Delete the newly
+        // created integrator.
+        delete integrator;
+
+    // Return pointer to the integrator that ended up in the map.
+    return *result.first->second;
 }
 
 } // namespace Fiber
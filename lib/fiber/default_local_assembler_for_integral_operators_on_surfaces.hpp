@@ -27,6 +27,7 @@
 
 #include "_2d_array.hpp"
 #include "accuracy_options.hpp"
+#include "element_data_cache.hpp"
 #include "element_pair_topology.hpp"
 #include "numerical_quadrature.hpp"
 #include "parallelization_options.hpp"
@@ -37,6 +38,7 @@
 #include <boost/static_assert.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
 #include <tbb/concurrent_unordered_map.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <cstring>
 #include <climits>
 #include <set>
@@ -150,6 +152,9 @@ private:
             int testElementIndex, int trialElementIndex,
             CoordinateType nominalDistance = -1.);
 
+    const arma::Mat<ResultType>* findCachedLocalWeakForm(
+            int testElementIndex, int trialElementIndex) const;
+
     enum ElementType {
         TEST, TRIAL
     };
@@ -197,6 +202,12 @@ private:
     Integrator*> IntegratorMap;
     IntegratorMap m_TestKernelTrialIntegrators;
 
+    typedef ElementDataCache<BasisFunctionType, CoordinateType> ElementDataCacheType;
+    /** \brief Caches of geometrical data and transformed basis function
+     *  values of test and trial elements, shared by all regular integrators. */
+    ElementDataCacheType m_testElementDataCache;
+    ElementDataCacheType m_trialElementDataCache;
+
     enum { INVALID_INDEX = INT_MAX };
     typedef _2dArray<std::pair<int, arma::Mat<ResultType> > > Cache;
     /** \brief Singular integral cache.
@@ -216,6 +227,25 @@ private:
     arma::Mat<CoordinateType> m_trialElementCenters;
     CoordinateType m_averageElementSize;
 
+    /** \brief Scratch arrays used by the overload of evaluateLocalWeakForms()
+     *  evaluating the interactions of many elements with a single element.
+     *
+     *  This overload is called (typically by ACA) for single rows and
+     *  columns of the weak form, so its per-call overhead matters; hence
+     *  each thread reuses its own arrays instead of allocating new ones. */
+    struct CrossEvaluationWorkspace
+    {
+        typedef std::pair<const Integrator*, const Basis<BasisFunctionType>*>
+        QuadVariant;
+
+        std::vector<QuadVariant> quadVariants;
+        std::vector<QuadVariant> uniqueQuadVariants;
+        std::vector<int> activeElementIndicesA;
+        std::vector<arma::Mat<ResultType>*> activeLocalResults;
+    };
+    tbb::enumerable_thread_specific<CrossEvaluationWorkspace>
+    m_crossEvaluationWorkspaces;
+
     // tbb::atomic<size_t> m_foundInCache;
     /** \endcond */
 };
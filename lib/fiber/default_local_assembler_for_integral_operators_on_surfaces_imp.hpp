@@ -26,9 +26,10 @@
 #include "nonseparable_numerical_test_kernel_trial_integrator.hpp"
 #include "separable_numerical_test_kernel_trial_integrator.hpp"
 #include "serial_blas_region.hpp"
+#include "thread_pool.hpp"
 
+#include <algorithm>
 #include <tbb/parallel_for.h>
-#include <tbb/task_scheduler_init.h>
 
 #include "../common/auto_timer.hpp"
 
@@ -114,7 +115,9 @@ DefaultLocalAssemblerForIntegralOperatorsOnSurfaces(
     m_openClHandler(openClHandler),
     m_parallelizationOptions(parallelizationOptions),
     m_verbosityLevel(verbosityLevel),
-    m_accuracyOptions(accuracyOptions)
+    m_accuracyOptions(accuracyOptions),
+    m_testElementDataCache(parallelizationOptions.elementDataCacheMemoryBudget()),
+    m_trialElementDataCache(parallelizationOptions.elementDataCacheMemoryBudget())
 {
     checkConsistencyOfGeometryAndBases(*testRawGeometry, *testBases);
     checkConsistencyOfGeometryAndBases(*trialRawGeometry, *trialBases);
@@ -199,46 +202,33 @@ evaluateLocalWeakForms(
         CoordinateType nominalDistance)
 {
     typedef Basis<BasisFunctionType> Basis;
+    typedef typename CrossEvaluationWorkspace::QuadVariant QuadVariant;
 
     const int elementACount = elementIndicesA.size();
     result.resize(elementACount);
 
-    // TODO: remove this unnecessary copy
     // Get bases
-    const std::vector<const Basis*>& m_basesA =
+    const std::vector<const Basis*>& basesA =
             callVariant == TEST_TRIAL ? *m_testBases : *m_trialBases;
-    const std::vector<const Basis*>& m_basesB =
+    const std::vector<const Basis*>& basesB =
             callVariant == TEST_TRIAL ? *m_trialBases : *m_testBases;
-    std::vector<const Basis*> basesA(elementACount);
-    for (int i = 0; i < elementACount; ++i)
-        basesA[i] = m_basesA[elementIndicesA[i]];
-    const Basis& basisB = *m_basesB[elementIndexB];
+    const Basis& basisB = *basesB[elementIndexB];
+
+    CrossEvaluationWorkspace& workspace = m_crossEvaluationWorkspaces.local();
+    std::vector<QuadVariant>& quadVariants = workspace.quadVariants;
+    std::vector<QuadVariant>& uniqueQuadVariants = workspace.uniqueQuadVariants;
+    quadVariants.resize(elementACount);
+    uniqueQuadVariants.clear();
 
     // Find cached matrices; select integrators to calculate non-cached ones
-    typedef std::pair<const Integrator*, const Basis*> QuadVariant;
     const QuadVariant CACHED(0, 0);
-    std::vector<QuadVariant> quadVariants(elementACount);
     for (int i = 0; i < elementACount; ++i) {
-        // Try to find matrix in cache
-        const arma::Mat<ResultType>* cachedLocalWeakForm = 0;
-        if (callVariant == TEST_TRIAL) {
-            const int testElementIndex = elementIndicesA[i];
-            const int trialElementIndex = elementIndexB;
-            for (size_t n = 0; n < m_cache.extent(0); ++n)
-                if (m_cache(n, trialElementIndex).first == testElementIndex) {
-                    cachedLocalWeakForm = &m_cache(n, trialElementIndex).second;
-                    break;
-                }
-        }
-        else {
-            const int testElementIndex = elementIndexB;
-            const int trialElementIndex = elementIndicesA[i];
-            for (size_t n = 0; n < m_cache.extent(0); ++n)
-                if (m_cache(n, trialElementIndex).first == testElementIndex) {
-                    cachedLocalWeakForm = &m_cache(n, trialElementIndex).second;
-                    break;
-                }
-        }
+        const int testElementIndex =
+                callVariant == TEST_TRIAL ? elementIndicesA[i] : elementIndexB;
+        const int trialElementIndex =
+                callVariant == TEST_TRIAL ? elementIndexB : elementIndicesA[i];
+        const arma::Mat<ResultType>* cachedLocalWeakForm =
+                findCachedLocalWeakForm(testElementIndex, trialElementIndex);
 
         if (cachedLocalWeakForm) { // Matrix found in cache
             quadVariants[i] = CACHED;
@@ -252,46 +242,40 @@ evaluateLocalWeakForms(
             }
         } else {
             const Integrator* integrator =
-                    callVariant == TEST_TRIAL ?
-                        &selectIntegrator(elementIndicesA[i], elementIndexB,
-                                          nominalDistance) :
-                        &selectIntegrator(elementIndexB, elementIndicesA[i],
-                                          nominalDistance);
-            quadVariants[i] = QuadVariant(integrator, basesA[i]);
+                    &selectIntegrator(testElementIndex, trialElementIndex,
+                                      nominalDistance);
+            quadVariants[i] = QuadVariant(integrator,
+                                          basesA[elementIndicesA[i]]);
+            // There are very few distinct variants, so a linear search is
+            // faster than any set or map
+            if (std::find(uniqueQuadVariants.begin(), uniqueQuadVariants.end(),
+                          quadVariants[i]) == uniqueQuadVariants.end())
+                uniqueQuadVariants.push_back(quadVariants[i]);
         }
     }
 
     // Integration will proceed in batches of test elements having the same
     // "quadrature variant", i.e. integrator and basis
 
-    // Find all the unique quadrature variants present
-    typedef std::set<QuadVariant> QuadVariantSet;
-    // Set of unique quadrature variants
-    QuadVariantSet uniqueQuadVariants(quadVariants.begin(), quadVariants.end());
-
-    std::vector<int> activeElementIndicesA;
-    activeElementIndicesA.reserve(elementACount);
-    std::vector<arma::Mat<ResultType>*> activeLocalResults;
-    activeLocalResults.reserve(elementACount);
+    std::vector<int>& activeElementIndicesA = workspace.activeElementIndicesA;
+    std::vector<arma::Mat<ResultType>*>& activeLocalResults =
+            workspace.activeLocalResults;
 
     // Now loop over unique quadrature variants
-    for (typename QuadVariantSet::const_iterator it = uniqueQuadVariants.begin();
-         it != uniqueQuadVariants.end(); ++it) {
-        const QuadVariant activeQuadVariant = *it;
-        if (activeQuadVariant == CACHED)
-            continue;
-        const Integrator& activeIntegrator = *it->first;
-        const Basis& activeBasisA = *it->second;
+    for (size_t v = 0; v < uniqueQuadVariants.size(); ++v) {
+        const QuadVariant activeQuadVariant = uniqueQuadVariants[v];
+        const Integrator& activeIntegrator = *activeQuadVariant.first;
+        const Basis& activeBasisA = *activeQuadVariant.second;
 
         // Find all the test elements for which quadrature should proceed
         // according to the current quadrature variant
         activeElementIndicesA.clear();
         activeLocalResults.clear();
         for (int indexA = 0; indexA < elementACount; ++indexA)
-  	    if (quadVariants[indexA] == activeQuadVariant) {
+            if (quadVariants[indexA] == activeQuadVariant) {
                 activeElementIndicesA.push_back(elementIndicesA[indexA]);
-		activeLocalResults.push_back(&result[indexA]);
-	    }
+                activeLocalResults.push_back(&result[indexA]);
+            }
 
         // Integrate!
         activeIntegrator.integrate(callVariant,
@@ -336,12 +320,9 @@ evaluateLocalWeakForms(
             const int activeTestElementIndex = testElementIndices[testIndex];
             const int activeTrialElementIndex = trialElementIndices[trialIndex];
             // Try to find matrix in cache
-            const arma::Mat<ResultType>* cachedLocalWeakForm = 0;
-            for (size_t n = 0; n < m_cache.extent(0); ++n)
-                if (m_cache(n, activeTrialElementIndex).first == activeTestElementIndex) {
-                    cachedLocalWeakForm = &m_cache(n, activeTrialElementIndex).second;
-                    break;
-                }
+            const arma::Mat<ResultType>* cachedLocalWeakForm =
+                    findCachedLocalWeakForm(activeTestElementIndex,
+                                            activeTrialElementIndex);
 
             if (cachedLocalWeakForm) { // Matrix found in cache
                 quadVariants(testIndex, trialIndex) = CACHED;
@@ -555,15 +536,7 @@ cacheLocalWeakForms(const ElementIndexPairSet& elementIndexPairs)
     activeLocalResults.reserve(elementPairCount);
     // m_cache.rehash(int(elementIndexPairs.size() / m_cache.max_load_factor() + 1));
 
-    int maxThreadCount = 1;
-    if (!m_parallelizationOptions.isOpenClEnabled()) {
-        if (m_parallelizationOptions.maxThreadCount() ==
-            ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = m_parallelizationOptions.maxThreadCount();
-    }
-    tbb::task_scheduler_init scheduler(maxThreadCount);
+    ScopedScheduler scheduler(m_parallelizationOptions);
 
     // Now loop over unique quadrature variants
     for (typename QuadVariantSet::const_iterator it = uniqueQuadVariants.begin();
@@ -674,6 +647,26 @@ precalculateElementSizesAndCentersForSingleGrid(
         elementCenters.col(e) = elementCenter(e, rawGeometry);
 }
 
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+inline const arma::Mat<ResultType>*
+DefaultLocalAssemblerForIntegralOperatorsOnSurfaces<BasisFunctionType,
+KernelType, ResultType, GeometryFactory>::
+findCachedLocalWeakForm(int testElementIndex, int trialElementIndex) const
+{
+    // Items in each column are sorted after increasing test element index
+    // (unused items are marked with INVALID_INDEX = INT_MAX), so the search
+    // can stop as soon as a larger index is encountered
+    for (size_t n = 0; n < m_cache.extent(0); ++n) {
+        const int cachedTestElementIndex = m_cache(n, trialElementIndex).first;
+        if (cachedTestElementIndex == testElementIndex)
+            return &m_cache(n, trialElementIndex).second;
+        if (cachedTestElementIndex > testElementIndex)
+            break;
+    }
+    return 0;
+}
+
 template <typename BasisFunctionType, typename KernelType,
           typename ResultType, typename GeometryFactory>
 const TestKernelTrialIntegrator<BasisFunctionType, KernelType, ResultType>&
@@ -909,13 +902,18 @@ getIntegrator(const DoubleQuadratureDescriptor& desc)
                                              trialPoints, trialWeights);
         typedef SeparableNumericalTestKernelTrialIntegrator<BasisFunctionType,
                 KernelType, ResultType, GeometryFactory> ConcreteIntegrator;
+        const bool useElementDataCache =
+                m_parallelizationOptions.elementDataCacheMemoryBudget() > 0;
         integrator = new ConcreteIntegrator(
                     testPoints, trialPoints, testWeights, trialWeights,
                     *m_testGeometryFactory, *m_trialGeometryFactory,
                     *m_testRawGeometry, *m_trialRawGeometry,
                     *m_testTransformations, *m_kernels, *m_trialTransformations,
                     *m_integral,
-                    *m_openClHandler);
+                    *m_openClHandler,
+                    useElementDataCache ? &m_testElementDataCache : 0,
+                    useElementDataCache ? &m_trialElementDataCache : 0,
+                    desc.testOrder, desc.trialOrder);
     } else {
         arma::Mat<CoordinateType> testPoints, trialPoints;
         std::vector<CoordinateType> weights;
@@ -23,9 +23,27 @@
 
 #include "test_kernel_trial_integral.hpp"
 
+#include "../common/armadillo_fwd.hpp"
+
+#include <tbb/enumerable_thread_specific.h>
+
 namespace Fiber
 {
 
+/** \cond PRIVATE */
+/** \brief Scratch matrices used to contract integrands of the form
+ *  conj(test) * kernel * trial with matrix products. */
+template <typename ResultType>
+struct TensorContractionWorkspace
+{
+    arma::Mat<ResultType> weightedKernelValues;
+    arma::Mat<ResultType> conjTestValues;
+    arma::Mat<ResultType> trialValuesTransposed;
+    arma::Mat<ResultType> kernelTimesTrialValues;
+    arma::Mat<ResultType> product;
+};
+/** \endcond */
+
 /** \ingroup weak_form_elements
  *  \brief Default implementation of the TestKernelTrialIntegral interface.
 
@@ -140,6 +158,9 @@ public:
 
 private:
     IntegrandFunctor m_functor;
+    /** \brief Per-thread scratch matrices, reused across element pairs. */
+    mutable tbb::enumerable_thread_specific<
+    TensorContractionWorkspace<ResultType> > m_workspaces;
 };
 
 } // namespace Fiber
@@ -20,13 +20,141 @@
 
 #include "default_test_kernel_trial_integral.hpp"
 
+#include "collection_of_3d_arrays.hpp"
+#include "collection_of_4d_arrays.hpp"
+#include "conjugate.hpp"
 #include "geometrical_data.hpp"
+#include "simple_test_scalar_kernel_trial_integrand_functor.hpp"
 
 #include <cassert>
 
 namespace Fiber
 {
 
+namespace
+{
+
+// Generic implementation: evaluate the integrand at each point pair
+template <typename IntegrandFunctor>
+void evaluateWithTensorQuadratureRuleImpl(
+        const IntegrandFunctor& functor,
+        const GeometricalData<typename IntegrandFunctor::CoordinateType>& testGeomData,
+        const GeometricalData<typename IntegrandFunctor::CoordinateType>& trialGeomData,
+        const CollectionOf3dArrays<typename IntegrandFunctor::BasisFunctionType>& testValues,
+        const CollectionOf3dArrays<typename IntegrandFunctor::BasisFunctionType>& trialValues,
+        const CollectionOf4dArrays<typename IntegrandFunctor::KernelType>& kernelValues,
+        const std::vector<typename IntegrandFunctor::CoordinateType>& testQuadWeights,
+        const std::vector<typename IntegrandFunctor::CoordinateType>& trialQuadWeights,
+        TensorContractionWorkspace<typename IntegrandFunctor::ResultType>& /* workspace */,
+        arma::Mat<typename IntegrandFunctor::ResultType>& result)
+{
+    typedef typename IntegrandFunctor::ResultType ResultType;
+
+    const size_t testDofCount = testValues[0].extent(1);
+    const size_t trialDofCount = trialValues[0].extent(1);
+
+    const size_t testPointCount = testQuadWeights.size();
+    const size_t trialPointCount = trialQuadWeights.size();
+
+    for (size_t trialDof = 0; trialDof < trialDofCount; ++trialDof)
+        for (size_t testDof = 0; testDof < testDofCount; ++testDof)
+        {
+            ResultType sum = 0.;
+            for (size_t trialPoint = 0; trialPoint < trialPointCount; ++trialPoint)
+                for (size_t testPoint = 0; testPoint < testPointCount; ++testPoint)
+                    sum += functor.evaluate(
+                                testGeomData.const_slice(testPoint),
+                                trialGeomData.const_slice(trialPoint),
+                                testValues.const_slice(testDof, testPoint),
+                                trialValues.const_slice(trialDof, trialPoint),
+                                kernelValues.const_slice(testPoint, trialPoint)) *
+                            testGeomData.integrationElements(testPoint) *
+                            trialGeomData.integrationElements(trialPoint) *
+                            testQuadWeights[testPoint] *
+                            trialQuadWeights[trialPoint];
+            result(testDof, trialDof) = sum;
+        }
+}
+
+// Integrand of the form conj(test) * kernel * trial, with a single scalar
+// kernel: the double sum over quadrature points is the matrix product
+// conj(T_c) * W_test * K * W_trial * R_c^T, summed over the components c of
+// the basis function transformations. Here T_c (R_c) is the matrix of the
+// c'th components of the test (trial) basis function transformations at
+// quadrature points and W_test (W_trial) are diagonal matrices of quadrature
+// weights multiplied by integration elements.
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+void evaluateWithTensorQuadratureRuleImpl(
+        const SimpleTestScalarKernelTrialIntegrandFunctor<
+            BasisFunctionType, KernelType, ResultType>& /* functor */,
+        const GeometricalData<typename ScalarTraits<ResultType>::RealType>& testGeomData,
+        const GeometricalData<typename ScalarTraits<ResultType>::RealType>& trialGeomData,
+        const CollectionOf3dArrays<BasisFunctionType>& testValues,
+        const CollectionOf3dArrays<BasisFunctionType>& trialValues,
+        const CollectionOf4dArrays<KernelType>& kernelValues,
+        const std::vector<typename ScalarTraits<ResultType>::RealType>& testQuadWeights,
+        const std::vector<typename ScalarTraits<ResultType>::RealType>& trialQuadWeights,
+        TensorContractionWorkspace<ResultType>& workspace,
+        arma::Mat<ResultType>& result)
+{
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    const size_t testDofCount = testValues[0].extent(1);
+    const size_t trialDofCount = trialValues[0].extent(1);
+
+    const size_t testPointCount = testQuadWeights.size();
+    const size_t trialPointCount = trialQuadWeights.size();
+
+    const size_t componentCount = testValues[0].extent(0);
+    assert(trialValues[0].extent(0) == componentCount);
+    assert(kernelValues[0].extent(0) == 1);
+    assert(kernelValues[0].extent(1) == 1);
+
+    // The workspace matrices keep their memory between calls as long as
+    // their dimensions do not change
+    arma::Mat<ResultType>& weightedKernelValues = workspace.weightedKernelValues;
+    arma::Mat<ResultType>& conjTestValues = workspace.conjTestValues;
+    arma::Mat<ResultType>& trialValuesTransposed = workspace.trialValuesTransposed;
+    arma::Mat<ResultType>& kernelTimesTrialValues = workspace.kernelTimesTrialValues;
+    arma::Mat<ResultType>& product = workspace.product;
+
+    weightedKernelValues.set_size(testPointCount, trialPointCount);
+    for (size_t trialPoint = 0; trialPoint < trialPointCount; ++trialPoint) {
+        const CoordinateType trialWeight =
+                trialGeomData.integrationElements(trialPoint) *
+                trialQuadWeights[trialPoint];
+        for (size_t testPoint = 0; testPoint < testPointCount; ++testPoint)
+            weightedKernelValues(testPoint, trialPoint) =
+                    kernelValues[0](0, 0, testPoint, trialPoint) *
+                    (testGeomData.integrationElements(testPoint) *
+                     testQuadWeights[testPoint] * trialWeight);
+    }
+
+    conjTestValues.set_size(testDofCount, testPointCount);
+    trialValuesTransposed.set_size(trialPointCount, trialDofCount);
+    if (componentCount == 0)
+        result.zeros(testDofCount, trialDofCount);
+    for (size_t dim = 0; dim < componentCount; ++dim) {
+        for (size_t testPoint = 0; testPoint < testPointCount; ++testPoint)
+            for (size_t testDof = 0; testDof < testDofCount; ++testDof)
+                conjTestValues(testDof, testPoint) =
+                        conjugate(testValues[0](dim, testDof, testPoint));
+        for (size_t trialDof = 0; trialDof < trialDofCount; ++trialDof)
+            for (size_t trialPoint = 0; trialPoint < trialPointCount; ++trialPoint)
+                trialValuesTransposed(trialPoint, trialDof) =
+                        trialValues[0](dim, trialDof, trialPoint);
+        kernelTimesTrialValues = weightedKernelValues * trialValuesTransposed;
+        if (dim == 0)
+            result = conjTestValues * kernelTimesTrialValues;
+        else {
+            product = conjTestValues * kernelTimesTrialValues;
+            result += product;
+        }
+    }
+}
+
+} // namespace
+
 template <typename IntegrandFunctor>
 void DefaultTestKernelTrialIntegral<IntegrandFunctor>::
 addGeometricalDependencies(size_t& testGeomDeps, size_t& trialGeomDeps) const
@@ -49,16 +177,12 @@ evaluateWithTensorQuadratureRule(
         const std::vector<CoordinateType>& trialQuadWeights,
         arma::Mat<ResultType>& result) const
 {
-    // Evaluate constants
-
-    const size_t testDofCount = testValues[0].extent(1);
-    const size_t trialDofCount = trialValues[0].extent(1);
+#ifndef NDEBUG
+    // Assert that array dimensions are correct
 
     const size_t testPointCount = testQuadWeights.size();
     const size_t trialPointCount = trialQuadWeights.size();
 
-    // Assert that array dimensions are correct
-
     for (size_t i = 0; i < kernelValues.size(); ++i) {
         assert(kernelValues[i].extent(2) == testPointCount);
         assert(kernelValues[i].extent(3) == trialPointCount);
@@ -67,27 +191,14 @@ evaluateWithTensorQuadratureRule(
         assert(testValues[i].extent(2) == testPointCount);
     for (size_t i = 0; i < trialValues.size(); ++i)
         assert(trialValues[i].extent(2) == trialPointCount);
+#endif
 
     // Integrate
 
-    for (size_t trialDof = 0; trialDof < trialDofCount; ++trialDof)
-        for (size_t testDof = 0; testDof < testDofCount; ++testDof)
-        {
-            ResultType sum = 0.;
-            for (size_t trialPoint = 0; trialPoint < trialPointCount; ++trialPoint)
-                for (size_t testPoint = 0; testPoint < testPointCount; ++testPoint)
-                    sum += m_functor.evaluate(
-                                testGeomData.const_slice(testPoint),
-                                trialGeomData.const_slice(trialPoint),
-                                testValues.const_slice(testDof, testPoint),
-                                trialValues.const_slice(trialDof, trialPoint),
-                                kernelValues.const_slice(testPoint, trialPoint)) *
-                            testGeomData.integrationElements(testPoint) *
-                            trialGeomData.integrationElements(trialPoint) *
-                            testQuadWeights[testPoint] *
-                            trialQuadWeights[trialPoint];
-            result(testDof, trialDof) = sum;
-        }
+    evaluateWithTensorQuadratureRuleImpl(
+                m_functor, testGeomData, trialGeomData, testValues, trialValues,
+                kernelValues, testQuadWeights, trialQuadWeights,
+                m_workspaces.local(), result);
 }
 
 template <typename IntegrandFunctor>
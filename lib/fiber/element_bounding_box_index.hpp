@@ -0,0 +1,235 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_element_bounding_box_index_hpp
+#define fiber_element_bounding_box_index_hpp
+
+#include "../common/common.hpp"
+
+#include "raw_grid_geometry.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Spatial index used to find the elements lying close to given
+ *  points.
+ *
+ *  The bounding box of each element is enlarged on every side by a given
+ *  multiple of the element's diameter and registered in all the cells of a
+ *  uniform Cartesian grid it overlaps. The cell size is chosen so that each
+ *  enlarged box overlaps only a few cells; finding the elements close to a
+ *  point therefore costs O(1) on quasi-uniform meshes. */
+template <typename CoordinateType>
+class ElementBoundingBoxIndex
+{
+public:
+    /** \brief Constructor.
+     *
+     *  \param[in] rawGeometry
+     *    Geometry of the elements to index.
+     *  \param[in] relativeMargin
+     *    Multiple of the diameter of each element by which its bounding box
+     *    is enlarged. Must be nonnegative. */
+    ElementBoundingBoxIndex(const RawGridGeometry<CoordinateType>& rawGeometry,
+                            CoordinateType relativeMargin) :
+        m_dimCount(rawGeometry.worldDimension()),
+        m_cellSize(1.),
+        m_cellCounts(m_dimCount, 1)
+    {
+        if (relativeMargin < 0.)
+            throw std::invalid_argument(
+                    "ElementBoundingBoxIndex::ElementBoundingBoxIndex(): "
+                    "relativeMargin must be nonnegative");
+
+        const arma::Mat<CoordinateType>& vertices = rawGeometry.vertices();
+        const arma::Mat<int>& cornerIndices = rawGeometry.elementCornerIndices();
+        const int elementCount = rawGeometry.elementCount();
+
+        // Find the enlarged bounding boxes
+        m_lower.set_size(m_dimCount, elementCount);
+        m_upper.set_size(m_dimCount, elementCount);
+        CoordinateType totalExtent = 0.;
+        for (int e = 0; e < elementCount; ++e) {
+            for (int dim = 0; dim < m_dimCount; ++dim)
+                m_lower(dim, e) = m_upper(dim, e) =
+                        vertices(dim, cornerIndices(0, e));
+            for (size_t corner = 1; corner < cornerIndices.n_rows &&
+                 cornerIndices(corner, e) >= 0; ++corner)
+                for (int dim = 0; dim < m_dimCount; ++dim) {
+                    const CoordinateType x =
+                            vertices(dim, cornerIndices(corner, e));
+                    m_lower(dim, e) = std::min(m_lower(dim, e), x);
+                    m_upper(dim, e) = std::max(m_upper(dim, e), x);
+                }
+            CoordinateType diameter2 = 0.;
+            for (int dim = 0; dim < m_dimCount; ++dim)
+                diameter2 += (m_upper(dim, e) - m_lower(dim, e)) *
+                        (m_upper(dim, e) - m_lower(dim, e));
+            const CoordinateType margin = relativeMargin * std::sqrt(diameter2);
+            CoordinateType extent = 0.;
+            for (int dim = 0; dim < m_dimCount; ++dim) {
+                m_lower(dim, e) -= margin;
+                m_upper(dim, e) += margin;
+                extent = std::max(extent, m_upper(dim, e) - m_lower(dim, e));
+            }
+            totalExtent += extent;
+        }
+        if (elementCount == 0)
+            return;
+
+        // Set up the grid of cells
+        m_origin.set_size(m_dimCount);
+        arma::Col<CoordinateType> gridExtent(m_dimCount);
+        for (int dim = 0; dim < m_dimCount; ++dim) {
+            CoordinateType lowest = m_lower(dim, 0), highest = m_upper(dim, 0);
+            for (int e = 1; e < elementCount; ++e) {
+                lowest = std::min(lowest, m_lower(dim, e));
+                highest = std::max(highest, m_upper(dim, e));
+            }
+            m_origin(dim) = lowest;
+            gridExtent(dim) = highest - lowest;
+        }
+        m_cellSize = totalExtent / elementCount;
+        if (m_cellSize <= 0.)
+            m_cellSize = 1.;
+        // Limit the number of cells to a small multiple of the number of
+        // elements
+        while (true) {
+            double cellCount = 1.;
+            for (int dim = 0; dim < m_dimCount; ++dim) {
+                m_cellCounts[dim] = std::max(
+                            1, int(std::ceil(gridExtent(dim) / m_cellSize)));
+                cellCount *= m_cellCounts[dim];
+            }
+            if (cellCount <= 8. * elementCount + 8.)
+                break;
+            m_cellSize *= 2.;
+        }
+
+        // Register elements in cells, in two passes (counting and filling)
+        std::vector<int> firstCell(m_dimCount), lastCell(m_dimCount);
+        int cellCount = 1;
+        for (int dim = 0; dim < m_dimCount; ++dim)
+            cellCount *= m_cellCounts[dim];
+        m_cellOffsets.assign(cellCount + 1, 0);
+        for (int pass = 0; pass < 2; ++pass) {
+            std::vector<int> fillPositions;
+            if (pass == 1) {
+                for (int c = 0; c < cellCount; ++c)
+                    m_cellOffsets[c + 1] += m_cellOffsets[c];
+                m_cellElements.resize(m_cellOffsets[cellCount]);
+                fillPositions.assign(m_cellOffsets.begin(),
+                                     m_cellOffsets.end() - 1);
+            }
+            for (int e = 0; e < elementCount; ++e) {
+                for (int dim = 0; dim < m_dimCount; ++dim) {
+                    firstCell[dim] = cellIndex(dim, m_lower(dim, e));
+                    lastCell[dim] = cellIndex(dim, m_upper(dim, e));
+                }
+                // Visit all cells overlapped by the box
+                std::vector<int> cell(firstCell);
+                while (true) {
+                    const int c = flatCellIndex(cell);
+                    if (pass == 0)
+                        ++m_cellOffsets[c + 1];
+                    else
+                        m_cellElements[fillPositions[c]++] = e;
+                    int dim = 0;
+                    for (; dim < m_dimCount; ++dim) {
+                        if (cell[dim] < lastCell[dim]) {
+                            ++cell[dim];
+                            break;
+                        }
+                        cell[dim] = firstCell[dim];
+                    }
+                    if (dim == m_dimCount)
+                        break;
+                }
+            }
+        }
+    }
+
+    /** \brief Find the elements whose enlarged bounding boxes contain a
+     *  point.
+     *
+     *  \param[in] point
+     *    Pointer to the coordinates of the point.
+     *  \param[out] elements
+     *    Indices of the elements found, in increasing order. */
+    void findElements(const CoordinateType* point,
+                      std::vector<int>& elements) const {
+        elements.clear();
+        if (m_cellOffsets.empty())
+            return;
+        std::vector<int> cell(m_dimCount);
+        for (int dim = 0; dim < m_dimCount; ++dim) {
+            const CoordinateType x = (point[dim] - m_origin(dim)) / m_cellSize;
+            if (x < 0. || x > m_cellCounts[dim])
+                return;
+            cell[dim] = std::min(int(x), m_cellCounts[dim] - 1);
+        }
+        const int c = flatCellIndex(cell);
+        for (int i = m_cellOffsets[c]; i < m_cellOffsets[c + 1]; ++i) {
+            const int e = m_cellElements[i];
+            bool inside = true;
+            for (int dim = 0; dim < m_dimCount && inside; ++dim)
+                inside = m_lower(dim, e) <= point[dim] &&
+                        point[dim] <= m_upper(dim, e);
+            if (inside)
+                elements.push_back(e);
+        }
+    }
+
+private:
+    int cellIndex(int dim, CoordinateType x) const {
+        const int index = int((x - m_origin(dim)) / m_cellSize);
+        return std::max(0, std::min(index, m_cellCounts[dim] - 1));
+    }
+
+    int flatCellIndex(const std::vector<int>& cell) const {
+        int index = 0;
+        for (int dim = m_dimCount - 1; dim >= 0; --dim)
+            index = index * m_cellCounts[dim] + cell[dim];
+        return index;
+    }
+
+private:
+    int m_dimCount;
+    arma::Mat<CoordinateType> m_lower;
+    arma::Mat<CoordinateType> m_upper;
+    arma::Col<CoordinateType> m_origin;
+    CoordinateType m_cellSize;
+    std::vector<int> m_cellCounts;
+    // Compressed lists of elements registered in each cell: the elements of
+    // cell c are stored in m_cellElements[m_cellOffsets[c]],
+    // ..., m_cellElements[m_cellOffsets[c + 1] - 1]
+    std::vector<int> m_cellOffsets;
+    std::vector<int> m_cellElements;
+};
+
+} // namespace Fiber
+
+#endif
@@ -0,0 +1,164 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_element_data_cache_hpp
+#define fiber_element_data_cache_hpp
+
+#include "../common/common.hpp"
+
+#include "collection_of_3d_arrays.hpp"
+#include "geometrical_data.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <tbb/atomic.h>
+#include <tbb/concurrent_unordered_map.h>
+#include <memory>
+#include <utility>
+
+namespace Fiber
+{
+
+/** \brief Geometrical data and transformed basis function values evaluated
+ *  at the quadrature points of a single element. */
+template <typename BasisFunctionType, typename CoordinateType>
+struct ElementData
+{
+    GeometricalData<CoordinateType> geomData;
+    CollectionOf3dArrays<BasisFunctionType> transformedBasisValues;
+};
+
+/** \brief Thread-safe cache of element data.
+ *
+ *  An ElementDataCache stores, for each pair (element index, quadrature
+ *  order), the geometrical data and the values of the transformed basis
+ *  functions at the quadrature points of that element. It is meant to be
+ *  owned by a local assembler and shared by all its integrators, which can
+ *  then avoid recalculating these quantities each time the same element is
+ *  visited.
+ *
+ *  The total amount of memory occupied by the cached items is limited by a
+ *  budget specified in the constructor. Once the budget has been exhausted,
+ *  no further items are inserted into the cache; items are never evicted. */
+template <typename BasisFunctionType, typename CoordinateType>
+class ElementDataCache : boost::noncopyable
+{
+public:
+    typedef ElementData<BasisFunctionType, CoordinateType> Data;
+
+    /** \brief Constructor.
+     *
+     *  \param[in] memoryBudget
+     *    Maximum amount of memory (in bytes) occupied by the cached items. */
+    explicit ElementDataCache(size_t memoryBudget) :
+        m_memoryBudget(memoryBudget) {
+        m_memoryUsage = 0;
+    }
+
+    /** \brief Destructor.
+     *
+     *  Must not be called while other threads are still using the cache. */
+    ~ElementDataCache() {
+        for (typename DataMap::const_iterator it = m_dataMap.begin();
+             it != m_dataMap.end(); ++it)
+            delete it->second;
+    }
+
+    /** \brief Return the data stored for element \p elementIndex and
+     *  quadrature order \p quadOrder, or a null pointer if there are none. */
+    const Data* find(int elementIndex, int quadOrder) const {
+        typename DataMap::const_iterator it =
+                m_dataMap.find(Key(elementIndex, quadOrder));
+        return it == m_dataMap.end() ? 0 : it->second;
+    }
+
+    /** \brief Try to store data for element \p elementIndex and quadrature
+     *  order \p quadOrder.
+     *
+     *  If the data fit into the memory budget, the cache takes ownership of
+     *  \p data and a pointer to the cached item is returned. If another
+     *  thread has stored data for the same element and order in the meantime,
+     *  \p data is left untouched and a pointer to the previously stored item
+     *  is returned. If the memory budget would be exceeded, \p data is left
+     *  untouched and a null pointer is returned. */
+    const Data* insert(int elementIndex, int quadOrder,
+                       std::auto_ptr<Data>& data) {
+        if (!data.get())
+            return 0;
+        const size_t size = dataSize(*data);
+        if (m_memoryUsage.fetch_and_add(size) + size > m_memoryBudget) {
+            m_memoryUsage -= size;
+            return 0;
+        }
+        std::pair<typename DataMap::iterator, bool> result =
+                m_dataMap.insert(std::make_pair(Key(elementIndex, quadOrder),
+                                                data.get()));
+        if (result.second)
+            data.release();
+        else
+            m_memoryUsage -= size;
+        return result.first->second;
+    }
+
+    /** \brief Return the amount of memory (in bytes) occupied by the cached
+     *  items. */
+    size_t memoryUsage() const {
+        return m_memoryUsage;
+    }
+
+    /** \brief Return the memory budget (in bytes) of the cache. */
+    size_t memoryBudget() const {
+        return m_memoryBudget;
+    }
+
+private:
+    /** \cond PRIVATE */
+    typedef std::pair<int, int> Key;
+
+    struct KeyHasher {
+        size_t operator()(const Key& key) const {
+            return static_cast<size_t>(key.first) * 64 + key.second;
+        }
+    };
+
+    typedef tbb::concurrent_unordered_map<Key, Data*, KeyHasher> DataMap;
+
+    static size_t dataSize(const Data& data) {
+        const GeometricalData<CoordinateType>& g = data.geomData;
+        size_t coordCount = g.globals.n_elem + g.integrationElements.n_elem +
+                g.jacobiansTransposed.n_elem +
+                g.jacobianInversesTransposed.n_elem + g.normals.n_elem;
+        size_t valueCount = 0;
+        const CollectionOf3dArrays<BasisFunctionType>& v =
+                data.transformedBasisValues;
+        for (size_t i = 0; i < v.size(); ++i)
+            valueCount += v[i].extent(0) * v[i].extent(1) * v[i].extent(2);
+        return sizeof(Data) + coordCount * sizeof(CoordinateType) +
+                valueCount * sizeof(BasisFunctionType);
+    }
+
+    DataMap m_dataMap;
+    size_t m_memoryBudget;
+    tbb::atomic<size_t> m_memoryUsage;
+    /** \endcond */
+};
+
+} // namespace Fiber
+
+#endif
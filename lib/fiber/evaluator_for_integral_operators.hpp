@@ -26,6 +26,9 @@
 
 #include "../common/common.hpp"
 
+#include <stdexcept>
+#include <vector>
+
 namespace Fiber
 {
 
@@ -44,6 +47,73 @@ public:
     virtual void evaluate(Region region,
                           const arma::Mat<CoordinateType>& points,
                           arma::Mat<ResultType>& result) const = 0;
+
+    /** \brief Return the global coordinates of the quadrature points at
+     *  which the argument is sampled when evaluating the potential in
+     *  \p region.
+     *
+     *  Together with evaluateContribution(), this function lets fast
+     *  summation schemes (such as HierarchicalEvaluatorForIntegralOperators)
+     *  split the potential into contributions of groups of quadrature
+     *  points. The default implementation throws an exception. */
+    virtual void getQuadraturePoints(
+            Region region, arma::Mat<CoordinateType>& quadPoints) const {
+        throw std::runtime_error(
+                "EvaluatorForIntegralOperators::getQuadraturePoints(): "
+                "not implemented by this evaluator");
+    }
+
+    /** \brief Evaluate the potential generated by a subset of the quadrature
+     *  points at given points.
+     *
+     *  The indices stored in \p quadPointIndices refer to the columns of
+     *  the array returned by getQuadraturePoints(). This function is
+     *  executed serially and may be called concurrently from several
+     *  threads. The default implementation throws an exception. */
+    virtual void evaluateContribution(
+            Region region,
+            const std::vector<int>& quadPointIndices,
+            const arma::Mat<CoordinateType>& points,
+            arma::Mat<ResultType>& result) const {
+        throw std::runtime_error(
+                "EvaluatorForIntegralOperators::evaluateContribution(): "
+                "not implemented by this evaluator");
+    }
+
+    /** \brief Evaluate the potentials generated by the individual local basis
+     *  functions of an element at given points.
+     *
+     *  On output, <tt>result[j]</tt> contains the potential generated in
+     *  \p region by the <em>j</em>th local basis function of element \p
+     *  element (with unit coefficient), irrespective of the coefficients of
+     *  the argument. The kernels are evaluated only once for all basis
+     *  functions. This function is executed serially and may be called
+     *  concurrently from several threads. The default implementation throws
+     *  an exception. */
+    virtual void evaluateLocalBasisContributions(
+            Region region, int element,
+            const arma::Mat<CoordinateType>& points,
+            std::vector<arma::Mat<ResultType> >& result) const {
+        throw std::runtime_error(
+                "EvaluatorForIntegralOperators::"
+                "evaluateLocalBasisContributions(): "
+                "not implemented by this evaluator");
+    }
+
+    /** \brief Improve the accuracy of a far-field potential at points lying
+     *  close to the surface.
+     *
+     *  On input, \p result should contain the potential evaluated with
+     *  <tt>evaluate(FAR_FIELD, points, result)</tt>. For each point, the
+     *  contributions of the elements whose bounding boxes lie closer to it
+     *  than \p nearFieldDistance times their diameter are replaced by ones
+     *  evaluated with the near-field quadrature rule. The default
+     *  implementation does nothing. */
+    virtual void applyNearFieldCorrection(
+            const arma::Mat<CoordinateType>& points,
+            CoordinateType nearFieldDistance,
+            arma::Mat<ResultType>& result) const {
+    }
 };
 
 } // namespace Fiber
@@ -4,6 +4,7 @@
 #include "../common/common.hpp"
 #include "scalar_traits.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <vector>
@@ -11,17 +12,25 @@
 namespace Fiber
 {
 
+/** \brief Piecewise cubic Hermite interpolant on a uniform grid.
+ *
+ *  The cubic polynomial interpolating the function on each interval is
+ *  precomputed in initialize() and its four coefficients are stored
+ *  contiguously in a single table, so that an evaluation costs one
+ *  multiplication to locate the interval, a single cache-line load and a
+ *  Horner scheme. */
 template <typename ValueType>
 class HermiteInterpolator
 {
 public:
     typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
 
-    HermiteInterpolator() : m_start(0.), m_end(0.), m_n(0), m_interval(0.)
+    HermiteInterpolator() :
+        m_start(0.), m_end(0.), m_n(0), m_interval(0.), m_inverseInterval(0.)
         {}
 
-    CoordinateType rangeStart() { return m_start; }
-    CoordinateType rangeEnd() { return m_end; }
+    CoordinateType rangeStart() const { return m_start; }
+    CoordinateType rangeEnd() const { return m_end; }
 
     void initialize(CoordinateType start, CoordinateType end,
                     const std::vector<ValueType>& values,
@@ -40,37 +49,143 @@ public:
         m_end = end;
         m_n = values.size();
         m_interval = (end - start) / (m_n - 1);
-        m_values = values;
-        m_derivatives = derivatives;
+        m_inverseInterval = 1. / m_interval;
+
+        // Coefficients of the cubic polynomial in the local coordinate
+        // t in [0, 1] on each interval; adapted from the chfev routine
+        // from SLATEC
+        m_coefficients.resize(COEFFICIENT_COUNT * (m_n - 1));
+        for (int n = 0; n < m_n - 1; ++n) {
+            const ValueType f_1 = values[n];
+            const ValueType f_2 = values[n+1];
+            const ValueType d_1 = derivatives[n] * m_interval;
+            const ValueType d_2 = derivatives[n+1] * m_interval;
+            const ValueType Delta = f_2 - f_1;
+            const ValueType Delta_1 = d_1 - Delta;
+            const ValueType Delta_2 = d_2 - Delta;
+            ValueType* c = &m_coefficients[COEFFICIENT_COUNT * n];
+            c[0] = f_1;
+            c[1] = d_1;
+            c[2] = -(Delta_1 + Delta_1 + Delta_2);
+            c[3] = Delta_1 + Delta_2;
+        }
     }
 
     ValueType evaluate(CoordinateType x) const {
         assert(x >= m_start && x <= m_end);
-        CoordinateType fpn;
-        const CoordinateType t = std::modf((x - m_start) / m_interval, &fpn);
-        const int n = int(fpn);
-        assert(n >= 0 && n < m_n);
-        assert(t >= 0 && t <= 1);
-        // Adapted from the chfev routine from SLATEC
-        const ValueType f_1 = m_values[n];
-        const ValueType f_2 = m_values[n+1];
-        const ValueType d_1 = m_derivatives[n] * m_interval;
-        const ValueType d_2 = m_derivatives[n+1] * m_interval;
-        const ValueType Delta = f_2 - f_1;
-        const ValueType Delta_1 = d_1 - Delta;
-        const ValueType Delta_2 = d_2 - Delta;
-        const ValueType c_2 = -(Delta_1 + Delta_1 + Delta_2);
-        const ValueType c_3 = Delta_1 + Delta_2;
-        return f_1 + t * (d_1 + t * (c_2 + t * c_3));
+        const CoordinateType s = (x - m_start) * m_inverseInterval;
+        // Points at the very end of the range belong to the last interval
+        const int n = std::min(int(s), m_n - 2);
+        assert(n >= 0);
+        const CoordinateType t = s - n;
+        const ValueType* c = &m_coefficients[COEFFICIENT_COUNT * n];
+        return c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+    }
+
+    /** \brief Evaluate the interpolant at \p count points.
+     *
+     *  Equivalent to setting <tt>result[i] = evaluate(x[i])</tt> for all
+     *  \p i. The points are processed in chunks. For each chunk, the
+     *  intervals containing the points and the local coordinates in these
+     *  intervals are computed in a loop free of table lookups, which the
+     *  compiler can vectorise. The coefficients are then fetched and the
+     *  polynomials evaluated in a separate loop. */
+    void evaluate(const CoordinateType* x, ValueType* result,
+                  size_t count) const {
+        const ValueType* coefficients = &m_coefficients[0];
+        const int lastInterval = m_n - 2;
+        int offsets[CHUNK_SIZE];
+        CoordinateType ts[CHUNK_SIZE];
+        for (size_t start = 0; start < count; start += CHUNK_SIZE) {
+            const size_t chunkCount = std::min<size_t>(CHUNK_SIZE, count - start);
+            const CoordinateType* chunkX = x + start;
+            ValueType* chunkResult = result + start;
+#pragma ivdep
+            for (size_t i = 0; i < chunkCount; ++i) {
+                assert(chunkX[i] >= m_start && chunkX[i] <= m_end);
+                const CoordinateType s = (chunkX[i] - m_start) * m_inverseInterval;
+                int n = int(s);
+                n = n < lastInterval ? n : lastInterval;
+                offsets[i] = COEFFICIENT_COUNT * n;
+                ts[i] = s - n;
+            }
+            for (size_t i = 0; i < chunkCount; ++i) {
+                const CoordinateType t = ts[i];
+                const ValueType* c = coefficients + offsets[i];
+                chunkResult[i] = c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+            }
+        }
+    }
+
+    /** \brief Evaluate a kernel of the form <tt>F(x, y) f(|x - y|)</tt>,
+     *  where \f$f\f$ is the interpolated function, at a sequence of point
+     *  pairs.
+     *
+     *  The arguments \p pointCount, \p testGlobals, \p testNormals,
+     *  \p testStride, \p trialGlobals, \p trialNormals, \p trialStride and
+     *  \p result have the same meaning as those of the evaluateScalars()
+     *  member function of kernel functors (see DefaultCollectionOfKernels).
+     *  \p functor must provide the member function
+     *
+     *  \code
+     *  // Store |x - y| in distance and F(x, y) in factor, x and y being the
+     *  // points with coordinates testGlobal[0..2] and trialGlobal[0..2].
+     *  void evaluateDistanceAndFactor(const CoordinateType* testGlobal,
+     *                                 const CoordinateType* testNormal,
+     *                                 const CoordinateType* trialGlobal,
+     *                                 const CoordinateType* trialNormal,
+     *                                 CoordinateType& distance,
+     *                                 ValueType& factor) const;
+     *  \endcode
+     *
+     *  The distances are collected in chunks and passed to the batched
+     *  evaluate(). */
+    template <typename Functor>
+    void evaluateAtPointPairs(size_t pointCount,
+                              const CoordinateType* testGlobals,
+                              const CoordinateType* testNormals,
+                              size_t testStride,
+                              const CoordinateType* trialGlobals,
+                              const CoordinateType* trialNormals,
+                              size_t trialStride,
+                              const Functor& functor,
+                              ValueType* result) const {
+        const int coordCount = 3;
+        const size_t testStep = coordCount * testStride;
+        const size_t trialStep = coordCount * trialStride;
+
+        CoordinateType distances[CHUNK_SIZE];
+        ValueType factors[CHUNK_SIZE];
+        for (size_t start = 0; start < pointCount; start += CHUNK_SIZE) {
+            const size_t count = std::min<size_t>(CHUNK_SIZE, pointCount - start);
+            for (size_t i = 0; i < count; ++i) {
+                const size_t p = start + i;
+                functor.evaluateDistanceAndFactor(
+                            testGlobals + testStep * p,
+                            testNormals ? testNormals + testStep * p : 0,
+                            trialGlobals + trialStep * p,
+                            trialNormals ? trialNormals + trialStep * p : 0,
+                            distances[i], factors[i]);
+            }
+            ValueType* values = result + start;
+            evaluate(distances, values, count);
+#pragma ivdep
+            for (size_t i = 0; i < count; ++i)
+                values[i] *= factors[i];
+        }
     }
 
 private:
     /** \cond PRIVATE */
+    enum { COEFFICIENT_COUNT = 4 };
+    // Number of points processed at a time by the batched evaluation routines
+    enum { CHUNK_SIZE = 64 };
+
     CoordinateType m_start, m_end;
     int m_n;
-    CoordinateType m_interval;
-    std::vector<ValueType> m_values;
-    std::vector<ValueType> m_derivatives;
+    CoordinateType m_interval, m_inverseInterval;
+    // Coefficients c0, c1, c2, c3 of consecutive intervals
+    std::vector<ValueType> m_coefficients;
     /** \endcond */
 };
 
@@ -0,0 +1,680 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "hierarchical_evaluator_for_integral_operators.hpp"
+
+#include "explicit_instantiation.hpp"
+#include "serial_blas_region.hpp"
+#include "thread_pool.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <tbb/parallel_for.h>
+
+namespace Fiber
+{
+
+namespace
+{
+
+/** \brief Cluster of points, stored as a range of a permutation array. */
+template <typename CoordinateType>
+struct PointCluster
+{
+    size_t begin;
+    size_t end;
+    int parent;
+    int children[2];
+    int level;
+    // Bounding box
+    arma::Col<CoordinateType> lower;
+    arma::Col<CoordinateType> upper;
+
+    bool isLeaf() const { return children[0] < 0; }
+    size_t size() const { return end - begin; }
+    CoordinateType diameter() const { return arma::norm(upper - lower, 2); }
+};
+
+template <typename CoordinateType>
+CoordinateType clusterDistance(const PointCluster<CoordinateType>& c1,
+                               const PointCluster<CoordinateType>& c2)
+{
+    CoordinateType dist2 = 0.;
+    for (size_t dim = 0; dim < c1.lower.n_rows; ++dim) {
+        const CoordinateType gap =
+                std::max(std::max(c1.lower(dim) - c2.upper(dim),
+                                  c2.lower(dim) - c1.upper(dim)),
+                         CoordinateType(0.));
+        dist2 += gap * gap;
+    }
+    return std::sqrt(dist2);
+}
+
+template <typename CoordinateType>
+class CoordinateBelow
+{
+public:
+    CoordinateBelow(const arma::Mat<CoordinateType>& points, int dim,
+                    CoordinateType value) :
+        m_points(points), m_dim(dim), m_value(value) {
+    }
+
+    bool operator()(int point) const {
+        return m_points(m_dim, point) < m_value;
+    }
+
+private:
+    const arma::Mat<CoordinateType>& m_points;
+    int m_dim;
+    CoordinateType m_value;
+};
+
+template <typename CoordinateType>
+class CoordinateLess
+{
+public:
+    CoordinateLess(const arma::Mat<CoordinateType>& points, int dim) :
+        m_points(points), m_dim(dim) {
+    }
+
+    bool operator()(int point1, int point2) const {
+        return m_points(m_dim, point1) < m_points(m_dim, point2);
+    }
+
+private:
+    const arma::Mat<CoordinateType>& m_points;
+    int m_dim;
+};
+
+/** \brief Binary tree of clusters obtained by recursive bisection of
+ *  bounding boxes. */
+template <typename CoordinateType>
+class PointClusterTree
+{
+public:
+    typedef PointCluster<CoordinateType> Cluster;
+
+    PointClusterTree(const arma::Mat<CoordinateType>& points,
+                     size_t maximumLeafSize) :
+        m_points(points), m_maximumLeafSize(maximumLeafSize),
+        m_permutation(points.n_cols), m_levelCount(0)
+    {
+        for (size_t i = 0; i < m_permutation.size(); ++i)
+            m_permutation[i] = i;
+        Cluster root;
+        root.begin = 0;
+        root.end = points.n_cols;
+        root.parent = -1;
+        root.level = 0;
+        m_clusters.push_back(root);
+        split(0);
+    }
+
+    const std::vector<Cluster>& clusters() const { return m_clusters; }
+    const Cluster& cluster(int index) const { return m_clusters[index]; }
+    /** \brief Original indices of points, in the order of clusters. */
+    const std::vector<int>& permutation() const { return m_permutation; }
+    int levelCount() const { return m_levelCount; }
+
+    /** \brief Append the original indices of the points of a cluster
+     *  to \p indices. */
+    void appendPointIndices(int clusterIndex, std::vector<int>& indices) const {
+        const Cluster& c = m_clusters[clusterIndex];
+        indices.insert(indices.end(),
+                       m_permutation.begin() + c.begin,
+                       m_permutation.begin() + c.end);
+    }
+
+private:
+    void split(int clusterIndex) {
+        // m_clusters may be reallocated below, so clusters are always
+        // accessed by index
+        const size_t begin = m_clusters[clusterIndex].begin;
+        const size_t end = m_clusters[clusterIndex].end;
+        const int level = m_clusters[clusterIndex].level;
+        m_levelCount = std::max(m_levelCount, level + 1);
+        m_clusters[clusterIndex].children[0] = -1;
+        m_clusters[clusterIndex].children[1] = -1;
+
+        const int dimCount = m_points.n_rows;
+        arma::Col<CoordinateType> lower(dimCount), upper(dimCount);
+        if (begin < end) {
+            lower = m_points.col(m_permutation[begin]);
+            upper = lower;
+        } else {
+            lower.fill(0.);
+            upper.fill(0.);
+        }
+        for (size_t i = begin; i < end; ++i)
+            for (int dim = 0; dim < dimCount; ++dim) {
+                const CoordinateType x = m_points(dim, m_permutation[i]);
+                lower(dim) = std::min(lower(dim), x);
+                upper(dim) = std::max(upper(dim), x);
+            }
+        m_clusters[clusterIndex].lower = lower;
+        m_clusters[clusterIndex].upper = upper;
+
+        if (end - begin <= m_maximumLeafSize)
+            return;
+        const arma::Col<CoordinateType> extents = upper - lower;
+        arma::uword splitDim;
+        if (extents.max(splitDim) <= 0.)
+            return; // all points coincide
+
+        // Bisect the bounding box along its longest side; if this leaves
+        // one half empty, split at the median instead
+        std::vector<int>::iterator first = m_permutation.begin() + begin;
+        std::vector<int>::iterator last = m_permutation.begin() + end;
+        std::vector<int>::iterator middle = std::partition(
+                    first, last,
+                    CoordinateBelow<CoordinateType>(
+                        m_points, splitDim,
+                        (lower(splitDim) + upper(splitDim)) / 2.));
+        if (middle == first || middle == last) {
+            middle = first + (end - begin) / 2;
+            std::nth_element(first, middle, last,
+                             CoordinateLess<CoordinateType>(m_points, splitDim));
+        }
+        const size_t splitPoint = middle - m_permutation.begin();
+
+        for (int child = 0; child < 2; ++child) {
+            Cluster c;
+            c.begin = child == 0 ? begin : splitPoint;
+            c.end = child == 0 ? splitPoint : end;
+            c.parent = clusterIndex;
+            c.level = level + 1;
+            m_clusters.push_back(c);
+            const int childIndex = m_clusters.size() - 1;
+            m_clusters[clusterIndex].children[child] = childIndex;
+            split(childIndex);
+        }
+    }
+
+private:
+    const arma::Mat<CoordinateType>& m_points;
+    size_t m_maximumLeafSize;
+    std::vector<Cluster> m_clusters;
+    std::vector<int> m_permutation;
+    int m_levelCount;
+};
+
+/** \brief Tensor-product Chebyshev interpolation in boxes. */
+template <typename CoordinateType>
+class ChebyshevInterpolation
+{
+public:
+    ChebyshevInterpolation(int dimCount, int order) :
+        m_dimCount(dimCount), m_order(order),
+        m_nodes(order), m_denominators(order), m_nodeCount(1)
+    {
+        for (int dim = 0; dim < dimCount; ++dim)
+            m_nodeCount *= order;
+        for (int k = 0; k < order; ++k)
+            m_nodes[k] = std::cos((2 * k + 1) * M_PI / (2 * order));
+        for (int k = 0; k < order; ++k) {
+            m_denominators[k] = 1.;
+            for (int m = 0; m < order; ++m)
+                if (m != k)
+                    m_denominators[k] *= m_nodes[k] - m_nodes[m];
+        }
+    }
+
+    int nodeCount() const { return m_nodeCount; }
+
+    /** \brief Return the global coordinates of the interpolation nodes of
+     *  a cluster's bounding box. */
+    void getNodes(const PointCluster<CoordinateType>& cluster,
+                  arma::Mat<CoordinateType>& nodes) const {
+        arma::Col<CoordinateType> center, halfWidth;
+        getBox(cluster, center, halfWidth);
+        nodes.set_size(m_dimCount, m_nodeCount);
+        for (int node = 0; node < m_nodeCount; ++node)
+            for (int dim = 0, k = node; dim < m_dimCount; ++dim, k /= m_order)
+                nodes(dim, node) = center(dim) +
+                        halfWidth(dim) * m_nodes[k % m_order];
+    }
+
+    /** \brief Evaluate the Lagrange polynomials associated with the
+     *  interpolation nodes of a cluster's bounding box at \p points.
+     *
+     *  On output, <tt>weights(n, j)</tt> is the value of the polynomial
+     *  associated with the <tt>n</tt>th node at the <tt>j</tt>th point. */
+    template <typename ValueType>
+    void getWeights(const PointCluster<CoordinateType>& cluster,
+                    const arma::Mat<CoordinateType>& points,
+                    arma::Mat<ValueType>& weights) const {
+        arma::Col<CoordinateType> center, halfWidth;
+        getBox(cluster, center, halfWidth);
+        arma::Mat<CoordinateType> lagrange(m_order, m_dimCount);
+        weights.set_size(m_nodeCount, points.n_cols);
+        for (size_t point = 0; point < points.n_cols; ++point) {
+            for (int dim = 0; dim < m_dimCount; ++dim) {
+                const CoordinateType t =
+                        (points(dim, point) - center(dim)) / halfWidth(dim);
+                for (int k = 0; k < m_order; ++k) {
+                    CoordinateType numerator = 1.;
+                    for (int m = 0; m < m_order; ++m)
+                        if (m != k)
+                            numerator *= t - m_nodes[m];
+                    lagrange(k, dim) = numerator / m_denominators[k];
+                }
+            }
+            for (int node = 0; node < m_nodeCount; ++node) {
+                CoordinateType weight = 1.;
+                for (int dim = 0, k = node; dim < m_dimCount; ++dim, k /= m_order)
+                    weight *= lagrange(k % m_order, dim);
+                weights(node, point) = weight;
+            }
+        }
+    }
+
+private:
+    void getBox(const PointCluster<CoordinateType>& cluster,
+                arma::Col<CoordinateType>& center,
+                arma::Col<CoordinateType>& halfWidth) const {
+        center = (cluster.lower + cluster.upper) / 2.;
+        halfWidth = (cluster.upper - cluster.lower) / 2.;
+        // Flat boxes (e.g. clusters of points lying on a plane) are
+        // given a small nonzero thickness
+        const CoordinateType minHalfWidth =
+                std::max(halfWidth.max(), CoordinateType(1.)) * 1e-6;
+        for (int dim = 0; dim < m_dimCount; ++dim)
+            halfWidth(dim) = std::max(halfWidth(dim), minHalfWidth);
+    }
+
+private:
+    int m_dimCount;
+    int m_order;
+    std::vector<CoordinateType> m_nodes;
+    std::vector<CoordinateType> m_denominators;
+    int m_nodeCount;
+};
+
+/** \brief Interaction lists of the clusters of evaluation points. */
+struct InteractionLists
+{
+    explicit InteractionLists(size_t clusterCount) :
+        interpolated(clusterCount), direct(clusterCount) {
+    }
+
+    /** \brief Source clusters whose potential is interpolated from the
+     *  nodes of the bounding box of each target cluster. */
+    std::vector<std::vector<int> > interpolated;
+    /** \brief Source clusters whose potential is evaluated directly at
+     *  the points of each target cluster. */
+    std::vector<std::vector<int> > direct;
+};
+
+template <typename CoordinateType>
+void buildInteractionLists(
+        const PointClusterTree<CoordinateType>& targetTree,
+        const PointClusterTree<CoordinateType>& sourceTree,
+        double eta, size_t nodeCount,
+        InteractionLists& lists)
+{
+    typedef PointCluster<CoordinateType> Cluster;
+    std::vector<std::pair<int, int> > pairs;
+    pairs.push_back(std::make_pair(0, 0));
+    while (!pairs.empty()) {
+        const int targetIndex = pairs.back().first;
+        const int sourceIndex = pairs.back().second;
+        pairs.pop_back();
+        const Cluster& target = targetTree.cluster(targetIndex);
+        const Cluster& source = sourceTree.cluster(sourceIndex);
+        if (target.size() == 0 || source.size() == 0)
+            continue;
+
+        const CoordinateType targetDiameter = target.diameter();
+        const CoordinateType sourceDiameter = source.diameter();
+        const bool admissible =
+                std::max(targetDiameter, sourceDiameter) <=
+                eta * clusterDistance(target, source);
+        if (admissible) {
+            // Interpolation only pays off if the target cluster contains
+            // more points than interpolation nodes
+            if (target.size() > nodeCount)
+                lists.interpolated[targetIndex].push_back(sourceIndex);
+            else
+                lists.direct[targetIndex].push_back(sourceIndex);
+        } else if (target.isLeaf() && source.isLeaf())
+            lists.direct[targetIndex].push_back(sourceIndex);
+        else if (source.isLeaf() ||
+                 (!target.isLeaf() && targetDiameter >= sourceDiameter)) {
+            pairs.push_back(std::make_pair(target.children[0], sourceIndex));
+            pairs.push_back(std::make_pair(target.children[1], sourceIndex));
+        } else {
+            pairs.push_back(std::make_pair(targetIndex, source.children[0]));
+            pairs.push_back(std::make_pair(targetIndex, source.children[1]));
+        }
+    }
+}
+
+template <typename ResultType>
+struct HierarchicalEvaluationData
+{
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+    typedef typename EvaluatorForIntegralOperators<ResultType>::Region Region;
+
+    HierarchicalEvaluationData(
+            const EvaluatorForIntegralOperators<ResultType>& evaluator_,
+            Region region_,
+            const arma::Mat<CoordinateType>& points_,
+            const PointClusterTree<CoordinateType>& targetTree_,
+            const PointClusterTree<CoordinateType>& sourceTree_,
+            const ChebyshevInterpolation<CoordinateType>& interpolation_,
+            const InteractionLists& lists_) :
+        evaluator(evaluator_), region(region_), points(points_),
+        targetTree(targetTree_), sourceTree(sourceTree_),
+        interpolation(interpolation_), lists(lists_),
+        nodeValues(targetTree_.clusters().size()) {
+    }
+
+    const EvaluatorForIntegralOperators<ResultType>& evaluator;
+    Region region;
+    const arma::Mat<CoordinateType>& points;
+    const PointClusterTree<CoordinateType>& targetTree;
+    const PointClusterTree<CoordinateType>& sourceTree;
+    const ChebyshevInterpolation<CoordinateType>& interpolation;
+    const InteractionLists& lists;
+    /** \brief Values of the far-field potential at the interpolation nodes
+     *  of each target cluster (empty if there is no far field). */
+    std::vector<arma::Mat<ResultType> > nodeValues;
+};
+
+/** \brief Evaluate the interpolated interactions of target clusters at
+ *  their interpolation nodes. */
+template <typename ResultType>
+class FarFieldLoopBody
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    FarFieldLoopBody(const std::vector<int>& targets,
+                     HierarchicalEvaluationData<ResultType>& data) :
+        m_targets(targets), m_data(data) {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        arma::Mat<CoordinateType> nodes;
+        std::vector<int> quadPointIndices;
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            const int target = m_targets[i];
+            const std::vector<int>& sources =
+                    m_data.lists.interpolated[target];
+            quadPointIndices.clear();
+            for (size_t s = 0; s < sources.size(); ++s)
+                m_data.sourceTree.appendPointIndices(sources[s],
+                                                     quadPointIndices);
+            m_data.interpolation.getNodes(m_data.targetTree.cluster(target),
+                                          nodes);
+            m_data.evaluator.evaluateContribution(
+                        m_data.region, quadPointIndices, nodes,
+                        m_data.nodeValues[target]);
+        }
+    }
+
+private:
+    const std::vector<int>& m_targets;
+    HierarchicalEvaluationData<ResultType>& m_data;
+};
+
+/** \brief Add the interpolants of the far-field potential of parent
+ *  clusters to those of their children. */
+template <typename ResultType>
+class DownwardPassLoopBody
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    DownwardPassLoopBody(const std::vector<int>& clusters,
+                         HierarchicalEvaluationData<ResultType>& data) :
+        m_clusters(clusters), m_data(data) {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        arma::Mat<CoordinateType> nodes;
+        arma::Mat<ResultType> weights;
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            const int child = m_clusters[i];
+            const int parent = m_data.targetTree.cluster(child).parent;
+            const arma::Mat<ResultType>& parentValues =
+                    m_data.nodeValues[parent];
+            if (parentValues.is_empty())
+                continue;
+            m_data.interpolation.getNodes(m_data.targetTree.cluster(child),
+                                          nodes);
+            m_data.interpolation.getWeights(m_data.targetTree.cluster(parent),
+                                            nodes, weights);
+            arma::Mat<ResultType>& childValues = m_data.nodeValues[child];
+            if (childValues.is_empty())
+                childValues = parentValues * weights;
+            else
+                childValues += parentValues * weights;
+        }
+    }
+
+private:
+    const std::vector<int>& m_clusters;
+    HierarchicalEvaluationData<ResultType>& m_data;
+};
+
+/** \brief Evaluate the potential at the points of leaf clusters. */
+template <typename ResultType>
+class LeafLoopBody
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    LeafLoopBody(const std::vector<int>& leaves,
+                 const HierarchicalEvaluationData<ResultType>& data,
+                 arma::Mat<ResultType>& result) :
+        m_leaves(leaves), m_data(data), m_result(result) {
+    }
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        typedef PointCluster<CoordinateType> Cluster;
+        const std::vector<int>& permutation = m_data.targetTree.permutation();
+        arma::Mat<CoordinateType> leafPoints;
+        arma::Mat<ResultType> leafResult;
+        arma::Mat<ResultType> weights;
+        std::vector<int> quadPointIndices;
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            const int leaf = m_leaves[i];
+            const Cluster& cluster = m_data.targetTree.cluster(leaf);
+            leafPoints.set_size(m_data.points.n_rows, cluster.size());
+            for (size_t p = 0; p < cluster.size(); ++p)
+                leafPoints.col(p) =
+                        m_data.points.col(permutation[cluster.begin + p]);
+
+            // Direct interactions of the leaf and of all its ancestors
+            // (restricted to the points of the leaf)
+            quadPointIndices.clear();
+            for (int c = leaf; c >= 0; c = m_data.targetTree.cluster(c).parent) {
+                const std::vector<int>& sources = m_data.lists.direct[c];
+                for (size_t s = 0; s < sources.size(); ++s)
+                    m_data.sourceTree.appendPointIndices(sources[s],
+                                                         quadPointIndices);
+            }
+            m_data.evaluator.evaluateContribution(
+                        m_data.region, quadPointIndices, leafPoints,
+                        leafResult);
+
+            // Interpolated far field
+            const arma::Mat<ResultType>& nodeValues = m_data.nodeValues[leaf];
+            if (!nodeValues.is_empty()) {
+                m_data.interpolation.getWeights(cluster, leafPoints, weights);
+                leafResult += nodeValues * weights;
+            }
+
+            for (size_t p = 0; p < cluster.size(); ++p)
+                m_result.col(permutation[cluster.begin + p]) = leafResult.col(p);
+        }
+    }
+
+private:
+    const std::vector<int>& m_leaves;
+    const HierarchicalEvaluationData<ResultType>& m_data;
+    arma::Mat<ResultType>& m_result;
+};
+
+} // namespace
+
+template <typename ResultType>
+HierarchicalEvaluatorForIntegralOperators<ResultType>::
+HierarchicalEvaluatorForIntegralOperators(
+        std::auto_ptr<Base> evaluator,
+        double eta,
+        int interpolationOrder,
+        int maximumLeafSize,
+        const ParallelizationOptions& parallelizationOptions) :
+    m_evaluator(evaluator.release()),
+    m_eta(eta),
+    m_interpolationOrder(interpolationOrder),
+    m_maximumLeafSize(maximumLeafSize),
+    m_parallelizationOptions(parallelizationOptions)
+{
+    if (!m_evaluator)
+        throw std::invalid_argument(
+                "HierarchicalEvaluatorForIntegralOperators::"
+                "HierarchicalEvaluatorForIntegralOperators(): "
+                "evaluator must not be null");
+    if (eta <= 0. || interpolationOrder < 1 || maximumLeafSize < 1)
+        throw std::invalid_argument(
+                "HierarchicalEvaluatorForIntegralOperators::"
+                "HierarchicalEvaluatorForIntegralOperators(): "
+                "eta, interpolationOrder and maximumLeafSize must be positive");
+}
+
+template <typename ResultType>
+HierarchicalEvaluatorForIntegralOperators<ResultType>::
+~HierarchicalEvaluatorForIntegralOperators()
+{
+}
+
+template <typename ResultType>
+void HierarchicalEvaluatorForIntegralOperators<ResultType>::evaluate(
+        Region region,
+        const arma::Mat<CoordinateType>& points,
+        arma::Mat<ResultType>& result) const
+{
+    arma::Mat<CoordinateType> quadPoints;
+    m_evaluator->getQuadraturePoints(region, quadPoints);
+    if (quadPoints.n_rows != points.n_rows)
+        throw std::invalid_argument(
+                "HierarchicalEvaluatorForIntegralOperators::evaluate(): "
+                "evaluation points and quadrature points must have the same "
+                "number of coordinates");
+
+    // Small problems gain nothing from clustering
+    const size_t leafSize = m_maximumLeafSize;
+    if (points.n_cols <= leafSize || quadPoints.n_cols <= leafSize) {
+        m_evaluator->evaluate(region, points, result);
+        return;
+    }
+
+    // Find the number of components of the potential
+    {
+        arma::Mat<ResultType> empty;
+        m_evaluator->evaluateContribution(
+                    region, std::vector<int>(),
+                    arma::Mat<CoordinateType>(points.n_rows, 0), empty);
+        result.set_size(empty.n_rows, points.n_cols);
+    }
+
+    const PointClusterTree<CoordinateType> targetTree(points, leafSize);
+    const PointClusterTree<CoordinateType> sourceTree(quadPoints, leafSize);
+    const ChebyshevInterpolation<CoordinateType> interpolation(
+                points.n_rows, m_interpolationOrder);
+    InteractionLists lists(targetTree.clusters().size());
+    buildInteractionLists(targetTree, sourceTree, m_eta,
+                          interpolation.nodeCount(), lists);
+
+    HierarchicalEvaluationData<ResultType> data(
+                *m_evaluator, region, points, targetTree, sourceTree,
+                interpolation, lists);
+
+    // Sort the target clusters
+    std::vector<int> interpolatedTargets, leaves;
+    std::vector<std::vector<int> > clustersByLevel(targetTree.levelCount());
+    for (size_t c = 0; c < targetTree.clusters().size(); ++c) {
+        if (!lists.interpolated[c].empty())
+            interpolatedTargets.push_back(c);
+        if (targetTree.cluster(c).isLeaf())
+            leaves.push_back(c);
+        clustersByLevel[targetTree.cluster(c).level].push_back(c);
+    }
+
+    ScopedScheduler scheduler(m_parallelizationOptions);
+    Fiber::SerialBlasRegion blasRegion;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, interpolatedTargets.size()),
+                      FarFieldLoopBody<ResultType>(interpolatedTargets, data));
+    for (size_t level = 1; level < clustersByLevel.size(); ++level)
+        tbb::parallel_for(tbb::blocked_range<size_t>(
+                              0, clustersByLevel[level].size()),
+                          DownwardPassLoopBody<ResultType>(
+                              clustersByLevel[level], data));
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, leaves.size()),
+                      LeafLoopBody<ResultType>(leaves, data, result));
+}
+
+template <typename ResultType>
+void HierarchicalEvaluatorForIntegralOperators<ResultType>::getQuadraturePoints(
+        Region region, arma::Mat<CoordinateType>& quadPoints) const
+{
+    m_evaluator->getQuadraturePoints(region, quadPoints);
+}
+
+template <typename ResultType>
+void HierarchicalEvaluatorForIntegralOperators<ResultType>::evaluateContribution(
+        Region region,
+        const std::vector<int>& quadPointIndices,
+        const arma::Mat<CoordinateType>& points,
+        arma::Mat<ResultType>& result) const
+{
+    m_evaluator->evaluateContribution(region, quadPointIndices, points, result);
+}
+
+template <typename ResultType>
+void HierarchicalEvaluatorForIntegralOperators<ResultType>::evaluateLocalBasisContributions(
+        Region region, int element,
+        const arma::Mat<CoordinateType>& points,
+        std::vector<arma::Mat<ResultType> >& result) const
+{
+    m_evaluator->evaluateLocalBasisContributions(region, element, points,
+                                                 result);
+}
+
+template <typename ResultType>
+void HierarchicalEvaluatorForIntegralOperators<ResultType>::applyNearFieldCorrection(
+        const arma::Mat<CoordinateType>& points,
+        CoordinateType nearFieldDistance,
+        arma::Mat<ResultType>& result) const
+{
+    // evaluate() reproduces the far-field potential of the wrapped evaluator
+    // up to the approximation error, so the latter can apply the correction
+    m_evaluator->applyNearFieldCorrection(points, nearFieldDistance, result);
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(HierarchicalEvaluatorForIntegralOperators);
+
+} // namespace Fiber
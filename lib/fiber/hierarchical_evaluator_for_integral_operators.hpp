@@ -0,0 +1,120 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_hierarchical_evaluator_for_integral_operators_hpp
+#define fiber_hierarchical_evaluator_for_integral_operators_hpp
+
+#include "../common/common.hpp"
+
+#include "evaluator_for_integral_operators.hpp"
+#include "parallelization_options.hpp"
+
+#include "../common/armadillo_fwd.hpp"
+#include <boost/scoped_ptr.hpp>
+#include <memory>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Evaluator of potentials using hierarchical summation.
+ *
+ *  This evaluator wraps another evaluator (typically an instance of
+ *  DefaultEvaluatorForIntegralOperators), which must implement
+ *  getQuadraturePoints() and evaluateContribution(). The evaluation points
+ *  and the quadrature points of the wrapped evaluator are organised into
+ *  cluster trees. For each pair of well-separated clusters, the potential
+ *  generated by the quadrature points of one cluster is evaluated only at the
+ *  Chebyshev nodes of the bounding box of the other and interpolated from
+ *  them; these interpolants are then passed down the tree of evaluation
+ *  points. All the remaining (near-field) interactions are summed directly.
+ *
+ *  The cost of evaluating a potential at \f$N\f$ points generated by
+ *  \f$M\f$ quadrature points is thus roughly proportional to
+ *  \f$p^d (N + M) \log (N + M)\f$, where \f$p\f$ is the interpolation order
+ *  and \f$d\f$ the dimension of the space, rather than to \f$NM\f$. */
+template <typename ResultType>
+class HierarchicalEvaluatorForIntegralOperators :
+        public EvaluatorForIntegralOperators<ResultType>
+{
+public:
+    typedef EvaluatorForIntegralOperators<ResultType> Base;
+    typedef typename Base::CoordinateType CoordinateType;
+    typedef typename Base::Region Region;
+
+    /** \brief Constructor.
+     *
+     *  \param[in] evaluator
+     *    Evaluator used to compute the contributions of individual clusters
+     *    of quadrature points. This object takes ownership of it.
+     *  \param[in] eta
+     *    Cluster-pair admissibility parameter. A pair of clusters is
+     *    approximated by interpolation if the larger of their diameters does
+     *    not exceed \p eta times the distance between them.
+     *  \param[in] interpolationOrder
+     *    Number of Chebyshev nodes along each axis of a cluster's bounding
+     *    box.
+     *  \param[in] maximumLeafSize
+     *    Maximum number of points in a leaf cluster.
+     *  \param[in] parallelizationOptions
+     *    Options controlling the number of threads used during evaluation. */
+    HierarchicalEvaluatorForIntegralOperators(
+            std::auto_ptr<Base> evaluator,
+            double eta,
+            int interpolationOrder,
+            int maximumLeafSize,
+            const ParallelizationOptions& parallelizationOptions);
+
+    virtual ~HierarchicalEvaluatorForIntegralOperators();
+
+    virtual void evaluate(Region region,
+                          const arma::Mat<CoordinateType>& points,
+                          arma::Mat<ResultType>& result) const;
+
+    virtual void getQuadraturePoints(
+            Region region, arma::Mat<CoordinateType>& quadPoints) const;
+
+    virtual void evaluateContribution(
+            Region region,
+            const std::vector<int>& quadPointIndices,
+            const arma::Mat<CoordinateType>& points,
+            arma::Mat<ResultType>& result) const;
+
+    virtual void evaluateLocalBasisContributions(
+            Region region, int element,
+            const arma::Mat<CoordinateType>& points,
+            std::vector<arma::Mat<ResultType> >& result) const;
+
+    virtual void applyNearFieldCorrection(
+            const arma::Mat<CoordinateType>& points,
+            CoordinateType nearFieldDistance,
+            arma::Mat<ResultType>& result) const;
+
+private:
+    boost::scoped_ptr<Base> m_evaluator;
+    double m_eta;
+    int m_interpolationOrder;
+    int m_maximumLeafSize;
+    ParallelizationOptions m_parallelizationOptions;
+};
+
+} // namespace Fiber
+
+#endif
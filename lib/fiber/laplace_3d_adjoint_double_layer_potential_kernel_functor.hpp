@@ -65,16 +65,34 @@ public:
         assert(testGeomData.dimWorld() == coordCount);
         assert(result.size() == 1);
 
+        CoordinateType testGlobal[coordCount], trialGlobal[coordCount];
+        CoordinateType testNormal[coordCount];
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            testGlobal[coordIndex] = testGeomData.global(coordIndex);
+            trialGlobal[coordIndex] = trialGeomData.global(coordIndex);
+            testNormal[coordIndex] = testGeomData.normal(coordIndex);
+        }
+        result[0](0, 0) = evaluateScalar(testGlobal, testNormal, trialGlobal, 0);
+    }
+
+    /** \brief Return the value of the kernel at a single pair of points.
+     *
+     *  See DefaultCollectionOfKernels for the meaning of the arguments. */
+    ValueType evaluateScalar(
+            const CoordinateType* testGlobal,
+            const CoordinateType* testNormal,
+            const CoordinateType* trialGlobal,
+            const CoordinateType* /* trialNormal */) const {
+        const int coordCount = 3;
+
         CoordinateType numeratorSum = 0., distanceSq = 0.;
-        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex)
-        {
-            CoordinateType diff = testGeomData.global(coordIndex) -
-                    trialGeomData.global(coordIndex);
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            CoordinateType diff = testGlobal[coordIndex] - trialGlobal[coordIndex];
             distanceSq += diff * diff;
-            numeratorSum += diff * testGeomData.normal(coordIndex);
+            numeratorSum += diff * testNormal[coordIndex];
         }
         CoordinateType distance = sqrt(distanceSq);
-        result[0](0, 0) = -numeratorSum /
+        return -numeratorSum /
             (static_cast<CoordinateType>(4. * M_PI) * distanceSq * distance);
     }
 };
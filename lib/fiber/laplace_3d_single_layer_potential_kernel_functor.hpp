@@ -65,14 +65,30 @@ public:
         assert(testGeomData.dimWorld() == coordCount);
         assert(result.size() == 1);
 
-        ValueType sum = 0;
+        CoordinateType testGlobal[coordCount], trialGlobal[coordCount];
         for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
-            ValueType diff = testGeomData.global(coordIndex) -
-                    trialGeomData.global(coordIndex);
+            testGlobal[coordIndex] = testGeomData.global(coordIndex);
+            trialGlobal[coordIndex] = trialGeomData.global(coordIndex);
+        }
+        result[0](0, 0) = evaluateScalar(testGlobal, 0, trialGlobal, 0);
+    }
+
+    /** \brief Return the value of the kernel at a single pair of points.
+     *
+     *  See DefaultCollectionOfKernels for the meaning of the arguments. */
+    ValueType evaluateScalar(
+            const CoordinateType* testGlobal,
+            const CoordinateType* /* testNormal */,
+            const CoordinateType* trialGlobal,
+            const CoordinateType* /* trialNormal */) const {
+        const int coordCount = 3;
+
+        CoordinateType sum = 0;
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            CoordinateType diff = testGlobal[coordIndex] - trialGlobal[coordIndex];
             sum += diff * diff;
         }
-        result[0](0, 0) = static_cast<CoordinateType>(1. / (4. * M_PI)) /
-                sqrt(sum);
+        return static_cast<CoordinateType>(1. / (4. * M_PI)) / sqrt(sum);
     }
 };
 
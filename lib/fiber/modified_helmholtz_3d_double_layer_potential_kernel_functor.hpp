@@ -71,17 +71,37 @@ public:
             const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
             CollectionOf2dSlicesOfNdArrays<ValueType>& result) const {
         const int coordCount = 3;
+        assert(testGeomData.dimWorld() == coordCount);
+        assert(result.size() == 1);
+
+        CoordinateType testGlobal[coordCount], trialGlobal[coordCount];
+        CoordinateType trialNormal[coordCount];
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            testGlobal[coordIndex] = testGeomData.global(coordIndex);
+            trialGlobal[coordIndex] = trialGeomData.global(coordIndex);
+            trialNormal[coordIndex] = trialGeomData.normal(coordIndex);
+        }
+        result[0](0, 0) = evaluateScalar(testGlobal, 0, trialGlobal, trialNormal);
+    }
+
+    /** \brief Return the value of the kernel at a single pair of points.
+     *
+     *  See DefaultCollectionOfKernels for the meaning of the arguments. */
+    ValueType evaluateScalar(
+            const CoordinateType* testGlobal,
+            const CoordinateType* /* testNormal */,
+            const CoordinateType* trialGlobal,
+            const CoordinateType* trialNormal) const {
+        const int coordCount = 3;
 
         CoordinateType numeratorSum = 0., denominatorSum = 0.;
-        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex)
-        {
-            CoordinateType diff = trialGeomData.global(coordIndex) -
-                    testGeomData.global(coordIndex);
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            CoordinateType diff = trialGlobal[coordIndex] - testGlobal[coordIndex];
             denominatorSum += diff * diff;
-            numeratorSum += diff * trialGeomData.normal(coordIndex);
+            numeratorSum += diff * trialNormal[coordIndex];
         }
         CoordinateType distance = sqrt(denominatorSum);
-        result[0](0, 0) = -numeratorSum /
+        return -numeratorSum /
                 (static_cast<CoordinateType>(4.0 * M_PI) * denominatorSum) *
                 (m_waveNumber + static_cast<CoordinateType>(1.0) / distance) *
                 exp(-m_waveNumber * distance);
@@ -79,20 +79,77 @@ public:
             const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
             CollectionOf2dSlicesOfNdArrays<ValueType>& result) const {
         const int coordCount = 3;
+        assert(testGeomData.dimWorld() == coordCount);
+        assert(result.size() == 1);
+
+        CoordinateType testGlobal[coordCount],
+                trialGlobal[coordCount], trialNormal[coordCount];
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            testGlobal[coordIndex] = testGeomData.global(coordIndex);
+            trialGlobal[coordIndex] = trialGeomData.global(coordIndex);
+            trialNormal[coordIndex] = trialGeomData.normal(coordIndex);
+        }
+        result[0](0, 0) = evaluateScalar(testGlobal, 0, trialGlobal, trialNormal);
+    }
+
+    /** \brief Return the value of the kernel at a single pair of points.
+     *
+     *  See DefaultCollectionOfKernels for the meaning of the arguments. */
+    ValueType evaluateScalar(
+            const CoordinateType* testGlobal,
+            const CoordinateType* testNormal,
+            const CoordinateType* trialGlobal,
+            const CoordinateType* trialNormal) const {
+        CoordinateType distance;
+        ValueType factor;
+        evaluateDistanceAndFactor(testGlobal, testNormal, trialGlobal,
+                                  trialNormal, distance, factor);
+        return factor * m_interpolator.evaluate(distance);
+    }
+
+    /** \brief Evaluate the kernel at a sequence of point pairs.
+     *
+     *  See DefaultCollectionOfKernels for the meaning of the arguments. */
+    void evaluateScalars(
+            size_t pointCount,
+            const CoordinateType* testGlobals,
+            const CoordinateType* testNormals,
+            size_t testStride,
+            const CoordinateType* trialGlobals,
+            const CoordinateType* trialNormals,
+            size_t trialStride,
+            ValueType* result) const {
+        m_interpolator.evaluateAtPointPairs(
+                    pointCount,
+                    testGlobals, testNormals, testStride,
+                    trialGlobals, trialNormals, trialStride,
+                    *this, result);
+    }
+
+    /** \brief Compute the distance between a pair of points and the factor
+     *  multiplying the interpolated function in the kernel.
+     *
+     *  See HermiteInterpolator::evaluateAtPointPairs(). */
+    void evaluateDistanceAndFactor(
+            const CoordinateType* testGlobal,
+            const CoordinateType* /* testNormal */,
+            const CoordinateType* trialGlobal,
+            const CoordinateType* trialNormal,
+            CoordinateType& distance,
+            ValueType& factor) const {
+        const int coordCount = 3;
 
         CoordinateType numeratorSum = 0., distSq = 0.;
-        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex)
-        {
-            CoordinateType diff = trialGeomData.global(coordIndex) -
-                    testGeomData.global(coordIndex);
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            CoordinateType diff = trialGlobal[coordIndex] - testGlobal[coordIndex];
             distSq += diff * diff;
-            numeratorSum += diff * trialGeomData.normal(coordIndex);
+            numeratorSum += diff * trialNormal[coordIndex];
         }
         CoordinateType dist = sqrt(distSq);
-        ValueType v = m_interpolator.evaluate(dist);
-        result[0](0, 0) = numeratorSum /
+        distance = dist;
+        factor = numeratorSum /
             (static_cast<CoordinateType>(-4.0 * M_PI) * distSq * dist) *
-            (m_waveNumber * dist + static_cast<CoordinateType>(1.0)) * v;
+            (m_waveNumber * dist + static_cast<CoordinateType>(1.0));
     }
 
 private:
@@ -70,17 +70,34 @@ public:
             const ConstGeometricalDataSlice<CoordinateType>& trialGeomData,
             CollectionOf2dSlicesOfNdArrays<ValueType>& result) const {
         const int coordCount = 3;
+        assert(testGeomData.dimWorld() == coordCount);
+        assert(result.size() == 1);
+
+        CoordinateType testGlobal[coordCount], trialGlobal[coordCount];
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            testGlobal[coordIndex] = testGeomData.global(coordIndex);
+            trialGlobal[coordIndex] = trialGeomData.global(coordIndex);
+        }
+        result[0](0, 0) = evaluateScalar(testGlobal, 0, trialGlobal, 0);
+    }
+
+    /** \brief Return the value of the kernel at a single pair of points.
+     *
+     *  See DefaultCollectionOfKernels for the meaning of the arguments. */
+    ValueType evaluateScalar(
+            const CoordinateType* testGlobal,
+            const CoordinateType* /* testNormal */,
+            const CoordinateType* trialGlobal,
+            const CoordinateType* /* trialNormal */) const {
+        const int coordCount = 3;
 
         CoordinateType sum = 0;
-        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex)
-        {
-            CoordinateType diff = testGeomData.global(coordIndex) -
-                    trialGeomData.global(coordIndex);
+        for (int coordIndex = 0; coordIndex < coordCount; ++coordIndex) {
+            CoordinateType diff = testGlobal[coordIndex] - trialGlobal[coordIndex];
             sum += diff * diff;
         }
         CoordinateType distance = sqrt(sum);
-        result[0](0, 0) =
-                static_cast<CoordinateType>(1.0 / (4.0 * M_PI)) / distance *
+        return static_cast<CoordinateType>(1.0 / (4.0 * M_PI)) / distance *
                 exp(-m_waveNumber * distance);
     }
 
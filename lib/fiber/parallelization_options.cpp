@@ -26,7 +26,10 @@ namespace Fiber
 {
 
 ParallelizationOptions::ParallelizationOptions() :
-    m_openClEnabled(false), m_maxThreadCount(AUTO)
+    m_openClEnabled(false), m_maxThreadCount(AUTO),
+    m_hMatrixMultiplicationMode(OUTPUT_PARTITIONING),
+    m_elementDataCacheMemoryBudget(64 * 1024 * 1024),
+    m_threadPinning(false)
 {
     m_openClOptions.useOpenCl = false;
 }
@@ -65,4 +68,37 @@ int ParallelizationOptions::maxThreadCount() const {
     return m_maxThreadCount;
 }
 
+void ParallelizationOptions::setHMatrixMultiplicationMode(
+        HMatrixMultiplicationMode mode)
+{
+    if (mode != REDUCTION && mode != OUTPUT_PARTITIONING)
+        throw std::invalid_argument(
+                "ParallelizationOptions::setHMatrixMultiplicationMode(): "
+                "invalid mode");
+    m_hMatrixMultiplicationMode = mode;
+}
+
+ParallelizationOptions::HMatrixMultiplicationMode
+ParallelizationOptions::hMatrixMultiplicationMode() const {
+    return m_hMatrixMultiplicationMode;
+}
+
+void ParallelizationOptions::setElementDataCacheMemoryBudget(size_t budget)
+{
+    m_elementDataCacheMemoryBudget = budget;
+}
+
+size_t ParallelizationOptions::elementDataCacheMemoryBudget() const {
+    return m_elementDataCacheMemoryBudget;
+}
+
+void ParallelizationOptions::enableThreadPinning(bool value)
+{
+    m_threadPinning = value;
+}
+
+bool ParallelizationOptions::isThreadPinningEnabled() const {
+    return m_threadPinning;
+}
+
 } // namespace Fiber
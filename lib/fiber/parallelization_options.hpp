@@ -32,7 +32,19 @@ namespace Fiber
 class ParallelizationOptions
 {
 public:
-    enum { AUTO = -1 };    
+    enum { AUTO = -1 };
+
+    /** \brief Algorithms available for parallel H-matrix-vector products. */
+    enum HMatrixMultiplicationMode {
+        /** \brief Each thread accumulates the contributions of the blocks it
+         *  processes in a private copy of the output vector; these copies are
+         *  summed at the end. */
+        REDUCTION,
+        /** \brief The output vector is split into disjoint index ranges, each
+         *  of which is updated by a single thread. No temporary copies of the
+         *  output vector are made. */
+        OUTPUT_PARTITIONING
+    };
 
     /** \brief Constructor. */
     ParallelizationOptions();
@@ -60,10 +72,53 @@ public:
      *  Intel Threading Building Blocks. */
     int maxThreadCount() const;
 
+    /** \brief Set the algorithm used to parallelise H-matrix-vector products.
+     *
+     *  By default, \p OUTPUT_PARTITIONING is used. H-matrices whose
+     *  off-diagonal blocks are neither general dense nor low-rank are always
+     *  multiplied using the \p REDUCTION algorithm.
+     *
+     *  Both algorithms support non-symmetric, symmetric and Hermitian
+     *  H-matrices. In the latter two cases each stored off-diagonal block is
+     *  applied both directly and as its (conjugate) transpose. */
+    void setHMatrixMultiplicationMode(HMatrixMultiplicationMode mode);
+
+    /** \brief Return the algorithm used to parallelise H-matrix-vector
+     *  products. */
+    HMatrixMultiplicationMode hMatrixMultiplicationMode() const;
+
+    /** \brief Set the memory budget of the element data caches.
+     *
+     *  During the assembly of integral operators, the geometrical data and
+     *  the values of transformed basis functions at the quadrature points of
+     *  each element are cached so that they need not be recalculated each
+     *  time the element is visited by a thread. \p budget is the maximum
+     *  amount of memory (in bytes) occupied by each of the two caches (for
+     *  test and trial elements) of a local assembler. Set it to 0 to disable
+     *  caching.
+     *
+     *  By default, the budget is 64 MB. */
+    void setElementDataCacheMemoryBudget(size_t budget);
+
+    /** \brief Return the memory budget of the element data caches. */
+    size_t elementDataCacheMemoryBudget() const;
+
+    /** \brief Enable or disable binding of threads to processor cores.
+     *
+     *  This setting is only taken into account by ThreadPool::initialize().
+     *  By default, threads are not pinned. */
+    void enableThreadPinning(bool value = true);
+
+    /** \brief Return whether threads should be bound to processor cores. */
+    bool isThreadPinningEnabled() const;
+
 private:
     bool m_openClEnabled;
     OpenClOptions m_openClOptions;
     int m_maxThreadCount;
+    HMatrixMultiplicationMode m_hMatrixMultiplicationMode;
+    size_t m_elementDataCacheMemoryBudget;
+    bool m_threadPinning;
 };
 
 } // namespace Fiber
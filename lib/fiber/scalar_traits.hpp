@@ -34,8 +34,10 @@ namespace Fiber
  *  This struct is specialized for the scalar types \c float, \c double,
  *  <tt>std::complex<float></tt> and <tt>std::complex<double></tt>. Each
  *  specialization <tt>ScalarTraits<T></tt> provides the typedefs \c RealType
- *  (denoting the real type of the same precision as \c T) and \c ComplexType
- *  (denoting the complex type of the same precision as \c T). */
+ *  (denoting the real type of the same precision as \c T), \c ComplexType
+ *  (denoting the complex type of the same precision as \c T) and
+ *  \c SinglePrecisionType (denoting the single-precision type that is real if
+ *  \c T is real and complex if \c T is complex). */
 template <typename T>
 struct ScalarTraits
 {
@@ -49,6 +51,7 @@ struct ScalarTraits<float>
 {
     typedef float RealType;
     typedef std::complex<float> ComplexType;
+    typedef float SinglePrecisionType;
 };
 
 template <>
@@ -56,6 +59,7 @@ struct ScalarTraits<double>
 {
     typedef double RealType;
     typedef std::complex<double> ComplexType;
+    typedef float SinglePrecisionType;
 };
 
 template <>
@@ -63,6 +67,7 @@ struct ScalarTraits<std::complex<float> >
 {
     typedef float RealType;
     typedef std::complex<float> ComplexType;
+    typedef std::complex<float> SinglePrecisionType;
 };
 
 template <>
@@ -70,6 +75,7 @@ struct ScalarTraits<std::complex<double> >
 {
     typedef double RealType;
     typedef std::complex<double> ComplexType;
+    typedef std::complex<float> SinglePrecisionType;
 };
 
 /** \brief "Larger" of the types U and V. */
@@ -25,8 +25,11 @@
 
 #include "bempp/common/config_opencl.hpp"
 
+#include "element_data_cache.hpp"
 #include "test_kernel_trial_integrator.hpp"
 
+#include <memory>
+
 namespace Fiber
 {
 
@@ -37,6 +40,7 @@ template <typename ValueType> class CollectionOfKernels;
 template <typename CoordinateType> class RawGridGeometry;
 template <typename BasisFunctionType, typename KernelType, typename ResultType>
 class TestKernelTrialIntegral;
+template <typename ValueType> struct BasisData;
 /** \endcond */
 
 /** \brief Integration over pairs of elements on tensor-product point grids. */
@@ -49,7 +53,17 @@ public:
     typedef TestKernelTrialIntegrator<BasisFunctionType, KernelType, ResultType> Base;
     typedef typename Base::CoordinateType CoordinateType;
     typedef typename Base::ElementIndexPair ElementIndexPair;
-
+    typedef ElementDataCache<BasisFunctionType, CoordinateType> ElementDataCacheType;
+
+    /** \brief Constructor.
+     *
+     *  If \p testElementDataCache or \p trialElementDataCache is not null,
+     *  geometrical data and transformed basis function values of test or
+     *  trial elements are looked up in (and stored into) the respective cache
+     *  under the quadrature order \p testQuadOrder or \p trialQuadOrder.
+     *  All integrators sharing a cache must use the same transformations,
+     *  kernels and integral and the same quadrature points for a given
+     *  element and order. The caches must outlive the integrator. */
     SeparableNumericalTestKernelTrialIntegrator(
             const arma::Mat<CoordinateType>& localTestQuadPoints,
             const arma::Mat<CoordinateType>& localTrialQuadPoints,
@@ -63,7 +77,11 @@ public:
             const CollectionOfKernels<KernelType>& kernels,
             const CollectionOfBasisTransformations<CoordinateType>& trialTransformations,
             const TestKernelTrialIntegral<BasisFunctionType, KernelType, ResultType>& integral,
-            const OpenClHandler& openClHandler);
+            const OpenClHandler& openClHandler,
+            ElementDataCacheType* testElementDataCache = 0,
+            ElementDataCacheType* trialElementDataCache = 0,
+            int testQuadOrder = -1,
+            int trialQuadOrder = -1);
 
     virtual ~SeparableNumericalTestKernelTrialIntegrator ();
 
@@ -113,6 +131,31 @@ private:
             const Basis<BasisFunctionType>& trialBasis,
             const std::vector<arma::Mat<ResultType>*>& result) const;
 
+    typedef ElementData<BasisFunctionType, CoordinateType> ElementDataType;
+    typedef typename GeometryFactory::Geometry Geometry;
+
+    /** \brief Return geometrical data and values of all transformed basis
+     *  functions of a single element.
+     *
+     *  The data are taken from \p cache if possible. Otherwise they are
+     *  calculated into \p scratch (allocated if necessary) and then, if
+     *  \p cache is not null and its memory budget allows it, moved into the
+     *  cache. \p basisData is evaluated on first use only, as indicated by
+     *  \p basisDataReady. */
+    const ElementDataType& getElementData(
+            ElementDataCacheType* cache,
+            int quadOrder,
+            int elementIndex,
+            const Basis<BasisFunctionType>& basis,
+            const arma::Mat<CoordinateType>& localQuadPoints,
+            const CollectionOfBasisTransformations<CoordinateType>& transformations,
+            size_t basisDeps, size_t geomDeps,
+            const RawGridGeometry<CoordinateType>& rawGeometry,
+            Geometry& geometry,
+            BasisData<BasisFunctionType>& basisData,
+            bool& basisDataReady,
+            std::auto_ptr<ElementDataType>& scratch) const;
+
     /**
      * \brief Returns an OpenCL code snippet containing the clIntegrate
      *   kernel function for integrating a single row or column
@@ -136,6 +179,11 @@ private:
 
     const OpenClHandler& m_openClHandler;
 
+    ElementDataCacheType* m_testElementDataCache;
+    ElementDataCacheType* m_trialElementDataCache;
+    int m_testQuadOrder;
+    int m_trialQuadOrder;
+
 #ifdef WITH_OPENCL
     cl::Buffer *clTestQuadPoints;
     cl::Buffer *clTrialQuadPoints;
@@ -65,7 +65,11 @@ SeparableNumericalTestKernelTrialIntegrator(
         const CollectionOfKernels<KernelType>& kernels,
         const CollectionOfBasisTransformations<CoordinateType>& trialTransformations,
         const TestKernelTrialIntegral<BasisFunctionType, KernelType, ResultType>& integral,
-        const OpenClHandler& openClHandler) :
+        const OpenClHandler& openClHandler,
+        ElementDataCacheType* testElementDataCache,
+        ElementDataCacheType* trialElementDataCache,
+        int testQuadOrder,
+        int trialQuadOrder) :
     m_localTestQuadPoints(localTestQuadPoints),
     m_localTrialQuadPoints(localTrialQuadPoints),
     m_testQuadWeights(testQuadWeights),
@@ -78,7 +82,11 @@ SeparableNumericalTestKernelTrialIntegrator(
     m_kernels(kernels),
     m_trialTransformations(trialTransformations),
     m_integral(integral),
-    m_openClHandler(openClHandler)
+    m_openClHandler(openClHandler),
+    m_testElementDataCache(testElementDataCache),
+    m_trialElementDataCache(trialElementDataCache),
+    m_testQuadOrder(testQuadOrder),
+    m_trialQuadOrder(trialQuadOrder)
 {
     if (localTestQuadPoints.n_cols != testQuadWeights.size())
         throw std::invalid_argument("SeparableNumericalTestKernelTrialIntegrator::"
@@ -175,9 +183,6 @@ integrateCpu(
     const int testDofCount = callVariant == TEST_TRIAL ? dofCountA : dofCountB;
     const int trialDofCount = callVariant == TEST_TRIAL ? dofCountB : dofCountA;
 
-    BasisData<BasisFunctionType> testBasisData, trialBasisData;
-    GeometricalData<CoordinateType> testGeomData, trialGeomData;
-
     size_t testBasisDeps = 0, trialBasisDeps = 0;
     size_t testGeomDeps = 0, trialGeomDeps = 0;
 
@@ -186,15 +191,32 @@ integrateCpu(
     m_kernels.addGeometricalDependencies(testGeomDeps, trialGeomDeps);
     m_integral.addGeometricalDependencies(testGeomDeps, trialGeomDeps);
 
-    typedef typename GeometryFactory::Geometry Geometry;
     std::auto_ptr<Geometry> geometryA, geometryB;
     const RawGridGeometry<CoordinateType> *rawGeometryA = 0, *rawGeometryB = 0;
+    const arma::Mat<CoordinateType> *localQuadPointsA = 0, *localQuadPointsB = 0;
+    const CollectionOfBasisTransformations<CoordinateType>
+            *transformationsA = 0, *transformationsB = 0;
+    size_t basisDepsA = 0, basisDepsB = 0, geomDepsA = 0, geomDepsB = 0;
+    ElementDataCacheType *cacheA = 0, *cacheB = 0;
+    int quadOrderA = -1, quadOrderB = -1;
     if (callVariant == TEST_TRIAL)
     {
         geometryA = m_testGeometryFactory.make();
         geometryB = m_trialGeometryFactory.make();
         rawGeometryA = &m_testRawGeometry;
         rawGeometryB = &m_trialRawGeometry;
+        localQuadPointsA = &m_localTestQuadPoints;
+        localQuadPointsB = &m_localTrialQuadPoints;
+        transformationsA = &m_testTransformations;
+        transformationsB = &m_trialTransformations;
+        basisDepsA = testBasisDeps;
+        basisDepsB = trialBasisDeps;
+        geomDepsA = testGeomDeps;
+        geomDepsB = trialGeomDeps;
+        cacheA = m_testElementDataCache;
+        cacheB = m_trialElementDataCache;
+        quadOrderA = m_testQuadOrder;
+        quadOrderB = m_trialQuadOrder;
     }
     else
     {
@@ -202,9 +224,20 @@ integrateCpu(
         geometryB = m_testGeometryFactory.make();
         rawGeometryA = &m_trialRawGeometry;
         rawGeometryB = &m_testRawGeometry;
+        localQuadPointsA = &m_localTrialQuadPoints;
+        localQuadPointsB = &m_localTestQuadPoints;
+        transformationsA = &m_trialTransformations;
+        transformationsB = &m_testTransformations;
+        basisDepsA = trialBasisDeps;
+        basisDepsB = testBasisDeps;
+        geomDepsA = trialGeomDeps;
+        geomDepsB = testGeomDeps;
+        cacheA = m_trialElementDataCache;
+        cacheB = m_testElementDataCache;
+        quadOrderA = m_trialQuadOrder;
+        quadOrderB = m_testQuadOrder;
     }
 
-    CollectionOf3dArrays<BasisFunctionType> testValues, trialValues;
     CollectionOf4dArrays<KernelType> kernelValues;
 
     for (size_t i = 0; i < result.size(); ++i) {
@@ -212,45 +245,97 @@ integrateCpu(
         result[i]->set_size(testDofCount, trialDofCount);
     }
 
-    rawGeometryB->setupGeometry(elementIndexB, *geometryB);
-    if (callVariant == TEST_TRIAL)
-    {
-        basisA.evaluate(testBasisDeps, m_localTestQuadPoints, ALL_DOFS, testBasisData);
-        basisB.evaluate(trialBasisDeps, m_localTrialQuadPoints, localDofIndexB, trialBasisData);
-        geometryB->getData(trialGeomDeps, m_localTrialQuadPoints, trialGeomData);
-        m_trialTransformations.evaluate(trialBasisData, trialGeomData, trialValues);
-    }
+    BasisData<BasisFunctionType> basisDataA, basisDataB;
+    bool basisDataAReady = false, basisDataBReady = false;
+    std::auto_ptr<ElementDataType> scratchA, scratchB;
+
+    // Only the data of all basis functions are cached
+    const ElementDataType* dataB = 0;
+    if (localDofIndexB == ALL_DOFS)
+        dataB = &getElementData(cacheB, quadOrderB, elementIndexB, basisB,
+                                *localQuadPointsB, *transformationsB,
+                                basisDepsB, geomDepsB, *rawGeometryB, *geometryB,
+                                basisDataB, basisDataBReady, scratchB);
     else
     {
-        basisA.evaluate(trialBasisDeps, m_localTrialQuadPoints, ALL_DOFS, trialBasisData);
-        basisB.evaluate(testBasisDeps, m_localTestQuadPoints, localDofIndexB, testBasisData);
-        geometryB->getData(testGeomDeps, m_localTestQuadPoints, testGeomData);
-        m_testTransformations.evaluate(testBasisData, testGeomData, testValues);
+        scratchB.reset(new ElementDataType);
+        basisB.evaluate(basisDepsB, *localQuadPointsB, localDofIndexB, basisDataB);
+        rawGeometryB->setupGeometry(elementIndexB, *geometryB);
+        geometryB->getData(geomDepsB, *localQuadPointsB, scratchB->geomData);
+        transformationsB->evaluate(basisDataB, scratchB->geomData,
+                                   scratchB->transformedBasisValues);
+        dataB = scratchB.get();
     }
 
     // Iterate over the elements
     for (int indexA = 0; indexA < elementACount; ++indexA)
     {
-        rawGeometryA->setupGeometry(elementIndicesA[indexA], *geometryA);
-        if (callVariant == TEST_TRIAL)
-        {
-            geometryA->getData(testGeomDeps, m_localTestQuadPoints, testGeomData);
-            m_testTransformations.evaluate(testBasisData, testGeomData, testValues);
-        }
-        else
-        {
-            geometryA->getData(trialGeomDeps, m_localTrialQuadPoints, trialGeomData);
-            m_trialTransformations.evaluate(trialBasisData, trialGeomData, trialValues);
-        }
-
-        m_kernels.evaluateOnGrid(testGeomData, trialGeomData, kernelValues);
+        const ElementDataType& dataA = getElementData(
+                    cacheA, quadOrderA, elementIndicesA[indexA], basisA,
+                    *localQuadPointsA, *transformationsA,
+                    basisDepsA, geomDepsA, *rawGeometryA, *geometryA,
+                    basisDataA, basisDataAReady, scratchA);
+        const ElementDataType& testData =
+                callVariant == TEST_TRIAL ? dataA : *dataB;
+        const ElementDataType& trialData =
+                callVariant == TEST_TRIAL ? *dataB : dataA;
+
+        m_kernels.evaluateOnGrid(testData.geomData, trialData.geomData,
+                                 kernelValues);
         m_integral.evaluateWithTensorQuadratureRule(
-                    testGeomData, trialGeomData, testValues, trialValues,
+                    testData.geomData, trialData.geomData,
+                    testData.transformedBasisValues,
+                    trialData.transformedBasisValues,
                     kernelValues, m_testQuadWeights, m_trialQuadWeights,
                     *result[indexA]);
     }
 }
 
+template <typename BasisFunctionType, typename KernelType,
+          typename ResultType, typename GeometryFactory>
+const typename SeparableNumericalTestKernelTrialIntegrator<
+BasisFunctionType, KernelType, ResultType, GeometryFactory>::ElementDataType&
+SeparableNumericalTestKernelTrialIntegrator<
+BasisFunctionType, KernelType, ResultType, GeometryFactory>::
+getElementData(
+        ElementDataCacheType* cache,
+        int quadOrder,
+        int elementIndex,
+        const Basis<BasisFunctionType>& basis,
+        const arma::Mat<CoordinateType>& localQuadPoints,
+        const CollectionOfBasisTransformations<CoordinateType>& transformations,
+        size_t basisDeps, size_t geomDeps,
+        const RawGridGeometry<CoordinateType>& rawGeometry,
+        Geometry& geometry,
+        BasisData<BasisFunctionType>& basisData,
+        bool& basisDataReady,
+        std::auto_ptr<ElementDataType>& scratch) const
+{
+    if (cache) {
+        if (const ElementDataType* data = cache->find(elementIndex, quadOrder))
+            return *data;
+    }
+
+    if (!basisDataReady) {
+        basis.evaluate(basisDeps, localQuadPoints, ALL_DOFS, basisData);
+        basisDataReady = true;
+    }
+    if (!scratch.get())
+        scratch.reset(new ElementDataType);
+    rawGeometry.setupGeometry(elementIndex, geometry);
+    geometry.getData(geomDeps, localQuadPoints, scratch->geomData);
+    transformations.evaluate(basisData, scratch->geomData,
+                             scratch->transformedBasisValues);
+
+    if (cache) {
+        // On success, the cache takes ownership of the scratch data
+        if (const ElementDataType* data =
+                cache->insert(elementIndex, quadOrder, scratch))
+            return *data;
+    }
+    return *scratch;
+}
+
 template <typename BasisFunctionType, typename KernelType,
           typename ResultType, typename GeometryFactory>
 void
@@ -633,7 +718,7 @@ integrateCpu(
     const int trialDofCount = trialBasis.size();
 
     BasisData<BasisFunctionType> testBasisData, trialBasisData;
-    GeometricalData<CoordinateType> testGeomData, trialGeomData;
+    bool testBasisDataReady = false, trialBasisDataReady = false;
 
     size_t testBasisDeps = 0, trialBasisDeps = 0;
     size_t testGeomDeps = 0, trialGeomDeps = 0;
@@ -643,11 +728,10 @@ integrateCpu(
     m_kernels.addGeometricalDependencies(testGeomDeps, trialGeomDeps);
     m_integral.addGeometricalDependencies(testGeomDeps, trialGeomDeps);
 
-    typedef typename GeometryFactory::Geometry Geometry;
     std::auto_ptr<Geometry> testGeometry(m_testGeometryFactory.make());
     std::auto_ptr<Geometry> trialGeometry(m_trialGeometryFactory.make());
 
-    CollectionOf3dArrays<BasisFunctionType> testValues, trialValues;
+    std::auto_ptr<ElementDataType> testScratch, trialScratch;
     CollectionOf4dArrays<KernelType> kernelValues;
 
     for (size_t i = 0; i < result.size(); ++i) {
@@ -655,22 +739,30 @@ integrateCpu(
         result[i]->set_size(testDofCount, trialDofCount);
     }
 
-    testBasis.evaluate(testBasisDeps, m_localTestQuadPoints, ALL_DOFS, testBasisData);
-    trialBasis.evaluate(trialBasisDeps, m_localTrialQuadPoints, ALL_DOFS, trialBasisData);
-
     // Iterate over the elements
     for (int pairIndex = 0; pairIndex < geometryPairCount; ++pairIndex)
     {
-        m_testRawGeometry.setupGeometry(elementIndexPairs[pairIndex].first, *testGeometry);
-        m_trialRawGeometry.setupGeometry(elementIndexPairs[pairIndex].second, *trialGeometry);
-        testGeometry->getData(testGeomDeps, m_localTestQuadPoints, testGeomData);
-        trialGeometry->getData(trialGeomDeps, m_localTrialQuadPoints, trialGeomData);
-        m_testTransformations.evaluate(testBasisData, testGeomData, testValues);
-        m_trialTransformations.evaluate(trialBasisData, trialGeomData, trialValues);
-
-        m_kernels.evaluateOnGrid(testGeomData, trialGeomData, kernelValues);
+        const ElementDataType& testData = getElementData(
+                    m_testElementDataCache, m_testQuadOrder,
+                    elementIndexPairs[pairIndex].first, testBasis,
+                    m_localTestQuadPoints, m_testTransformations,
+                    testBasisDeps, testGeomDeps, m_testRawGeometry,
+                    *testGeometry, testBasisData, testBasisDataReady,
+                    testScratch);
+        const ElementDataType& trialData = getElementData(
+                    m_trialElementDataCache, m_trialQuadOrder,
+                    elementIndexPairs[pairIndex].second, trialBasis,
+                    m_localTrialQuadPoints, m_trialTransformations,
+                    trialBasisDeps, trialGeomDeps, m_trialRawGeometry,
+                    *trialGeometry, trialBasisData, trialBasisDataReady,
+                    trialScratch);
+
+        m_kernels.evaluateOnGrid(testData.geomData, trialData.geomData,
+                                 kernelValues);
         m_integral.evaluateWithTensorQuadratureRule(
-                    testGeomData, trialGeomData, testValues, trialValues,
+                    testData.geomData, trialData.geomData,
+                    testData.transformedBasisValues,
+                    trialData.transformedBasisValues,
                     kernelValues, m_testQuadWeights, m_trialQuadWeights,
                     *result[pairIndex]);
     }
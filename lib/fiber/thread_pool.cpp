@@ -0,0 +1,193 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "thread_pool.hpp"
+
+#include "parallelization_options.hpp"
+
+#include <stdexcept>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+#include <tbb/task_scheduler_init.h>
+#include <tbb/task_scheduler_observer.h>
+#include <tbb/tbb_thread.h>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace Fiber
+{
+
+namespace
+{
+
+#ifdef __linux__
+// Return the indices of the CPUs contained in cpuSet
+std::vector<int> cpusInSet(const cpu_set_t& cpuSet)
+{
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &cpuSet))
+            cpus.push_back(cpu);
+    return cpus;
+}
+#endif
+
+// Index of the CPU to which the next thread will be bound, shared by all
+// pools initialized during the lifetime of the process so that threads
+// started by successive pools do not all land on the same CPUs
+tbb::atomic<unsigned int> nextCpuIndex;
+
+/** \brief Binds each thread entering the TBB scheduler to a separate CPU.
+ *
+ *  The CPUs are chosen round-robin from those the thread owning the
+ *  ThreadPool was allowed to run on when the pool was initialized. Worker
+ *  threads and the owner of the pool are pinned; other application threads
+ *  starting parallel operations of their own are left alone. */
+class PinningObserver : public tbb::task_scheduler_observer
+{
+public:
+    PinningObserver(const std::vector<int>& cpus, tbb::tbb_thread::id owner) :
+        m_cpus(cpus), m_owner(owner) {
+        observe(true);
+    }
+
+    virtual ~PinningObserver() {
+        observe(false);
+    }
+
+    virtual void on_scheduler_entry(bool isWorker) {
+#ifdef __linux__
+        if (m_cpus.empty())
+            return;
+        if (!isWorker && tbb::this_tbb_thread::get_id() != m_owner)
+            return;
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(m_cpus[nextCpuIndex++ % m_cpus.size()], &cpuSet);
+        // Failure is not fatal: the thread simply remains unpinned
+        sched_setaffinity(0 /* calling thread */, sizeof(cpuSet), &cpuSet);
+#endif
+    }
+
+private:
+    const std::vector<int> m_cpus;
+    const tbb::tbb_thread::id m_owner;
+};
+
+struct ThreadPoolState
+{
+    ThreadPoolState() : ownerCpuSetSaved(false) {}
+
+    // The observer must be destroyed before the scheduler
+    boost::scoped_ptr<tbb::task_scheduler_init> scheduler;
+    boost::scoped_ptr<PinningObserver> observer;
+    tbb::tbb_thread::id owner;
+#ifdef __linux__
+    // Affinity mask of the owner before it was pinned, restored by
+    // ThreadPool::finalize()
+    cpu_set_t ownerCpuSet;
+#endif
+    bool ownerCpuSetSaved;
+};
+
+tbb::mutex threadPoolMutex;
+
+ThreadPoolState& threadPoolState()
+{
+    static ThreadPoolState state;
+    return state;
+}
+
+} // namespace
+
+void ThreadPool::initialize(const ParallelizationOptions& options)
+{
+    tbb::mutex::scoped_lock lock(threadPoolMutex);
+    ThreadPoolState& state = threadPoolState();
+    if (state.scheduler)
+        throw std::runtime_error("ThreadPool::initialize(): "
+                                 "thread pool is already initialized");
+    state.owner = tbb::this_tbb_thread::get_id();
+    state.scheduler.reset(new tbb::task_scheduler_init(
+                              ScopedScheduler::requestedThreadCount(options)));
+    if (options.isThreadPinningEnabled()) {
+        std::vector<int> cpus;
+#ifdef __linux__
+        state.ownerCpuSetSaved =
+                sched_getaffinity(0 /* calling thread */,
+                                  sizeof(state.ownerCpuSet),
+                                  &state.ownerCpuSet) == 0;
+        if (state.ownerCpuSetSaved)
+            cpus = cpusInSet(state.ownerCpuSet);
+#endif
+        state.observer.reset(new PinningObserver(cpus, state.owner));
+    }
+}
+
+void ThreadPool::finalize()
+{
+    tbb::mutex::scoped_lock lock(threadPoolMutex);
+    ThreadPoolState& state = threadPoolState();
+    if (!state.scheduler)
+        return;
+    if (state.owner != tbb::this_tbb_thread::get_id())
+        throw std::runtime_error("ThreadPool::finalize(): "
+                                 "thread pool must be finalized by the thread "
+                                 "that initialized it");
+    state.observer.reset();
+    state.scheduler.reset();
+#ifdef __linux__
+    if (state.ownerCpuSetSaved)
+        sched_setaffinity(0 /* calling thread */, sizeof(state.ownerCpuSet),
+                          &state.ownerCpuSet);
+#endif
+    state.ownerCpuSetSaved = false;
+}
+
+bool ThreadPool::isInitialized()
+{
+    tbb::mutex::scoped_lock lock(threadPoolMutex);
+    return threadPoolState().scheduler.get() != 0;
+}
+
+ScopedScheduler::ScopedScheduler(const ParallelizationOptions& options) :
+    // If the calling thread already has an active scheduler (in particular,
+    // if it owns the ThreadPool), this only increments its reference count
+    m_scheduler(new tbb::task_scheduler_init(requestedThreadCount(options)))
+{
+}
+
+ScopedScheduler::~ScopedScheduler()
+{
+}
+
+int ScopedScheduler::requestedThreadCount(const ParallelizationOptions& options)
+{
+    if (options.isOpenClEnabled())
+        return 1;
+    if (options.maxThreadCount() == ParallelizationOptions::AUTO)
+        return tbb::task_scheduler_init::automatic;
+    return options.maxThreadCount();
+}
+
+} // namespace Fiber
@@ -0,0 +1,115 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef fiber_thread_pool_hpp
+#define fiber_thread_pool_hpp
+
+#include "../common/common.hpp"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+/** \cond FORWARD_DECL */
+namespace tbb
+{
+class task_scheduler_init;
+} // namespace tbb
+/** \endcond */
+
+namespace Fiber
+{
+
+/** \cond FORWARD_DECL */
+class ParallelizationOptions;
+/** \endcond */
+
+/** \brief Library-wide persistent pool of worker threads.
+ *
+ *  By default, each parallel operation of BEM++ (assembly, evaluation of
+ *  potentials, H-matrix-vector products etc.) initialises the Intel TBB
+ *  scheduler on entry and shuts it down on exit, which involves starting and
+ *  stopping the worker threads. Calling initialize() keeps the scheduler,
+ *  and hence the worker threads, alive until finalize() is called, so that
+ *  this cost is paid only once. This is particularly beneficial for
+ *  iterative solvers, which perform many matrix-vector products.
+ *
+ *  While the pool is active, the number of threads used by parallel
+ *  operations started from the thread that called initialize() is fixed by
+ *  the options passed to initialize(); the thread counts stored in the
+ *  options of individual operators are ignored.
+ *
+ *  Both initialize() and finalize() must be called from the same thread,
+ *  normally the main thread of the program. */
+class ThreadPool : boost::noncopyable
+{
+public:
+    /** \brief Start the persistent thread pool.
+     *
+     *  The number of threads is taken from
+     *  ParallelizationOptions::maxThreadCount(). If
+     *  ParallelizationOptions::isThreadPinningEnabled() returns true, the
+     *  worker threads and the calling thread are bound to separate CPUs,
+     *  chosen round-robin from those the calling thread may run on (this is
+     *  currently supported only on Linux).
+     *
+     *  An exception is thrown if the pool has already been initialized. */
+    static void initialize(const ParallelizationOptions& options);
+
+    /** \brief Stop the persistent thread pool.
+     *
+     *  Does nothing if the pool is not active. An exception is thrown if this
+     *  function is called from a thread different from the one that called
+     *  initialize(). If threads were pinned, the original CPU affinity of
+     *  the calling thread is restored. */
+    static void finalize();
+
+    /** \brief Return true if the persistent thread pool is active. */
+    static bool isInitialized();
+};
+
+/** \brief Scoped initialisation of the TBB scheduler.
+ *
+ *  An object of this class should be constructed at the beginning of each
+ *  parallel operation. If the calling thread owns the persistent
+ *  ThreadPool, its construction is essentially free. Otherwise it starts
+ *  the TBB scheduler with the number of threads requested in the options
+ *  passed to the constructor and stops it on destruction. */
+class ScopedScheduler : boost::noncopyable
+{
+public:
+    /** \brief Constructor. */
+    explicit ScopedScheduler(const ParallelizationOptions& options);
+
+    /** \brief Destructor. */
+    ~ScopedScheduler();
+
+    /** \brief Return the number of threads requested by \p options, in the
+     *  form expected by the constructor of tbb::task_scheduler_init.
+     *
+     *  If OpenCL is enabled, 1 is returned. */
+    static int requestedThreadCount(const ParallelizationOptions& options);
+
+private:
+    boost::scoped_ptr<tbb::task_scheduler_init> m_scheduler;
+};
+
+} // namespace Fiber
+
+#endif
@@ -28,9 +28,13 @@
 #include "concrete_index_set.hpp"
 #include "concrete_range_entity_iterator.hpp"
 #include "concrete_vtk_writer.hpp"
+#include "flat_grid_data.hpp"
 #include "geometry_type.hpp"
 #include "reverse_element_mapper.hpp"
 
+#include <boost/scoped_ptr.hpp>
+#include <tbb/mutex.h>
+
 namespace Bempp
 {
 
@@ -44,6 +48,8 @@ private:
     ConcreteElementMapper<DuneGridView> m_element_mapper;
     mutable ReverseElementMapper m_reverse_element_mapper;
     mutable bool m_reverse_element_mapper_is_up_to_date;
+    mutable boost::scoped_ptr<FlatGridData> m_flat_grid_data;
+    mutable tbb::mutex m_flat_grid_data_mutex;
 
 public:
     /** \brief Constructor */
@@ -108,6 +114,17 @@ public:
         return m_reverse_element_mapper;
     }
 
+    virtual const FlatGridData& flatGridData() const {
+        tbb::mutex::scoped_lock lock(m_flat_grid_data_mutex);
+        if (!m_flat_grid_data)
+        {
+            boost::scoped_ptr<FlatGridData> data(new FlatGridData);
+            fillFlatGridData(*data);
+            m_flat_grid_data.swap(data);
+        }
+        return *m_flat_grid_data;
+    }
+
     virtual std::auto_ptr<VtkWriter> vtkWriter(Dune::VTK::DataMode dm=Dune::VTK::conforming) const {
         return std::auto_ptr<VtkWriter>(new ConcreteVtkWriter<DuneGridView>(m_dune_gv, dm));
     }
@@ -162,6 +179,8 @@ private:
     void getRawElementDataImpl(arma::Mat<CoordinateType>& vertices,
                                arma::Mat<int>& elementCorners,
                                arma::Mat<char>& auxData) const;
+
+    void fillFlatGridData(FlatGridData& data) const;
 };
 
 } // namespace Bempp
@@ -101,4 +101,106 @@ void ConcreteGridView<DuneGridView>::getRawElementDataImpl(
     auxData.set_size(0, elementCorners.n_cols);
 }
 
+template <typename DuneGridView>
+void ConcreteGridView<DuneGridView>::fillFlatGridData(FlatGridData& data) const
+{
+    typedef typename DuneGridView::Grid DuneGrid;
+    typedef typename DuneGridView::IndexSet DuneIndexSet;
+    const int dimGrid = DuneGrid::dimension;
+    const int dimWorld = DuneGrid::dimensionworld;
+    const int codimVertex = dimGrid;
+    const int codimEdge = dimGrid - 1; // only used if dimGrid >= 2
+    const int codimElement = 0;
+    typedef Dune::MultipleCodimMultipleGeomTypeMapper<DuneGridView,
+            Dune::MCMGElementLayout> DuneElementMapper;
+    typedef typename DuneGridView::template Codim<codimVertex>::Iterator
+            DuneVertexIterator;
+    typedef typename DuneGridView::template Codim<codimElement>::Iterator
+            DuneElementIterator;
+    typedef typename DuneGrid::ctype ctype;
+
+    const DuneIndexSet& indexSet = m_dune_gv.indexSet();
+    // Same numbering as that of m_element_mapper
+    DuneElementMapper elementMapper(
+                m_dune_gv, Dune::MCMGElementLayout<dimGrid>());
+    const size_t elementCount = elementMapper.size();
+    const size_t vertexCount = indexSet.size(codimVertex);
+
+    data.m_gridDimension = dimGrid;
+    data.m_worldDimension = dimWorld;
+    data.m_edgeCount = dimGrid >= 2 ? indexSet.size(codimEdge) : 0;
+
+    // Vertex coordinates, stored dimension by dimension
+    data.m_vertexCoordinates.resize(dimWorld * vertexCount);
+    for (DuneVertexIterator it = m_dune_gv.template begin<codimVertex>();
+         it != m_dune_gv.template end<codimVertex>(); ++it)
+    {
+        const size_t index = indexSet.index(*it);
+        Dune::FieldVector<ctype, dimWorld> vertex = it->geometry().corner(0);
+        for (int i = 0; i < dimWorld; ++i)
+            data.m_vertexCoordinates[i * vertexCount + index] = vertex[i];
+    }
+
+    // Vertices and edges of each element. The elements are visited in the
+    // order of the iterator, so their subentities are first collected in
+    // per-element arrays of fixed size and then compressed.
+    const int MAX_CORNER_COUNT = 1 << dimGrid;
+    const int MAX_EDGE_COUNT = dimGrid == 3 ? 12 : 4;
+    std::vector<int> cornerCounts(elementCount, 0);
+    std::vector<int> corners(MAX_CORNER_COUNT * elementCount);
+    std::vector<int> edgeCounts;
+    std::vector<int> edges;
+    if (dimGrid >= 2) {
+        edgeCounts.resize(elementCount, 0);
+        edges.resize(MAX_EDGE_COUNT * elementCount);
+    }
+    for (DuneElementIterator it = m_dune_gv.template begin<codimElement>();
+         it != m_dune_gv.template end<codimElement>(); ++it)
+    {
+        const size_t index = elementMapper.map(*it);
+        const Dune::GenericReferenceElement<ctype, dimGrid>& refElement =
+                Dune::GenericReferenceElements<ctype, dimGrid>::general(it->type());
+        const int cornerCount = refElement.size(codimVertex);
+        assert(cornerCount <= MAX_CORNER_COUNT);
+        cornerCounts[index] = cornerCount;
+        for (int i = 0; i < cornerCount; ++i)
+            corners[MAX_CORNER_COUNT * index + i] =
+                    indexSet.subIndex(*it, i, codimVertex);
+        if (dimGrid >= 2) {
+            const int edgeCount = refElement.size(codimEdge);
+            assert(edgeCount <= MAX_EDGE_COUNT);
+            edgeCounts[index] = edgeCount;
+            for (int i = 0; i < edgeCount; ++i)
+                edges[MAX_EDGE_COUNT * index + i] =
+                        indexSet.subIndex(*it, i, codimEdge);
+        }
+    }
+
+    data.m_elementVertexOffsets.resize(elementCount + 1);
+    data.m_elementVertexOffsets[0] = 0;
+    for (size_t e = 0; e < elementCount; ++e)
+        data.m_elementVertexOffsets[e + 1] =
+                data.m_elementVertexOffsets[e] + cornerCounts[e];
+    data.m_elementVertices.resize(data.m_elementVertexOffsets[elementCount]);
+    for (size_t e = 0; e < elementCount; ++e)
+        for (int i = 0; i < cornerCounts[e]; ++i)
+            data.m_elementVertices[data.m_elementVertexOffsets[e] + i] =
+                    corners[MAX_CORNER_COUNT * e + i];
+
+    if (dimGrid >= 2) {
+        data.m_elementEdgeOffsets.resize(elementCount + 1);
+        data.m_elementEdgeOffsets[0] = 0;
+        for (size_t e = 0; e < elementCount; ++e)
+            data.m_elementEdgeOffsets[e + 1] =
+                    data.m_elementEdgeOffsets[e] + edgeCounts[e];
+        data.m_elementEdges.resize(data.m_elementEdgeOffsets[elementCount]);
+        for (size_t e = 0; e < elementCount; ++e)
+            for (int i = 0; i < edgeCounts[e]; ++i)
+                data.m_elementEdges[data.m_elementEdgeOffsets[e] + i] =
+                        edges[MAX_EDGE_COUNT * e + i];
+    }
+
+    data.invertElementVertexTable(vertexCount);
+}
+
 } // namespace Bempp
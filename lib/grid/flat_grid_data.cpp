@@ -0,0 +1,54 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "flat_grid_data.hpp"
+
+namespace Bempp
+{
+
+FlatGridData::FlatGridData() :
+    m_gridDimension(0), m_worldDimension(0), m_edgeCount(0),
+    m_elementVertexOffsets(1, 0), m_vertexElementOffsets(1, 0)
+{
+}
+
+void FlatGridData::invertElementVertexTable(size_t vertexCount)
+{
+    const size_t elementCount_ = elementCount();
+
+    // Count the elements adjacent to each vertex...
+    m_vertexElementOffsets.assign(vertexCount + 1, 0);
+    for (size_t i = 0; i < m_elementVertices.size(); ++i)
+        ++m_vertexElementOffsets[m_elementVertices[i] + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        m_vertexElementOffsets[v + 1] += m_vertexElementOffsets[v];
+
+    // ... and store them. Since elements are visited in increasing order,
+    // the list of each vertex ends up sorted.
+    m_vertexElements.resize(m_elementVertices.size());
+    std::vector<int> fillPositions(m_vertexElementOffsets.begin(),
+                                   m_vertexElementOffsets.end() - 1);
+    for (size_t e = 0; e < elementCount_; ++e)
+        for (int i = m_elementVertexOffsets[e];
+             i < m_elementVertexOffsets[e + 1]; ++i)
+            m_vertexElements[fillPositions[m_elementVertices[i]]++] = e;
+}
+
+} // namespace Bempp
@@ -0,0 +1,164 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_flat_grid_data_hpp
+#define bempp_flat_grid_data_hpp
+
+#include "../common/common.hpp"
+
+#include "../common/types.hpp"
+
+#include <vector>
+
+namespace Bempp
+{
+
+/** \brief Connectivity and vertex coordinates of a grid view stored in flat
+  arrays.
+
+  Walking a grid through EntityIterator objects involves a virtual call and
+  an index lookup per entity. Code that needs to traverse all elements of a
+  grid view repeatedly (e.g. to assign degrees of freedom) can instead use
+  the tables provided by this class in plain indexed loops.
+
+  Elements are numbered as by GridView::elementMapper(); vertices and edges
+  as by GridView::indexSet(). The element-to-vertex, element-to-edge and
+  vertex-to-element incidence relations are stored in compressed
+  (CSR-like) form: for instance, the vertices of element \e e are
+  <tt>elementVertices()[elementVertexOffsets()[e]]</tt>, ...,
+  <tt>elementVertices()[elementVertexOffsets()[e + 1] - 1]</tt>, listed in
+  the order of the element's corners.
+
+  Objects of this class are created by GridView::flatGridData(). */
+class FlatGridData
+{
+    template <typename DuneGridView> friend class ConcreteGridView;
+
+public:
+    /** \brief Dimension of the grid. */
+    int gridDimension() const {
+        return m_gridDimension;
+    }
+
+    /** \brief Dimension of the space containing the grid. */
+    int worldDimension() const {
+        return m_worldDimension;
+    }
+
+    /** \brief Number of elements. */
+    size_t elementCount() const {
+        return m_elementVertexOffsets.size() - 1;
+    }
+
+    /** \brief Number of vertices. */
+    size_t vertexCount() const {
+        return m_vertexElementOffsets.size() - 1;
+    }
+
+    /** \brief Number of edges.
+
+      For one-dimensional grids, whose elements have no edges, this
+      function returns 0. */
+    size_t edgeCount() const {
+        return m_edgeCount;
+    }
+
+    /** \brief Number of corners of element \p element. */
+    int elementCornerCount(EntityIndex element) const {
+        return m_elementVertexOffsets[element + 1] -
+                m_elementVertexOffsets[element];
+    }
+
+    /** \brief Offsets of the vertex lists of individual elements in the
+      array returned by elementVertices(). */
+    const std::vector<int>& elementVertexOffsets() const {
+        return m_elementVertexOffsets;
+    }
+
+    /** \brief Indices of the vertices of all elements. */
+    const std::vector<int>& elementVertices() const {
+        return m_elementVertices;
+    }
+
+    /** \brief Offsets of the edge lists of individual elements in the
+      array returned by elementEdges().
+
+      Empty for one-dimensional grids. */
+    const std::vector<int>& elementEdgeOffsets() const {
+        return m_elementEdgeOffsets;
+    }
+
+    /** \brief Indices of the edges of all elements.
+
+      The edges of each element are listed in the order of the element's
+      one-dimensional subentities. Empty for one-dimensional grids. */
+    const std::vector<int>& elementEdges() const {
+        return m_elementEdges;
+    }
+
+    /** \brief Offsets of the element lists of individual vertices in the
+      array returned by vertexElements(). */
+    const std::vector<int>& vertexElementOffsets() const {
+        return m_vertexElementOffsets;
+    }
+
+    /** \brief Indices of the elements adjacent to each vertex.
+
+      The elements adjacent to each vertex are listed in increasing order. */
+    const std::vector<int>& vertexElements() const {
+        return m_vertexElements;
+    }
+
+    /** \brief Pointer to the array of the <tt>dim</tt>th coordinates of all
+      vertices.
+
+      The coordinates are stored dimension by dimension, so that the
+      <tt>dim</tt>th coordinate of vertex \e v is
+      <tt>vertexCoordinates(dim)[v]</tt>. If the grid view has no vertices,
+      a null pointer is returned. */
+    const double* vertexCoordinates(int dim) const {
+        // &m_vertexCoordinates[0] is undefined for an empty vector
+        return m_vertexCoordinates.empty() ?
+                    0 : &m_vertexCoordinates[0] + dim * vertexCount();
+    }
+
+private:
+    FlatGridData();
+
+    // Fill m_vertexElementOffsets and m_vertexElements from
+    // m_elementVertexOffsets and m_elementVertices
+    void invertElementVertexTable(size_t vertexCount);
+
+private:
+    int m_gridDimension;
+    int m_worldDimension;
+    size_t m_edgeCount;
+    std::vector<int> m_elementVertexOffsets;
+    std::vector<int> m_elementVertices;
+    std::vector<int> m_elementEdgeOffsets;
+    std::vector<int> m_elementEdges;
+    std::vector<int> m_vertexElementOffsets;
+    std::vector<int> m_vertexElements;
+    std::vector<double> m_vertexCoordinates;
+};
+
+} // namespace Bempp
+
+#endif
@@ -37,6 +37,7 @@ namespace Bempp
 /** \cond FORWARD_DECL */
 template<int codim> class Entity;
 template<int codim> class EntityCache;
+class FlatGridData;
 class IndexSet;
 class Mapper;
 class ReverseElementMapper;
@@ -132,6 +133,20 @@ public:
     */
     virtual const ReverseElementMapper& reverseElementMapper() const = 0;
 
+    /** \brief Connectivity and vertex coordinates of this grid view stored
+      in flat arrays.
+
+      The returned object lets code traverse the elements and vertices of the
+      view with plain indexed loops instead of entity iterators. See the
+      documentation of FlatGridData for details.
+
+      Like the reverse element mapper, this object is *not* updated when the
+      grid is adapted.
+
+      \internal The object is created on the first call to this method.
+    */
+    virtual const FlatGridData& flatGridData() const = 0;
+
     /** \brief Create a VtkWriter for this grid view.
 
       \param dm Data mode (conforming or nonconforming; see the documentation of Dune::VTK::DataMode for details). */
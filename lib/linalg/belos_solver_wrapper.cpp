@@ -296,6 +296,26 @@ inline defaultCgParameterListInternal(MagnitudeType tol, int maxIterationCount)
     return paramList;
 }
 
+template <typename MagnitudeType>
+Teuchos::RCP<Teuchos::ParameterList>
+inline defaultBlockGmresParameterListInternal(
+        MagnitudeType tol, int blockSize, int maxIterationCount)
+{
+    if (blockSize < 1)
+        throw std::invalid_argument("defaultBlockGmresParameterList(): "
+                                    "block size must be positive");
+    Teuchos::RCP<Teuchos::ParameterList> paramList(
+                new Teuchos::ParameterList("DefaultParameters"));
+    paramList->set("Solver Type", "Block GMRES");
+    Teuchos::ParameterList& solverTypesList = paramList->sublist("Solver Types");
+    Teuchos::ParameterList& blockGmresList =
+             solverTypesList.sublist("Block GMRES");
+    blockGmresList.set("Convergence Tolerance", tol);
+    blockGmresList.set("Maximum Iterations", maxIterationCount);
+    blockGmresList.set("Block Size", blockSize);
+    return paramList;
+}
+
 } // namespace
 
 Teuchos::RCP<Teuchos::ParameterList> defaultGmresParameterList(
@@ -322,6 +342,20 @@ Teuchos::RCP<Teuchos::ParameterList> defaultCgParameterList(
     return defaultCgParameterListInternal(tol, maxIterationCount);
 }
 
+Teuchos::RCP<Teuchos::ParameterList> defaultBlockGmresParameterList(
+        double tol, int blockSize, int maxIterationCount)
+{
+    return defaultBlockGmresParameterListInternal(
+                tol, blockSize, maxIterationCount);
+}
+
+Teuchos::RCP<Teuchos::ParameterList> defaultBlockGmresParameterList(
+        float tol, int blockSize, int maxIterationCount)
+{
+    return defaultBlockGmresParameterListInternal(
+                tol, blockSize, maxIterationCount);
+}
+
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(BelosSolverWrapper);
 
 } // namespace Bempp
@@ -23,6 +23,10 @@ Teuchos::RCP<Teuchos::ParameterList> defaultGmresParameterList(
         float tol, int maxIterationCount = 1000);
 Teuchos::RCP<Teuchos::ParameterList> defaultCgParameterList(
         float tol, int maxIterationCount = 1000);
+Teuchos::RCP<Teuchos::ParameterList> defaultBlockGmresParameterList(
+        double tol, int blockSize, int maxIterationCount = 1000);
+Teuchos::RCP<Teuchos::ParameterList> defaultBlockGmresParameterList(
+        float tol, int blockSize, int maxIterationCount = 1000);
 
 } // namespace Bempp
 
@@ -17,38 +17,212 @@
 // LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
-
 #include "default_direct_solver.hpp"
 
 #include "../assembly/abstract_boundary_operator.hpp"
 #include "../assembly/blocked_boundary_operator.hpp"
 #include "../assembly/boundary_operator.hpp"
 #include "../assembly/discrete_boundary_operator.hpp"
+#include "../assembly/grid_function.hpp"
+#include "../assembly/symmetry.hpp"
+#include "../common/complex_aux.hpp"
+#include "../common/to_string.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../space/space.hpp"
 
+#include <algorithm>
 #include <boost/variant.hpp>
+#include <complex>
+#include <stdexcept>
+#include <tbb/mutex.h>
+
+extern "C" {
+void sgetrf_(const int* m, const int* n, float* a, const int* lda,
+             int* ipiv, int* info);
+void dgetrf_(const int* m, const int* n, double* a, const int* lda,
+             int* ipiv, int* info);
+void cgetrf_(const int* m, const int* n, std::complex<float>* a,
+             const int* lda, int* ipiv, int* info);
+void zgetrf_(const int* m, const int* n, std::complex<double>* a,
+             const int* lda, int* ipiv, int* info);
+
+void sgetrs_(const char* trans, const int* n, const int* nrhs,
+             const float* a, const int* lda, const int* ipiv,
+             float* b, const int* ldb, int* info);
+void dgetrs_(const char* trans, const int* n, const int* nrhs,
+             const double* a, const int* lda, const int* ipiv,
+             double* b, const int* ldb, int* info);
+void cgetrs_(const char* trans, const int* n, const int* nrhs,
+             const std::complex<float>* a, const int* lda, const int* ipiv,
+             std::complex<float>* b, const int* ldb, int* info);
+void zgetrs_(const char* trans, const int* n, const int* nrhs,
+             const std::complex<double>* a, const int* lda, const int* ipiv,
+             std::complex<double>* b, const int* ldb, int* info);
+
+void ssytrf_(const char* uplo, const int* n, float* a, const int* lda,
+             int* ipiv, float* work, const int* lwork, int* info);
+void dsytrf_(const char* uplo, const int* n, double* a, const int* lda,
+             int* ipiv, double* work, const int* lwork, int* info);
+void csytrf_(const char* uplo, const int* n, std::complex<float>* a,
+             const int* lda, int* ipiv, std::complex<float>* work,
+             const int* lwork, int* info);
+void zsytrf_(const char* uplo, const int* n, std::complex<double>* a,
+             const int* lda, int* ipiv, std::complex<double>* work,
+             const int* lwork, int* info);
+
+void ssytrs_(const char* uplo, const int* n, const int* nrhs,
+             const float* a, const int* lda, const int* ipiv,
+             float* b, const int* ldb, int* info);
+void dsytrs_(const char* uplo, const int* n, const int* nrhs,
+             const double* a, const int* lda, const int* ipiv,
+             double* b, const int* ldb, int* info);
+void csytrs_(const char* uplo, const int* n, const int* nrhs,
+             const std::complex<float>* a, const int* lda, const int* ipiv,
+             std::complex<float>* b, const int* ldb, int* info);
+void zsytrs_(const char* uplo, const int* n, const int* nrhs,
+             const std::complex<double>* a, const int* lda, const int* ipiv,
+             std::complex<double>* b, const int* ldb, int* info);
+} // extern "C"
 
 namespace Bempp
 {
 
+namespace
+{
+
+// Type-dispatching wrappers of the Lapack routines declared above
+
+template <typename ValueType> struct LapackLu;
+
+#define BEMPP_DEFINE_LAPACK_LU(VALUE_TYPE, PREFIX) \
+    template <> struct LapackLu<VALUE_TYPE> \
+    { \
+        static void getrf(int n, VALUE_TYPE* a, int* ipiv, int& info) { \
+            PREFIX ## getrf_(&n, &n, a, &n, ipiv, &info); \
+        } \
+        static void getrs(int n, int nrhs, const VALUE_TYPE* a, \
+                          const int* ipiv, VALUE_TYPE* b, int& info) { \
+            const char trans = 'N'; \
+            PREFIX ## getrs_(&trans, &n, &nrhs, a, &n, ipiv, b, &n, &info); \
+        } \
+        static void sytrf(int n, VALUE_TYPE* a, int* ipiv, \
+                          VALUE_TYPE* work, int lwork, int& info) { \
+            const char uplo = 'L'; \
+            PREFIX ## sytrf_(&uplo, &n, a, &n, ipiv, work, &lwork, &info); \
+        } \
+        static void sytrs(int n, int nrhs, const VALUE_TYPE* a, \
+                          const int* ipiv, VALUE_TYPE* b, int& info) { \
+            const char uplo = 'L'; \
+            PREFIX ## sytrs_(&uplo, &n, &nrhs, a, &n, ipiv, b, &n, &info); \
+        } \
+    }
+
+BEMPP_DEFINE_LAPACK_LU(float, s);
+BEMPP_DEFINE_LAPACK_LU(double, d);
+BEMPP_DEFINE_LAPACK_LU(std::complex<float>, c);
+BEMPP_DEFINE_LAPACK_LU(std::complex<double>, z);
+
+#undef BEMPP_DEFINE_LAPACK_LU
+
+} // namespace
+
 /** \cond HIDDEN_INTERNAL */
 
 template <typename BasisFunctionType, typename ResultType> 
 struct DefaultDirectSolver<BasisFunctionType, ResultType>::Impl
 {
     Impl(const BoundaryOperator<BasisFunctionType, ResultType>& op_) :
-        op(op_)
+        op(op_), factorized(false), symmetric(false)
     {
     }
 
     Impl(const BlockedBoundaryOperator<BasisFunctionType, ResultType>& op_) :
-        op(op_)
+        op(op_), factorized(false), symmetric(false)
+    {
+    }
+
+    // Factorize the weak form of the operator unless this has already been
+    // done. If symmetric_ is set, the matrix is assumed to be symmetric
+    // (not Hermitian).
+    void factorize(const DiscreteBoundaryOperator<ResultType>& weakForm,
+                   bool symmetric_)
+    {
+        tbb::mutex::scoped_lock lock(mutex);
+        if (factorized)
+            return;
+        if (weakForm.rowCount() != weakForm.columnCount())
+            throw std::invalid_argument(
+                "DefaultDirectSolver::solve(): the weak form of the operator "
+                "is not a square matrix");
+
+        arma::Mat<ResultType> mat = weakForm.asMatrix();
+        const int n = mat.n_rows;
+        std::vector<int> ipiv(std::max(n, 1));
+        int info = 0;
+        if (n > 0) {
+            if (symmetric_) {
+                // Query the optimal workspace size first
+                ResultType optimalWorkSize;
+                LapackLu<ResultType>::sytrf(n, mat.memptr(), &ipiv[0],
+                                            &optimalWorkSize, -1, info);
+                const int lwork = std::max(
+                            1, static_cast<int>(realPart(optimalWorkSize)));
+                std::vector<ResultType> work(lwork);
+                LapackLu<ResultType>::sytrf(n, mat.memptr(), &ipiv[0],
+                                            &work[0], lwork, info);
+            }
+            else
+                LapackLu<ResultType>::getrf(n, mat.memptr(), &ipiv[0], info);
+        }
+        if (info < 0)
+            throw std::runtime_error(
+                "DefaultDirectSolver::solve(): factorization failed: invalid "
+                "argument #" + toString(-info) + " passed to Lapack");
+        if (info > 0)
+            throw std::runtime_error(
+                "DefaultDirectSolver::solve(): the weak form of the operator "
+                "is singular");
+
+        factors.swap(mat);
+        pivots.swap(ipiv);
+        symmetric = symmetric_;
+        factorized = true;
+    }
+
+    // Overwrite the columns of rhs with the solutions of the factorized
+    // system.
+    void backSubstitute(arma::Mat<ResultType>& rhs) const
     {
+        const int n = factors.n_rows;
+        const int nrhs = rhs.n_cols;
+        if (rhs.n_rows != factors.n_rows)
+            throw std::invalid_argument(
+                "DefaultDirectSolver::solve(): right-hand side has "
+                "incorrect length");
+        if (n == 0 || nrhs == 0)
+            return;
+        int info = 0;
+        if (symmetric)
+            LapackLu<ResultType>::sytrs(n, nrhs, factors.memptr(), &pivots[0],
+                                        rhs.memptr(), info);
+        else
+            LapackLu<ResultType>::getrs(n, nrhs, factors.memptr(), &pivots[0],
+                                        rhs.memptr(), info);
+        if (info != 0)
+            throw std::runtime_error(
+                "DefaultDirectSolver::solve(): back substitution failed: "
+                "invalid argument #" + toString(-info) + " passed to Lapack");
     }
-    
+
     boost::variant<
         BoundaryOperator<BasisFunctionType, ResultType>,
         BlockedBoundaryOperator<BasisFunctionType, ResultType> > op;
+
+    tbb::mutex mutex;
+    bool factorized;
+    bool symmetric;
+    arma::Mat<ResultType> factors;
+    std::vector<int> pivots;
 };
 
 /** \endcond */
@@ -76,6 +250,25 @@ template <typename BasisFunctionType, typename ResultType>
 Solution<BasisFunctionType, ResultType> 
 DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
         const GridFunction<BasisFunctionType, ResultType>& rhs) const
+{
+    std::vector<GridFunction<BasisFunctionType, ResultType> > rhsBatch(1, rhs);
+    return solveBatch(rhsBatch)[0];
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BlockedSolution<BasisFunctionType, ResultType>
+DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplBlocked(
+    const std::vector<GridFunction<BasisFunctionType, ResultType> >& rhs) const
+{
+    std::vector<std::vector<GridFunction<BasisFunctionType, ResultType> > >
+            rhsBatch(1, rhs);
+    return solveBatch(rhsBatch)[0];
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<Solution<BasisFunctionType, ResultType> >
+DefaultDirectSolver<BasisFunctionType, ResultType>::solveBatch(
+        const std::vector<GridFunction<BasisFunctionType, ResultType> >& rhs) const
 {
     typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
 
@@ -85,25 +278,45 @@ DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
             "DefaultDirectSolver::solve(): for solvers constructed "
             "from a BlockedBoundaryOperator the other solve() overload "
             "must be used");
-    Solver<BasisFunctionType, ResultType>::checkConsistency(
-        *boundaryOp, rhs, ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
-
-    arma::Col<ResultType> armaSolution = arma::solve(
-                boundaryOp->weakForm()->asMatrix(),
-                rhs.projections(*boundaryOp->dualToRange()));
-    
-    return Solution<BasisFunctionType, ResultType>(
-        GridFunction<BasisFunctionType, ResultType>(
-            boundaryOp->context(), boundaryOp->domain(), armaSolution),
-        SolutionStatus::CONVERGED,
-        SolutionBase<BasisFunctionType, ResultType>::unknownTolerance(),
-        "Solver finished");
+    for (size_t i = 0; i < rhs.size(); ++i)
+        Solver<BasisFunctionType, ResultType>::checkConsistency(
+            *boundaryOp, rhs[i],
+            ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+
+    std::vector<Solution<BasisFunctionType, ResultType> > solutions;
+    if (rhs.empty())
+        return solutions;
+
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > weakForm =
+            boundaryOp->weakForm();
+    m_impl->factorize(*weakForm,
+                      boundaryOp->abstractOperator()->symmetry() & SYMMETRIC);
+
+    // Gather the projections of all right-hand sides into a single matrix
+    // and solve for all of them at once
+    arma::Mat<ResultType> armaSolutions(
+                boundaryOp->dualToRange()->globalDofCount(), rhs.size());
+    for (size_t i = 0; i < rhs.size(); ++i)
+        armaSolutions.col(i) = rhs[i].projections(*boundaryOp->dualToRange());
+    m_impl->backSubstitute(armaSolutions);
+
+    solutions.reserve(rhs.size());
+    for (size_t i = 0; i < rhs.size(); ++i)
+        solutions.push_back(Solution<BasisFunctionType, ResultType>(
+            GridFunction<BasisFunctionType, ResultType>(
+                boundaryOp->context(), boundaryOp->domain(),
+                arma::Col<ResultType>(armaSolutions.col(i))),
+            SolutionStatus::CONVERGED,
+            SolutionBase<BasisFunctionType, ResultType>::unknownTolerance(),
+            "Solver finished"));
+    return solutions;
 }
 
 template <typename BasisFunctionType, typename ResultType>
-BlockedSolution<BasisFunctionType, ResultType>
-DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplBlocked(
-    const std::vector<GridFunction<BasisFunctionType, ResultType> >& rhs) const
+std::vector<BlockedSolution<BasisFunctionType, ResultType> >
+DefaultDirectSolver<BasisFunctionType, ResultType>::solveBatch(
+        const std::vector<std::vector<
+        GridFunction<BasisFunctionType, ResultType> > >& rhs) const
 {
     typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
 
@@ -113,41 +326,56 @@ DefaultDirectSolver<BasisFunctionType, ResultType>::solveImplBlocked(
             "DefaultDirectSolver::solve(): for solvers constructed "
             "from a (non-blocked) BoundaryOperator the other solve() overload "
             "must be used");
-    std::vector<GridFunction<BasisFunctionType, ResultType> > canonicalRhs =
+    std::vector<std::vector<GridFunction<BasisFunctionType, ResultType> > >
+            canonicalRhs(rhs.size());
+    for (size_t i = 0; i < rhs.size(); ++i) {
+        canonicalRhs[i] =
             Solver<BasisFunctionType, ResultType>::canonicalizeBlockedRhs(
-                *boundaryOp, rhs,
-                ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
-    // Shouldn't be needed, but better safe than sorry...
-    Solver<BasisFunctionType, ResultType>::checkConsistency(
-                *boundaryOp, canonicalRhs,
+                *boundaryOp, rhs[i],
                 ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+        // Shouldn't be needed, but better safe than sorry...
+        Solver<BasisFunctionType, ResultType>::checkConsistency(
+                    *boundaryOp, canonicalRhs[i],
+                    ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE);
+    }
+
+    std::vector<BlockedSolution<BasisFunctionType, ResultType> > solutions;
+    if (rhs.empty())
+        return solutions;
 
-    // Construct the right-hand size vector
-    arma::Col<ResultType> armaRhs(boundaryOp->totalGlobalDofCountInDualsToRanges());
-    for (size_t i = 0, start = 0; i < canonicalRhs.size(); ++i) {
-        const arma::Col<ResultType>& chunkProjections =
-                canonicalRhs[i].projections(*boundaryOp->dualToRange(i));
-        size_t chunkSize = chunkProjections.n_rows;
-        armaRhs.rows(start, start + chunkSize - 1) = chunkProjections;
-        start += chunkSize;
-    }        
+    m_impl->factorize(*boundaryOp->weakForm(), false /* not symmetric */);
+
+    // Construct the right-hand-side matrix, one column per right-hand side
+    arma::Mat<ResultType> armaSolutions(
+                boundaryOp->totalGlobalDofCountInDualsToRanges(), rhs.size());
+    for (size_t col = 0; col < canonicalRhs.size(); ++col)
+        for (size_t i = 0, start = 0; i < canonicalRhs[col].size(); ++i) {
+            const arma::Col<ResultType>& chunkProjections =
+                    canonicalRhs[col][i].projections(*boundaryOp->dualToRange(i));
+            size_t chunkSize = chunkProjections.n_rows;
+            if (chunkSize > 0)
+                armaSolutions.submat(start, col, start + chunkSize - 1, col) =
+                        chunkProjections;
+            start += chunkSize;
+        }
 
     // Solve
-    arma::Col<ResultType> armaSolution = arma::solve(
-                boundaryOp->weakForm()->asMatrix(),
-                armaRhs);
-    
-    // Convert chunks of the solution vector into grid functions
-    std::vector<GridFunction<BasisFunctionType, ResultType> > solutionFunctions;
-    Solver<BasisFunctionType, ResultType>::constructBlockedGridFunction(
-        armaSolution, *boundaryOp, solutionFunctions);
-
-    // Return solution
-    return BlockedSolution<BasisFunctionType, ResultType>(
-        solutionFunctions,
-        SolutionStatus::CONVERGED,
-        SolutionBase<BasisFunctionType, ResultType>::unknownTolerance(),
-        "Solver finished");
+    m_impl->backSubstitute(armaSolutions);
+
+    // Convert chunks of the solution vectors into grid functions
+    solutions.reserve(rhs.size());
+    for (size_t col = 0; col < canonicalRhs.size(); ++col) {
+        std::vector<GridFunction<BasisFunctionType, ResultType> > solutionFunctions;
+        Solver<BasisFunctionType, ResultType>::constructBlockedGridFunction(
+            arma::Col<ResultType>(armaSolutions.col(col)), *boundaryOp,
+            solutionFunctions);
+        solutions.push_back(BlockedSolution<BasisFunctionType, ResultType>(
+            solutionFunctions,
+            SolutionStatus::CONVERGED,
+            SolutionBase<BasisFunctionType, ResultType>::unknownTolerance(),
+            "Solver finished"));
+    }
+    return solutions;
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(DefaultDirectSolver);
@@ -32,9 +32,16 @@ namespace Bempp
   * \brief Default Interface to the solution of boundary integral equations using a dense LU decomposition.
   *
   * This class provides an interface to the direct solution of boundary integral equations using standard LU.
-  * It is implemented via a call to the <a href="http://arma.sourceforge.net">Armadillo</a> dense solver, which
-  * is an interface to the corresponding Lapack routines.
+  * The weak form of the operator is converted to a dense matrix and factorized by direct calls to
+  * Lapack: weak forms of (non-blocked) operators flagged as SYMMETRIC are factorized with the
+  * Bunch-Kaufman method (\c sytrf, solved with \c sytrs), all others with partial-pivoting LU
+  * (\c getrf, solved with \c getrs).
   *
+  * The factorization is computed on the first call to solve() or
+  * solveBatch(); the factors are stored in the solver and reused by all
+  * subsequent solves. Hence, to solve the same system for many right-hand
+  * sides, construct a single solver and call solve() repeatedly or,
+  * preferably, pass all right-hand sides at once to solveBatch().
   */
 
 template <typename BasisFunctionType, typename ResultType>
@@ -51,6 +58,40 @@ public:
             const BlockedBoundaryOperator<BasisFunctionType, ResultType>& boundaryOp);
     ~DefaultDirectSolver();
 
+    /** \brief Solve a standard (non-blocked) boundary integral equation for
+     *  several right-hand sides at once.
+     *
+     *  This function is equivalent to calling solve() for each element of
+     *  \p rhs in turn, but the right-hand sides are solved for together with
+     *  a single blocked call to the Lapack back-substitution routine.
+     *
+     *  (This function is not an overload of solve(), since
+     *  solve(const std::vector<GridFunction>&) solves a blocked system.)
+     *
+     *  \param[in] rhs
+     *    Vector of right-hand sides.
+     *
+     *  \return A vector of Solution objects; the <em>i</em>th element
+     *  contains the solution corresponding to <tt>rhs[i]</tt>. */
+    std::vector<Solution<BasisFunctionType, ResultType> > solveBatch(
+            const std::vector<GridFunction<BasisFunctionType, ResultType> >&
+            rhs) const;
+
+    /** \brief Solve a block-operator system of boundary integral equations
+     *  for several right-hand sides at once.
+     *
+     *  The <em>i</em>th element of \p rhs is a vector of GridFunctions
+     *  constituting the <em>i</em>th block right-hand side, as in the
+     *  solve(const std::vector<GridFunction>&) overload. All right-hand sides
+     *  are solved for with a single blocked call to the Lapack
+     *  back-substitution routine.
+     *
+     *  \return A vector of BlockedSolution objects; the <em>i</em>th element
+     *  contains the solution corresponding to <tt>rhs[i]</tt>. */
+    std::vector<BlockedSolution<BasisFunctionType, ResultType> > solveBatch(
+            const std::vector<std::vector<
+            GridFunction<BasisFunctionType, ResultType> > >& rhs) const;
+
 private:
     virtual Solution<BasisFunctionType, ResultType> solveImplNonblocked(
             const GridFunction<BasisFunctionType, ResultType>& rhs) const;
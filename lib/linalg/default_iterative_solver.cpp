@@ -35,33 +35,58 @@
 #include "../assembly/discrete_boundary_operator.hpp"
 #include "../assembly/discrete_boundary_operator_composition.hpp"
 #include "../assembly/identity_operator.hpp"
-#include "../assembly/vector.hpp"
 #include "../fiber/explicit_instantiation.hpp"
+#include "../fiber/thread_pool.hpp"
 #include "../space/space.hpp"
 
 #include <Teuchos_RCPBoostSharedPtrConversions.hpp>
+#include <Thyra_DefaultSpmdMultiVector.hpp>
 #include <Thyra_DefaultSpmdVectorSpace.hpp>
 
 #include <boost/make_shared.hpp>
 #include <boost/variant.hpp>
 
-#include <tbb/task_scheduler_init.h>
+#include <algorithm>
+#include <limits>
+#include <sstream>
 
 namespace Bempp
 {
 
 template <typename ValueType>
-Teuchos::RCP<Thyra::DefaultSpmdVector<ValueType> >
-wrapInTrilinosVector(arma::Col<ValueType>& col)
+Teuchos::RCP<Thyra::DefaultSpmdMultiVector<ValueType> >
+wrapInTrilinosMultiVector(arma::Mat<ValueType>& mat)
 {
-    size_t size = col.n_rows;
+    size_t rowCount = mat.n_rows;
+    size_t colCount = mat.n_cols;
     Teuchos::ArrayRCP<ValueType> trilinosArray =
-            Teuchos::arcp(col.memptr(), 0 /* lowerOffset */,
-                          size, false /* doesn't own memory */);
-    typedef Thyra::DefaultSpmdVector<ValueType> TrilinosVector;
-    return Teuchos::RCP<TrilinosVector>(new TrilinosVector(
-        Thyra::defaultSpmdVectorSpace<ValueType>(size),
-        trilinosArray, 1 /* stride */));
+            Teuchos::arcp(mat.memptr(), 0 /* lowerOffset */,
+                          rowCount * colCount, false /* doesn't own memory */);
+    typedef Thyra::DefaultSpmdMultiVector<ValueType> TrilinosMultiVector;
+    return Teuchos::RCP<TrilinosMultiVector>(new TrilinosMultiVector(
+        Thyra::defaultSpmdVectorSpace<ValueType>(rowCount),
+        Thyra::defaultSpmdVectorSpace<ValueType>(colCount),
+        trilinosArray, rowCount /* leadingDim */));
+}
+
+// Smallest relative residual to which iterative refinement can reduce
+// systems whose weak forms are assembled in the given context. Residuals are
+// computed with the stored weak form, so they are only as accurate as its
+// matrix-vector products.
+template <typename BasisFunctionType, typename ResultType>
+typename ScalarTraits<ResultType>::RealType refinementToleranceFloor(
+        const Context<BasisFunctionType, ResultType>& context)
+{
+    typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
+    typedef typename ScalarTraits<
+            typename ScalarTraits<ResultType>::SinglePrecisionType>::RealType
+            SinglePrecisionMagnitudeType;
+    const AssemblyOptions& options = context.assemblyOptions();
+    if (options.assemblyMode() == AssemblyOptions::ACA &&
+            options.acaOptions().singlePrecisionStorage)
+        return 10 * std::numeric_limits<SinglePrecisionMagnitudeType>::epsilon();
+    else
+        return 10 * std::numeric_limits<MagnitudeType>::epsilon();
 }
 
 /** \cond HIDDEN_INTERNAL */
@@ -69,12 +94,16 @@ wrapInTrilinosVector(arma::Col<ValueType>& col)
 template <typename BasisFunctionType, typename ResultType>
 struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl
 {
+    typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
 
     // Constructor for non-blocked operators
     Impl(const BoundaryOperator<BasisFunctionType, ResultType>& op_,
          ConvergenceTestMode::Mode mode_) :
         op(op_),
-        mode(mode_)
+        mode(mode_),
+        refinementEnabled(false),
+        refinementTolerance(0.),
+        maximumRefinementIterationCount(0)
     {
         typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
         typedef Solver<BasisFunctionType, ResultType> Solver_;
@@ -82,6 +111,8 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl
         if (!boundaryOp.isInitialized())
             throw std::invalid_argument("DefaultIterativeSolver::Impl::Impl(): "
                                         "boundary operator must be initialized");
+        minimumRefinementTolerance =
+                refinementToleranceFloor(*boundaryOp.context());
 
         if (mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE) {
             if (boundaryOp.domain()->globalDofCount() !=
@@ -89,6 +120,7 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl
                 throw std::invalid_argument("DefaultIterativeSolver::Impl::Impl(): "
                                             "non-square system provided");
 
+            systemOp = boundaryOp.weakForm();
             solverWrapper.reset(
                         new BelosSolverWrapper<ResultType>(
                             Teuchos::rcp<const Thyra::LinearOpBase<ResultType> >(
@@ -108,6 +140,7 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl
                     boost::make_shared<DiscreteBoundaryOperatorComposition<ResultType> >(
                         boost::get<BoundaryOp>(pinvId).weakForm(),
                         boundaryOp.weakForm());
+            systemOp = totalBoundaryOp;
             solverWrapper.reset(
                         new BelosSolverWrapper<ResultType>(
                             Teuchos::rcp<const Thyra::LinearOpBase<ResultType> >(
@@ -123,17 +156,29 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl
     Impl(const BlockedBoundaryOperator<BasisFunctionType, ResultType>& op_,
          ConvergenceTestMode::Mode mode_) :
         op(op_),
-        mode(mode_)
+        mode(mode_),
+        refinementEnabled(false),
+        refinementTolerance(0.),
+        maximumRefinementIterationCount(0)
     {
         typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
         typedef Solver<BasisFunctionType, ResultType> Solver_;
         const BoundaryOp& boundaryOp = boost::get<BoundaryOp>(op);
+        minimumRefinementTolerance = 0.;
+        for (size_t row = 0; row < boundaryOp.rowCount(); ++row)
+            for (size_t col = 0; col < boundaryOp.columnCount(); ++col)
+                if (boundaryOp.block(row, col).context())
+                    minimumRefinementTolerance = std::max(
+                                minimumRefinementTolerance,
+                                refinementToleranceFloor(
+                                    *boundaryOp.block(row, col).context()));
 
         if (mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE) {
             if (boundaryOp.totalGlobalDofCountInDomains() !=
                     boundaryOp.totalGlobalDofCountInDualsToRanges())
                 throw std::invalid_argument("DefaultIterativeSolver::Impl::Impl(): "
                                             "non-square system provided");
+            systemOp = boundaryOp.weakForm();
             solverWrapper.reset(
                         new BelosSolverWrapper<ResultType>(
                             Teuchos::rcp<const Thyra::LinearOpBase<ResultType> >(
@@ -172,6 +217,7 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl
                     boost::make_shared<DiscreteBoundaryOperatorComposition<ResultType> >(
                         boost::get<BoundaryOp>(pinvId).weakForm(),
                         boundaryOp.weakForm());
+            systemOp = totalBoundaryOp;
             solverWrapper.reset(
                         new BelosSolverWrapper<ResultType>(
                             Teuchos::rcp<const Thyra::LinearOpBase<ResultType> >(
@@ -183,6 +229,73 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl
                     "invalid convergence test mode");
     }
 
+    // Solve the system for all columns of rhs, refining the solution
+    // iteratively if requested
+    Thyra::SolveStatus<MagnitudeType> solve(arma::Mat<ResultType>& rhs,
+                                            arma::Mat<ResultType>& solution) const
+    {
+        typedef Thyra::MultiVectorBase<ResultType> TrilinosMultiVector;
+
+        Teuchos::RCP<TrilinosMultiVector> rhsVector =
+                wrapInTrilinosMultiVector(rhs);
+        Teuchos::RCP<TrilinosMultiVector> solutionVector =
+                wrapInTrilinosMultiVector(solution);
+        Thyra::SolveStatus<MagnitudeType> status = solverWrapper->solve(
+                    Thyra::NOTRANS, *rhsVector, solutionVector.ptr());
+        if (!refinementEnabled)
+            return status;
+
+        std::vector<MagnitudeType> rhsNorms(rhs.n_cols);
+        for (size_t col = 0; col < rhs.n_cols; ++col)
+            rhsNorms[col] = arma::norm(rhs.col(col), 2);
+
+        arma::Mat<ResultType> residual(rhs.n_rows, rhs.n_cols);
+        arma::Mat<ResultType> correction(solution.n_rows, solution.n_cols);
+        Teuchos::RCP<TrilinosMultiVector> residualVector =
+                wrapInTrilinosMultiVector(residual);
+        Teuchos::RCP<TrilinosMultiVector> correctionVector =
+                wrapInTrilinosMultiVector(correction);
+        MagnitudeType relativeResidual = 0.;
+        int step = 0;
+        while (true) {
+            // r := b - A x, accumulated in the precision of ResultType, but
+            // with the stored weak form A (see refinementToleranceFloor()).
+            // The entries are copied so as not to reallocate the memory
+            // wrapped by residualVector
+            std::copy(rhs.memptr(), rhs.memptr() + rhs.n_elem,
+                      residual.memptr());
+            systemOp->apply(NO_TRANSPOSE, solution, residual, -1., 1.);
+            relativeResidual = 0.;
+            for (size_t col = 0; col < residual.n_cols; ++col) {
+                MagnitudeType norm = arma::norm(residual.col(col), 2);
+                if (rhsNorms[col] > 0.)
+                    norm /= rhsNorms[col];
+                relativeResidual = std::max(relativeResidual, norm);
+            }
+            if (relativeResidual <= refinementTolerance ||
+                    step == maximumRefinementIterationCount)
+                break;
+
+            // Solve A d = r and update x := x + d
+            correction.fill(static_cast<ResultType>(0.));
+            status = solverWrapper->solve(
+                        Thyra::NOTRANS, *residualVector, correctionVector.ptr());
+            solution += correction;
+            ++step;
+        }
+
+        status.solveStatus = relativeResidual <= refinementTolerance ?
+                    Thyra::SOLVE_STATUS_CONVERGED :
+                    Thyra::SOLVE_STATUS_UNCONVERGED;
+        status.achievedTol = relativeResidual;
+        std::ostringstream message;
+        message << status.message << "\nIterative refinement: " << step
+                << " correction step(s), relative residual "
+                << relativeResidual << ".";
+        status.message = message.str();
+        return status;
+    }
+
     boost::variant<
         BoundaryOperator<BasisFunctionType, ResultType>,
         BlockedBoundaryOperator<BasisFunctionType, ResultType> > op;
@@ -191,6 +304,12 @@ struct DefaultIterativeSolver<BasisFunctionType, ResultType>::Impl
     boost::variant<
         BoundaryOperator<BasisFunctionType, ResultType>,
         BlockedBoundaryOperator<BasisFunctionType, ResultType> > pinvId;
+    // Operator of the system passed to the Belos solver
+    shared_ptr<const DiscreteBoundaryOperator<ResultType> > systemOp;
+    bool refinementEnabled;
+    MagnitudeType refinementTolerance;
+    int maximumRefinementIterationCount;
+    MagnitudeType minimumRefinementTolerance;
 };
 
 /** \endcond */
@@ -239,14 +358,78 @@ void DefaultIterativeSolver<BasisFunctionType, ResultType>::initializeSolver(
     m_impl->solverWrapper->initializeSolver(paramList);
 }
 
+template <typename BasisFunctionType, typename ResultType>
+void DefaultIterativeSolver<BasisFunctionType, ResultType>::enableIterativeRefinement(
+        double tolerance, int maximumIterationCount)
+{
+    if (tolerance <= 0.)
+        throw std::invalid_argument(
+                "DefaultIterativeSolver::enableIterativeRefinement(): "
+                "tolerance must be positive");
+    if (maximumIterationCount < 0)
+        throw std::invalid_argument(
+                "DefaultIterativeSolver::enableIterativeRefinement(): "
+                "maximumIterationCount must not be negative");
+    if (tolerance < m_impl->minimumRefinementTolerance) {
+        std::ostringstream message;
+        message << "DefaultIterativeSolver::enableIterativeRefinement(): "
+                   "tolerance must not be smaller than "
+                << m_impl->minimumRefinementTolerance
+                << ", the relative accuracy of residuals computed with the "
+                   "weak form of the system";
+        throw std::invalid_argument(message.str());
+    }
+    m_impl->refinementEnabled = true;
+    m_impl->refinementTolerance = tolerance;
+    m_impl->maximumRefinementIterationCount = maximumIterationCount;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+double DefaultIterativeSolver<BasisFunctionType, ResultType>::
+minimumRefinementTolerance() const
+{
+    return m_impl->minimumRefinementTolerance;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void DefaultIterativeSolver<BasisFunctionType, ResultType>::disableIterativeRefinement()
+{
+    m_impl->refinementEnabled = false;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+bool DefaultIterativeSolver<BasisFunctionType, ResultType>::
+isIterativeRefinementEnabled() const
+{
+    return m_impl->refinementEnabled;
+}
+
 template <typename BasisFunctionType, typename ResultType>
 Solution<BasisFunctionType, ResultType>
 DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
         const GridFunction<BasisFunctionType, ResultType>& rhs) const
+{
+    std::vector<GridFunction<BasisFunctionType, ResultType> > rhsBatch(1, rhs);
+    return solveBatch(rhsBatch)[0];
+}
+
+template <typename BasisFunctionType, typename ResultType>
+BlockedSolution<BasisFunctionType, ResultType>
+DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplBlocked(
+    const std::vector<GridFunction<BasisFunctionType, ResultType> >& rhs) const
+{
+    std::vector<std::vector<GridFunction<BasisFunctionType, ResultType> > >
+            rhsBatch(1, rhs);
+    return solveBatch(rhsBatch)[0];
+}
+
+template <typename BasisFunctionType, typename ResultType>
+std::vector<Solution<BasisFunctionType, ResultType> >
+DefaultIterativeSolver<BasisFunctionType, ResultType>::solveBatch(
+        const std::vector<GridFunction<BasisFunctionType, ResultType> >& rhs) const
 {
     typedef BoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
     typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
-    typedef Thyra::MultiVectorBase<ResultType> TrilinosVector;
 
     const BoundaryOp* boundaryOp = boost::get<BoundaryOp>(&m_impl->op);
     if (!boundaryOp)
@@ -254,64 +437,63 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplNonblocked(
             "DefaultIterativeSolver::solve(): for solvers constructed "
             "from a BlockedBoundaryOperator the other solve() overload "
             "must be used");
-    Solver<BasisFunctionType, ResultType>::checkConsistency(
-        *boundaryOp, rhs, m_impl->mode);
-
-    // Construct rhs vector
-    Vector<ResultType> projectionsVector(
-                rhs.projections(*boundaryOp->dualToRange()));
-    Teuchos::RCP<TrilinosVector> rhsVector;
-    if (m_impl->mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE)
-        rhsVector = Teuchos::rcpFromRef(projectionsVector);
-    else {
-        const size_t size = boundaryOp->range()->globalDofCount();
-        rhsVector.reset(new Vector<ResultType>(size));
+    for (size_t i = 0; i < rhs.size(); ++i)
+        Solver<BasisFunctionType, ResultType>::checkConsistency(
+            *boundaryOp, rhs[i], m_impl->mode);
+
+    std::vector<Solution<BasisFunctionType, ResultType> > solutions;
+    if (rhs.empty())
+        return solutions;
+
+    // Construct the right-hand-side multivector, one column per right-hand side
+    arma::Mat<ResultType> armaRhs(
+                boundaryOp->dualToRange()->globalDofCount(), rhs.size());
+    for (size_t i = 0; i < rhs.size(); ++i)
+        armaRhs.col(i) = rhs[i].projections(*boundaryOp->dualToRange());
+    if (m_impl->mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_RANGE) {
+        arma::Mat<ResultType> projections;
+        projections.swap(armaRhs);
+        armaRhs.set_size(boundaryOp->range()->globalDofCount(), rhs.size());
         boost::get<BoundaryOp>(m_impl->pinvId).weakForm()->apply(
-            Thyra::NOTRANS, projectionsVector, rhsVector.ptr(), 1., 0.);
+            NO_TRANSPOSE, projections, armaRhs, 1., 0.);
     }
 
-    // Construct solution vector
-    arma::Col<ResultType> armaSolution(rhsVector->range()->dim());
+    // Construct the solution multivector
+    arma::Mat<ResultType> armaSolution(armaRhs.n_rows, rhs.size());
     armaSolution.fill(static_cast<ResultType>(0.));
-    Teuchos::RCP<TrilinosVector> solutionVector = wrapInTrilinosVector(armaSolution);
 
-    // Get number of threads
     Fiber::ParallelizationOptions parallelOptions =
         boundaryOp->context()->assemblyOptions().parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled()) {
-        if (parallelOptions.maxThreadCount() ==
-            ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
 
-    // Solve
+    // Solve for all right-hand sides in a single call, so that block solvers
+    // apply the operator to all of them at once
     Thyra::SolveStatus<MagnitudeType> status;
     {
         // Initialize TBB threads here (to prevent their construction and
         // destruction on every matrix-vector multiplication)
-        tbb::task_scheduler_init scheduler(maxThreadCount);
-        status = m_impl->solverWrapper->solve(
-            Thyra::NOTRANS, *rhsVector, solutionVector.ptr());
+        Fiber::ScopedScheduler scheduler(parallelOptions);
+        status = m_impl->solve(armaRhs, armaSolution);
     }
 
-    // Construct grid function and return
-    return Solution<BasisFunctionType, ResultType>(
-        GridFunction<BasisFunctionType, ResultType>(
-            boundaryOp->context(), boundaryOp->domain(), armaSolution),
-        status);
+    // Construct grid functions and return
+    solutions.reserve(rhs.size());
+    for (size_t i = 0; i < rhs.size(); ++i)
+        solutions.push_back(Solution<BasisFunctionType, ResultType>(
+            GridFunction<BasisFunctionType, ResultType>(
+                boundaryOp->context(), boundaryOp->domain(),
+                arma::Col<ResultType>(armaSolution.col(i))),
+            status));
+    return solutions;
 }
 
 template <typename BasisFunctionType, typename ResultType>
-BlockedSolution<BasisFunctionType, ResultType>
-DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplBlocked(
-    const std::vector<GridFunction<BasisFunctionType, ResultType> >& rhs) const
+std::vector<BlockedSolution<BasisFunctionType, ResultType> >
+DefaultIterativeSolver<BasisFunctionType, ResultType>::solveBatch(
+        const std::vector<std::vector<
+        GridFunction<BasisFunctionType, ResultType> > >& rhs) const
 {
     typedef BlockedBoundaryOperator<BasisFunctionType, ResultType> BoundaryOp;
     typedef typename ScalarTraits<ResultType>::RealType MagnitudeType;
-    typedef Thyra::MultiVectorBase<ResultType> TrilinosVector;
 
     const BoundaryOp* boundaryOp = boost::get<BoundaryOp>(&m_impl->op);
     if (!boundaryOp)
@@ -319,44 +501,46 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplBlocked(
             "DefaultIterativeSolver::solve(): for solvers constructed "
             "from a (non-blocked) BoundaryOperator the other solve() overload "
             "must be used");
-    std::vector<GridFunction<BasisFunctionType, ResultType> > canonicalRhs =
+    std::vector<std::vector<GridFunction<BasisFunctionType, ResultType> > >
+            canonicalRhs(rhs.size());
+    for (size_t i = 0; i < rhs.size(); ++i) {
+        canonicalRhs[i] =
             Solver<BasisFunctionType, ResultType>::canonicalizeBlockedRhs(
-        *boundaryOp, rhs, m_impl->mode);
-    // Shouldn't be needed, but better safe than sorry...
-    Solver<BasisFunctionType, ResultType>::checkConsistency(
-                *boundaryOp, canonicalRhs, m_impl->mode);
-
-    // Currently we only support convergence testing in space dual to range.
-
-    // Construct the right-hand-side vector
-    arma::Col<ResultType> armaProjections(
-        boundaryOp->totalGlobalDofCountInDualsToRanges());
-    for (size_t i = 0, start = 0; i < canonicalRhs.size(); ++i) {
-        const arma::Col<ResultType>& chunkProjections =
-                canonicalRhs[i].projections(*boundaryOp->dualToRange(i));
-        size_t chunkSize = chunkProjections.n_rows;
-        armaProjections.rows(start, start + chunkSize - 1) = chunkProjections;
-        start += chunkSize;
+                *boundaryOp, rhs[i], m_impl->mode);
+        // Shouldn't be needed, but better safe than sorry...
+        Solver<BasisFunctionType, ResultType>::checkConsistency(
+                    *boundaryOp, canonicalRhs[i], m_impl->mode);
     }
 
-    Vector<ResultType> projectionsVector(armaProjections);
-    Teuchos::RCP<TrilinosVector> rhsVector;
-    if (m_impl->mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE)
-        rhsVector = Teuchos::rcpFromRef(projectionsVector);
-    else {
-        const size_t rhsSize = boundaryOp->totalGlobalDofCountInRanges();
-        rhsVector.reset(new Vector<ResultType>(rhsSize));
+    std::vector<BlockedSolution<BasisFunctionType, ResultType> > solutions;
+    if (rhs.empty())
+        return solutions;
+
+    // Construct the right-hand-side multivector, one column per right-hand side
+    arma::Mat<ResultType> armaRhs(
+        boundaryOp->totalGlobalDofCountInDualsToRanges(), rhs.size());
+    for (size_t col = 0; col < canonicalRhs.size(); ++col)
+        for (size_t i = 0, start = 0; i < canonicalRhs[col].size(); ++i) {
+            const arma::Col<ResultType>& chunkProjections =
+                    canonicalRhs[col][i].projections(*boundaryOp->dualToRange(i));
+            size_t chunkSize = chunkProjections.n_rows;
+            if (chunkSize > 0)
+                armaRhs.submat(start, col, start + chunkSize - 1, col) =
+                        chunkProjections;
+            start += chunkSize;
+        }
+    if (m_impl->mode == ConvergenceTestMode::TEST_CONVERGENCE_IN_RANGE) {
+        arma::Mat<ResultType> projections;
+        projections.swap(armaRhs);
+        armaRhs.set_size(boundaryOp->totalGlobalDofCountInRanges(), rhs.size());
         boost::get<BoundaryOp>(m_impl->pinvId).weakForm()->apply(
-            Thyra::NOTRANS, projectionsVector, rhsVector.ptr(), 1., 0.);
+            NO_TRANSPOSE, projections, armaRhs, 1., 0.);
     }
 
-    // Initialize the solution vector
-    size_t solutionSize = 0;
-    for (size_t i = 0; i < canonicalRhs.size(); ++i)
-        solutionSize += boundaryOp->domain(i)->globalDofCount();
-    arma::Col<ResultType> armaSolution(solutionSize);
+    // Initialize the solution multivector
+    arma::Mat<ResultType> armaSolution(
+        boundaryOp->totalGlobalDofCountInDomains(), rhs.size());
     armaSolution.fill(static_cast<ResultType>(0.));
-    Teuchos::RCP<TrilinosVector> solutionVector = wrapInTrilinosVector(armaSolution);
 
     // Get context of the first non-empty operator
     size_t rowCount = boundaryOp->rowCount();
@@ -368,35 +552,29 @@ DefaultIterativeSolver<BasisFunctionType, ResultType>::solveImplBlocked(
         }
     assert(context);
 
-    // Get number of threads
     Fiber::ParallelizationOptions parallelOptions =
         context->assemblyOptions().parallelizationOptions();
-    int maxThreadCount = 1;
-    if (!parallelOptions.isOpenClEnabled()) {
-        if (parallelOptions.maxThreadCount() ==
-            ParallelizationOptions::AUTO)
-            maxThreadCount = tbb::task_scheduler_init::automatic;
-        else
-            maxThreadCount = parallelOptions.maxThreadCount();
-    }
 
-    // Solve
+    // Solve for all right-hand sides in a single call
     Thyra::SolveStatus<MagnitudeType> status;
     {
         // Initialize TBB threads here (to prevent their construction and
         // destruction on every matrix-vector multiplication)
-        tbb::task_scheduler_init scheduler(maxThreadCount);
-        status = m_impl->solverWrapper->solve(
-            Thyra::NOTRANS, *rhsVector, solutionVector.ptr());
+        Fiber::ScopedScheduler scheduler(parallelOptions);
+        status = m_impl->solve(armaRhs, armaSolution);
     }
 
-    // Convert chunks of the solution vector into grid functions
-    std::vector<GridFunction<BasisFunctionType, ResultType> > solutionFunctions;
-    Solver<BasisFunctionType, ResultType>::constructBlockedGridFunction(
-        armaSolution, *boundaryOp, solutionFunctions);
-
-    // Return solution
-    return BlockedSolution<BasisFunctionType, ResultType>(solutionFunctions, status);
+    // Convert chunks of the solution vectors into grid functions
+    solutions.reserve(rhs.size());
+    for (size_t col = 0; col < canonicalRhs.size(); ++col) {
+        std::vector<GridFunction<BasisFunctionType, ResultType> > solutionFunctions;
+        Solver<BasisFunctionType, ResultType>::constructBlockedGridFunction(
+            arma::Col<ResultType>(armaSolution.col(col)), *boundaryOp,
+            solutionFunctions);
+        solutions.push_back(BlockedSolution<BasisFunctionType, ResultType>(
+            solutionFunctions, status));
+    }
+    return solutions;
 }
 
 FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(DefaultIterativeSolver);
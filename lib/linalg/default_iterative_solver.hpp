@@ -59,6 +59,13 @@ namespace Bempp
   * Ax=M^\dagger b\f$ is solved, where \f$M\f$ is the mass matrix, mapping from
   * the range space into its dual and \f$M^\dagger\f$ is its pseudoinverse.
   *
+  * To solve the same system for many right-hand sides, pass all of them at
+  * once to solveBatch(). They are then handed to Belos as a single
+  * multivector, so that block solvers such as Pseudo Block GMRES (used by
+  * defaultGmresParameterList()) or Block GMRES (see
+  * defaultBlockGmresParameterList()) apply the discrete operator to all
+  * right-hand sides in one go in each iteration, instead of running a
+  * separate Krylov loop for each of them.
   */
 template <typename BasisFunctionType, typename ResultType>
 class DefaultIterativeSolver : public Solver<BasisFunctionType, ResultType>
@@ -129,6 +136,95 @@ public:
     void initializeSolver(const Teuchos::RCP<Teuchos::ParameterList>& paramList,
                           const Preconditioner<ResultType>& preconditioner);
 
+    /** \brief Enable iterative refinement of solutions.
+     *
+     *  If iterative refinement is enabled, then once the Belos solver has
+     *  returned a solution \f$x\f$, the residual \f$r = b - Ax\f$ is
+     *  evaluated and the solver is run again on the correction equation
+     *  \f$Ad = r\f$; \f$x\f$ is then replaced by \f$x + d\f$. This is
+     *  repeated until the norm of the residual of each right-hand side is at
+     *  most \p tolerance times the norm of that right-hand side or
+     *  \p maximumIterationCount corrections have been made. The status of
+     *  the returned solutions reflects the final residuals.
+     *
+     *  Refinement is mainly useful for weak forms stored in single precision
+     *  (see AcaOptions::singlePrecisionStorage). The Krylov solver and the
+     *  residuals then work on vectors of type \p ResultType, and the solver
+     *  can be initialized with a loose tolerance (say, 1e-4): each
+     *  correction step then reduces the residual by roughly that factor
+     *  while keeping the Krylov subspaces small.
+     *
+     *  The residuals are evaluated with the stored weak form, so they cannot
+     *  be made smaller than the relative accuracy of its matrix-vector
+     *  products. For weak forms stored in single precision this accuracy is
+     *  about 1e-7 even though the products are accumulated in double
+     *  precision; refinement then yields the solution of the system with
+     *  the rounded matrix, not a more accurate one. An exception is thrown
+     *  if \p tolerance is smaller than minimumRefinementTolerance().
+     *
+     *  \param[in] tolerance
+     *    Requested relative residual. Must be positive and not smaller than
+     *    minimumRefinementTolerance().
+     *  \param[in] maximumIterationCount
+     *    Maximum number of correction steps. Must be nonnegative. */
+    void enableIterativeRefinement(double tolerance,
+                                   int maximumIterationCount = 10);
+
+    /** \brief Return the smallest tolerance accepted by
+     *  enableIterativeRefinement().
+     *
+     *  This is ten times the machine epsilon of the precision in which the
+     *  weak form of the system is stored: single precision if any of its
+     *  operators is assembled with AcaOptions::singlePrecisionStorage set,
+     *  otherwise the precision of \p ResultType. */
+    double minimumRefinementTolerance() const;
+
+    /** \brief Disable iterative refinement of solutions.
+     *
+     *  Iterative refinement is disabled by default. */
+    void disableIterativeRefinement();
+
+    /** \brief Return whether iterative refinement of solutions is enabled.
+     *
+     *  See enableIterativeRefinement() for more information. */
+    bool isIterativeRefinementEnabled() const;
+
+    /** \brief Solve a standard (non-blocked) boundary integral equation for
+     *  several right-hand sides at once.
+     *
+     *  The projections of all right-hand sides are gathered into a single
+     *  multivector and passed to the Belos solver in one call. With a block
+     *  solver (e.g. Pseudo Block GMRES or Block GMRES) the weak form is then
+     *  applied to all active right-hand sides simultaneously in each
+     *  iteration.
+     *
+     *  (This function is not an overload of solve(), since
+     *  solve(const std::vector<GridFunction>&) solves a blocked system.)
+     *
+     *  \param[in] rhs
+     *    Vector of right-hand sides.
+     *
+     *  \return A vector of Solution objects; the <em>i</em>th element
+     *  contains the solution corresponding to <tt>rhs[i]</tt>. The status
+     *  reported by each of them is the status of the whole block solve. */
+    std::vector<Solution<BasisFunctionType, ResultType> > solveBatch(
+            const std::vector<GridFunction<BasisFunctionType, ResultType> >&
+            rhs) const;
+
+    /** \brief Solve a block-operator system of boundary integral equations
+     *  for several right-hand sides at once.
+     *
+     *  The <em>i</em>th element of \p rhs is a vector of GridFunctions
+     *  constituting the <em>i</em>th block right-hand side, as in the
+     *  solve(const std::vector<GridFunction>&) overload. All right-hand sides
+     *  are passed to the Belos solver in one call.
+     *
+     *  \return A vector of BlockedSolution objects; the <em>i</em>th element
+     *  contains the solution corresponding to <tt>rhs[i]</tt>. */
+    std::vector<BlockedSolution<BasisFunctionType, ResultType> > solveBatch(
+            const std::vector<std::vector<
+            GridFunction<BasisFunctionType, ResultType> > >& rhs) const;
+
 private:
     virtual Solution<BasisFunctionType, ResultType> solveImplNonblocked(
             const GridFunction<BasisFunctionType, ResultType>& rhs) const;
@@ -139,6 +139,13 @@ void PiecewiseConstantScalarSpace<BasisFunctionType>::getGlobalDofs(
     dofs = m_local2globalDofs[index];
 }
 
+template <typename BasisFunctionType>
+void PiecewiseConstantScalarSpace<BasisFunctionType>::getGlobalDofsOfAllElements(
+        std::vector<std::vector<GlobalDofIndex> >& dofs) const
+{
+    dofs = m_local2globalDofs;
+}
+
 template <typename BasisFunctionType>
 void PiecewiseConstantScalarSpace<BasisFunctionType>::global2localDofs(
         const std::vector<GlobalDofIndex>& globalDofs,
@@ -25,6 +25,7 @@
 #include "../fiber/explicit_instantiation.hpp"
 #include "../grid/entity.hpp"
 #include "../grid/entity_iterator.hpp"
+#include "../grid/flat_grid_data.hpp"
 #include "../grid/geometry.hpp"
 #include "../grid/grid.hpp"
 #include "../grid/grid_view.hpp"
@@ -121,56 +122,30 @@ void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::setElementVariant(
 template <typename BasisFunctionType>
 void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::assignDofsImpl()
 {
-    const int gridDim = domainDimension();
-
-    const Mapper& elementMapper = m_view->elementMapper();
-    const IndexSet& indexSet = m_view->indexSet();
+    const FlatGridData& flatData = m_view->flatGridData();
+    const std::vector<int>& elementVertexOffsets = flatData.elementVertexOffsets();
+    const std::vector<int>& elementVertices = flatData.elementVertices();
+    const std::vector<int>& vertexElementOffsets = flatData.vertexElementOffsets();
 
     // Global DOF numbers will be identical with vertex indices.
     // Thus, the will be as many global DOFs as there are vertices.
-    int globalDofCount_ = m_view->entityCount(this->grid()->dim());
-    int elementCount = m_view->entityCount(0);
-
-//    // DEBUG
-//    {
-//        std::cout << "Vertices:\n" << std::endl;
-//        std::auto_ptr<EntityIterator<2> > vit = m_view->entityIterator<2>();
-//        const IndexSet& indexSet = m_view->indexSet();
-//        while (!vit->finished())
-//        {
-//            arma::Col<BasisFunctionType> vertex;
-//            vit->entity().geometry().center(vertex);
-//            std::cout << indexSet.entityIndex(vit->entity()) << ": "
-//                      << vertex(0) << " "
-//                      << vertex(1) << " "
-//                      << vertex(2) << std::endl;
-//            vit->next();
-//        }
-//    }
+    int globalDofCount_ = flatData.vertexCount();
+    int elementCount = flatData.elementCount();
 
     // (Re)initialise DOF maps
     m_local2globalDofs.clear();
     m_local2globalDofs.resize(elementCount);
     m_global2localDofs.clear();
     m_global2localDofs.resize(globalDofCount_);
-    // TODO: consider calling reserve(x) for each element of m_global2localDofs
-    // with x being the typical number of elements adjacent to a vertex in a
-    // grid of dimension gridDim
+    for (int v = 0; v < globalDofCount_; ++v)
+        m_global2localDofs[v].reserve(
+                    vertexElementOffsets[v + 1] - vertexElementOffsets[v]);
 
     // Iterate over elements
-    std::auto_ptr<EntityIterator<0> > it = m_view->entityIterator<0>();
-    m_flatLocalDofCount = 0;
-    while (!it->finished())
+    m_flatLocalDofCount = elementVertices.size();
+    for (int elementIndex = 0; elementIndex < elementCount; ++elementIndex)
     {
-        const Entity<0>& element = it->entity();
-        EntityIndex elementIndex = elementMapper.entityIndex(element);
-
-        int vertexCount;
-        if (gridDim == 1)
-            vertexCount = element.template subEntityCount<1>();
-        else // gridDim == 2
-            vertexCount = element.template subEntityCount<2>();
-        m_flatLocalDofCount += vertexCount;
+        const int vertexCount = flatData.elementCornerCount(elementIndex);
 
         // List of global DOF indices corresponding to the local DOFs of the
         // current element
@@ -178,11 +153,11 @@ void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::assignDofsImpl()
         globalDofs.resize(vertexCount);
         for (int i = 0; i < vertexCount; ++i)
         {
-            GlobalDofIndex globalDofIndex = indexSet.subEntityIndex(element, i, gridDim);
+            GlobalDofIndex globalDofIndex =
+                    elementVertices[elementVertexOffsets[elementIndex] + i];
             globalDofs[i] = globalDofIndex;
             m_global2localDofs[globalDofIndex].push_back(LocalDof(elementIndex, i));
         }
-        it->next();
     }
 
     // Initialize the container mapping the flat local dof indices to
@@ -223,6 +198,13 @@ void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::getGlobalDofs(
     dofs = m_local2globalDofs[index];
 }
 
+template <typename BasisFunctionType>
+void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::getGlobalDofsOfAllElements(
+        std::vector<std::vector<GlobalDofIndex> >& dofs) const
+{
+    dofs = m_local2globalDofs;
+}
+
 template <typename BasisFunctionType>
 void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::global2localDofs(
         const std::vector<GlobalDofIndex>& globalDofs,
@@ -251,39 +233,16 @@ void PiecewiseLinearContinuousScalarSpace<BasisFunctionType>::getGlobalDofPositi
     const int globalDofCount_ = globalDofCount();
     positions.resize(globalDofCount_);
 
-    const IndexSet& indexSet = m_view->indexSet();
-
-    if (gridDim == 1)
+    // Global DOFs coincide with vertices
+    const FlatGridData& flatData = m_view->flatGridData();
+    const double* x = flatData.vertexCoordinates(0);
+    const double* y = flatData.vertexCoordinates(1);
+    const double* z = gridDim == 1 ? 0 : flatData.vertexCoordinates(2);
+    for (int index = 0; index < globalDofCount_; ++index)
     {
-        std::auto_ptr<EntityIterator<1> > it = m_view->entityIterator<1>();
-        while (!it->finished())
-        {
-            const Entity<1>& e = it->entity();
-            int index = indexSet.entityIndex(e);
-            arma::Col<CoordinateType> vertex;
-            e.geometry().getCenter(vertex);
-
-            positions[index].x = vertex(0);
-            positions[index].y = vertex(1);
-            positions[index].z = 0.;
-            it->next();
-        }
-    }
-    else // gridDim == 2
-    {
-        std::auto_ptr<EntityIterator<2> > it = m_view->entityIterator<2>();
-        while (!it->finished())
-        {
-            const Entity<2>& e = it->entity();
-            int index = indexSet.entityIndex(e);
-            arma::Col<CoordinateType> vertex;
-            e.geometry().getCenter(vertex);
-
-            positions[index].x = vertex(0);
-            positions[index].y = vertex(1);
-            positions[index].z = vertex(2);
-            it->next();
-        }
+        positions[index].x = x[index];
+        positions[index].y = y[index];
+        positions[index].z = gridDim == 1 ? 0. : z[index];
     }
 }
 
@@ -69,6 +69,8 @@ public:
     virtual size_t flatLocalDofCount() const;
     virtual void getGlobalDofs(const Entity<0>& element,
                             std::vector<GlobalDofIndex>& dofs) const;
+    virtual void getGlobalDofsOfAllElements(
+            std::vector<std::vector<GlobalDofIndex> >& dofs) const;
     virtual void global2localDofs(
             const std::vector<GlobalDofIndex>& globalDofs,
             std::vector<std::vector<LocalDof> >& localDofs) const;
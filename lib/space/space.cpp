@@ -54,19 +54,8 @@ void constructGlobalToFlatLocalDofsMappingVectors(
 {
     const int ldofCount = space.flatLocalDofCount();
 
-    std::auto_ptr<GridView> view = space.grid()->leafView();
-    const IndexSet& indexSet = view->indexSet();
-    const size_t elementCount = view->entityCount(0);
-
     std::vector<std::vector<GlobalDofIndex> > gdofs;
-    gdofs.resize(elementCount);
-    std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
-    while (!it->finished()) {
-        const Entity<0>& e = it->entity();
-        int index = indexSet.entityIndex(e);
-        space.getGlobalDofs(e, gdofs[index]);
-        it->next();
-    }
+    space.getGlobalDofsOfAllElements(gdofs);
 
     rows.clear();
     cols.clear();
@@ -146,6 +135,22 @@ bool Space<BasisFunctionType>::dofsAssigned() const
     return true;
 }
 
+template <typename BasisFunctionType>
+void Space<BasisFunctionType>::getGlobalDofsOfAllElements(
+        std::vector<std::vector<GlobalDofIndex> >& dofs) const
+{
+    std::auto_ptr<GridView> view = m_grid->leafView();
+    const Mapper& mapper = view->elementMapper();
+    dofs.resize(view->entityCount(0));
+
+    std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+    while (!it->finished()) {
+        const Entity<0>& e = it->entity();
+        getGlobalDofs(e, dofs[mapper.entityIndex(e)]);
+        it->next();
+    }
+}
+
 template <typename BasisFunctionType>
 void getAllBases(const Space<BasisFunctionType>& space,
         std::vector<const Fiber::Basis<BasisFunctionType>*>& bases)
@@ -195,6 +195,21 @@ public:
     virtual void getGlobalDofs(const Entity<0>& element,
                                std::vector<GlobalDofIndex>& dofs) const = 0;
 
+    /** \brief Map local degrees of freedom residing on all elements to global
+     *  degrees of freedom.
+     *
+     *  \param[out] dofs
+     *    Vector whose <em>e</em>th element contains the indices of the global
+     *    degrees of freedom corresponding to the local degrees of freedom
+     *    residing on the element with index \e e (as given by the element
+     *    mapper of the leaf view of grid()).
+     *
+     *  The default implementation calls getGlobalDofs() for each element of
+     *  the leaf view of grid(). Spaces storing their DOF lists in a table
+     *  indexed by element should override it to copy that table. */
+    virtual void getGlobalDofsOfAllElements(
+            std::vector<std::vector<GlobalDofIndex> >& dofs) const;
+
     /** \brief Map global degrees of freedom to local degrees of freedom.
      *
      *  \param[in] globalDofs
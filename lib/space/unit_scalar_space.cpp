@@ -136,6 +136,13 @@ void UnitScalarSpace<BasisFunctionType>::getGlobalDofs(
     dofs = m_local2globalDofs[index];
 }
 
+template <typename BasisFunctionType>
+void UnitScalarSpace<BasisFunctionType>::getGlobalDofsOfAllElements(
+        std::vector<std::vector<GlobalDofIndex> >& dofs) const
+{
+    dofs = m_local2globalDofs;
+}
+
 template <typename BasisFunctionType>
 void UnitScalarSpace<BasisFunctionType>::global2localDofs(
         const std::vector<GlobalDofIndex>& globalDofs,
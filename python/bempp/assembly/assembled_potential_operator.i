@@ -0,0 +1,77 @@
+%{
+#include "assembly/assembled_potential_operator.hpp"
+%}
+
+namespace Bempp
+{
+
+BEMPP_FORWARD_DECLARE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(AssembledPotentialOperator);
+
+%extend AssembledPotentialOperator
+{
+    %apply arma::Mat<float>& ARGOUT_MAT { arma::Mat<float>& result_ };
+    %apply arma::Mat<double>& ARGOUT_MAT { arma::Mat<double>& result_ };
+    %apply arma::Mat<std::complex<float> >& ARGOUT_MAT
+        { arma::Mat<std::complex<float> >& result_ };
+    %apply arma::Mat<std::complex<double> >& ARGOUT_MAT
+        { arma::Mat<std::complex<double> >& result_ };
+
+    %apply const arma::Mat<float>& IN_MAT
+        { const arma::Mat<float>& argumentCoefficients };
+    %apply const arma::Mat<double>& IN_MAT
+        { const arma::Mat<double>& argumentCoefficients };
+    %apply const arma::Mat<std::complex<float> >& IN_MAT
+        { const arma::Mat<std::complex<float> >& argumentCoefficients };
+    %apply const arma::Mat<std::complex<double> >& IN_MAT
+        { const arma::Mat<std::complex<double> >& argumentCoefficients };
+
+    %ignore AssembledPotentialOperator;
+    %ignore evaluationPoints;
+
+    void _apply(
+        arma::Mat<ResultType>& result_,
+        const GridFunction<BasisFunctionType_, ResultType_>& argument)
+    {
+        result_ = $self->apply(argument);
+    }
+
+    void _applyBatch(
+        arma::Mat<ResultType>& result_,
+        const arma::Mat<ResultType>& argumentCoefficients)
+    {
+        result_ = $self->applyBatch(argumentCoefficients);
+    }
+
+    %ignore apply;
+    %ignore applyBatch;
+
+    %pythoncode {
+        def apply(self, argument):
+            return self._apply(argument)
+
+        def applyBatch(self, argumentCoefficients):
+            return self._applyBatch(argumentCoefficients)
+    }
+}
+
+BEMPP_EXTEND_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(AssembledPotentialOperator);
+
+} // namespace Bempp
+
+#define shared_ptr boost::shared_ptr
+%include "assembly/assembled_potential_operator.hpp"
+#undef shared_ptr
+
+namespace Bempp
+{
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(AssembledPotentialOperator);
+}
+
+%clear arma::Mat<float>& result_;
+%clear arma::Mat<double>& result_;
+%clear arma::Mat<std::complex<float> >& result_;
+%clear arma::Mat<std::complex<double> >& result_;
+%clear const arma::Mat<float>& argumentCoefficients;
+%clear const arma::Mat<double>& argumentCoefficients;
+%clear const arma::Mat<std::complex<float> >& argumentCoefficients;
+%clear const arma::Mat<std::complex<double> >& argumentCoefficients;
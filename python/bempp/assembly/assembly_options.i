@@ -15,6 +15,7 @@ namespace Bempp
 %feature("autodoc", "outputPostscript -> bool") AcaOptions::outputPostscript;
 %feature("autodoc", "recompress -> bool") AcaOptions::recompress;
 %feature("autodoc", "scaling -> float") AcaOptions::scaling;
+%feature("autodoc", "singlePrecisionStorage -> bool") AcaOptions::singlePrecisionStorage;
 
 %extend AssemblyOptions
 {
@@ -21,6 +21,8 @@ class AssemblyOptions;
 
 BEMPP_EXTEND_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(Context);
 
+%ignore Context::massMatrixCache;
+
 } // namespace Bempp
 
 #define shared_ptr boost::shared_ptr
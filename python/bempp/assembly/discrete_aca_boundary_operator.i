@@ -9,6 +9,7 @@
 namespace Bempp 
 {
     %ignore DiscreteAcaBoundaryOperator;
+    %ignore singlePrecisionAcaOperator;
 }
 
 #define shared_ptr boost::shared_ptr
@@ -24,6 +25,10 @@ namespace Bempp
          scaledAcaOperator< VALUE >;
     %template(acaOperatorSum_## PY_VALUE) 
          acaOperatorSum< VALUE >;
+    %template(saveAcaOperator_## PY_VALUE)
+         saveAcaOperator< VALUE >;
+    %template(loadAcaOperator_## PY_VALUE)
+         loadAcaOperator< VALUE >;
 }
 %enddef
 
@@ -40,6 +40,13 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_VALUE(DiscreteBoundaryOperator)
     // this function is only for internal use
     %ignore addBlock;
 
+    // the multi-vector overload of apply() is exposed through matmat()
+    %ignore apply(const TranspositionMode trans,
+                  const arma::Mat<ValueType>& x_in,
+                  arma::Mat<ValueType>& y_inout,
+                  const ValueType alpha,
+                  const ValueType beta) const;
+
     %apply const arma::Col<float>& IN_COL {
         const arma::Col<float>& x_in
     };
@@ -128,11 +135,7 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_VALUE(DiscreteBoundaryOperator)
         mat_out.zeros(opRows,matCols);
         if (opCols!=matRows)
             throw std::invalid_argument("__matrixMultImpl(): Wrong dimensions.");
-        for (int i=0;i<matCols;i++){
-            arma::Col< ValueType > tmp1 = mat_in.unsafe_col(i);
-            arma::Col< ValueType > tmp2 = mat_out.unsafe_col(i);
-            op->apply(Bempp::NO_TRANSPOSE,tmp1,tmp2,1.0,0.0);
-        }
+        op->apply(Bempp::NO_TRANSPOSE,mat_in,mat_out,1.0,0.0);
     }
 
     static void
@@ -147,11 +150,7 @@ BEMPP_EXTEND_CLASS_TEMPLATED_ON_VALUE(DiscreteBoundaryOperator)
         mat_out.zeros(opCols,matCols);
         if (opRows!=matRows)
             throw std::invalid_argument("__matrixHMultImpl(): Wrong dimensions.");
-        for (int i=0;i<matCols;i++){
-            arma::Col< ValueType > tmp1 = mat_in.unsafe_col(i);
-            arma::Col< ValueType > tmp2 = mat_out.unsafe_col(i);
-            op->apply(Bempp::CONJUGATE_TRANSPOSE,tmp1,tmp2,1.0,0.0);
-        }
+        op->apply(Bempp::CONJUGATE_TRANSPOSE,mat_in,mat_out,1.0,0.0);
     }
 
     %feature("compactdefaultargs") asDiscreteAcaBoundaryOperator;
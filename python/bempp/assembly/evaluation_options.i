@@ -5,9 +5,14 @@
 namespace Bempp
 {
 
+%feature("autodoc", "eta -> float") HierarchicalEvaluationOptions::eta;
+%feature("autodoc", "interpolationOrder -> int") HierarchicalEvaluationOptions::interpolationOrder;
+%feature("autodoc", "maximumLeafSize -> int") HierarchicalEvaluationOptions::maximumLeafSize;
+
 %extend EvaluationOptions
 {
     %ignore switchToTbb;
+    %feature("compactdefaultargs") enableNearFieldQuadrature;
 }
 
 } // namespace Bempp
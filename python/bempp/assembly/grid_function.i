@@ -44,9 +44,18 @@ gridFunctionFromPythonSurfaceNormalIndependentFunctor(
     const boost::shared_ptr<const Space<BasisFunctionType> >& dualSpace,
     const PythonSurfaceNormalIndependentFunctor<ResultType>& functor)
 {
-    return new GridFunction<BasisFunctionType, ResultType>(
-        context, space, dualSpace,
-        surfaceNormalIndependentFunction(functor));
+    // Copies of the Python functor must be made and destroyed while the GIL
+    // is held
+    const SurfaceNormalIndependentFunction<
+        PythonSurfaceNormalIndependentFunctor<ResultType> > function(functor);
+    GridFunction<BasisFunctionType, ResultType>* result;
+    {
+        // Let the threads calculating projections evaluate the functor
+        PythonGilRelease gilRelease;
+        result = new GridFunction<BasisFunctionType, ResultType>(
+            context, space, dualSpace, function);
+    }
+    return result;
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -57,9 +66,18 @@ gridFunctionFromPythonSurfaceNormalDependentFunctor(
     const boost::shared_ptr<const Space<BasisFunctionType> >& dualSpace,
     const PythonSurfaceNormalDependentFunctor<ResultType>& functor)
 {
-    return new GridFunction<BasisFunctionType, ResultType>(
-        context, space, dualSpace,
-        surfaceNormalDependentFunction(functor));
+    // Copies of the Python functor must be made and destroyed while the GIL
+    // is held
+    const SurfaceNormalDependentFunction<
+        PythonSurfaceNormalDependentFunctor<ResultType> > function(functor);
+    GridFunction<BasisFunctionType, ResultType>* result;
+    {
+        // Let the threads calculating projections evaluate the functor
+        PythonGilRelease gilRelease;
+        result = new GridFunction<BasisFunctionType, ResultType>(
+            context, space, dualSpace, function);
+    }
+    return result;
 }
 
 template <typename BasisFunctionType, typename ResultType>
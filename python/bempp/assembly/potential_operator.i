@@ -1,5 +1,6 @@
 %{
 #include "assembly/potential_operator.hpp"
+#include <boost/make_shared.hpp>
 %}
 
 BEMPP_DECLARE_SHARED_PTR_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(
@@ -38,11 +39,31 @@ BEMPP_FORWARD_DECLARE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(PotentialOperator);
 
     %ignore evaluateAtPoints;
 
+    AssembledPotentialOperator<BasisFunctionType_, ResultType_> _assemble(
+        const boost::shared_ptr<const Space<BasisFunctionType_> >& space,
+        const arma::Mat<CoordinateType>& evaluationPoints,
+        const Fiber::QuadratureStrategy<
+        BasisFunctionType_, ResultType_, GeometryFactory>& quadStrategy,
+        const EvaluationOptions& options)
+    {
+        return $self->assemble(
+            space,
+            boost::make_shared<const arma::Mat<CoordinateType> >(evaluationPoints),
+            quadStrategy, options);
+    }
+
+    %ignore assemble;
+
     %pythoncode {
         def evaluateAtPoints(self, argument, evaluationPoints,
                              evaluationOptions=EvaluationOptions()):
             return self._evaluateAtPoints(argument, evaluationPoints,
                                           self._context.quadStrategy(), evaluationOptions)
+
+        def assemble(self, space, evaluationPoints,
+                     evaluationOptions=EvaluationOptions()):
+            return self._assemble(space, evaluationPoints,
+                                  self._context.quadStrategy(), evaluationOptions)
     }
 }
 
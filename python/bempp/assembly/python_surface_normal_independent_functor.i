@@ -28,7 +28,19 @@ public:
         Py_INCREF(m_pyFunc); // Increase shared pointer reference count
     }
 
+    PythonSurfaceNormalIndependentFunctor(
+        const PythonSurfaceNormalIndependentFunctor& other) :
+            m_pyFunc(other.m_pyFunc),
+            m_argumentDimension(other.m_argumentDimension),
+            m_resultDimension(other.m_resultDimension) {
+        // Copies may be made outside the Python interpreter's control
+        PythonGilLock lock;
+        Py_INCREF(m_pyFunc);
+    }
+
     ~PythonSurfaceNormalIndependentFunctor() {
+        // May be called from a thread that does not hold the GIL
+        PythonGilLock lock;
         Py_DECREF(m_pyFunc);
     }
 
@@ -43,6 +55,9 @@ public:
     void evaluate(const arma::Col<CoordinateType>& point,
                   arma::Col<ValueType>& result_) const
     {
+        // May be called from a worker thread during parallel assembly
+        PythonGilLock lock;
+
         const int coordinateNumpyType = PythonScalarTraits<CoordinateType>::numpyType;
         const int valueNumpyType = PythonScalarTraits<ValueType>::numpyType;
 
@@ -113,6 +128,10 @@ public:
     }
 
 private:
+    // Not assignable
+    PythonSurfaceNormalIndependentFunctor& operator=(
+        const PythonSurfaceNormalIndependentFunctor&);
+
     PyObject* m_pyFunc;
     int m_argumentDimension;
     int m_resultDimension;
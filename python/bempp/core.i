@@ -130,6 +130,7 @@ AUTO_PTR_TYPEMAPS_FOR_CLASS_TEMPLATED_ON_RESULT(Bempp::InterpolatedFunction)
 // Fiber
 %include "fiber/opencl_options.i"
 %include "fiber/parallelization_options.i"
+%include "fiber/thread_pool.i"
 %include "fiber/quadrature_options.i"
 %include "fiber/accuracy_options.i"
 %include "fiber/quadrature_strategy.i"
@@ -160,6 +161,7 @@ AUTO_PTR_TYPEMAPS_FOR_CLASS_TEMPLATED_ON_RESULT(Bempp::InterpolatedFunction)
 %include "assembly/modified_helmholtz_3d_operators.i"
 %include "assembly/identity_operator.i"
 %include "assembly/null_operator.i"
+%include "assembly/assembled_potential_operator.i"
 %include "assembly/potential_operator.i"
 %include "assembly/helmholtz_3d_potential_operators.i"
 %include "assembly/laplace_3d_potential_operators.i"
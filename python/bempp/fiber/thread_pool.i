@@ -0,0 +1,16 @@
+%{
+#include "fiber/thread_pool.hpp"
+%}
+
+namespace Fiber
+{
+
+// ScopedScheduler is only used internally by parallel operations
+%ignore ScopedScheduler;
+
+// ThreadPool derives from boost::noncopyable, which is not wrapped
+%warnfilter(401) ThreadPool;
+
+}
+
+%include "fiber/thread_pool.hpp"
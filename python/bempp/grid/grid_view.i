@@ -95,6 +95,7 @@ namespace Bempp
 
     %ignore elementMapper;
     %ignore reverseElementMapper;
+    %ignore flatGridData;
 
     %pythonappend indexSet %{
         val._parentGridView = self
@@ -9,11 +9,29 @@
 
 #ifdef WITH_TRILINOS
 
+// Lists of solutions returned by solveBatch(). Solution has no default
+// constructor, so the vector methods requiring one are not wrapped.
+%define BEMPP_DECLARE_VECTOR_OF_SOLUTIONS(BASIS, RESULT, PYBASIS, PYRESULT)
+    %ignore std::vector<Bempp::Solution< BASIS, RESULT > >::vector(size_type);
+    %ignore std::vector<Bempp::Solution< BASIS, RESULT > >::resize;
+    %template(vector_Solution_ ## PYBASIS ## _ ## PYRESULT)
+        std::vector<Bempp::Solution< BASIS, RESULT > >;
+%enddef
+BEMPP_ITERATE_OVER_BASIS_AND_RESULT_TYPES(BEMPP_DECLARE_VECTOR_OF_SOLUTIONS);
+
 namespace Bempp
 {
 
 BEMPP_FORWARD_DECLARE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(DefaultIterativeSolver);
 
+%extend DefaultIterativeSolver
+{
+    // only the variant of solveBatch() for non-blocked operators is wrapped
+    %ignore solveBatch(
+        const std::vector<std::vector<
+        GridFunction<BasisFunctionType, ResultType> > >& rhs) const;
+}
+
 %define BEMPP_EXTEND_DEFAULT_ITERATIVE_SOLVER(BASIS, RESULT, PYBASIS, PYRESULT)
     %extend DefaultIterativeSolver< BASIS, RESULT >
     {
@@ -30,6 +48,8 @@ Teuchos::RCP<Teuchos::ParameterList> defaultGmresParameterList(
     double tol, int maxIterationCount = 1000);
 Teuchos::RCP<Teuchos::ParameterList> defaultCgParameterList(
     double tol, int maxIterationCount = 1000);
+Teuchos::RCP<Teuchos::ParameterList> defaultBlockGmresParameterList(
+    double tol, int blockSize, int maxIterationCount = 1000);
 
 } // namespace Bempp
 
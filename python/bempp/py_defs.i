@@ -1,2 +1,52 @@
 // Useful Python tools
 
+
+%{
+namespace Bempp
+{
+
+// Acquire the global interpreter lock for the lifetime of this object. Must
+// be used by C++ code that calls into Python and may run in a worker thread.
+class PythonGilLock
+{
+public:
+    PythonGilLock() : m_state(PyGILState_Ensure()) {
+    }
+
+    ~PythonGilLock() {
+        PyGILState_Release(m_state);
+    }
+
+private:
+    PythonGilLock(const PythonGilLock&);
+    PythonGilLock& operator=(const PythonGilLock&);
+
+    PyGILState_STATE m_state;
+};
+
+// Release the global interpreter lock for the lifetime of this object, so
+// that worker threads started by the C++ code invoked in the meantime can
+// call back into Python.
+class PythonGilRelease
+{
+public:
+    PythonGilRelease() : m_state(PyEval_SaveThread()) {
+    }
+
+    ~PythonGilRelease() {
+        PyEval_RestoreThread(m_state);
+    }
+
+private:
+    PythonGilRelease(const PythonGilRelease&);
+    PythonGilRelease& operator=(const PythonGilRelease&);
+
+    PyThreadState* m_state;
+};
+
+} // namespace Bempp
+%}
+
+%init %{
+    PyEval_InitThreads();
+%}
@@ -0,0 +1,52 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef bempp_create_points_around_sphere_hpp
+#define bempp_create_points_around_sphere_hpp
+
+#include "common/armadillo_fwd.hpp"
+#include <cmath>
+
+/** \brief Return points lying on spheres centred at the origin.
+ *
+ *  For each of the \p radiusCount radii stored in \p radii, \p directionCount
+ *  points are generated, spread over the sphere of that radius. The
+ *  coordinates of the (<tt>r * directionCount + d</tt>)th point, which lies
+ *  on the sphere of radius <tt>radii[r]</tt>, are stored in the
+ *  corresponding column of the returned 3 x (<tt>radiusCount *
+ *  directionCount</tt>) matrix. */
+template <typename RealType>
+arma::Mat<RealType> createPointsAroundSphere(
+    const RealType* radii, int radiusCount, int directionCount)
+{
+    arma::Mat<RealType> points(3, radiusCount * directionCount);
+    for (int r = 0; r < radiusCount; ++r)
+        for (int d = 0; d < directionCount; ++d) {
+            const int point = r * directionCount + d;
+            const RealType theta = 0.3 + 2.5 * d / directionCount;
+            const RealType phi = 1.7 * d;
+            points(0, point) = radii[r] * std::sin(theta) * std::cos(phi);
+            points(1, point) = radii[r] * std::sin(theta) * std::sin(phi);
+            points(2, point) = radii[r] * std::cos(theta);
+        }
+    return points;
+}
+
+#endif
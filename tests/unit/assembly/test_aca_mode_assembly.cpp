@@ -25,7 +25,9 @@
 #include "../type_template.hpp"
 #include "../check_arrays_are_close.hpp"
 
+#include "assembly/ahmed_aux.hpp"
 #include "assembly/context.hpp"
+#include "assembly/discrete_aca_boundary_operator.hpp"
 #include "assembly/discrete_boundary_operator.hpp"
 #include "assembly/laplace_3d_adjoint_double_layer_boundary_operator.hpp"
 #include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
@@ -42,6 +44,8 @@
 #include <boost/type_traits/is_complex.hpp>
 #include "grid/grid.hpp"
 
+#include <limits>
+
 using namespace Bempp;
 
 // Tests
@@ -344,6 +348,306 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(aca_of_disassembled_helmholtz_hypersingular_operat
                     weakFormDense, weakFormAca, 2. * acaOptions.eps));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(aca_with_cached_singular_integrals_agrees_with_aca_without_caching_for_distance_dependent_quadrature,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.2.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    // Several regular quadrature orders, so that each row and column of an
+    // ACA block mixes cached local weak forms with several quadrature
+    // variants
+    AccuracyOptionsEx accuracyOptions;
+    accuracyOptions.setDoubleRegular(2., 3, 4., 2, 1);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+
+    AcaOptions acaOptions;
+
+    AssemblyOptions assemblyOptionsCached;
+    assemblyOptionsCached.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptionsCached.enableSingularIntegralCaching(true);
+    assemblyOptionsCached.switchToAcaMode(acaOptions);
+    shared_ptr<Context<BFT, RT> > contextCached(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsCached));
+
+    AssemblyOptions assemblyOptionsUncached;
+    assemblyOptionsUncached.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptionsUncached.enableSingularIntegralCaching(false);
+    assemblyOptionsUncached.switchToAcaMode(acaOptions);
+    shared_ptr<Context<BFT, RT> > contextUncached(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsUncached));
+
+    AssemblyOptions assemblyOptionsDense;
+    assemblyOptionsDense.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > contextDense(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsDense));
+
+    BoundaryOperator<BFT, RT> opCached =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                contextCached, pwiseLinears, pwiseConstants, pwiseLinears);
+    BoundaryOperator<BFT, RT> opUncached =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                contextUncached, pwiseLinears, pwiseConstants, pwiseLinears);
+    BoundaryOperator<BFT, RT> opDense =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                contextDense, pwiseLinears, pwiseConstants, pwiseLinears);
+    arma::Mat<RT> weakFormCached = opCached.weakForm()->asMatrix();
+    arma::Mat<RT> weakFormUncached = opUncached.weakForm()->asMatrix();
+    arma::Mat<RT> weakFormDense = opDense.weakForm()->asMatrix();
+
+    // Cached local weak forms are computed by the same integrators, so ACA
+    // should see the same entries and make the same choices
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    weakFormCached, weakFormUncached,
+                    100. * std::numeric_limits<RealType>::epsilon()));
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    weakFormDense, weakFormCached, 2. * acaOptions.eps));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(aca_with_recompression_agrees_with_dense_assembly_for_614_element_mesh,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.2.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    accuracyOptions.doubleRegular.setRelativeQuadratureOrder(1);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+
+    AssemblyOptions assemblyOptionsDense;
+    assemblyOptionsDense.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > contextDense(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsDense));
+
+    BoundaryOperator<BFT, RT> opDense =
+            laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                contextDense, pwiseLinears, pwiseLinears, pwiseConstants);
+    arma::Mat<RT> weakFormDense = opDense.weakForm()->asMatrix();
+
+    AssemblyOptions assemblyOptionsAca;
+    assemblyOptionsAca.setVerbosityLevel(VerbosityLevel::LOW);
+    AcaOptions acaOptions;
+    acaOptions.recompress = true;
+    assemblyOptionsAca.switchToAcaMode(acaOptions);
+    shared_ptr<Context<BFT, RT> > contextAca(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsAca));
+
+    BoundaryOperator<BFT, RT> opAca =
+            laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                contextAca, pwiseLinears, pwiseLinears, pwiseConstants);
+    arma::Mat<RT> weakFormAca = opAca.weakForm()->asMatrix();
+
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    weakFormDense, weakFormAca, 4. * acaOptions.eps));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(parallel_recompression_agrees_with_serial_recompression,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.2.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    accuracyOptions.doubleRegular.setRelativeQuadratureOrder(1);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+
+    AcaOptions acaOptions;
+    acaOptions.recompress = true;
+
+    // With a single thread agglH() is called once on the whole tree
+    AssemblyOptions assemblyOptionsSerial;
+    assemblyOptionsSerial.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptionsSerial.setMaxThreadCount(1);
+    assemblyOptionsSerial.switchToAcaMode(acaOptions);
+    shared_ptr<Context<BFT, RT> > contextSerial(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsSerial));
+
+    AssemblyOptions assemblyOptionsParallel;
+    assemblyOptionsParallel.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptionsParallel.setMaxThreadCount(4);
+    assemblyOptionsParallel.switchToAcaMode(acaOptions);
+    shared_ptr<Context<BFT, RT> > contextParallel(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsParallel));
+
+    BoundaryOperator<BFT, RT> opSerial =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                contextSerial, pwiseConstants, pwiseConstants, pwiseConstants);
+    BoundaryOperator<BFT, RT> opParallel =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                contextParallel, pwiseConstants, pwiseConstants, pwiseConstants);
+
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > weakFormSerial =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(opSerial.weakForm());
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > weakFormParallel =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(opParallel.weakForm());
+
+    // Same block structure and storage...
+    BOOST_CHECK_EQUAL(weakFormSerial->blockCount(),
+                      weakFormParallel->blockCount());
+    BOOST_CHECK_EQUAL(weakFormSerial->actualMaximumRank(),
+                      weakFormParallel->actualMaximumRank());
+    // const_cast because Ahmed is not const-correct
+    BOOST_CHECK_EQUAL(
+        sizeH(const_cast<blcluster*>(static_cast<const blcluster*>(
+                  weakFormSerial->blockCluster().get())),
+              weakFormSerial->blocks().get()),
+        sizeH(const_cast<blcluster*>(static_cast<const blcluster*>(
+                  weakFormParallel->blockCluster().get())),
+              weakFormParallel->blocks().get()));
+    // ... and the same accuracy
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    weakFormSerial->asMatrix(), weakFormParallel->asMatrix(),
+                    100. * std::numeric_limits<RealType>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(operators_on_same_spaces_share_block_cluster_tree,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.2.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    accuracyOptions.doubleRegular.setRelativeQuadratureOrder(1);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+
+    AssemblyOptions assemblyOptionsAca;
+    assemblyOptionsAca.setVerbosityLevel(VerbosityLevel::LOW);
+    AcaOptions acaOptions;
+    assemblyOptionsAca.switchToAcaMode(acaOptions);
+    shared_ptr<Context<BFT, RT> > contextAca(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsAca));
+
+    BoundaryOperator<BFT, RT> dlpOp =
+            laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                contextAca, pwiseLinears, pwiseLinears, pwiseConstants);
+    BoundaryOperator<BFT, RT> adlpOp =
+            laplace3dAdjointDoubleLayerBoundaryOperator<BFT, RT>(
+                contextAca, pwiseLinears, pwiseLinears, pwiseConstants);
+
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > dlpWeakForm =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(dlpOp.weakForm());
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > adlpWeakForm =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(adlpOp.weakForm());
+    BOOST_CHECK(dlpWeakForm->blockCluster() == adlpWeakForm->blockCluster());
+
+    // The shared tree must not affect the values of the operators
+    AssemblyOptions assemblyOptionsDense;
+    assemblyOptionsDense.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > contextDense(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsDense));
+    BoundaryOperator<BFT, RT> adlpOpDense =
+            laplace3dAdjointDoubleLayerBoundaryOperator<BFT, RT>(
+                contextDense, pwiseLinears, pwiseLinears, pwiseConstants);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    adlpOpDense.weakForm()->asMatrix(),
+                    adlpWeakForm->asMatrix(), 2. * acaOptions.eps));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(block_cluster_trees_for_different_options_are_cached_separately,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.2.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    accuracyOptions.doubleRegular.setRelativeQuadratureOrder(1);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+
+    AcaOptions acaOptionsSmall;
+    acaOptionsSmall.minimumBlockSize = 8;
+    AssemblyOptions assemblyOptionsSmall;
+    assemblyOptionsSmall.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptionsSmall.switchToAcaMode(acaOptionsSmall);
+    shared_ptr<Context<BFT, RT> > contextSmall(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsSmall));
+
+    AcaOptions acaOptionsLarge;
+    acaOptionsLarge.minimumBlockSize = 32;
+    AssemblyOptions assemblyOptionsLarge;
+    assemblyOptionsLarge.setVerbosityLevel(VerbosityLevel::LOW);
+    assemblyOptionsLarge.switchToAcaMode(acaOptionsLarge);
+    shared_ptr<Context<BFT, RT> > contextLarge(
+        new Context<BFT, RT>(quadStrategy, assemblyOptionsLarge));
+
+    // Alternate between the two sets of options
+    BoundaryOperator<BFT, RT> op1 =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                contextSmall, pwiseConstants, pwiseConstants, pwiseConstants);
+    BoundaryOperator<BFT, RT> op2 =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                contextLarge, pwiseConstants, pwiseConstants, pwiseConstants);
+    BoundaryOperator<BFT, RT> op3 =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                contextSmall, pwiseConstants, pwiseConstants, pwiseConstants);
+
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > weakForm1 =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(op1.weakForm());
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > weakForm2 =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(op2.weakForm());
+    shared_ptr<const DiscreteAcaBoundaryOperator<RT> > weakForm3 =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(op3.weakForm());
+    BOOST_CHECK(weakForm1->blockCluster() != weakForm2->blockCluster());
+    BOOST_CHECK(weakForm1->blockCluster() == weakForm3->blockCluster());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif // WITH_AHMED
@@ -0,0 +1,114 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "create_points_around_sphere.hpp"
+
+#include "assembly/assembled_potential_operator.hpp"
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/evaluation_options.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/laplace_3d_double_layer_potential_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <boost/make_shared.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <cmath>
+#include <limits>
+
+using namespace Bempp;
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(AssembledPotentialOperator)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(apply_agrees_with_evaluateAtPoints,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.2.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    const size_t dofCount = pwiseLinears->globalDofCount();
+    arma::Mat<RT> coefficients(dofCount, 2);
+    for (size_t i = 0; i < dofCount; ++i) {
+        coefficients(i, 0) = 1. + 0.5 * std::sin(RealType(i));
+        coefficients(i, 1) = std::cos(RealType(3 * i));
+    }
+
+    // Points lying both close to and far from the surface
+    const RealType radii[3] = { 0.9, 1.1, 3. };
+    shared_ptr<arma::Mat<RealType> > points =
+            boost::make_shared<arma::Mat<RealType> >(
+                createPointsAroundSphere(radii, 3, 10 /* directionCount */));
+
+    Laplace3dDoubleLayerPotentialOperator<BFT, RT> op;
+    EvaluationOptions evaluationOptions;
+    Bempp::AssembledPotentialOperator<BFT, RT> assembledOp =
+            op.assemble(pwiseLinears, points, *quadStrategy, evaluationOptions);
+    BOOST_CHECK_EQUAL(assembledOp.componentCount(), 1);
+
+    // In single precision, the rounding errors accumulated over all
+    // quadrature points are too large for a tolerance of a few epsilons
+    const RealType tolerance = boost::is_same<RealType, float>() ?
+                1e-4 : 100. * std::numeric_limits<RealType>::epsilon();
+    arma::Mat<RT> batchResult = assembledOp.applyBatch(coefficients);
+    for (int k = 0; k < 2; ++k) {
+        GridFunction<BFT, RT> density(context, pwiseLinears,
+                                      arma::Col<RT>(coefficients.col(k)));
+        arma::Mat<RT> expected = op.evaluateAtPoints(
+                    density, *points, *quadStrategy, evaluationOptions);
+        arma::Mat<RT> result = assembledOp.apply(density);
+        BOOST_CHECK(check_arrays_are_close<ValueType>(
+                        result, expected, tolerance));
+        arma::Mat<RT> batchColumn(batchResult.colptr(k), 1, points->n_cols);
+        BOOST_CHECK(check_arrays_are_close<ValueType>(
+                        batchColumn, expected, tolerance));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "create_regular_grid.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/laplace_3d_double_layer_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "grid/grid.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <limits>
+
+// Tests
+
+using namespace Bempp;
+
+namespace
+{
+
+template <typename BFT, typename RT>
+struct DenseModeAssemblyFixture
+{
+    DenseModeAssemblyFixture()
+    {
+        grid = createRegularTriangularGrid();
+
+        pwiseConstants.reset(new PiecewiseConstantScalarSpace<BFT>(grid));
+        pwiseLinears.reset(new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+        shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+            new NumericalQuadratureStrategy<BFT, RT>);
+
+        AssemblyOptions serialOptions;
+        serialOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        serialOptions.setMaxThreadCount(1);
+        serialContext.reset(new Context<BFT, RT>(quadStrategy, serialOptions));
+
+        AssemblyOptions parallelOptions;
+        parallelOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        parallelContext.reset(new Context<BFT, RT>(quadStrategy, parallelOptions));
+    }
+
+    shared_ptr<Grid> grid;
+    shared_ptr<const Space<BFT> > pwiseConstants;
+    shared_ptr<const Space<BFT> > pwiseLinears;
+    shared_ptr<const Context<BFT, RT> > serialContext;
+    shared_ptr<const Context<BFT, RT> > parallelContext;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(DenseModeAssembly)
+
+// Continuous linear elements share DOFs between neighbouring elements, so
+// these tests fail if concurrently assembled elements write to the same
+// entries of the weak form.
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multithreaded_assembly_agrees_with_serial_assembly_for_shared_test_and_trial_dofs,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DenseModeAssemblyFixture<BFT, RT> fixture;
+
+    arma::Mat<RT> serialWeakForm =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                fixture.serialContext, fixture.pwiseLinears,
+                fixture.pwiseLinears, fixture.pwiseLinears)
+            .weakForm()->asMatrix();
+    arma::Mat<RT> parallelWeakForm =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                fixture.parallelContext, fixture.pwiseLinears,
+                fixture.pwiseLinears, fixture.pwiseLinears)
+            .weakForm()->asMatrix();
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    parallelWeakForm, serialWeakForm,
+                    10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multithreaded_assembly_agrees_with_serial_assembly_for_shared_trial_dofs,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DenseModeAssemblyFixture<BFT, RT> fixture;
+
+    arma::Mat<RT> serialWeakForm =
+            laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                fixture.serialContext, fixture.pwiseLinears,
+                fixture.pwiseConstants, fixture.pwiseConstants)
+            .weakForm()->asMatrix();
+    arma::Mat<RT> parallelWeakForm =
+            laplace3dDoubleLayerBoundaryOperator<BFT, RT>(
+                fixture.parallelContext, fixture.pwiseLinears,
+                fixture.pwiseConstants, fixture.pwiseConstants)
+            .weakForm()->asMatrix();
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    parallelWeakForm, serialWeakForm,
+                    10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -28,12 +28,15 @@
 
 #include "create_regular_grid.hpp"
 
+#include "assembly/aca_approximate_lu_inverse.hpp"
+#include "assembly/ahmed_aux.hpp"
 #include "assembly/assembly_options.hpp"
 #include "assembly/discrete_aca_boundary_operator.hpp"
 #include "assembly/discrete_boundary_operator.hpp"
 #include "assembly/boundary_operator.hpp"
 #include "assembly/context.hpp"
 #include "assembly/identity_operator.hpp"
+#include "assembly/mixed_precision_discrete_boundary_operator.hpp"
 #include "assembly/numerical_quadrature_strategy.hpp"
 
 #include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
@@ -50,10 +53,15 @@
 
 #include <algorithm>
 #include "common/armadillo_fwd.hpp"
+#include <boost/cstdint.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
+#include <boost/type_traits/is_same.hpp>
 #include <boost/version.hpp>
 #include <complex>
+#include <cstdio>
+#include <fstream>
+#include <limits>
 
 // Tests
 
@@ -73,9 +81,13 @@ template <> std::complex<double> initWaveNumber()
 template <typename BFT, typename RT>
 struct DiscreteAcaBoundaryOperatorFixture
 {
-    DiscreteAcaBoundaryOperatorFixture()
+    DiscreteAcaBoundaryOperatorFixture(
+            ParallelizationOptions::HMatrixMultiplicationMode mode =
+            ParallelizationOptions::OUTPUT_PARTITIONING,
+            bool singlePrecisionStorage = false,
+            int nElementsX = 4, int nElementsY = 7)
     {
-        grid = createRegularTriangularGrid(4, 7);
+        grid = createRegularTriangularGrid(nElementsX, nElementsY);
 
         shared_ptr<Space<BFT> > pwiseConstants(
             new PiecewiseConstantScalarSpace<BFT>(grid));
@@ -84,8 +96,10 @@ struct DiscreteAcaBoundaryOperatorFixture
 
         AssemblyOptions assemblyOptions;
         assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        assemblyOptions.setHMatrixMultiplicationMode(mode);
         AcaOptions acaOptions;
         acaOptions.minimumBlockSize = 2;
+        acaOptions.singlePrecisionStorage = singlePrecisionStorage;
         assemblyOptions.switchToAcaMode(acaOptions);
         AccuracyOptions accuracyOptions;
         accuracyOptions.doubleRegular.setRelativeQuadratureOrder(4);
@@ -109,7 +123,9 @@ struct DiscreteAcaBoundaryOperatorFixture
 template <typename BFT, typename RT>
 struct DiscreteRealSymmetricAcaBoundaryOperatorFixture
 {
-    DiscreteRealSymmetricAcaBoundaryOperatorFixture()
+    DiscreteRealSymmetricAcaBoundaryOperatorFixture(
+            ParallelizationOptions::HMatrixMultiplicationMode mode =
+            ParallelizationOptions::OUTPUT_PARTITIONING)
     {
         grid = createRegularTriangularGrid(4, 7);
 
@@ -118,6 +134,7 @@ struct DiscreteRealSymmetricAcaBoundaryOperatorFixture
 
         AssemblyOptions assemblyOptions;
         assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        assemblyOptions.setHMatrixMultiplicationMode(mode);
         AcaOptions acaOptions;
         acaOptions.minimumBlockSize = 2;
         assemblyOptions.switchToAcaMode(acaOptions);
@@ -142,7 +159,9 @@ struct DiscreteRealSymmetricAcaBoundaryOperatorFixture
 template <typename BFT, typename RT>
 struct DiscreteComplexSymmetricAcaBoundaryOperatorFixture
 {
-    DiscreteComplexSymmetricAcaBoundaryOperatorFixture()
+    DiscreteComplexSymmetricAcaBoundaryOperatorFixture(
+            ParallelizationOptions::HMatrixMultiplicationMode mode =
+            ParallelizationOptions::OUTPUT_PARTITIONING)
     {
         grid = createRegularTriangularGrid(4, 7);
 
@@ -151,6 +170,7 @@ struct DiscreteComplexSymmetricAcaBoundaryOperatorFixture
 
         AssemblyOptions assemblyOptions;
         assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        assemblyOptions.setHMatrixMultiplicationMode(mode);
         AcaOptions acaOptions;
         acaOptions.minimumBlockSize = 2;
         assemblyOptions.switchToAcaMode(acaOptions);
@@ -556,6 +576,185 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_alpha_equal_to_2
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_gives_the_same_results_in_reduction_and_output_partitioning_modes, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> reductionFixture(
+                ParallelizationOptions::REDUCTION);
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> partitioningFixture(
+                ParallelizationOptions::OUTPUT_PARTITIONING);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > reductionDop =
+            reductionFixture.op.weakForm();
+    shared_ptr<const DiscreteBoundaryOperator<RT> > partitioningDop =
+            partitioningFixture.op.weakForm();
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    const TranspositionMode modes[] =
+        { NO_TRANSPOSE, TRANSPOSE, CONJUGATE_TRANSPOSE };
+    for (int m = 0; m < 3; ++m) {
+        const bool transposed = (modes[m] & TRANSPOSE);
+        arma::Col<RT> x = generateRandomVector<RT>(
+                    transposed ? reductionDop->rowCount()
+                               : reductionDop->columnCount());
+        arma::Col<RT> expected = generateRandomVector<RT>(
+                    transposed ? reductionDop->columnCount()
+                               : reductionDop->rowCount());
+        arma::Col<RT> y = expected;
+
+        reductionDop->apply(modes[m], x, expected, alpha, beta);
+        partitioningDop->apply(modes[m], x, y, alpha, beta);
+
+        BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                               10. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_in_both_multiplication_modes_for_real_symmetric_operator, ResultType, result_types)
+{
+    if (boost::is_same<ResultType, std::complex<float> >())
+        return; // this type is not supported because of a deficiency in AHMED
+
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    const ParallelizationOptions::HMatrixMultiplicationMode multiplicationModes[] =
+        { ParallelizationOptions::REDUCTION,
+          ParallelizationOptions::OUTPUT_PARTITIONING };
+    const TranspositionMode modes[] =
+        { NO_TRANSPOSE, TRANSPOSE, CONJUGATE_TRANSPOSE };
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+
+    for (int mm = 0; mm < 2; ++mm) {
+        DiscreteRealSymmetricAcaBoundaryOperatorFixture<BFT, RT> fixture(
+                    multiplicationModes[mm]);
+        shared_ptr<const DiscreteBoundaryOperator<RT> > dop =
+                fixture.op.weakForm();
+        // asMatrix() uses AHMED's serial routines for symmetric H-matrices
+        arma::Mat<RT> matrix = dop->asMatrix();
+
+        for (int m = 0; m < 3; ++m) {
+            arma::Col<RT> x = generateRandomVector<RT>(dop->rowCount());
+            arma::Col<RT> y = generateRandomVector<RT>(dop->columnCount());
+
+            arma::Col<RT> expected;
+            if (modes[m] == NO_TRANSPOSE)
+                expected = alpha * matrix * x + beta * y;
+            else if (modes[m] == TRANSPOSE)
+                expected = alpha * matrix.st() * x + beta * y;
+            else // .t() gives conjugate transpose for complex matrices
+                expected = alpha * matrix.t() * x + beta * y;
+
+            dop->apply(modes[m], x, y, alpha, beta);
+
+            BOOST_CHECK(check_arrays_are_close<RT>(
+                            y, expected,
+                            10. * std::numeric_limits<CT>::epsilon()));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_in_both_multiplication_modes_for_complex_symmetric_operator,
+                              ResultType, complex_result_types)
+{
+    if (boost::is_same<ResultType, std::complex<float> >())
+        return; // this type is not supported because of a deficiency in AHMED
+
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    const ParallelizationOptions::HMatrixMultiplicationMode multiplicationModes[] =
+        { ParallelizationOptions::REDUCTION,
+          ParallelizationOptions::OUTPUT_PARTITIONING };
+    const TranspositionMode modes[] =
+        { NO_TRANSPOSE, TRANSPOSE, CONJUGATE_TRANSPOSE };
+
+    RT alpha = RT(2., 3.);
+    RT beta = RT(4., -5.);
+
+    for (int mm = 0; mm < 2; ++mm) {
+        DiscreteComplexSymmetricAcaBoundaryOperatorFixture<BFT, RT> fixture(
+                    multiplicationModes[mm]);
+        shared_ptr<const DiscreteBoundaryOperator<RT> > dop =
+                fixture.op.weakForm();
+        // asMatrix() uses AHMED's serial routines for symmetric H-matrices
+        arma::Mat<RT> matrix = dop->asMatrix();
+
+        for (int m = 0; m < 3; ++m) {
+            arma::Col<RT> x = generateRandomVector<RT>(dop->rowCount());
+            arma::Col<RT> y = generateRandomVector<RT>(dop->columnCount());
+
+            arma::Col<RT> expected;
+            if (modes[m] == NO_TRANSPOSE)
+                expected = alpha * matrix * x + beta * y;
+            else if (modes[m] == TRANSPOSE)
+                expected = alpha * matrix.st() * x + beta * y;
+            else // .t() gives conjugate transpose for complex matrices
+                expected = alpha * matrix.t() * x + beta * y;
+
+            dop->apply(modes[m], x, y, alpha, beta);
+
+            BOOST_CHECK(check_arrays_are_close<RT>(
+                            y, expected,
+                            10. * std::numeric_limits<CT>::epsilon()));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_to_multivector_gives_the_same_results_as_apply_to_each_column, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+    const int colCount = 3;
+
+    const TranspositionMode modes[] =
+        { NO_TRANSPOSE, TRANSPOSE, CONJUGATE_TRANSPOSE };
+    for (int m = 0; m < 3; ++m) {
+        const bool transposed = (modes[m] & TRANSPOSE);
+        arma::Mat<RT> x = generateRandomMatrix<RT>(
+                    transposed ? dop->rowCount() : dop->columnCount(),
+                    colCount);
+        arma::Mat<RT> expected = generateRandomMatrix<RT>(
+                    transposed ? dop->columnCount() : dop->rowCount(),
+                    colCount);
+        arma::Mat<RT> y = expected;
+
+        for (int col = 0; col < colCount; ++col) {
+            arma::Col<RT> xCol = x.col(col);
+            arma::Col<RT> expectedCol = expected.col(col);
+            dop->apply(modes[m], xCol, expectedCol, alpha, beta);
+            expected.col(col) = expectedCol;
+        }
+        dop->apply(modes[m], x, y, alpha, beta);
+
+        BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                               10. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(acaOperatorSum_works_correctly_for_nonsymmetric_operators, ResultType, result_types)
 {
     typedef ResultType RT;
@@ -908,6 +1107,207 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(scaledAcaOperator_works_correctly_for_complex_symm
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(loadAcaOperator_recreates_operator_saved_with_saveAcaOperator,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    const std::string fileName = "test_discrete_aca_boundary_operator.bin";
+    saveAcaOperator(dop, fileName);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > loaded =
+            loadAcaOperator<RT>(fileName);
+    std::remove(fileName.c_str());
+
+    const DiscreteAcaBoundaryOperator<RT>& acaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(*dop);
+    const DiscreteAcaBoundaryOperator<RT>& loadedAcaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(*loaded);
+    BOOST_CHECK_EQUAL(loadedAcaOp.rowCount(), acaOp.rowCount());
+    BOOST_CHECK_EQUAL(loadedAcaOp.columnCount(), acaOp.columnCount());
+    BOOST_CHECK_EQUAL(loadedAcaOp.symmetry(), acaOp.symmetry());
+    BOOST_CHECK_EQUAL(loadedAcaOp.blockCount(), acaOp.blockCount());
+    BOOST_CHECK(loadedAcaOp.domainPermutation() == acaOp.domainPermutation());
+    BOOST_CHECK(loadedAcaOp.rangePermutation() == acaOp.rangePermutation());
+    BOOST_CHECK(check_arrays_are_close<RT>(loaded->asMatrix(), dop->asMatrix(),
+                                           0.));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(loadAcaOperator_recreates_real_symmetric_operator_saved_with_saveAcaOperator,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+
+    DiscreteRealSymmetricAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    const std::string fileName = "test_discrete_aca_boundary_operator.bin";
+    saveAcaOperator(dop, fileName);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > loaded =
+            loadAcaOperator<RT>(fileName);
+    std::remove(fileName.c_str());
+
+    BOOST_CHECK(check_arrays_are_close<RT>(loaded->asMatrix(), dop->asMatrix(),
+                                           0.));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(loadAcaOperator_throws_if_mblock_dimensions_do_not_match_block_cluster_tree,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename AhmedTypeTraits<RT>::Type AhmedRT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+    const DiscreteAcaBoundaryOperator<RT>& acaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(*dop);
+
+    const std::string fileName = "test_discrete_aca_boundary_operator.bin";
+    saveAcaOperator(dop, fileName);
+
+    // The mblocks are stored at the end of the file, each as a one-byte
+    // kind, n1, n2 and rank (32 bits each), the number of values (64 bits)
+    // and the values. Locate the last rectangular mblock and swap its
+    // dimensions; this leaves its size unchanged.
+    typename DiscreteAcaBoundaryOperator<RT>::AhmedMblockArray blocks =
+            acaOp.blocks();
+    const std::streamoff headerSize = 1 + 3 * 4 + 8;
+    std::ifstream in(fileName.c_str(), std::ios::binary | std::ios::ate);
+    std::streamoff offset = in.tellg();
+    in.close();
+    std::streamoff rectangularBlockOffset = -1;
+    unsigned int n1 = 0, n2 = 0;
+    for (size_t b = acaOp.blockCount(); b-- > 0; ) {
+        BOOST_REQUIRE(blocks[b]);
+        offset -= headerSize + blocks[b]->nvals() * sizeof(AhmedRT);
+        if (blocks[b]->getn1() != blocks[b]->getn2()) {
+            rectangularBlockOffset = offset;
+            n1 = blocks[b]->getn1();
+            n2 = blocks[b]->getn2();
+            break;
+        }
+    }
+    BOOST_REQUIRE(rectangularBlockOffset >= 0);
+
+    {
+        std::fstream file(fileName.c_str(),
+                          std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(rectangularBlockOffset + 1);
+        const boost::uint32_t swappedDims[2] = { n2, n1 };
+        file.write(reinterpret_cast<const char*>(swappedDims),
+                   sizeof(swappedDims));
+    }
+
+    BOOST_CHECK_THROW(loadAcaOperator<RT>(fileName), std::runtime_error);
+    std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(approximate_lu_inverse_works_for_multiple_vectors, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+    const DiscreteAcaBoundaryOperator<RT>& acaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(*dop);
+    AcaApproximateLuInverse<RT> luInverse(acaOp, 1e-4 /* delta */);
+
+    const int colCount = 4;
+    arma::Mat<RT> expected = generateRandomMatrix<RT>(dop->columnCount(),
+                                                      colCount);
+    arma::Mat<RT> rhs(dop->rowCount(), colCount);
+    dop->apply(NO_TRANSPOSE, expected, rhs, 1., 0.);
+
+    // Solve for all columns at once...
+    arma::Mat<RT> solution(luInverse.rowCount(), colCount);
+    luInverse.apply(NO_TRANSPOSE, rhs, solution, 1., 0.);
+    BOOST_CHECK(check_arrays_are_close<RT>(solution, expected, 1e-2));
+
+    // ... and one column at a time
+    for (int col = 0; col < colCount; ++col) {
+        arma::Col<RT> rhsCol = rhs.col(col);
+        arma::Col<RT> solutionCol(luInverse.rowCount());
+        luInverse.apply(NO_TRANSPOSE, rhsCol, solutionCol, 1., 0.);
+        arma::Col<RT> expectedCol = solution.col(col);
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        solutionCol, expectedCol,
+                        100. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(approximate_lu_inverse_works_for_operators_with_blocks_split_between_several_tasks, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+
+    // 1152 unknowns: the off-diagonal blocks at the top of the block cluster
+    // tree are large enough for their products with the partial solution to
+    // be multithreaded
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture(
+                ParallelizationOptions::OUTPUT_PARTITIONING,
+                false /* singlePrecisionStorage */, 24, 24);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+    const DiscreteAcaBoundaryOperator<RT>& acaOp =
+            DiscreteAcaBoundaryOperator<RT>::castToAca(*dop);
+    AcaApproximateLuInverse<RT> luInverse(acaOp, 1e-4 /* delta */);
+
+    arma::Col<RT> expected = generateRandomVector<RT>(dop->columnCount());
+    arma::Col<RT> rhs(dop->rowCount());
+    dop->apply(NO_TRANSPOSE, expected, rhs, 1., 0.);
+
+    arma::Col<RT> solution(luInverse.rowCount());
+    luInverse.apply(NO_TRANSPOSE, rhs, solution, 1., 0.);
+    BOOST_CHECK(check_arrays_are_close<RT>(solution, expected, 1e-2));
+}
+
+#ifdef ENABLE_SINGLE_PRECISION
+BOOST_AUTO_TEST_CASE_TEMPLATE(single_precision_storage_gives_the_same_results_as_storage_in_full_precision,
+                              ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::SinglePrecisionType SPT;
+
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+    DiscreteAcaBoundaryOperatorFixture<BFT, RT> singlePrecisionFixture(
+                ParallelizationOptions::OUTPUT_PARTITIONING,
+                true /* singlePrecisionStorage */);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > singlePrecisionDop =
+            singlePrecisionFixture.op.weakForm();
+    if (!boost::is_same<RT, SPT>::value)
+        BOOST_CHECK(dynamic_cast<const MixedPrecisionDiscreteBoundaryOperator<RT>*>(
+                        singlePrecisionDop.get()));
+
+    const int colCount = 3;
+    arma::Mat<RT> x = generateRandomMatrix<RT>(dop->columnCount(), colCount);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(dop->rowCount(), colCount);
+    arma::Mat<RT> expected = y;
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+    dop->apply(NO_TRANSPOSE, x, expected, alpha, beta);
+    singlePrecisionDop->apply(NO_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    y, expected,
+                    100. * std::numeric_limits<float>::epsilon()));
+}
+#endif // ENABLE_SINGLE_PRECISION
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif // WITH_AHMED
@@ -241,6 +241,112 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_alpha_equal_to_2
                                            10. * std::numeric_limits<CT>::epsilon()));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_multiple_columns_and_conjugate_transpose, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    DiscreteSparseBoundaryOperatorFixture<BFT, RT> fixture(false, 6, 8);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+    const int colCount = 3;
+
+    arma::Mat<RT> x = generateRandomMatrix<RT>(dop->rowCount(), colCount);
+    arma::Mat<RT> y = generateRandomMatrix<RT>(dop->columnCount(), colCount);
+
+    arma::Mat<RT> expected = alpha * dop->asMatrix().t() * x + beta * y;
+
+    dop->apply(CONJUGATE_TRANSPOSE, x, y, alpha, beta);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(builtin_apply_works_correctly_for_matrices_split_between_several_tasks, ResultType, result_types)
+{
+    std::srand(1);
+
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    // 625 rows and 1152 columns: more than the number of rows processed by
+    // a single task of the sparse matrix-vector product, both with and
+    // without transposition
+    DiscreteSparseBoundaryOperatorFixture<BFT, RT> fixture(false, 24, 24);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > dop = fixture.op.weakForm();
+    BOOST_REQUIRE_GT(dop->rowCount(), 512u);
+    BOOST_REQUIRE_GT(dop->columnCount(), 1024u);
+
+    RT alpha = static_cast<RT>(2.);
+    RT beta = static_cast<RT>(3.);
+    const int colCount = 2;
+    arma::Mat<RT> mat = dop->asMatrix();
+
+    {
+        arma::Mat<RT> x = generateRandomMatrix<RT>(dop->columnCount(), colCount);
+        arma::Mat<RT> y = generateRandomMatrix<RT>(dop->rowCount(), colCount);
+
+        arma::Mat<RT> expected = alpha * mat * x + beta * y;
+
+        dop->apply(NO_TRANSPOSE, x, y, alpha, beta);
+
+        BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                               10. * std::numeric_limits<CT>::epsilon()));
+    }
+    {
+        arma::Mat<RT> x = generateRandomMatrix<RT>(dop->rowCount(), colCount);
+        arma::Mat<RT> y = generateRandomMatrix<RT>(dop->columnCount(), colCount);
+
+        arma::Mat<RT> expected = alpha * mat.st() * x + beta * y;
+
+        dop->apply(TRANSPOSE, x, y, alpha, beta);
+
+        BOOST_CHECK(check_arrays_are_close<RT>(y, expected,
+                                               10. * std::numeric_limits<CT>::epsilon()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(sparse_mode_assembly_agrees_with_dense_mode_assembly, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    shared_ptr<Grid> grid = createRegularTriangularGrid(10, 12);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+        new NumericalQuadratureStrategy<BFT, RT>);
+    shared_ptr<Context<BFT, RT> > sparseContext(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    assemblyOptions.enableSparseStorageOfMassMatrices(false);
+    shared_ptr<Context<BFT, RT> > denseContext(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    BoundaryOperator<BFT, RT> sparseOp = identityOperator<BFT, RT>(
+        sparseContext, pwiseLinears, pwiseConstants, pwiseConstants);
+    BoundaryOperator<BFT, RT> denseOp = identityOperator<BFT, RT>(
+        denseContext, pwiseLinears, pwiseConstants, pwiseConstants);
+
+    arma::Mat<RT> sparseMat = sparseOp.weakForm()->asMatrix();
+    arma::Mat<RT> denseMat = denseOp.weakForm()->asMatrix();
+
+    BOOST_CHECK(check_arrays_are_close<RT>(sparseMat, denseMat,
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(asDiscreteAcaBoundaryOperator_works_correctly, ResultType, result_types)
 {
     std::srand(1);
@@ -188,4 +188,43 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(L2Norm_works_for_exponential_function_and_piecewis
     BOOST_CHECK_CLOSE(norm, expectedNorm, 1 /* percent */);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(projections_do_not_depend_on_the_number_of_threads, ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename ScalarTraits<RT>::RealType BFT;
+    typedef typename ScalarTraits<RT>::RealType CT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > space(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions serialAssemblyOptions;
+    serialAssemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    serialAssemblyOptions.setMaxThreadCount(1);
+    shared_ptr<Context<BFT, RT> > serialContext(
+        new Context<BFT, RT>(quadStrategy, serialAssemblyOptions));
+    AssemblyOptions parallelAssemblyOptions;
+    parallelAssemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > parallelContext(
+        new Context<BFT, RT>(quadStrategy, parallelAssemblyOptions));
+
+    Bempp::GridFunction<BFT, RT> serialFun(
+                serialContext, space, space,
+                surfaceNormalIndependentFunction(SinusoidalFunction<RT>()));
+    Bempp::GridFunction<BFT, RT> parallelFun(
+                parallelContext, space, space,
+                surfaceNormalIndependentFunction(SinusoidalFunction<RT>()));
+
+    BOOST_CHECK(check_arrays_are_close<RT>(parallelFun.projections(*space),
+                                           serialFun.projections(*space),
+                                           10. * std::numeric_limits<CT>::epsilon()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,110 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/evaluation_options.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/laplace_3d_double_layer_potential_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+using namespace Bempp;
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(HierarchicalPotentialEvaluation)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(hierarchical_evaluation_agrees_with_dense_evaluation,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.2.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseLinears(
+        new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    arma::Col<RT> coefficients(pwiseLinears->globalDofCount());
+    for (size_t i = 0; i < coefficients.n_rows; ++i)
+        coefficients(i) = 1. + 0.5 * std::sin(RealType(i));
+    GridFunction<BFT, RT> density(context, pwiseLinears, coefficients);
+
+    // Regular lattice of points in [-3, 3]^3 lying outside the unit sphere
+    const int pointsPerAxis = 24;
+    std::vector<RealType> coords;
+    for (int i = 0; i < pointsPerAxis; ++i)
+        for (int j = 0; j < pointsPerAxis; ++j)
+            for (int k = 0; k < pointsPerAxis; ++k) {
+                RealType x = -3. + 6. * i / (pointsPerAxis - 1);
+                RealType y = -3. + 6. * j / (pointsPerAxis - 1);
+                RealType z = -3. + 6. * k / (pointsPerAxis - 1);
+                if (x * x + y * y + z * z > 1.5 * 1.5) {
+                    coords.push_back(x);
+                    coords.push_back(y);
+                    coords.push_back(z);
+                }
+            }
+    arma::Mat<RealType> points(&coords[0], 3, coords.size() / 3);
+
+    Laplace3dDoubleLayerPotentialOperator<BFT, RT> op;
+
+    EvaluationOptions denseOptions;
+    arma::Mat<RT> denseResult =
+            op.evaluateAtPoints(density, points, *quadStrategy, denseOptions);
+
+    EvaluationOptions hierarchicalOptions;
+    HierarchicalEvaluationOptions hOptions;
+    hOptions.maximumLeafSize = 16;
+    hierarchicalOptions.switchToHierarchicalMode(hOptions);
+    arma::Mat<RT> hierarchicalResult =
+            op.evaluateAtPoints(density, points, *quadStrategy,
+                                hierarchicalOptions);
+
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    denseResult, hierarchicalResult, 1e-3));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
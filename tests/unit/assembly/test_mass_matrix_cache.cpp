@@ -0,0 +1,296 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../check_arrays_are_close.hpp"
+#include "../type_template.hpp"
+
+#include "create_regular_grid.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/boundary_operator.hpp"
+#include "assembly/context.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/identity_operator.hpp"
+#include "assembly/mass_matrix_cache.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "grid/grid.hpp"
+
+#include "space/piecewise_linear_continuous_scalar_space.hpp"
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <boost/weak_ptr.hpp>
+#include <limits>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <vector>
+
+// Tests
+
+using namespace Bempp;
+
+namespace
+{
+
+template <typename BFT, typename RT>
+struct MassMatrixCacheFixture
+{
+    MassMatrixCacheFixture()
+    {
+        grid = createRegularTriangularGrid();
+
+        pwiseConstants.reset(new PiecewiseConstantScalarSpace<BFT>(grid));
+        pwiseLinears.reset(new PiecewiseLinearContinuousScalarSpace<BFT>(grid));
+
+        AssemblyOptions assemblyOptions;
+        assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+        shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+            new NumericalQuadratureStrategy<BFT, RT>);
+        context.reset(new Context<BFT, RT>(quadStrategy, assemblyOptions));
+    }
+
+    shared_ptr<Grid> grid;
+    shared_ptr<const Space<BFT> > pwiseConstants;
+    shared_ptr<const Space<BFT> > pwiseLinears;
+    shared_ptr<const Context<BFT, RT> > context;
+};
+
+// Apply an operator to the columns of a matrix, one column per task
+template <typename RT>
+struct ApplyToColumnsLoopBody
+{
+    ApplyToColumnsLoopBody(const DiscreteBoundaryOperator<RT>& op_,
+                           const arma::Mat<RT>& x_,
+                           std::vector<arma::Col<RT> >& y_) :
+        op(op_), x(x_), y(y_) {
+    }
+
+    void operator() (const tbb::blocked_range<int>& r) const {
+        for (int col = r.begin(); col < r.end(); ++col) {
+            arma::Col<RT> xCol = x.col(col);
+            y[col].set_size(op.rowCount());
+            op.apply(NO_TRANSPOSE, xCol, y[col], static_cast<RT>(1.),
+                     static_cast<RT>(0.));
+        }
+    }
+
+    const DiscreteBoundaryOperator<RT>& op;
+    const arma::Mat<RT>& x;
+    std::vector<arma::Col<RT> >& y;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MassMatrixCache)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(massMatrix_returns_the_same_object_on_subsequent_calls,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+
+    MassMatrixCacheFixture<BFT, RT> fixture;
+    const Bempp::MassMatrixCache<BFT, RT>& cache =
+            fixture.context->massMatrixCache();
+
+    shared_ptr<const DiscreteBoundaryOperator<RT> > first =
+            cache.massMatrix(fixture.context, fixture.pwiseLinears,
+                             fixture.pwiseConstants);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > second =
+            cache.massMatrix(fixture.context, fixture.pwiseLinears,
+                             fixture.pwiseConstants);
+    BOOST_CHECK(first.get() == second.get());
+
+    shared_ptr<const DiscreteBoundaryOperator<RT> > other =
+            cache.massMatrix(fixture.context, fixture.pwiseLinears,
+                             fixture.pwiseLinears);
+    BOOST_CHECK(other.get() != first.get());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(massMatrix_agrees_with_weak_form_of_identity_operator,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    MassMatrixCacheFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > massMatrix =
+            fixture.context->massMatrixCache().massMatrix(
+                fixture.context, fixture.pwiseLinears, fixture.pwiseConstants);
+    BoundaryOperator<BFT, RT> id = identityOperator(
+                fixture.context, fixture.pwiseLinears, fixture.pwiseLinears,
+                fixture.pwiseConstants);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    massMatrix->asMatrix(), id.weakForm()->asMatrix(),
+                    10. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(entry_is_discarded_once_its_spaces_are_destroyed,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+
+    MassMatrixCacheFixture<BFT, RT> fixture;
+    const Bempp::MassMatrixCache<BFT, RT>& cache =
+            fixture.context->massMatrixCache();
+
+    boost::weak_ptr<const DiscreteBoundaryOperator<RT> > weakMassMatrix,
+            weakInverseMassMatrix;
+    {
+        shared_ptr<const Space<BFT> > space(
+                    new PiecewiseLinearContinuousScalarSpace<BFT>(fixture.grid));
+        shared_ptr<const Space<BFT> > dualSpace(
+                    new PiecewiseLinearContinuousScalarSpace<BFT>(fixture.grid));
+        weakMassMatrix = cache.massMatrix(fixture.context, space, dualSpace);
+        weakInverseMassMatrix =
+                cache.inverseMassMatrix(fixture.context, space, dualSpace);
+        // While the spaces are alive, the cache keeps the matrices
+        BOOST_CHECK(!weakMassMatrix.expired());
+        BOOST_CHECK(!weakInverseMassMatrix.expired());
+    }
+
+    // Expired entries are discarded when the cache is next accessed
+    cache.massMatrix(fixture.context, fixture.pwiseLinears,
+                     fixture.pwiseConstants);
+    BOOST_CHECK(weakMassMatrix.expired());
+    BOOST_CHECK(weakInverseMassMatrix.expired());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(inverseMassMatrix_returns_the_same_object_on_subsequent_calls,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+
+    MassMatrixCacheFixture<BFT, RT> fixture;
+    const Bempp::MassMatrixCache<BFT, RT>& cache =
+            fixture.context->massMatrixCache();
+
+    shared_ptr<const DiscreteBoundaryOperator<RT> > first =
+            cache.inverseMassMatrix(fixture.context, fixture.pwiseLinears,
+                                    fixture.pwiseLinears);
+    shared_ptr<const DiscreteBoundaryOperator<RT> > second =
+            cache.inverseMassMatrix(fixture.context, fixture.pwiseLinears,
+                                    fixture.pwiseLinears);
+    BOOST_CHECK(first.get() == second.get());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(inverseMassMatrix_inverts_massMatrix,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    MassMatrixCacheFixture<BFT, RT> fixture;
+    const Bempp::MassMatrixCache<BFT, RT>& cache =
+            fixture.context->massMatrixCache();
+
+    arma::Mat<RT> massMatrix =
+            cache.massMatrix(fixture.context, fixture.pwiseLinears,
+                             fixture.pwiseLinears)->asMatrix();
+    arma::Mat<RT> inverseMassMatrix =
+            cache.inverseMassMatrix(fixture.context, fixture.pwiseLinears,
+                                    fixture.pwiseLinears)->asMatrix();
+    arma::Mat<RT> identity = arma::eye<arma::Mat<RT> >(
+                massMatrix.n_rows, massMatrix.n_cols);
+
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    arma::Mat<RT>(inverseMassMatrix * massMatrix), identity,
+                    1000. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(inverseMassMatrix_can_be_applied_from_several_threads_at_once,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    MassMatrixCacheFixture<BFT, RT> fixture;
+    shared_ptr<const DiscreteBoundaryOperator<RT> > inverseMassMatrix =
+            fixture.context->massMatrixCache().inverseMassMatrix(
+                fixture.context, fixture.pwiseLinears, fixture.pwiseLinears);
+
+    const int colCount = 64;
+    arma::Mat<RT> x(inverseMassMatrix->columnCount(), colCount);
+    for (size_t col = 0; col < x.n_cols; ++col)
+        for (size_t row = 0; row < x.n_rows; ++row)
+            x(row, col) = static_cast<RT>(1. + 0.1 * row + 0.01 * col);
+    arma::Mat<RT> expected = inverseMassMatrix->asMatrix() * x;
+
+    std::vector<arma::Col<RT> > y(colCount);
+    tbb::parallel_for(tbb::blocked_range<int>(0, colCount, 1),
+                      ApplyToColumnsLoopBody<RT>(*inverseMassMatrix, x, y));
+
+    for (int col = 0; col < colCount; ++col)
+        BOOST_CHECK(check_arrays_are_close<RT>(
+                        y[col], arma::Col<RT>(expected.col(col)),
+                        1000. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(cached_mass_matrices_give_correct_grid_function_projections,
+                              ResultType, result_types)
+{
+    typedef ResultType RT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType BFT;
+    typedef typename Fiber::ScalarTraits<RT>::RealType CT;
+
+    MassMatrixCacheFixture<BFT, RT> fixture;
+    const Bempp::MassMatrixCache<BFT, RT>& cache =
+            fixture.context->massMatrixCache();
+
+    arma::Col<RT> coefficients(fixture.pwiseLinears->globalDofCount());
+    for (size_t i = 0; i < coefficients.n_rows; ++i)
+        coefficients(i) = static_cast<RT>(1. + 0.5 * i);
+    GridFunction<BFT, RT> function(fixture.context, fixture.pwiseLinears,
+                                   coefficients);
+
+    // The dual space is the space of the grid function, so the cache is used
+    arma::Col<RT> projections = function.projections(*fixture.pwiseLinears);
+    arma::Col<RT> expected =
+            cache.massMatrix(fixture.context, fixture.pwiseLinears,
+                             fixture.pwiseLinears)->asMatrix() * coefficients;
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    projections, expected,
+                    100. * std::numeric_limits<CT>::epsilon()));
+
+    // An equivalent dual space not known to the grid function bypasses the
+    // cache; the result must be the same
+    PiecewiseLinearContinuousScalarSpace<BFT> otherDualSpace(fixture.grid);
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    function.projections(otherDualSpace), projections,
+                    100. * std::numeric_limits<CT>::epsilon()));
+
+    // Construction from projections uses the cached inverse mass matrix
+    GridFunction<BFT, RT> roundTrip(fixture.context, fixture.pwiseLinears,
+                                    fixture.pwiseLinears, projections);
+    BOOST_CHECK(check_arrays_are_close<RT>(
+                    roundTrip.coefficients(), coefficients,
+                    1000. * std::numeric_limits<CT>::epsilon()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,114 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../type_template.hpp"
+
+#include "create_points_around_sphere.hpp"
+
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
+#include "assembly/evaluation_options.hpp"
+#include "assembly/grid_function.hpp"
+#include "assembly/laplace_3d_single_layer_potential_operator.hpp"
+#include "assembly/numerical_quadrature_strategy.hpp"
+
+#include "common/scalar_traits.hpp"
+
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+
+#include "space/piecewise_constant_scalar_space.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+using namespace Bempp;
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(NearFieldPotentialEvaluation)
+
+// The single-layer potential of a unit density on the unit sphere is equal
+// to 1 inside the sphere and to 1/r outside it. The points used below lie
+// at a distance of half an element diameter from the surface.
+BOOST_AUTO_TEST_CASE_TEMPLATE(near_field_quadrature_improves_potential_close_to_surface,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    shared_ptr<Grid> grid = GridFactory::importGmshGrid(
+        params, "../../examples/meshes/sphere-h-0.1.msh", false /* verbose */);
+
+    shared_ptr<Space<BFT> > pwiseConstants(
+        new PiecewiseConstantScalarSpace<BFT>(grid));
+
+    AccuracyOptions accuracyOptions;
+    shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
+                new NumericalQuadratureStrategy<BFT, RT>(accuracyOptions));
+    AssemblyOptions assemblyOptions;
+    assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    shared_ptr<Context<BFT, RT> > context(
+        new Context<BFT, RT>(quadStrategy, assemblyOptions));
+
+    arma::Col<RT> coefficients(pwiseConstants->globalDofCount());
+    coefficients.fill(1.);
+    GridFunction<BFT, RT> density(context, pwiseConstants, coefficients);
+
+    const int directionCount = 12;
+    const RealType radii[2] = { 0.95, 1.05 };
+    arma::Mat<RealType> points =
+            createPointsAroundSphere(radii, 2, directionCount);
+    arma::Row<RealType> exactValues(points.n_cols);
+    for (size_t point = 0; point < points.n_cols; ++point) {
+        const RealType radius = radii[point / directionCount];
+        exactValues(point) = radius < 1. ? 1. : 1. / radius;
+    }
+
+    Laplace3dSingleLayerPotentialOperator<BFT, RT> op;
+
+    EvaluationOptions farFieldOptions;
+    farFieldOptions.enableNearFieldQuadrature(false);
+    arma::Mat<RT> farFieldResult =
+            op.evaluateAtPoints(density, points, *quadStrategy,
+                                farFieldOptions);
+
+    EvaluationOptions nearFieldOptions;
+    arma::Mat<RT> nearFieldResult =
+            op.evaluateAtPoints(density, points, *quadStrategy,
+                                nearFieldOptions);
+
+    RealType farFieldError = 0., nearFieldError = 0.;
+    for (size_t point = 0; point < points.n_cols; ++point) {
+        farFieldError = std::max<RealType>(
+                    farFieldError,
+                    std::abs(farFieldResult(0, point) - exactValues(point)));
+        nearFieldError = std::max<RealType>(
+                    nearFieldError,
+                    std::abs(nearFieldResult(0, point) - exactValues(point)));
+    }
+    BOOST_CHECK_LT(nearFieldError, 1e-2);
+    BOOST_CHECK_LT(nearFieldError, farFieldError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
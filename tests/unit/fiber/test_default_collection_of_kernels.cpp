@@ -0,0 +1,155 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/geometrical_data.hpp"
+#include "fiber/collection_of_3d_arrays.hpp"
+#include "fiber/collection_of_4d_arrays.hpp"
+#include "fiber/default_collection_of_kernels.hpp"
+#include "fiber/laplace_3d_adjoint_double_layer_potential_kernel_functor.hpp"
+#include "fiber/laplace_3d_double_layer_potential_kernel_functor.hpp"
+#include "fiber/laplace_3d_single_layer_potential_kernel_functor.hpp"
+#include "fiber/modified_helmholtz_3d_double_layer_potential_kernel_functor.hpp"
+
+#include "../type_template.hpp"
+#include "../check_arrays_are_close.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <limits>
+
+// Tests
+
+namespace
+{
+
+// Check that evaluateOnGrid() and evaluateAtPointPairs(), which evaluate the
+// kernel in chunks of point pairs copied to scratch buffers, give the same
+// results as calling Functor::evaluateScalar() for each pair separately
+template <typename Functor>
+void checkBatchedEvaluationAgreesWithEvaluateScalar(const Functor& functor)
+{
+    typedef typename Functor::ValueType ValueType;
+    typedef typename Functor::CoordinateType CoordinateType;
+    typedef Fiber::DefaultCollectionOfKernels<Functor> Kernels;
+    Kernels kernels(functor);
+
+    const int worldDim = 3;
+    // More test points than fit in two chunks of point pairs
+    const int testPointCount = 150, trialPointCount = 3;
+
+    Fiber::GeometricalData<CoordinateType> testGeomData, trialGeomData;
+    testGeomData.globals = arma::randu<arma::Mat<CoordinateType> >(
+                worldDim, testPointCount);
+    testGeomData.normals = arma::randu<arma::Mat<CoordinateType> >(
+                worldDim, testPointCount);
+    // Keep the trial points away from the test points
+    trialGeomData.globals = arma::randu<arma::Mat<CoordinateType> >(
+                worldDim, trialPointCount);
+    trialGeomData.globals += static_cast<CoordinateType>(2.);
+    trialGeomData.normals = arma::randu<arma::Mat<CoordinateType> >(
+                worldDim, trialPointCount);
+
+    // evaluateOnGrid()
+    Fiber::CollectionOf4dArrays<ValueType> resultOnGrid;
+    kernels.evaluateOnGrid(testGeomData, trialGeomData, resultOnGrid);
+
+    arma::Col<ValueType> batchedOnGrid(testPointCount * trialPointCount);
+    arma::Col<ValueType> expectedOnGrid(testPointCount * trialPointCount);
+    for (int trialPoint = 0; trialPoint < trialPointCount; ++trialPoint)
+        for (int testPoint = 0; testPoint < testPointCount; ++testPoint) {
+            const int pair = testPoint + trialPoint * testPointCount;
+            batchedOnGrid(pair) = resultOnGrid[0](0, 0, testPoint, trialPoint);
+            expectedOnGrid(pair) = functor.evaluateScalar(
+                        testGeomData.globals.colptr(testPoint),
+                        testGeomData.normals.colptr(testPoint),
+                        trialGeomData.globals.colptr(trialPoint),
+                        trialGeomData.normals.colptr(trialPoint));
+        }
+
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    batchedOnGrid, expectedOnGrid,
+                    10. * std::numeric_limits<CoordinateType>::epsilon()));
+
+    // evaluateAtPointPairs(): pair each test point with one of the trial
+    // points
+    Fiber::GeometricalData<CoordinateType> pairedTrialGeomData;
+    pairedTrialGeomData.globals.set_size(worldDim, testPointCount);
+    pairedTrialGeomData.normals.set_size(worldDim, testPointCount);
+    for (int point = 0; point < testPointCount; ++point) {
+        pairedTrialGeomData.globals.col(point) =
+                trialGeomData.globals.col(point % trialPointCount);
+        pairedTrialGeomData.normals.col(point) =
+                trialGeomData.normals.col(point % trialPointCount);
+    }
+
+    Fiber::CollectionOf3dArrays<ValueType> resultAtPointPairs;
+    kernels.evaluateAtPointPairs(testGeomData, pairedTrialGeomData,
+                                 resultAtPointPairs);
+
+    arma::Col<ValueType> batchedAtPointPairs(testPointCount);
+    arma::Col<ValueType> expectedAtPointPairs(testPointCount);
+    for (int point = 0; point < testPointCount; ++point) {
+        batchedAtPointPairs(point) = resultAtPointPairs[0](0, 0, point);
+        expectedAtPointPairs(point) = functor.evaluateScalar(
+                    testGeomData.globals.colptr(point),
+                    testGeomData.normals.colptr(point),
+                    pairedTrialGeomData.globals.colptr(point),
+                    pairedTrialGeomData.normals.colptr(point));
+    }
+
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    batchedAtPointPairs, expectedAtPointPairs,
+                    10. * std::numeric_limits<CoordinateType>::epsilon()));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(DefaultCollectionOfKernels)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(batched_evaluation_agrees_with_evaluateScalar_for_laplace_3d_single_layer_potential_kernel,
+                              ValueType, kernel_types)
+{
+    checkBatchedEvaluationAgreesWithEvaluateScalar(
+                Fiber::Laplace3dSingleLayerPotentialKernelFunctor<ValueType>());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(batched_evaluation_agrees_with_evaluateScalar_for_laplace_3d_double_layer_potential_kernel,
+                              ValueType, kernel_types)
+{
+    checkBatchedEvaluationAgreesWithEvaluateScalar(
+                Fiber::Laplace3dDoubleLayerPotentialKernelFunctor<ValueType>());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(batched_evaluation_agrees_with_evaluateScalar_for_laplace_3d_adjoint_double_layer_potential_kernel,
+                              ValueType, kernel_types)
+{
+    checkBatchedEvaluationAgreesWithEvaluateScalar(
+                Fiber::Laplace3dAdjointDoubleLayerPotentialKernelFunctor<ValueType>());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(batched_evaluation_agrees_with_evaluateScalar_for_modified_helmholtz_3d_double_layer_potential_kernel,
+                              ValueType, kernel_types)
+{
+    checkBatchedEvaluationAgreesWithEvaluateScalar(
+                Fiber::ModifiedHelmholtz3dDoubleLayerPotentialKernelFunctor<ValueType>(
+                    static_cast<ValueType>(1.3)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -60,7 +60,7 @@ public:
     typedef Fiber::RawGridGeometry<CT> RawGridGeometry;
 
     DefaultLocalAssemblerForIntegralOperatorsOnSurfacesManager(
-            bool cacheSingularIntegrals)
+            bool cacheSingularIntegrals, bool cacheElementData = true)
     {
         // Create a Bempp grid
         shared_ptr<Grid> grid = createGrid();
@@ -87,6 +87,8 @@ public:
         AssemblyOptions assemblyOptions;
         assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
         assemblyOptions.enableSingularIntegralCaching(cacheSingularIntegrals);
+        if (!cacheElementData)
+            assemblyOptions.setElementDataCacheMemoryBudget(0);
         assembler = op->makeAssembler(*quadStrategy, assemblyOptions);
     }
 
@@ -380,4 +382,47 @@ evaluateLocalWeakForms_with_and_without_singular_integral_caching_gives_same_res
                     resultWithCaching, resultWithoutCaching, 1e-6));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(
+        evaluateLocalWeakForms_with_and_without_element_data_caching_gives_same_results,
+        ResultType, result_types)
+{
+    const int elementCount = N_ELEMENTS_X * N_ELEMENTS_Y * 2;
+    std::vector<int> elementIndices(elementCount);
+    for (int i = 0; i < elementCount; ++i)
+        elementIndices[i] = i;
+
+    std::vector<arma::Mat<ResultType> > resultWithCaching;
+    std::vector<arma::Mat<ResultType> > resultWithoutCaching;
+    std::vector<arma::Mat<ResultType> > colResult;
+
+    {
+        DefaultLocalAssemblerForIntegralOperatorsOnSurfacesManager<
+                typename ScalarTraits<ResultType>::RealType, ResultType> mgr(
+                    false, true);
+        // Visit each element several times, so that cached data get reused
+        for (int trialI = 0; trialI < elementCount; ++trialI) {
+            mgr.assembler->evaluateLocalWeakForms(Fiber::TEST_TRIAL,
+                                                  elementIndices, trialI,
+                                                  Fiber::ALL_DOFS, colResult);
+            resultWithCaching.insert(resultWithCaching.end(),
+                                     colResult.begin(), colResult.end());
+        }
+    }
+    {
+        DefaultLocalAssemblerForIntegralOperatorsOnSurfacesManager<
+                typename ScalarTraits<ResultType>::RealType, ResultType> mgr(
+                    false, false);
+        for (int trialI = 0; trialI < elementCount; ++trialI) {
+            mgr.assembler->evaluateLocalWeakForms(Fiber::TEST_TRIAL,
+                                                  elementIndices, trialI,
+                                                  Fiber::ALL_DOFS, colResult);
+            resultWithoutCaching.insert(resultWithoutCaching.end(),
+                                        colResult.begin(), colResult.end());
+        }
+    }
+
+    BOOST_CHECK(check_arrays_are_close<ResultType>(
+                    resultWithCaching, resultWithoutCaching, 1e-6));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
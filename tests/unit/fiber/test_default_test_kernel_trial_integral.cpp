@@ -0,0 +1,155 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/collection_of_3d_arrays.hpp"
+#include "fiber/collection_of_4d_arrays.hpp"
+#include "fiber/default_test_kernel_trial_integral.hpp"
+#include "fiber/geometrical_data.hpp"
+#include "fiber/scalar_traits.hpp"
+#include "fiber/simple_test_scalar_kernel_trial_integrand_functor.hpp"
+
+#include "../type_template.hpp"
+#include "../check_arrays_are_close.hpp"
+
+#include "common/armadillo_fwd.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Tests
+
+namespace
+{
+
+// Functor equivalent to SimpleTestScalarKernelTrialIntegrandFunctor, but of
+// a different type, so that DefaultTestKernelTrialIntegral evaluates it at
+// individual point pairs rather than with matrix products
+template <typename BasisFunctionType, typename KernelType, typename ResultType>
+class PointwiseTestScalarKernelTrialIntegrandFunctor :
+        public Fiber::SimpleTestScalarKernelTrialIntegrandFunctor<
+        BasisFunctionType, KernelType, ResultType>
+{
+};
+
+// Arbitrary, but reproducible, test data
+template <typename ValueType>
+ValueType testValue(int i)
+{
+    return static_cast<ValueType>(std::sin(1.3 * i + 0.4));
+}
+
+// Check that the matrix-product contraction of the integrand
+// conj(test) * kernel * trial agrees with the pointwise evaluation
+template <typename ResultType>
+void checkMatrixProductContractionAgreesWithPointwiseEvaluation(
+        int componentCount)
+{
+    typedef typename Fiber::ScalarTraits<ResultType>::RealType CoordinateType;
+    typedef CoordinateType BasisFunctionType;
+    typedef ResultType KernelType;
+
+    const int testDofCount = 3, trialDofCount = 4;
+    const int testPointCount = 6, trialPointCount = 7;
+
+    Fiber::GeometricalData<CoordinateType> testGeomData, trialGeomData;
+    testGeomData.integrationElements.set_size(testPointCount);
+    for (int point = 0; point < testPointCount; ++point)
+        testGeomData.integrationElements(point) =
+                1. + 0.5 * testValue<CoordinateType>(point);
+    trialGeomData.integrationElements.set_size(trialPointCount);
+    for (int point = 0; point < trialPointCount; ++point)
+        trialGeomData.integrationElements(point) =
+                1. + 0.5 * testValue<CoordinateType>(point + 10);
+
+    Fiber::CollectionOf3dArrays<BasisFunctionType> testValues(1), trialValues(1);
+    testValues[0].set_size(componentCount, testDofCount, testPointCount);
+    trialValues[0].set_size(componentCount, trialDofCount, trialPointCount);
+    int index = 0;
+    for (int point = 0; point < testPointCount; ++point)
+        for (int dof = 0; dof < testDofCount; ++dof)
+            for (int dim = 0; dim < componentCount; ++dim)
+                testValues[0](dim, dof, point) =
+                        testValue<BasisFunctionType>(++index);
+    for (int point = 0; point < trialPointCount; ++point)
+        for (int dof = 0; dof < trialDofCount; ++dof)
+            for (int dim = 0; dim < componentCount; ++dim)
+                trialValues[0](dim, dof, point) =
+                        testValue<BasisFunctionType>(++index);
+
+    Fiber::CollectionOf4dArrays<KernelType> kernelValues(1);
+    kernelValues[0].set_size(1, 1, testPointCount, trialPointCount);
+    for (int trialPoint = 0; trialPoint < trialPointCount; ++trialPoint)
+        for (int testPoint = 0; testPoint < testPointCount; ++testPoint)
+            kernelValues[0](0, 0, testPoint, trialPoint) =
+                    testValue<KernelType>(++index);
+
+    std::vector<CoordinateType> testQuadWeights(testPointCount);
+    for (int point = 0; point < testPointCount; ++point)
+        testQuadWeights[point] = 0.1 + 0.05 * point;
+    std::vector<CoordinateType> trialQuadWeights(trialPointCount);
+    for (int point = 0; point < trialPointCount; ++point)
+        trialQuadWeights[point] = 0.2 - 0.01 * point;
+
+    typedef Fiber::SimpleTestScalarKernelTrialIntegrandFunctor<
+            BasisFunctionType, KernelType, ResultType> SimpleFunctor;
+    typedef PointwiseTestScalarKernelTrialIntegrandFunctor<
+            BasisFunctionType, KernelType, ResultType> PointwiseFunctor;
+    Fiber::DefaultTestKernelTrialIntegral<SimpleFunctor> simpleIntegral(
+                (SimpleFunctor()));
+    Fiber::DefaultTestKernelTrialIntegral<PointwiseFunctor> pointwiseIntegral(
+                (PointwiseFunctor()));
+
+    arma::Mat<ResultType> result, expected;
+    // Evaluate twice to check that the reused scratch matrices do not
+    // affect the results
+    for (int i = 0; i < 2; ++i) {
+        simpleIntegral.evaluateWithTensorQuadratureRule(
+                    testGeomData, trialGeomData, testValues, trialValues,
+                    kernelValues, testQuadWeights, trialQuadWeights, result);
+        pointwiseIntegral.evaluateWithTensorQuadratureRule(
+                    testGeomData, trialGeomData, testValues, trialValues,
+                    kernelValues, testQuadWeights, trialQuadWeights, expected);
+
+        BOOST_CHECK_EQUAL(static_cast<int>(result.n_rows), testDofCount);
+        BOOST_CHECK_EQUAL(static_cast<int>(result.n_cols), trialDofCount);
+        BOOST_CHECK(check_arrays_are_close<ResultType>(
+                        result, expected,
+                        100. * std::numeric_limits<CoordinateType>::epsilon()));
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(DefaultTestKernelTrialIntegral)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(matrix_product_contraction_agrees_with_pointwise_evaluation_for_scalar_transformations,
+                              ResultType, result_types)
+{
+    checkMatrixProductContractionAgreesWithPointwiseEvaluation<ResultType>(1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(matrix_product_contraction_agrees_with_pointwise_evaluation_for_vector_transformations,
+                              ResultType, result_types)
+{
+    checkMatrixProductContractionAgreesWithPointwiseEvaluation<ResultType>(3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+// Copyright (C) 2011 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/hermite_interpolator.hpp"
+#include "fiber/initialize_interpolator_for_modified_helmholtz_3d_kernels.hpp"
+#include "assembly/helmholtz_3d_operators_common.hpp"
+
+#include "../type_template.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+#include <complex>
+#include <limits>
+#include <vector>
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(HermiteInterpolator)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluate_agrees_with_exponential_in_whole_range,
+                              ValueType, kernel_types)
+{
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+    const ValueType waveNumber = 2;
+    const CoordinateType maxDist = 5.;
+    Fiber::HermiteInterpolator<ValueType> interpolator;
+    Fiber::initializeInterpolatorForModifiedHelmholtz3dKernels(
+                waveNumber, maxDist,
+                Bempp::DEFAULT_HELMHOLTZ_INTERPOLATION_DENSITY, interpolator);
+
+    const int pointCount = 1001;
+    CoordinateType tol = 1000 * std::numeric_limits<CoordinateType>::epsilon();
+    for (int i = 0; i < pointCount; ++i) {
+        // The last point lies exactly at the end of the range
+        CoordinateType x = maxDist * i / CoordinateType(pointCount - 1);
+        ValueType expected = exp(-waveNumber * x);
+        BOOST_CHECK_SMALL(std::abs(interpolator.evaluate(x) - expected), tol);
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(batched_evaluate_agrees_with_pointwise_evaluate,
+                              ValueType, kernel_types)
+{
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+    const ValueType waveNumber = 1;
+    const CoordinateType maxDist = 20.;
+    Fiber::HermiteInterpolator<ValueType> interpolator;
+    Fiber::initializeInterpolatorForModifiedHelmholtz3dKernels(
+                waveNumber, maxDist,
+                Bempp::DEFAULT_HELMHOLTZ_INTERPOLATION_DENSITY, interpolator);
+
+    const int pointCount = 257;
+    std::vector<CoordinateType> points(pointCount);
+    for (int i = 0; i < pointCount; ++i)
+        points[i] = maxDist * i / CoordinateType(pointCount - 1);
+    std::vector<ValueType> values(pointCount);
+    interpolator.evaluate(&points[0], &values[0], pointCount);
+
+    for (int i = 0; i < pointCount; ++i)
+        BOOST_CHECK_EQUAL(values[i], interpolator.evaluate(points[i]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
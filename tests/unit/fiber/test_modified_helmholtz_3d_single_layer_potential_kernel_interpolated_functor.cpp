@@ -259,4 +259,63 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(agrees_with_noninterpolated_for_complex_wave_numbe
                                                   noninterpResult[0], tol));
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluateOnGrid_agrees_with_evaluateAtPointPairs,
+                              ValueType, kernel_types)
+{
+    typedef Fiber::ModifiedHelmholtz3dSingleLayerPotentialKernelInterpolatedFunctor<ValueType>
+            Functor;
+    typedef Fiber::DefaultCollectionOfKernels<Functor> Kernels;
+    typedef typename Fiber::ScalarTraits<ValueType>::RealType CoordinateType;
+    const ValueType waveNumber = 1;
+    const double maxDist = 20.;
+    Kernels kernels((Functor(waveNumber, maxDist,
+                             Bempp::DEFAULT_HELMHOLTZ_INTERPOLATION_DENSITY)));
+
+    typedef Fiber::GeometricalData<CoordinateType> GeomData;
+
+    const int worldDim = 3;
+    // More test points than are passed to the interpolator at once
+    const int testPointCount = 100, trialPointCount = 3;
+
+    // Collect data with evaluateOnGrid
+    GeomData testGeomDataOnGrid, trialGeomDataOnGrid;
+    testGeomDataOnGrid.globals = 0.5 * maxDist *
+            generateRandomMatrix<CoordinateType>(worldDim, testPointCount);
+    trialGeomDataOnGrid.globals = 0.5 * maxDist *
+            generateRandomMatrix<CoordinateType>(worldDim, trialPointCount);
+
+    Fiber::CollectionOf4dArrays<ValueType> resultOnGrid;
+    kernels.evaluateOnGrid(testGeomDataOnGrid, trialGeomDataOnGrid,
+                           resultOnGrid);
+    arma::Col<ValueType> convertedResultOnGrid(testPointCount * trialPointCount);
+    for (int testPoint = 0; testPoint < testPointCount; ++testPoint)
+        for (int trialPoint = 0; trialPoint < trialPointCount; ++trialPoint)
+            convertedResultOnGrid(testPoint + trialPoint * testPointCount) =
+                    resultOnGrid[0](0, 0, testPoint, trialPoint);
+
+    // Collect data with evaluateAtPointPairs
+    GeomData testGeomDataAtPointPairs, trialGeomDataAtPointPairs;
+    testGeomDataAtPointPairs.globals.set_size(worldDim, testPointCount * trialPointCount);
+    trialGeomDataAtPointPairs.globals.set_size(worldDim, testPointCount * trialPointCount);
+    for (int testPoint = 0; testPoint < testPointCount; ++testPoint)
+        for (int trialPoint = 0; trialPoint < trialPointCount; ++trialPoint) {
+            testGeomDataAtPointPairs.globals.col(testPoint + trialPoint * testPointCount) =
+                    testGeomDataOnGrid.globals.col(testPoint);
+            trialGeomDataAtPointPairs.globals.col(testPoint + trialPoint * testPointCount) =
+                    trialGeomDataOnGrid.globals.col(trialPoint);
+        }
+
+    Fiber::CollectionOf3dArrays<ValueType> resultAtPointPairs;
+    kernels.evaluateAtPointPairs(testGeomDataAtPointPairs, trialGeomDataAtPointPairs,
+                                 resultAtPointPairs);
+    arma::Col<ValueType> convertedResultAtPointPairs(testPointCount * trialPointCount);
+    for (int point = 0; point < testPointCount * trialPointCount; ++point)
+        convertedResultAtPointPairs(point) =
+                resultAtPointPairs[0](0, 0, point);
+
+    CoordinateType tol = 10 * std::numeric_limits<CoordinateType>::epsilon();
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    convertedResultAtPointPairs, convertedResultOnGrid, tol));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
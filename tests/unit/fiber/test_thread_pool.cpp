@@ -0,0 +1,168 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "fiber/parallelization_options.hpp"
+#include "fiber/thread_pool.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <tbb/atomic.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/tbb_thread.h>
+#include <tbb/tick_count.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace
+{
+
+// Records the maximum number of loop iterations executed simultaneously
+class ConcurrencyProbe
+{
+public:
+    ConcurrencyProbe(tbb::atomic<int>& active, tbb::atomic<int>& maxActive) :
+        m_active(active), m_maxActive(maxActive)
+    {
+    }
+
+    void operator() (const tbb::blocked_range<int>& r) const {
+        for (int i = r.begin(); i != r.end(); ++i) {
+            const int active = ++m_active;
+            int maxActive = m_maxActive;
+            while (active > maxActive &&
+                   m_maxActive.compare_and_swap(active, maxActive) != maxActive)
+                maxActive = m_maxActive;
+            tbb::this_tbb_thread::sleep(tbb::tick_count::interval_t(0.002));
+            --m_active;
+        }
+    }
+
+private:
+    tbb::atomic<int>& m_active;
+    tbb::atomic<int>& m_maxActive;
+};
+
+// Run a parallel loop in the way BEM++ operations do and return the
+// maximum number of threads that took part in it simultaneously
+int maxConcurrencyOfParallelLoop(int requestedThreadCount)
+{
+    Fiber::ParallelizationOptions options;
+    options.setMaxThreadCount(requestedThreadCount);
+    Fiber::ScopedScheduler scheduler(options);
+
+    tbb::atomic<int> active, maxActive;
+    active = 0;
+    maxActive = 0;
+    tbb::parallel_for(tbb::blocked_range<int>(0, 128, 1),
+                      ConcurrencyProbe(active, maxActive));
+    return maxActive;
+}
+
+} // namespace
+
+// Tests
+
+BOOST_AUTO_TEST_SUITE(ThreadPool)
+
+BOOST_AUTO_TEST_CASE(thread_pool_overrides_thread_count_of_parallel_loops)
+{
+    BOOST_CHECK(!Fiber::ThreadPool::isInitialized());
+
+    Fiber::ParallelizationOptions poolOptions;
+    poolOptions.setMaxThreadCount(1);
+    Fiber::ThreadPool::initialize(poolOptions);
+    BOOST_CHECK(Fiber::ThreadPool::isInitialized());
+    const int maxConcurrencyWithPool = maxConcurrencyOfParallelLoop(4);
+    Fiber::ThreadPool::finalize();
+    BOOST_CHECK(!Fiber::ThreadPool::isInitialized());
+
+    const int maxConcurrencyWithoutPool = maxConcurrencyOfParallelLoop(4);
+
+    BOOST_CHECK_EQUAL(maxConcurrencyWithPool, 1);
+    BOOST_CHECK(maxConcurrencyWithoutPool > 1);
+    BOOST_CHECK(maxConcurrencyWithoutPool <= 4);
+}
+
+BOOST_AUTO_TEST_CASE(scoped_scheduler_limits_thread_count_of_parallel_loops)
+{
+    BOOST_CHECK_EQUAL(maxConcurrencyOfParallelLoop(1), 1);
+    BOOST_CHECK(maxConcurrencyOfParallelLoop(2) <= 2);
+}
+
+BOOST_AUTO_TEST_CASE(initialize_throws_if_thread_pool_is_already_initialized)
+{
+    Fiber::ParallelizationOptions options;
+    options.setMaxThreadCount(2);
+    Fiber::ThreadPool::initialize(options);
+    BOOST_CHECK_THROW(Fiber::ThreadPool::initialize(options),
+                      std::runtime_error);
+    Fiber::ThreadPool::finalize();
+    BOOST_CHECK(!Fiber::ThreadPool::isInitialized());
+    // finalize() does nothing if the pool is not active
+    BOOST_CHECK_NO_THROW(Fiber::ThreadPool::finalize());
+}
+
+BOOST_AUTO_TEST_CASE(parallel_loops_run_in_thread_pool_with_pinned_threads)
+{
+    Fiber::ParallelizationOptions options;
+    options.setMaxThreadCount(2);
+    options.enableThreadPinning();
+    Fiber::ThreadPool::initialize(options);
+    const int maxConcurrency = maxConcurrencyOfParallelLoop(4);
+    Fiber::ThreadPool::finalize();
+    BOOST_CHECK(maxConcurrency >= 1);
+    BOOST_CHECK(maxConcurrency <= 2);
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(finalize_restores_cpu_affinity_of_pinned_owner_thread)
+{
+    cpu_set_t originalCpuSet;
+    BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(originalCpuSet),
+                                          &originalCpuSet), 0);
+
+    Fiber::ParallelizationOptions options;
+    options.setMaxThreadCount(2);
+    options.enableThreadPinning();
+    Fiber::ThreadPool::initialize(options);
+    maxConcurrencyOfParallelLoop(2);
+
+    // Whatever CPU the owner was bound to must have been allowed before
+    cpu_set_t pinnedCpuSet;
+    BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(pinnedCpuSet),
+                                          &pinnedCpuSet), 0);
+    cpu_set_t outsideCpuSet;
+    CPU_XOR(&outsideCpuSet, &pinnedCpuSet, &originalCpuSet);
+    CPU_AND(&outsideCpuSet, &outsideCpuSet, &pinnedCpuSet);
+    BOOST_CHECK_EQUAL(CPU_COUNT(&outsideCpuSet), 0);
+
+    Fiber::ThreadPool::finalize();
+
+    cpu_set_t restoredCpuSet;
+    BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(restoredCpuSet),
+                                          &restoredCpuSet), 0);
+    BOOST_CHECK(CPU_EQUAL(&restoredCpuSet, &originalCpuSet));
+}
+#endif // __linux__
+
+BOOST_AUTO_TEST_SUITE_END()
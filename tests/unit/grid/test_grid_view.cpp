@@ -22,8 +22,12 @@
 #include "grid/armadillo_helpers.hpp"
 #include "grid/entity.hpp"
 #include "grid/entity_iterator.hpp"
+#include "grid/flat_grid_data.hpp"
 #include "grid/geometry.hpp"
+#include "grid/index_set.hpp"
+#include "grid/mapper.hpp"
 
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
 #include <boost/version.hpp>
 #include "../num_template.hpp"
@@ -296,6 +300,79 @@ BOOST_AUTO_TEST_CASE_NUM_TEMPLATE(containsEntity_returns_true_for_second_entity_
     BOOST_CHECK(bemppGridView->containsEntity(it->entity()));
 }
 
+// flatGridData()
+
+BOOST_AUTO_TEST_CASE(flatGridData_entity_counts_agree_with_entityCount)
+{
+    const FlatGridData& data = bemppGridView->flatGridData();
+    BOOST_CHECK_EQUAL(data.elementCount(), bemppGridView->entityCount(0));
+    BOOST_CHECK_EQUAL(data.edgeCount(), bemppGridView->entityCount(1));
+    BOOST_CHECK_EQUAL(data.vertexCount(), bemppGridView->entityCount(2));
+}
+
+BOOST_AUTO_TEST_CASE(flatGridData_element_vertices_and_edges_agree_with_index_set)
+{
+    const FlatGridData& data = bemppGridView->flatGridData();
+    const IndexSet& indexSet = bemppGridView->indexSet();
+    const Mapper& mapper = bemppGridView->elementMapper();
+
+    std::auto_ptr<EntityIterator<0> > it = bemppGridView->entityIterator<0>();
+    while (!it->finished()) {
+        const Entity<0>& element = it->entity();
+        const int index = mapper.entityIndex(element);
+        const int vertexCount = element.subEntityCount<2>();
+        BOOST_REQUIRE_EQUAL(data.elementCornerCount(index), vertexCount);
+        for (int i = 0; i < vertexCount; ++i)
+            BOOST_CHECK_EQUAL(
+                        data.elementVertices()[data.elementVertexOffsets()[index] + i],
+                        (int) indexSet.subEntityIndex(element, i, 2));
+        const int edgeCount = element.subEntityCount<1>();
+        BOOST_REQUIRE_EQUAL(data.elementEdgeOffsets()[index + 1] -
+                            data.elementEdgeOffsets()[index], edgeCount);
+        for (int i = 0; i < edgeCount; ++i)
+            BOOST_CHECK_EQUAL(
+                        data.elementEdges()[data.elementEdgeOffsets()[index] + i],
+                        (int) indexSet.subEntityIndex(element, i, 1));
+        it->next();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(flatGridData_vertex_elements_are_inverse_of_element_vertices)
+{
+    const FlatGridData& data = bemppGridView->flatGridData();
+    const std::vector<int>& elementVertexOffsets = data.elementVertexOffsets();
+    const std::vector<int>& elementVertices = data.elementVertices();
+    const std::vector<int>& vertexElementOffsets = data.vertexElementOffsets();
+    const std::vector<int>& vertexElements = data.vertexElements();
+
+    BOOST_CHECK_EQUAL(vertexElements.size(), elementVertices.size());
+    for (size_t e = 0; e < data.elementCount(); ++e)
+        for (int i = elementVertexOffsets[e]; i < elementVertexOffsets[e + 1]; ++i) {
+            const int v = elementVertices[i];
+            BOOST_CHECK(std::binary_search(
+                            vertexElements.begin() + vertexElementOffsets[v],
+                            vertexElements.begin() + vertexElementOffsets[v + 1],
+                            (int) e));
+        }
+}
+
+BOOST_AUTO_TEST_CASE(flatGridData_vertex_coordinates_agree_with_geometry)
+{
+    const FlatGridData& data = bemppGridView->flatGridData();
+    const IndexSet& indexSet = bemppGridView->indexSet();
+
+    std::auto_ptr<EntityIterator<2> > it = bemppGridView->entityIterator<2>();
+    arma::Col<double> center;
+    while (!it->finished()) {
+        const Entity<2>& vertex = it->entity();
+        const int index = indexSet.entityIndex(vertex);
+        vertex.geometry().getCenter(center);
+        for (int dim = 0; dim < data.worldDimension(); ++dim)
+            BOOST_CHECK_EQUAL(data.vertexCoordinates(dim)[index], center(dim));
+        it->next();
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -19,7 +19,8 @@ Laplace3dDirichletFixture<BFT, RT>::Laplace3dDirichletFixture(
     SpaceType dirichletDataDomain,
     SpaceType neumannDataDomain,
     SpaceType range,
-    SpaceType dualToRange)
+    SpaceType dualToRange,
+    const AcaOptions* acaOptions)
 {
     GridParameters params;
     params.topology = GridParameters::TRIANGULAR;
@@ -34,6 +35,8 @@ Laplace3dDirichletFixture<BFT, RT>::Laplace3dDirichletFixture(
 
     AssemblyOptions assemblyOptions;
     assemblyOptions.setVerbosityLevel(VerbosityLevel::LOW);
+    if (acaOptions)
+        assemblyOptions.switchToAcaMode(*acaOptions);
     shared_ptr<NumericalQuadratureStrategy<BFT, RT> > quadStrategy(
         new NumericalQuadratureStrategy<BFT, RT>);
     shared_ptr<Context<BFT, RT> > context(
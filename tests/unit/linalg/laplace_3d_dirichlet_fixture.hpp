@@ -23,6 +23,7 @@
 
 #include "common/common.hpp"
 
+#include "assembly/assembly_options.hpp"
 #include "assembly/boundary_operator.hpp"
 #include "assembly/grid_function.hpp"
 
@@ -63,7 +64,8 @@ struct Laplace3dDirichletFixture
         SpaceType dirichletDataDomain = PIECEWISE_LINEARS,
         SpaceType neumannDataDomain = PIECEWISE_CONSTANTS,
         SpaceType range = PIECEWISE_LINEARS,
-        SpaceType dualToRange = PIECEWISE_CONSTANTS);
+        SpaceType dualToRange = PIECEWISE_CONSTANTS,
+        const AcaOptions* acaOptions = 0 /* dense mode */);
 
     shared_ptr<Grid> grid;
     BoundaryOperator<BFT, RT> lhsOp;
@@ -25,6 +25,9 @@
 
 #include "assembly/blocked_boundary_operator.hpp"
 #include "assembly/blocked_operator_structure.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "assembly/laplace_3d_single_layer_boundary_operator.hpp"
+#include "assembly/symmetry.hpp"
 #include "linalg/default_direct_solver.hpp"
 
 #include <boost/test/unit_test.hpp>
@@ -165,4 +168,117 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(boundary_operator_agrees_with_2x2_blocked_boundary
     }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(solve_batch_agrees_with_repeated_solve,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+    DirectSolver solver(fixture.lhsOp);
+
+    std::vector<GridFunction<BFT, RT> > rhsBatch;
+    rhsBatch.push_back(fixture.rhs);
+    rhsBatch.push_back(2. * fixture.rhs);
+    rhsBatch.push_back(-3. * fixture.rhs);
+
+    std::vector<Solution<BFT, RT> > batchSolutions = solver.solveBatch(rhsBatch);
+    BOOST_REQUIRE_EQUAL(batchSolutions.size(), rhsBatch.size());
+
+    for (size_t i = 0; i < rhsBatch.size(); ++i) {
+        // Reuses the factorization computed by solveBatch()
+        Solution<BFT, RT> solution = solver.solve(rhsBatch[i]);
+        BOOST_CHECK(check_arrays_are_close<ValueType>(
+                        solution.gridFunction().coefficients(),
+                        batchSolutions[i].gridFunction().coefficients(),
+                        solverTol));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(solve_agrees_with_dense_reference_solution,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    // Reference solution obtained independently of the cached factorization
+    arma::Col<RT> expected = arma::solve(
+                fixture.lhsOp.weakForm()->asMatrix(),
+                fixture.rhs.projections(*fixture.lhsOp.dualToRange()));
+
+    DirectSolver solver(fixture.lhsOp);
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solution.gridFunction().coefficients(), expected,
+                    solverTol * 10));
+
+    std::vector<GridFunction<BFT, RT> > rhsBatch;
+    rhsBatch.push_back(fixture.rhs);
+    rhsBatch.push_back(2. * fixture.rhs);
+    std::vector<Solution<BFT, RT> > batchSolutions = solver.solveBatch(rhsBatch);
+    BOOST_REQUIRE_EQUAL(batchSolutions.size(), rhsBatch.size());
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    batchSolutions[0].gridFunction().coefficients(), expected,
+                    solverTol * 10));
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    arma::Col<RT>(batchSolutions[1].gridFunction().coefficients() / 2.),
+                    expected, solverTol * 10));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(symmetric_operator_solution_agrees_with_dense_reference_solution,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultDirectSolver<BFT, RT> DirectSolver;
+    const RealType solverTol = 1e-5;
+
+    // The single-layer operator acting on piecewise constants, tested with
+    // piecewise constants, has a symmetric weak form
+    Laplace3dDirichletFixture<BFT, RT> fixture(
+                PIECEWISE_LINEARS, PIECEWISE_CONSTANTS,
+                PIECEWISE_CONSTANTS, PIECEWISE_CONSTANTS);
+    BoundaryOperator<BFT, RT> symmetricOp =
+            laplace3dSingleLayerBoundaryOperator<BFT, RT>(
+                fixture.lhsOp.context(), fixture.lhsOp.domain(),
+                fixture.lhsOp.range(), fixture.lhsOp.dualToRange(),
+                "", SYMMETRIC);
+    BOOST_REQUIRE(symmetricOp.abstractOperator()->symmetry() & SYMMETRIC);
+
+    arma::Col<RT> expected = arma::solve(
+                fixture.lhsOp.weakForm()->asMatrix(),
+                fixture.rhs.projections(*fixture.lhsOp.dualToRange()));
+
+    // Factorized with sytrf
+    DirectSolver solver(symmetricOp);
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    solution.gridFunction().coefficients(), expected,
+                    solverTol * 10));
+
+    std::vector<GridFunction<BFT, RT> > rhsBatch;
+    rhsBatch.push_back(fixture.rhs);
+    rhsBatch.push_back(-3. * fixture.rhs);
+    std::vector<Solution<BFT, RT> > batchSolutions = solver.solveBatch(rhsBatch);
+    BOOST_REQUIRE_EQUAL(batchSolutions.size(), rhsBatch.size());
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    batchSolutions[0].gridFunction().coefficients(), expected,
+                    solverTol * 10));
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    arma::Col<RT>(batchSolutions[1].gridFunction().coefficients() / -3.),
+                    expected, solverTol * 10));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -18,23 +18,27 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include "bempp/common/config_ahmed.hpp"
 #include "bempp/common/config_trilinos.hpp"
 
 #ifdef WITH_TRILINOS
 
 #include "../type_template.hpp"
 #include "../check_arrays_are_close.hpp"
+#include "../random_arrays.hpp"
 
 #include "laplace_3d_dirichlet_fixture.hpp"
 
 #include "assembly/blocked_boundary_operator.hpp"
 #include "assembly/blocked_operator_structure.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
 #include "linalg/default_iterative_solver.hpp"
 #include "linalg/solver.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 #include <boost/type_traits/is_complex.hpp>
+#include <limits>
 
 using namespace Bempp;
 
@@ -355,6 +359,158 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(boundary_operator_agrees_with_2x2_blocked_boundary
     }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(block_gmres_solve_batch_agrees_with_dense_reference_solutions,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultIterativeSolver<BFT, RT> IterSolver;
+    const RealType solverTol = 1e-5;
+
+    std::srand(1);
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    // Block GMRES needs linearly independent right-hand sides
+    std::vector<GridFunction<BFT, RT> > rhsBatch;
+    rhsBatch.push_back(fixture.rhs);
+    rhsBatch.push_back(GridFunction<BFT, RT>(
+                           fixture.lhsOp.context(), fixture.lhsOp.range(),
+                           generateRandomVector<RT>(
+                               fixture.lhsOp.range()->globalDofCount())));
+
+    const arma::Mat<RT> weakForm = fixture.lhsOp.weakForm()->asMatrix();
+    std::vector<arma::Col<RT> > expected;
+    for (size_t i = 0; i < rhsBatch.size(); ++i)
+        expected.push_back(arma::solve(
+                               weakForm,
+                               rhsBatch[i].projections(
+                                   *fixture.lhsOp.dualToRange())));
+
+    ConvergenceTestMode::Mode modes[] = {
+        ConvergenceTestMode::TEST_CONVERGENCE_IN_DUAL_TO_RANGE,
+        ConvergenceTestMode::TEST_CONVERGENCE_IN_RANGE
+    };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+        IterSolver solver(fixture.lhsOp, modes[m]);
+        solver.initializeSolver(defaultBlockGmresParameterList(
+                                    solverTol, rhsBatch.size()));
+
+        std::vector<Solution<BFT, RT> > batchSolutions =
+                solver.solveBatch(rhsBatch);
+        BOOST_REQUIRE_EQUAL(batchSolutions.size(), rhsBatch.size());
+
+        for (size_t i = 0; i < rhsBatch.size(); ++i) {
+            BOOST_CHECK_EQUAL(batchSolutions[i].status(),
+                              SolutionStatus::CONVERGED);
+            BOOST_CHECK(check_arrays_are_close<ValueType>(
+                            batchSolutions[i].gridFunction().coefficients(),
+                            expected[i], solverTol * 100));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(iterative_refinement_reaches_requested_tolerance_with_loose_inner_solves,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultIterativeSolver<BFT, RT> IterSolver;
+    const RealType solverTol = 1e-5;
+    const RealType innerSolverTol = 1e-2;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    IterSolver referenceSolver(fixture.lhsOp);
+    referenceSolver.initializeSolver(defaultGmresParameterList(solverTol));
+    Solution<BFT, RT> referenceSolution = referenceSolver.solve(fixture.rhs);
+
+    IterSolver solver(fixture.lhsOp);
+    BOOST_CHECK(!solver.isIterativeRefinementEnabled());
+    solver.initializeSolver(defaultGmresParameterList(innerSolverTol));
+    solver.enableIterativeRefinement(solverTol);
+    BOOST_CHECK(solver.isIterativeRefinementEnabled());
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+
+    BOOST_CHECK_EQUAL(solution.status(), SolutionStatus::CONVERGED);
+    BOOST_CHECK(solution.achievedTolerance() <= solverTol);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    referenceSolution.gridFunction().coefficients(),
+                    solution.gridFunction().coefficients(),
+                    solverTol * 100));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(enableIterativeRefinement_rejects_tolerances_below_accuracy_of_weak_form,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultIterativeSolver<BFT, RT> IterSolver;
+
+    Laplace3dDirichletFixture<BFT, RT> fixture;
+
+    IterSolver solver(fixture.lhsOp);
+    BOOST_CHECK_EQUAL(solver.minimumRefinementTolerance(),
+                      10. * std::numeric_limits<RealType>::epsilon());
+    BOOST_CHECK_THROW(solver.enableIterativeRefinement(
+                          0.5 * solver.minimumRefinementTolerance()),
+                      std::invalid_argument);
+    BOOST_CHECK(!solver.isIterativeRefinementEnabled());
+}
+
+#ifdef WITH_AHMED
+BOOST_AUTO_TEST_CASE_TEMPLATE(iterative_refinement_converges_for_weak_form_stored_in_single_precision,
+                              ValueType, result_types)
+{
+    typedef ValueType RT;
+    typedef typename ScalarTraits<ValueType>::RealType RealType;
+    typedef RealType BFT;
+
+    typedef Bempp::DefaultIterativeSolver<BFT, RT> IterSolver;
+    const RealType solverTol = 1e-5;
+    const RealType innerSolverTol = 1e-2;
+
+    AcaOptions acaOptions;
+    acaOptions.minimumBlockSize = 2;
+    Laplace3dDirichletFixture<BFT, RT> referenceFixture(
+        PIECEWISE_LINEARS, PIECEWISE_CONSTANTS, PIECEWISE_LINEARS,
+        PIECEWISE_CONSTANTS, &acaOptions);
+    acaOptions.singlePrecisionStorage = true;
+    Laplace3dDirichletFixture<BFT, RT> fixture(
+        PIECEWISE_LINEARS, PIECEWISE_CONSTANTS, PIECEWISE_LINEARS,
+        PIECEWISE_CONSTANTS, &acaOptions);
+
+    IterSolver referenceSolver(referenceFixture.lhsOp);
+    referenceSolver.initializeSolver(defaultGmresParameterList(solverTol));
+    Solution<BFT, RT> referenceSolution =
+            referenceSolver.solve(referenceFixture.rhs);
+
+    IterSolver solver(fixture.lhsOp);
+    // Residuals computed with a single-precision weak form are accurate only
+    // to about 1e-7
+    BOOST_CHECK_EQUAL(solver.minimumRefinementTolerance(),
+                      10. * std::numeric_limits<float>::epsilon());
+    BOOST_CHECK_THROW(solver.enableIterativeRefinement(1e-10),
+                      std::invalid_argument);
+    solver.initializeSolver(defaultGmresParameterList(innerSolverTol));
+    solver.enableIterativeRefinement(solverTol);
+    Solution<BFT, RT> solution = solver.solve(fixture.rhs);
+
+    BOOST_CHECK_EQUAL(solution.status(), SolutionStatus::CONVERGED);
+    BOOST_CHECK(solution.achievedTolerance() <= solverTol);
+    BOOST_CHECK(check_arrays_are_close<ValueType>(
+                    referenceSolution.gridFunction().coefficients(),
+                    solution.gridFunction().coefficients(),
+                    solverTol * 100));
+}
+#endif // WITH_AHMED
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif